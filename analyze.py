@@ -9,6 +9,13 @@ def format_latency(us):
     if us < 1e6: return f"{us/1000:.3f} ms"
     return f"{us/1e6:.6f} s"
 
+def read_run_id(path):
+    with open(path) as f:
+        first = f.readline().strip()
+    if first.startswith('# run_id='):
+        return first.split('=', 1)[1]
+    return None
+
 def main():
     if len(sys.argv) < 3:
         print("Usage: python3 analyze.py <sender.csv> <receiver.csv>")
@@ -19,8 +26,11 @@ def main():
         print("Error: missing file(s).")
         sys.exit(1)
 
-    sender = pd.read_csv(sfile)
-    receiver = pd.read_csv(rfile)
+    sender = pd.read_csv(sfile, comment='#')
+    receiver = pd.read_csv(rfile, comment='#')
+    send_run, recv_run = read_run_id(sfile), read_run_id(rfile)
+    if send_run and recv_run and send_run != recv_run:
+        print(f"Warning: run ID mismatch (sender {send_run}, receiver {recv_run})")
     if 'seq' not in receiver.columns:
         raise SystemExit("Receiver CSV missing 'seq' column")
     receiver = receiver.sort_values(['seq', 'recv_ts_ns' if 'recv_ts_ns' in receiver.columns else receiver.columns[1]])
@@ -36,14 +46,27 @@ def main():
     # safe merge on seq
     df = pd.merge(sender, receiver[['seq','recv_ts_ns']], on='seq', how='outer', suffixes=('_send','_recv'))
     if 'send_ts_ns' in sender.columns and 'recv_ts_ns' in receiver.columns:
-        df = pd.merge(sender[['seq','send_ts_ns']], receiver[['seq','recv_ts_ns']], on='seq', how='outer')
+        recv_cols = ['seq','recv_ts_ns'] + (['clock_offset_ns'] if 'clock_offset_ns' in receiver.columns else [])
+        send_cols = ['seq','send_ts_ns'] + (['intended_ts_ns'] if 'intended_ts_ns' in sender.columns else [])
+        df = pd.merge(sender[send_cols], receiver[recv_cols], on='seq', how='outer')
         df['oneway_us'] = (df['recv_ts_ns'] - df['send_ts_ns']) / 1000.0
+        if 'clock_offset_ns' in df.columns:
+            # Receiver logged the (receiver - sender) clock offset it applied.
+            df['oneway_us'] -= df['clock_offset_ns'] / 1000.0
+        if 'intended_ts_ns' in df.columns:
+            # Backlog between the scheduled and actual send counts as latency.
+            df['oneway_co_us'] = df['oneway_us'] + (df['send_ts_ns'] - df['intended_ts_ns']) / 1000.0
+        negative = int((df['oneway_us'] < 0).sum())
+        if negative > 0:
+            print(f"Warning: {negative:,} negative one-way samples excluded (clock offset error)")
         df.loc[df['oneway_us'] < 0, 'oneway_us'] = np.nan
     else:
         df['oneway_us'] = np.nan
     if 'ack_recv_ts_ns' in sender.columns:
         sender['rtt_us'] = (sender['ack_recv_ts_ns'] - sender['send_ts_ns']) / 1000.0
         sender.loc[sender['rtt_us'] <= 0, 'rtt_us'] = np.nan
+        if 'intended_ts_ns' in sender.columns:
+            sender['rtt_co_us'] = sender['rtt_us'] + (sender['send_ts_ns'] - sender['intended_ts_ns']) / 1000.0
     else:
         sender['rtt_us'] = np.nan
 
@@ -72,6 +95,42 @@ def main():
         print(f"  p99.9: {format_latency(pct(a,99.9))}")
         print(f"  Max: {format_latency(np.nanmax(a))}")
 
+    if 'oneway_co_us' in df.columns and df['oneway_co_us'].notna().sum() > 0:
+        c = df.loc[df['oneway_us'].notna(), 'oneway_co_us'].dropna().values
+        print("\nOne-way latency from intended send time (coordinated omission corrected):")
+        print(f"  Median (p50): {format_latency(np.nanpercentile(c,50))}")
+        print(f"  p99: {format_latency(np.nanpercentile(c,99))}")
+        print(f"  p99.9: {format_latency(np.nanpercentile(c,99.9))}")
+        print(f"  Max: {format_latency(np.nanmax(c))}")
+
+    # Latency stages from kernel timestamps (--kernel-timestamps 1); a 0 stamp is missing.
+    if 'tx_ts_ns' in sender.columns and 'kernel_rx_ts_ns' in receiver.columns:
+        send_cols = ['seq','send_ts_ns','tx_sched_ts_ns','tx_ts_ns'] + (['retransmits'] if 'retransmits' in sender.columns else [])
+        k = pd.merge(sender[send_cols], receiver[['seq','recv_ts_ns','kernel_rx_ts_ns','clock_offset_ns']], on='seq')
+        k = k[(k['tx_ts_ns'] > 0) & (k['kernel_rx_ts_ns'] > 0)]
+        if 'retransmits' in k.columns:
+            k = k[k['retransmits'] == 0]
+        stages = [
+            ("app -> qdisc (TX_SCHED)", (k['tx_sched_ts_ns'] - k['send_ts_ns']).where(k['tx_sched_ts_ns'] > 0)),
+            ("qdisc -> device (TX_SOFTWARE)", (k['tx_ts_ns'] - k['tx_sched_ts_ns']).where(k['tx_sched_ts_ns'] > 0)),
+            ("app -> kernel TX", k['tx_ts_ns'] - k['send_ts_ns']),
+            ("kernel TX -> kernel RX", k['kernel_rx_ts_ns'] - k['tx_ts_ns'] - k['clock_offset_ns']),
+            ("kernel RX -> app", k['recv_ts_ns'] - k['kernel_rx_ts_ns']),
+        ]
+        print("\nLatency stages (kernel timestamps):")
+        print(f"  Packets: {len(k):,}")
+        for name, ns in stages:
+            s = ns.dropna()
+            negative = int((s < 0).sum())
+            s = s[s >= 0].values / 1000.0
+            if len(s) == 0:
+                continue
+            line = (f"  {name}: p50 {format_latency(np.percentile(s,50))}, p99 {format_latency(np.percentile(s,99))}, "
+                    f"p99.9 {format_latency(np.percentile(s,99.9))}")
+            if negative > 0:
+                line += f" ({negative:,} negative excluded)"
+            print(line)
+
     # RTT stats
     if sender['rtt_us'].notna().sum() > 0:
         b = sender['rtt_us'].dropna().values
@@ -80,6 +139,9 @@ def main():
         print(f"  Median (p50): {format_latency(np.nanpercentile(b,50))}")
         print(f"  p99: {format_latency(np.nanpercentile(b,99))}")
         print(f"  Max: {format_latency(np.nanmax(b))}")
+        if 'rtt_co_us' in sender.columns:
+            d = sender.loc[sender['rtt_us'].notna(), 'rtt_co_us'].values
+            print(f"  Corrected p99 / p99.9: {format_latency(np.nanpercentile(d,99))} / {format_latency(np.nanpercentile(d,99.9))}")
 
     # Throughput based on receiver timestamps (unique)
     if 'recv_ts_ns' in receiver.columns and len(receiver) > 1:
@@ -0,0 +1,459 @@
+#include "udp_benchmark/packet.hpp"
+#include "udp_benchmark/reliability.hpp"
+#include "udp_benchmark/stats.hpp"
+#include "udp_benchmark/trace.hpp"
+#include "udp_benchmark/live_stats.hpp"
+#include "udp_benchmark/interval_log.hpp"
+#include "udp_benchmark/fec.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace udp_benchmark;
+
+
+// Every heap allocation in the process goes through here, so allocs/op is exact.
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+
+namespace {
+
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+struct BenchResult {
+    std::string name;
+    uint64_t ops = 0;
+    double ns_per_op = 0;
+    double min_ns_per_op = 0;
+    double allocs_per_op = 0;
+};
+
+struct BenchOptions {
+    int reps = 5;
+    double scale = 1.0;
+    std::string filter;
+    std::string json_path;
+};
+
+BenchOptions g_options;
+std::vector<BenchResult> g_results;
+
+
+uint64_t scaled(uint64_t ops) {
+    return std::max<uint64_t>(1, static_cast<uint64_t>(ops * g_options.scale));
+}
+
+
+// Runs body(ops) once to warm up, then reps times; reports the median.
+void measure(const std::string& name, uint64_t ops, const std::function<void(uint64_t)>& body) {
+    if (!g_options.filter.empty() && name.find(g_options.filter) == std::string::npos) {
+        return;
+    }
+    body(ops);
+
+    std::vector<double> samples;
+    uint64_t allocations = 0;
+    for (int rep = 0; rep < g_options.reps; ++rep) {
+        uint64_t allocs_before = g_allocations.load(std::memory_order_relaxed);
+        timestamp_t start = get_timestamp_ns();
+        body(ops);
+        timestamp_t end = get_timestamp_ns();
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocs_before;
+        samples.push_back(static_cast<double>(end - start) / ops);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.ops = ops;
+    result.ns_per_op = samples[samples.size() / 2];
+    result.min_ns_per_op = samples.front();
+    result.allocs_per_op = static_cast<double>(allocations) / (ops * g_options.reps);
+    g_results.push_back(result);
+
+    std::cout << "  " << std::left << std::setw(48) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << result.ns_per_op << " ns/op"
+              << std::setw(10) << result.min_ns_per_op << " min"
+              << std::setprecision(3) << std::setw(10) << result.allocs_per_op << " allocs/op\n";
+}
+
+
+// "reorder" displaces 2% of packets by up to 3 places; "loss" drops 1%.
+enum class Pattern { IN_ORDER, REORDER, LOSS };
+
+const char* pattern_name(Pattern pattern) {
+    switch (pattern) {
+        case Pattern::IN_ORDER: return "in_order";
+        case Pattern::REORDER: return "reorder_2pct";
+        case Pattern::LOSS: return "loss_1pct";
+    }
+    return "";
+}
+
+std::vector<sequence_t> make_arrival_order(uint64_t n, Pattern pattern) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::vector<sequence_t> order;
+    order.reserve(n);
+    for (sequence_t seq = 1; seq <= n; ++seq) {
+        order.push_back(seq);
+    }
+
+    if (pattern == Pattern::REORDER) {
+        for (size_t i = 0; i + 3 < order.size(); ++i) {
+            if (coin(rng) < 0.02) {
+                std::swap(order[i], order[i + 1 + rng() % 3]);
+            }
+        }
+    } else if (pattern == Pattern::LOSS) {
+        std::vector<sequence_t> delivered;
+        delivered.reserve(n);
+        std::vector<std::pair<size_t, sequence_t>> retransmits;
+        for (sequence_t seq : order) {
+            while (!retransmits.empty() && retransmits.front().first <= delivered.size()) {
+                delivered.push_back(retransmits.front().second);
+                retransmits.erase(retransmits.begin());
+            }
+            if (coin(rng) < 0.01) {
+                retransmits.emplace_back(delivered.size() + 64, seq);
+            } else {
+                delivered.push_back(seq);
+            }
+        }
+        for (const auto& retransmit : retransmits) {
+            delivered.push_back(retransmit.second);
+        }
+        order.swap(delivered);
+    }
+    return order;
+}
+
+
+void bench_clock() {
+    init_time_source(false);
+    measure("clock/get_timestamp_ns_steady_clock", scaled(10000000), [](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            do_not_optimize(get_timestamp_ns());
+        }
+    });
+
+    if (init_time_source(true)) {
+        measure("clock/get_timestamp_ns_tsc", scaled(10000000), [](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                do_not_optimize(get_timestamp_ns());
+            }
+        });
+    }
+}
+
+
+void bench_packet() {
+    Packet packet = PacketHandler::create_data_packet(123456, get_timestamp_ns(), 128, get_timestamp_ns());
+    measure("packet/parse_data_packet", scaled(5000000), [&](uint64_t ops) {
+        sequence_t seq;
+        timestamp_t ts;
+        timestamp_t intended_ts;
+        for (uint64_t i = 0; i < ops; ++i) {
+            do_not_optimize(packet.data());
+            PacketHandler::parse_data_packet(packet.data(), packet.size(), seq, ts, &intended_ts);
+            do_not_optimize(seq);
+            do_not_optimize(ts);
+        }
+    });
+
+    measure("packet/create_data_packet", scaled(2000000), [&](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            Packet p = PacketHandler::create_data_packet(i, i, 128, i);
+            do_not_optimize(p.data());
+        }
+    });
+
+
+    for (size_t holes : {0, 4, 32}) {
+        std::vector<sequence_t> missing;
+        for (size_t i = 0; i < holes; ++i) {
+            missing.push_back(1001 + i * (config::DEFAULT_WINDOW_SIZE / (holes + 1)));
+        }
+        AckTimestamps timestamps{1, 2, 3};
+
+        measure("ack/create_ack_packet/holes_" + std::to_string(holes), scaled(1000000), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                AckPacket ack = PacketHandler::create_ack_packet(1000, missing, config::DEFAULT_WINDOW_SIZE,
+                                                                 50, timestamps);
+                do_not_optimize(ack.data());
+            }
+        });
+
+        AckPacket ack = PacketHandler::create_ack_packet(1000, missing, config::DEFAULT_WINDOW_SIZE, 50, timestamps);
+        measure("ack/parse_ack_packet/holes_" + std::to_string(holes), scaled(1000000), [&](uint64_t ops) {
+            sequence_t ack_seq;
+            sequence_t window_end;
+            uint32_t ack_delay_us;
+            AckTimestamps parsed;
+            std::vector<sequence_t> parsed_missing;
+            for (uint64_t i = 0; i < ops; ++i) {
+                PacketHandler::parse_ack_packet(ack.data(), ack.size(), ack_seq, parsed_missing,
+                                                &ack_delay_us, &window_end, &parsed);
+                do_not_optimize(parsed_missing.data());
+            }
+        });
+    }
+}
+
+
+void bench_ack_manager() {
+    for (Pattern pattern : {Pattern::IN_ORDER, Pattern::REORDER, Pattern::LOSS}) {
+        std::vector<sequence_t> order = make_arrival_order(scaled(1000000), pattern);
+        std::string suffix = pattern_name(pattern);
+
+        AckManager add_only;
+        sequence_t base = 0;
+        measure("ack_manager/add_received_packet/" + suffix, order.size(), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                add_only.add_received_packet(base + order[i], i + 1, i + 1);
+            }
+            base += ops;
+        });
+
+        AckManager receive_path;
+        sequence_t path_base = 0;
+        measure("ack_manager/add+generate_ack/" + suffix, order.size(), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                timestamp_t now = i + 1;
+                receive_path.add_received_packet(path_base + order[i], now, now);
+                if (receive_path.should_send_ack(now)) {
+                    AckPacket ack = receive_path.generate_ack(now);
+                    do_not_optimize(ack.data());
+                }
+            }
+            path_base += ops;
+        });
+    }
+}
+
+
+// Steady state with `window` packets in flight.
+void bench_reliability() {
+    for (Pattern pattern : {Pattern::IN_ORDER, Pattern::LOSS}) {
+        for (sequence_t window : {64, 256, 1024}) {
+            ReliabilityManager manager;
+            uint64_t acked = 0;
+            manager.set_ack_callback([&](sequence_t, timestamp_t, timestamp_t, int, timestamp_t) { ++acked; });
+
+            sequence_t next_seq = 1;
+            for (; next_seq <= window; ++next_seq) {
+                manager.add_pending_packet(next_seq, get_timestamp_ns());
+            }
+
+            std::vector<sequence_t> missing;
+            missing.reserve(window);
+            std::string name = "reliability/process_ack/" + std::string(pattern_name(pattern)) +
+                               "/window_" + std::to_string(window);
+            measure(name, scaled(32000000 / window), [&](uint64_t ops) {
+                for (uint64_t i = 0; i < ops; ++i, ++next_seq) {
+                    timestamp_t now = get_timestamp_ns();
+                    manager.add_pending_packet(next_seq, now);
+
+                    sequence_t ack_seq = next_seq - window;
+                    missing.clear();
+                    if (pattern == Pattern::LOSS) {
+                        for (sequence_t seq = (ack_seq / 97 + 1) * 97; seq <= next_seq; seq += 97) {
+                            missing.push_back(seq);
+                        }
+                    }
+                    manager.process_ack(ack_seq, missing, next_seq);
+                }
+            });
+            do_not_optimize(acked);
+        }
+    }
+}
+
+
+void bench_stats() {
+    LatencyStats stats;
+    uint64_t total = scaled(10000000) * (g_options.reps + 1);
+    stats.latencies.reserve(std::min<uint64_t>(total, config::MAX_PREALLOCATED_SAMPLES));
+    measure("stats/latency_stats_add_latency", scaled(10000000), [&](uint64_t ops) {
+        if (stats.latencies.size() + ops > stats.latencies.capacity()) {
+            stats.reset();
+        }
+        for (uint64_t i = 0; i < ops; ++i) {
+            stats.add_latency(10000 + (i & 0xfff));
+        }
+    });
+
+
+    LatencyLogger sender_log("/dev/null");
+    measure("stats/latency_logger_sender_row", scaled(2000000), [&](uint64_t ops) {
+        timestamp_t now = get_timestamp_ns();
+        for (uint64_t i = 0; i < ops; ++i) {
+            sender_log.log_sender_data(i, now + i, now + i + 25000, 0, now + i);
+        }
+    });
+
+    LatencyLogger receiver_log("/dev/null");
+    measure("stats/latency_logger_receiver_row", scaled(2000000), [&](uint64_t ops) {
+        timestamp_t now = get_timestamp_ns();
+        for (uint64_t i = 0; i < ops; ++i) {
+            receiver_log.log_receiver_data(i, now + i + 12000, now + i, -1500, now + i);
+        }
+    });
+}
+
+
+// Calls the tracer directly, since the macros may be compiled out.
+void bench_trace() {
+    Tracer::enable("/dev/null");
+    measure("trace/record_instant", scaled(10000000), [](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            timestamp_t now = get_timestamp_ns();
+            Tracer::record(TraceEvent::SEND, now, now, i, 64);
+        }
+    });
+}
+
+void bench_live_stats() {
+    LiveStats live_stats;
+    if (!live_stats.create("micro_bench." + std::to_string(getpid()), LiveRole::RECEIVER, 0, 0)) {
+        return;
+    }
+    LiveStatsWriter writer = live_stats.add_section("bench");
+    measure("live_stats/publish_packet", scaled(10000000), [&](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            LiveValues* live = writer.begin();
+            live->packets_received++;
+            live->bytes_received += 64;
+            writer.add_latency(live, i * 100, 20000 + (i & 1023));
+            writer.end();
+        }
+    });
+}
+
+void bench_interval_log() {
+    IntervalRecorder recorder;
+    measure("interval_log/record", scaled(10000000), [&](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            recorder.add_packet(64);
+            recorder.add_latency(20000 + (i & 1023));
+        }
+    });
+}
+
+void bench_fec() {
+    std::vector<uint8_t> src(1472);
+    std::vector<uint8_t> dst(1472);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    measure(std::string("fec/gf256_mul_add_region_1472/") + Gf256::get_simd_name(), scaled(2000000),
+            [&](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            Gf256::mul_add_region(dst.data(), src.data(), static_cast<uint8_t>(i | 2), src.size());
+            do_not_optimize(dst.data());
+        }
+    });
+
+    for (uint32_t parity : {1u, 2u}) {
+        FecCode code;
+        code.data = 10;
+        code.parity = parity;
+        FecEncoder encoder;
+        encoder.set_code(code);
+        std::vector<Packet> out;
+        out.reserve(parity);
+        measure("fec/encode_1024/10_" + std::to_string(parity), scaled(1000000), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                encoder.add(i + 1, src.data(), 1024, out);
+                do_not_optimize(out.data());
+                out.clear();
+            }
+        });
+    }
+}
+
+
+bool write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"reps\": " << g_options.reps << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        const BenchResult& r = g_results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+            << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"min_ns_per_op\": " << r.min_ns_per_op
+            << ", \"allocs_per_op\": " << r.allocs_per_op << "}"
+            << (i + 1 < g_results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            g_options.json_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            g_options.filter = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--reps") == 0) {
+            g_options.reps = std::max(1, std::atoi(argv[i + 1]));
+        } else if (std::strcmp(argv[i], "--scale") == 0) {
+            g_options.scale = std::atof(argv[i + 1]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--json out.json] [--filter SUBSTR] [--reps N] [--scale F]\n";
+            return 1;
+        }
+    }
+    if (g_options.scale <= 0) {
+        g_options.scale = 1.0;
+    }
+
+    std::cout << "Hot-path micro-benchmarks (median of " << g_options.reps << " reps):\n";
+    bench_clock();
+    bench_packet();
+    bench_ack_manager();
+    bench_reliability();
+    bench_stats();
+    bench_trace();
+    bench_live_stats();
+    bench_interval_log();
+    bench_fec();
+
+    if (!g_options.json_path.empty() && write_json(g_options.json_path)) {
+        std::cout << "Results written to " << g_options.json_path << "\n";
+    }
+    return 0;
+}
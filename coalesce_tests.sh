@@ -0,0 +1,80 @@
+set -e
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+# Runs the same load once without coalescing and once per hold time, and
+# tabulates the hold delay each setting adds against the datagrams it saves.
+# RATE=0 sends as fast as possible, which shows the messages/sec gain.
+MSG_SIZE=${1:-32}
+RATE=${2:-20000}
+TOTAL=${3:-100000}
+HOLDS=${HOLDS:-"0 10 50 200 1000"}
+BYTES=${BYTES:-1472}
+PORT=9000
+RESULTS_DIR="coalesce_results/$(date +%Y%m%d_%H%M%S)"
+
+mkdir -p "$RESULTS_DIR"
+
+echo -e "${GREEN}Coalescing Test Suite${NC}"
+echo "Message size: $MSG_SIZE bytes, rate: $RATE msgs/sec, total: $TOTAL, datagram limit: $BYTES bytes"
+echo "Results: $RESULTS_DIR"
+echo ""
+
+run_coalesce_test() {
+    local test_name=$1
+    shift
+
+    echo -e "${YELLOW}Running: $test_name${NC}"
+    TEST_DIR="$RESULTS_DIR/$test_name"
+    mkdir -p "$TEST_DIR"
+
+    ./udp_receiver $PORT "$TEST_DIR/recv.csv" > "$TEST_DIR/receiver.txt" 2>&1 &
+    RECV_PID=$!
+    sleep 1
+
+    ./udp_sender 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/send.csv" "$@" > "$TEST_DIR/sender.txt" 2>/dev/null
+
+    for i in $(seq 1 50); do
+        kill -0 $RECV_PID 2>/dev/null || break
+        sleep 0.1
+    done
+    kill $RECV_PID 2>/dev/null || true
+    wait $RECV_PID 2>/dev/null || true
+}
+
+# Pulls one row out of a run's sender and receiver summaries.
+summarize() {
+    local test_name=$1
+    local dir="$RESULTS_DIR/$test_name"
+    tr '\r' '\n' < "$dir/sender.txt" | awk -v name="$test_name" -v recv="$dir/receiver.txt" '
+        /^  Packet rate:/ && !coalesced { msgs = $3; datagrams = $3 }
+        /^  Messages: .* per datagram/ { coalesced = 1; per = $6; gsub(/\(/, "", per) }
+        /^  Rate: .* datagrams\/sec/ { msgs = $2; datagrams = $5 }
+        /^  Hold delay:/ { hold50 = $7; hold99 = $10 }
+        END {
+            while ((getline line < recv) > 0) {
+                if (line ~ /^  p50:/ && lat50 == "") { split(line, f, " "); lat50 = f[2] }
+                if (line ~ /^  p99:/ && lat99 == "") { split(line, f, " "); lat99 = f[2] }
+            }
+            printf "%-10s %10s %12s %14s %10s %10s %10s %10s\n", name, (per == "" ? "1.00" : per),
+                   msgs, datagrams, (hold50 == "" ? "0" : hold50), (hold99 == "" ? "0" : hold99), lat50, lat99
+        }'
+}
+
+run_coalesce_test "off"
+for hold in $HOLDS; do
+    run_coalesce_test "hold_${hold}us" --coalesce-us "$hold" --coalesce-bytes "$BYTES"
+done
+
+{
+    printf "%-10s %10s %12s %14s %10s %10s %10s %10s\n" "setting" "msgs/dgram" "msgs/sec" "datagrams/sec" \
+           "hold p50" "hold p99" "p50 (us)" "p99 (us)"
+    summarize "off"
+    for hold in $HOLDS; do
+        summarize "hold_${hold}us"
+    done
+} | tee "$RESULTS_DIR/summary.txt"
+
+echo -e "${GREEN}✅ All tests complete!${NC}"
+echo "Results saved to: $RESULTS_DIR"
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.hpp"
+#include <array>
+
+namespace udp_benchmark {
+
+
+// The true offset lies within offset_ns +/- uncertainty_ns.
+struct ClockEstimate {
+    timestamp_t ref_ts = 0;
+    int64_t offset_ns = 0;
+    int64_t drift_ppb = 0;
+    uint64_t uncertainty_ns = 0;
+    uint64_t samples = 0;
+
+    bool is_valid() const { return samples > 0; }
+
+    int64_t offset_at(timestamp_t sender_ts) const {
+        double elapsed_s = static_cast<double>(static_cast<int64_t>(sender_ts - ref_ts)) / 1e9;
+        return offset_ns + static_cast<int64_t>(elapsed_s * static_cast<double>(drift_ppb));
+    }
+
+    ClockSyncFrame to_frame() const;
+    static ClockEstimate from_frame(const ClockSyncFrame& frame);
+
+    void print_summary(const char* title) const;
+};
+
+
+// NTP-style offset and drift from a least-squares fit over the minimum-delay
+// sample of each recent epoch.
+class ClockSync {
+private:
+    struct EpochSample {
+        timestamp_t local_ts = 0;
+        int64_t offset_ns = 0;
+        uint64_t delay_ns = 0;
+    };
+
+    std::array<EpochSample, config::CLOCK_SYNC_EPOCHS> epochs_{};
+    size_t epoch_head_ = 0;
+    size_t epoch_count_ = 0;
+    uint64_t epochs_closed_ = 0;
+
+    EpochSample current_;
+    timestamp_t current_start_ns_ = 0;
+    bool current_valid_ = false;
+
+    uint64_t total_samples_ = 0;
+    uint64_t rejected_fits_ = 0;
+    bool synchronized_ = false;
+    ClockEstimate estimate_;
+
+public:
+    ClockSync() = default;
+
+
+    bool add_sample(timestamp_t t1, timestamp_t t2, timestamp_t t3, timestamp_t t4);
+
+
+    const ClockEstimate& get_estimate() const { return estimate_; }
+    uint64_t get_epochs_closed() const { return epochs_closed_; }
+    uint64_t get_rejected_fits() const { return rejected_fits_; }
+
+private:
+    void update_estimate();
+};
+
+}
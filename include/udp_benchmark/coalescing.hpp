@@ -0,0 +1,86 @@
+#pragma once
+
+#include "common.hpp"
+#include "packet.hpp"
+#include "stats.hpp"
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct CoalescingStats {
+    uint64_t messages = 0;
+    uint64_t datagrams = 0;
+    uint64_t full_flushes = 0;
+    uint64_t timer_flushes = 0;
+    LatencyStats hold_delay;
+
+    double get_messages_per_datagram() const {
+        return datagrams > 0 ? static_cast<double>(messages) / datagrams : 0.0;
+    }
+
+    void add_datagram(timestamp_t send_ts, const BatchEntry* messages, size_t count);
+    void print_summary(const char* title, double seconds) const;
+};
+
+
+// Packs messages into one datagram until full or held for max_hold_us;
+// build() recreates a batch from its sequence for retransmission. Batch seq
+// takes slot seq & mask, so the caller must not flush it while the datagram
+// get_slot_count() sequences earlier is still pending.
+class MessageCoalescer {
+private:
+    struct Batch {
+        sequence_t seq = 0;
+        uint32_t count = 0;
+    };
+
+    size_t message_size_;
+    size_t capacity_;
+    timestamp_t max_hold_ns_;
+
+    std::vector<BatchEntry> open_;
+    std::vector<Batch> batches_;
+    sequence_t batch_mask_ = 0;
+    std::vector<BatchEntry> messages_;
+
+    CoalescingStats stats_;
+
+public:
+    MessageCoalescer(size_t message_size, size_t max_bytes, uint32_t max_hold_us,
+                     size_t max_inflight = config::MAX_CWND, uint64_t expected_messages = 0);
+
+
+    size_t get_capacity() const { return capacity_; }
+    size_t get_slot_count() const { return batches_.size(); }
+
+
+    bool add(sequence_t seq, timestamp_t ts, timestamp_t intended_ts);
+    bool empty() const { return open_.empty(); }
+    size_t get_open_count() const { return open_.size(); }
+
+    timestamp_t get_deadline() const { return open_.front().ts + max_hold_ns_; }
+
+
+    // Returns the intended time of its first message.
+    timestamp_t flush(sequence_t seq, timestamp_t send_ts, bool timer_expired);
+
+    Packet build(sequence_t seq, timestamp_t send_ts, timestamp_t intended_ts) const;
+
+    template<typename Fn>
+    void for_each_message(sequence_t seq, Fn&& fn) const {
+        size_t slot = seq & batch_mask_;
+        if (batches_[slot].seq != seq) {
+            return;
+        }
+        const BatchEntry* messages = messages_.data() + slot * capacity_;
+        for (uint32_t i = 0; i < batches_[slot].count; ++i) {
+            fn(messages[i]);
+        }
+    }
+
+    size_t get_datagram_size(sequence_t seq) const;
+    const CoalescingStats& get_stats() const { return stats_; }
+};
+
+}
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <atomic>
 #include <mutex>
 #include <iostream>
+#include <string>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <x86intrin.h>
+#define UDP_BENCHMARK_HAS_TSC 1
+#endif
 
 
 #ifdef __APPLE__
@@ -25,42 +32,358 @@ using sequence_t = uint64_t;
 
 namespace config {
     constexpr int DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
-    constexpr int MIN_MESSAGE_SIZE = 16;
+    constexpr int MIN_MESSAGE_SIZE = 24;
     constexpr int MAX_PACKET_SIZE = 2048;
     constexpr int DEFAULT_WINDOW_SIZE = 256;
-    constexpr int DEFAULT_ACK_PERIOD = 1;
+    constexpr int DEFAULT_ACK_PERIOD = 2;
+    constexpr uint32_t DEFAULT_MAX_ACK_DELAY_US = 200;
     constexpr uint64_t MIN_CWND = 10;
     constexpr uint64_t MAX_CWND = 10000;
+    constexpr uint64_t CONTROL_MARKER = UINT64_MAX;
+    constexpr uint32_t MIN_PTO_US = 1000;
+    constexpr uint32_t INITIAL_PTO_US = 10000;
+    constexpr uint32_t MAX_PTO_BACKOFF = 6;
+    constexpr size_t MAX_DSACKS = 8;
+    constexpr size_t DSACK_HISTORY = 1 << 12;
+    constexpr uint32_t REO_WND_PERSIST = 16;
+    constexpr int DRAIN_TIMEOUT_MS = 2000;
+    constexpr int RECEIVER_IDLE_TIMEOUT_MS = 5 * DRAIN_TIMEOUT_MS;
+    constexpr int FIN_LINGER_MS = 50;
+    constexpr int HELLO_RETRY_MS = 100;
+    constexpr int HELLO_TIMEOUT_MS = 5000;
+    constexpr int MAX_DATAGRAM_SIZE = 65507;
+    constexpr int MAX_MESSAGE_SIZE = 64 * 1024;
+    constexpr int DEFAULT_FRAGMENT_SIZE = 1472;
+    constexpr int MIN_FRAGMENT_SIZE = 128;
+    constexpr int REASSEMBLY_TIMEOUT_MS = 1000;
+    constexpr size_t MIN_REASSEMBLY_SLOTS = 16;
+    constexpr int DEFAULT_COALESCE_BYTES = DEFAULT_FRAGMENT_SIZE;
+    constexpr int COALESCE_SPIN_US = 50;
+    constexpr int PACER_SPIN_US = 50;
+    constexpr int ACK_TIMER_SPIN_US = 50;
+    constexpr uint32_t PACER_MAX_BURST = 16;
+    constexpr size_t MAX_PREALLOCATED_SAMPLES = 1 << 22;
+    constexpr size_t LOG_BUFFER_SIZE = 64 * 1024;
+    constexpr int CLOCK_SYNC_EPOCH_MS = 100;
+    constexpr size_t CLOCK_SYNC_EPOCHS = 64;
+    constexpr uint64_t CLOCK_SYNC_MAX_DELAY_FACTOR = 4;
+    constexpr int64_t CLOCK_SYNC_MAX_DRIFT_PPM = 500;
+    constexpr int PING_PONG_TIMEOUT_MS = 1000;
+    constexpr int PING_PONG_GIVE_UP_MS = 5000;
+    constexpr int SWEEP_STEP_MS = 1000;
+    constexpr int SWEEP_WARMUP_PERCENT = 20;
+    constexpr int SWEEP_DRAIN_MS = 200;
+    constexpr uint32_t IMPAIR_DEFAULT_BURST = 15000;
+    constexpr uint32_t IMPAIR_DEFAULT_QUEUE_LIMIT = 1000;
+    constexpr int IMPAIR_SPIN_US = 50;
+    constexpr uint64_t SIM_TIME_LIMIT_S = 600;
+    constexpr int MULTICAST_DEFAULT_TTL = 1;
+    constexpr size_t MULTICAST_HISTORY = 1 << 16;
+    constexpr uint32_t NACK_DELAY_US = 500;
+    constexpr uint32_t NACK_RETRY_US = 5000;
+    constexpr int NACK_MAX_RETRIES = 5;
+    constexpr size_t NACK_MAX_ENTRIES = 128;
+    constexpr uint32_t REPAIR_HOLDOFF_US = 2000;
+    constexpr size_t TIMESTAMP_TABLE_SIZE = 1 << 14;
+    constexpr size_t TX_REPORT_MAX_ENTRIES = 64;
+    constexpr uint32_t TX_REPORT_INTERVAL_US = 1000;
+    constexpr int TSC_CALIBRATION_MS = 20;
+    constexpr int TSC_RESYNC_INTERVAL_MS = 1000;
+    constexpr size_t TRACE_RING_EVENTS = 1 << 16;
+    constexpr size_t REORDER_EXTENT_HISTORY = 1024;
+    constexpr size_t MAX_PATHS = 8;
+    constexpr size_t PATH_RACE_HISTORY = 1 << 16;
+    constexpr uint32_t FEC_MAX_DATA = 64;
+    constexpr uint32_t FEC_MAX_PARITY = 16;
+    constexpr size_t FEC_BLOCK_HISTORY = 64;
+    constexpr int LIVE_STATS_WINDOW_MS = 1000;
+    constexpr uint32_t LIVE_STATS_GAUGE_US = 1000;
+    constexpr int LIVE_STATS_VIEW_INTERVAL_MS = 1000;
+    constexpr int INTERVAL_LOG_DEFAULT_MS = 1000;
+    constexpr size_t ANALYZE_REORDER_WINDOW = 1 << 18;
+    constexpr size_t ANALYZE_CHUNK_BYTES = 4 << 20;
 }
 
 
+enum class ControlType : uint8_t {
+    ACK_FREQUENCY = 1,
+    FIN = 2,
+    FIN_ACK = 3,
+    HELLO = 4,
+    HELLO_ACK = 5,
+    CLOCK_SYNC = 6,
+    NACK = 7,
+    TX_TIMESTAMPS = 8,
+    PARITY = 9
+};
+
+
 struct Pending {
     sequence_t seq;
     timestamp_t send_ts_ns;
+    timestamp_t xmit_ts_ns;
+    timestamp_t intended_ts_ns;
     int retransmits;
+    int spurious;
+    bool sacked;
+    bool lost;
 
-    Pending() : seq(0), send_ts_ns(0), retransmits(0) {}
-    Pending(sequence_t s, timestamp_t ts, int rt = 0)
-        : seq(s), send_ts_ns(ts), retransmits(rt) {}
+    Pending()
+        : seq(0), send_ts_ns(0), xmit_ts_ns(0), intended_ts_ns(0), retransmits(0), spurious(0), sacked(false),
+          lost(false) {}
+    Pending(sequence_t s, timestamp_t ts, int rt = 0, timestamp_t intended = 0)
+        : seq(s), send_ts_ns(ts), xmit_ts_ns(ts), intended_ts_ns(intended != 0 ? intended : ts),
+          retransmits(rt), spurious(0), sacked(false), lost(false) {}
 };
 
+// intended_ts is when the rate schedule wanted the packet to leave.
 struct PacketHeader {
     sequence_t seq;
     timestamp_t timestamp;
+    timestamp_t intended_ts;
+} __attribute__((packed));
+
+struct FragmentHeader {
+    uint64_t message_id;
+    uint32_t message_size;
+    uint16_t index;
+    uint16_t count;
+} __attribute__((packed));
+
+// count messages follow, each with its own PacketHeader.
+struct BatchHeader {
+    uint16_t count;
+    uint16_t message_size;
 } __attribute__((packed));
 
+struct BatchEntry {
+    sequence_t seq;
+    timestamp_t ts;
+    timestamp_t intended_ts;
+};
+
+// Fragment k of message m travels as sequence (m - 1) * fragment_count + k + 1.
+struct FragmentLayout {
+    uint32_t message_size = 0;
+    uint32_t fragment_size = 0;
+    uint32_t payload_size = 0;
+    uint32_t fragment_count = 1;
+
+    FragmentLayout() = default;
+    FragmentLayout(uint32_t message, uint32_t fragment) : message_size(message), fragment_size(fragment) {
+        if (fragment > header_size() && message > fragment) {
+            payload_size = fragment - static_cast<uint32_t>(header_size());
+            fragment_count = (message + payload_size - 1) / payload_size;
+        }
+    }
+
+    bool enabled() const { return fragment_count > 1; }
+    uint64_t message_of(sequence_t seq) const { return (seq - 1) / fragment_count + 1; }
+    uint32_t index_of(sequence_t seq) const { return static_cast<uint32_t>((seq - 1) % fragment_count); }
+    sequence_t first_sequence(uint64_t message_id) const { return (message_id - 1) * fragment_count + 1; }
+    sequence_t last_sequence(uint64_t message_id) const { return message_id * fragment_count; }
+
+    size_t datagram_size(uint32_t index) const {
+        if (!enabled()) {
+            return message_size;
+        }
+        uint32_t offset = index * payload_size;
+        return header_size() + std::min(payload_size, message_size - offset);
+    }
+
+    static constexpr size_t header_size() { return sizeof(PacketHeader) + sizeof(FragmentHeader); }
+};
+
+// The bitmap is followed by dsack_count D-SACK sequences (RFC 2883).
 struct AckHeader {
     sequence_t ack_seq;
     uint16_t bitmap_len;
+    uint32_t ack_delay_us;
+    timestamp_t echo_ts;
+    timestamp_t recv_ts;
+    timestamp_t ack_ts;
+    uint16_t dsack_count;
 } __attribute__((packed));
 
+struct AckTimestamps {
+    timestamp_t echo_ts = 0;
+    timestamp_t recv_ts = 0;
+    timestamp_t ack_ts = 0;
+};
 
-inline timestamp_t get_timestamp_ns() {
+// CONTROL_MARKER in the sequence slot marks a control packet.
+struct ControlHeader {
+    sequence_t marker;
+    uint8_t type;
+} __attribute__((packed));
+
+struct AckFrequencyFrame {
+    uint32_t request_id;
+    uint32_t ack_period;
+    uint32_t max_ack_delay_us;
+} __attribute__((packed));
+
+enum HelloFlags : uint32_t {
+    HELLO_FLAG_ECHO = 1 << 0,
+    HELLO_FLAG_MULTICAST = 1 << 1,
+    HELLO_FLAG_COALESCED = 1 << 2,
+    HELLO_FLAG_KERNEL_TIMESTAMPS = 1 << 3
+};
+
+// datagram_size is 0 when every datagram carries one msg_size message.
+struct HelloFrame {
+    uint64_t run_id;
+    timestamp_t send_ts;
+    uint64_t total_count;
+    uint32_t msg_size;
+    uint32_t window_size;
+    uint32_t max_inflight;
+    uint32_t ack_period;
+    uint32_t max_ack_delay_us;
+    uint32_t flags;
+    uint32_t datagram_size;
+    uint16_t fec_data;
+    uint16_t fec_parity;
+} __attribute__((packed));
+
+struct HelloAckFrame {
+    uint64_t run_id;
+    timestamp_t echo_ts;
+    timestamp_t recv_ts;
+    timestamp_t ack_ts;
+} __attribute__((packed));
+
+// Estimate of (receiver clock - sender clock) at ref_ts on the sender clock.
+struct ClockSyncFrame {
+    timestamp_t ref_ts;
+    int64_t offset_ns;
+    int64_t drift_ppb;
+    uint64_t uncertainty_ns;
+    uint64_t samples;
+} __attribute__((packed));
+
+struct FinFrame {
+    sequence_t final_seq;
+} __attribute__((packed));
+
+struct FinAckFrame {
+    sequence_t final_seq;
+    uint64_t packets_received;
+    uint64_t duplicate_packets;
+    uint64_t acks_sent;
+} __attribute__((packed));
+
+struct NackHeader {
+    uint16_t count;
+} __attribute__((packed));
+
+// Kernel TX timestamps of ACKed data packets; count entries follow.
+struct TxTimestampsHeader {
+    uint16_t count;
+} __attribute__((packed));
+
+// Bit i of encoded is set when packet first_seq + i is in the parity.
+struct ParityHeader {
+    sequence_t first_seq;
+    uint64_t encoded;
+    uint16_t count;
+    uint8_t index;
+    uint8_t parity_count;
+} __attribute__((packed));
+
+struct TxTimestampEntry {
+    sequence_t seq;
+    timestamp_t tx_ts;
+} __attribute__((packed));
+
+
+// Synthetic clock error for testing cross-host offset estimation on one host.
+struct ClockSkew {
+    bool enabled = false;
+    int64_t offset_ns = 0;
+    double drift_ppm = 0.0;
+    timestamp_t origin_ns = 0;
+};
+
+extern ClockSkew g_clock_skew;
+
+void inject_clock_skew(int64_t offset_ns, double drift_ppm);
+timestamp_t apply_clock_skew(timestamp_t ts_ns);
+
+
+// Invariant-TSC time source, re-synced to CLOCK_MONOTONIC by a background
+// thread. Readers take the parameters under a seqlock.
+struct TscClock {
+    bool enabled = false;
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> base_ticks{0};
+    std::atomic<timestamp_t> base_ns{0};
+    std::atomic<uint64_t> mult{0};
+    uint64_t calibration_ticks = 0;
+    timestamp_t calibration_ns = 0;
+    double ticks_per_ns = 0.0;
+};
+
+extern TscClock g_tsc_clock;
+
+// Falls back to steady_clock without an invariant TSC.
+bool init_time_source(bool allow_tsc);
+std::string describe_time_source();
+
+inline timestamp_t read_clock_ns() {
+#ifdef UDP_BENCHMARK_HAS_TSC
+    if (g_tsc_clock.enabled) {
+        TscClock& clock = g_tsc_clock;
+        uint64_t ticks = __rdtsc();
+        uint32_t sequence;
+        uint64_t base_ticks, mult;
+        timestamp_t base_ns;
+        do {
+            sequence = clock.sequence.load(std::memory_order_acquire);
+            base_ticks = clock.base_ticks.load(std::memory_order_relaxed);
+            base_ns = clock.base_ns.load(std::memory_order_relaxed);
+            mult = clock.mult.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (__builtin_expect((sequence & 1) != 0 || sequence != clock.sequence.load(std::memory_order_relaxed), 0));
+
+        int64_t delta = static_cast<int64_t>(ticks - base_ticks);
+        if (__builtin_expect(delta < 0, 0)) {
+            return base_ns;
+        }
+        return base_ns + static_cast<timestamp_t>((static_cast<unsigned __int128>(delta) * mult) >> 32);
+    }
+#endif
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
         clock_ns::now().time_since_epoch()
     ).count();
 }
 
+inline timestamp_t get_timestamp_ns() {
+    timestamp_t ts = read_clock_ns();
+    if (__builtin_expect(g_clock_skew.enabled, 0)) {
+        return apply_clock_skew(ts);
+    }
+    return ts;
+}
+
+// VirtualClock is advanced only by the simulation's event loop.
+struct SystemClock {
+    static timestamp_t now() { return get_timestamp_ns(); }
+};
+
+struct VirtualClock {
+    static inline timestamp_t now_ns = 0;
+    static timestamp_t now() { return now_ns; }
+};
+
+struct NullMutex {
+    void lock() {}
+    void unlock() {}
+};
+
+// Sleeps until spin_us before deadline_ns, then spins.
+void wait_until_ns(timestamp_t deadline_ns, uint32_t spin_us);
+
 inline double timestamp_to_seconds(timestamp_t ts_ns) {
     return static_cast<double>(ts_ns) / 1e9;
 }
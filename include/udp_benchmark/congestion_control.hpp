@@ -10,6 +10,7 @@ private:
     std::atomic<uint64_t> cwnd_;
     std::atomic<uint64_t> ssthresh_;
     std::atomic<uint64_t> inflight_;
+    std::atomic<uint64_t> avoidance_acks_{0};
 
     const uint64_t min_cwnd_;
     const uint64_t max_cwnd_;
@@ -32,7 +33,7 @@ public:
     void packet_lost();
 
 
-    void on_ack_received(bool has_loss = false);
+    void on_ack_received(bool has_loss = false, uint64_t acked = 1);
     void on_timeout();
     void on_duplicate_ack();
 
@@ -45,7 +46,7 @@ public:
     void set_max_cwnd(uint64_t max_cwnd);
 
 protected:
-    void increase_cwnd();
+    void increase_cwnd(uint64_t acked);
     void decrease_cwnd_on_loss();
     void enter_slow_start();
     void enter_congestion_avoidance();
@@ -87,7 +88,8 @@ public:
                                         bool verbose = false);
 
 
-    void on_ack_received_with_stats(bool has_loss = false);
+    // acked is the number of packets the ACK newly delivered.
+    void on_ack_received_with_stats(bool has_loss = false, uint64_t acked = 1);
     void on_timeout_with_stats();
 
 
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "common.hpp"
+#include "packet.hpp"
+#include "interval_log.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+// GF(2^8) over x^8 + x^4 + x^3 + x^2 + 1, with pshufb nibble tables where available.
+class Gf256 {
+public:
+    static uint8_t mul(uint8_t a, uint8_t b);
+    static uint8_t div(uint8_t a, uint8_t b);
+    static uint8_t inverse(uint8_t a);
+
+
+    static void mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size);
+    static void xor_region(uint8_t* dst, const uint8_t* src, size_t size);
+
+    static const char* get_simd_name();
+};
+
+
+// K data and M parity packets per block, from a Cauchy matrix whose row 0 is
+// all ones, so M = 1 is XOR parity and any K of the K + M packets suffice.
+struct FecCode {
+    uint32_t data = 0;
+    uint32_t parity = 0;
+
+    bool enabled() const { return data > 0 && parity > 0; }
+    double get_rate() const { return enabled() ? static_cast<double>(data) / (data + parity) : 1.0; }
+    double get_overhead_percent() const { return enabled() ? 100.0 * parity / data : 0.0; }
+    std::string describe() const;
+
+    static uint8_t coefficient(uint32_t row, uint32_t column);
+
+    uint64_t block_of(sequence_t seq) const { return (seq - 1) / data; }
+    uint32_t index_of(sequence_t seq) const { return static_cast<uint32_t>((seq - 1) % data); }
+
+    static constexpr size_t parity_overhead() { return sizeof(ControlHeader) + sizeof(ParityHeader) + sizeof(uint16_t); }
+
+    static bool parse(const char* spec, FecCode& code);
+};
+
+
+struct FecSendStats {
+    uint64_t blocks = 0;
+    uint64_t data_packets = 0;
+    uint64_t data_bytes = 0;
+    uint64_t parity_packets = 0;
+    uint64_t parity_bytes = 0;
+
+    double get_overhead_percent() const {
+        return data_bytes > 0 ? 100.0 * static_cast<double>(parity_bytes) / data_bytes : 0.0;
+    }
+
+    void print_summary(const char* title, const FecCode& code) const;
+};
+
+
+// Folds each first transmission into its block's parity as it is sent.
+class FecEncoder {
+private:
+    FecCode code_;
+    uint64_t block_ = UINT64_MAX;
+    uint32_t count_ = 0;
+    uint64_t encoded_ = 0;
+    size_t symbol_size_ = 0;
+    sequence_t closed_through_ = 0;
+    std::vector<std::vector<uint8_t>> parity_;
+    FecSendStats stats_;
+
+public:
+    void set_code(const FecCode& code);
+    const FecCode& get_code() const { return code_; }
+    bool enabled() const { return code_.enabled(); }
+
+
+    // Parity packets of any block this closes are appended to parity.
+    void add(sequence_t seq, const uint8_t* data, size_t size, std::vector<Packet>& parity);
+
+    void flush(std::vector<Packet>& parity);
+
+    sequence_t get_closed_through() const { return closed_through_; }
+
+    const FecSendStats& get_stats() const { return stats_; }
+
+private:
+    void finish_block(std::vector<Packet>& parity);
+};
+
+
+struct FecReceiveStats {
+    uint64_t blocks = 0;
+    uint64_t data_packets = 0;
+    uint64_t data_bytes = 0;
+    uint64_t parity_packets = 0;
+    uint64_t parity_bytes = 0;
+
+    uint64_t late_packets = 0;
+
+    uint64_t repaired_blocks = 0;
+    uint64_t recovered_packets = 0;
+    uint64_t unrepaired_blocks = 0;
+    uint64_t unrepaired_packets = 0;
+    uint64_t corrupt_blocks = 0;
+
+    LatencyHistogram recovered_latency;
+
+    void print_summary(const char* title, const FecCode& code) const;
+};
+
+
+// Rebuilds missing data packets as soon as enough of a block has arrived;
+// blocks that leave the FEC_BLOCK_HISTORY ring incomplete are left to retransmission.
+class FecDecoder {
+private:
+    struct Block {
+        uint64_t id = UINT64_MAX;
+        uint32_t count = 0;
+        uint32_t data_received = 0;
+        uint32_t parity_received = 0;
+        uint32_t after_parity = 0;
+        uint64_t data_mask = 0;
+        uint64_t encoded_mask = 0;
+        uint64_t parity_mask = 0;
+        size_t symbol_size = 0;
+        bool done = false;
+        std::vector<std::vector<uint8_t>> symbols;
+    };
+
+    FecCode code_;
+    std::vector<Block> blocks_;
+    uint64_t mask_ = 0;
+    FecReceiveStats stats_;
+
+public:
+    void reset(const FecCode& code, size_t history = config::FEC_BLOCK_HISTORY);
+    const FecCode& get_code() const { return code_; }
+    bool enabled() const { return code_.enabled(); }
+
+
+    // Packets this lets the decoder rebuild are appended to recovered.
+    void add_data(sequence_t seq, const uint8_t* data, size_t size, std::vector<Packet>& recovered);
+    void add_parity(const uint8_t* data, size_t size, std::vector<Packet>& recovered);
+
+    void finish();
+
+    void add_recovered_latency(uint64_t latency_ns) { stats_.recovered_latency.record(latency_ns); }
+    const FecReceiveStats& get_stats() const { return stats_; }
+
+private:
+    Block* find_block(uint64_t id);
+    void retire(Block& block);
+    void try_recover(Block& block, std::vector<Packet>& recovered);
+};
+
+}
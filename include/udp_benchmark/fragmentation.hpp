@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.hpp"
+#include "stats.hpp"
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct ReassemblyStats {
+    uint64_t fragments = 0;
+    uint64_t duplicate_fragments = 0;
+    uint64_t stale_fragments = 0;
+    uint64_t messages_completed = 0;
+    uint64_t messages_evicted = 0;
+    uint64_t max_open = 0;
+};
+
+
+// payload is set only when payloads are kept, until the next add_fragment.
+struct ReassembledMessage {
+    uint64_t message_id = 0;
+    timestamp_t first_send_ts = 0;
+    timestamp_t intended_ts = 0;
+    timestamp_t first_arrival_ns = 0;
+    timestamp_t last_arrival_ns = 0;
+    int retransmits = 0;
+    const uint8_t* payload = nullptr;
+};
+
+
+// Message m lives in slot m & mask until complete, timed out or displaced.
+class Reassembler {
+private:
+    struct Slot {
+        uint64_t message_id = 0;
+        uint32_t received = 0;
+        int retransmits = 0;
+        timestamp_t first_send_ts = 0;
+        timestamp_t intended_ts = 0;
+        timestamp_t first_arrival_ns = 0;
+        timestamp_t last_arrival_ns = 0;
+    };
+
+    FragmentLayout layout_;
+    std::vector<Slot> slots_;
+    uint64_t slot_mask_ = 0;
+    std::vector<uint64_t> bitmaps_;
+    size_t bitmap_words_ = 0;
+    std::vector<uint8_t> payloads_;
+
+    uint64_t open_ = 0;
+    timestamp_t timeout_ns_ = 0;
+    timestamp_t next_sweep_ns_ = 0;
+
+    ReassembledMessage completed_;
+    ReassemblyStats stats_;
+    LatencyStats reassembly_time_;
+
+public:
+    Reassembler() = default;
+
+
+    void reset(const FragmentLayout& layout, size_t max_inflight, bool keep_payload,
+               uint64_t expected_messages = 0);
+
+
+    const ReassembledMessage* add_fragment(uint64_t message_id, uint32_t index, timestamp_t send_ts,
+                                           timestamp_t intended_ts, timestamp_t now,
+                                           const uint8_t* payload = nullptr, size_t payload_size = 0,
+                                           int retransmits = 0);
+
+
+    void evict_expired(timestamp_t now);
+
+
+    uint64_t get_open_count() const { return open_; }
+    size_t get_slot_count() const { return slots_.size(); }
+    const ReassemblyStats& get_stats() const { return stats_; }
+
+    const LatencyStats& get_reassembly_time() const { return reassembly_time_; }
+    void print_summary(const char* title) const;
+
+private:
+    void evict(Slot& slot);
+};
+
+}
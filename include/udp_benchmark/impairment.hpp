@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common.hpp"
+#include "network_utils.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+enum class JitterDistribution { UNIFORM, NORMAL, PARETO };
+
+// Userspace stand-in for tc/netem; percentages are 0-100.
+struct ImpairmentConfig {
+    uint32_t delay_us = 0;
+    uint32_t jitter_us = 0;
+    JitterDistribution distribution = JitterDistribution::UNIFORM;
+
+    double loss_pct = 0;
+
+    // Gilbert-Elliott: p = good->bad, r = bad->good, per-state loss.
+    double ge_p_pct = 0;
+    double ge_r_pct = 0;
+    double ge_bad_loss_pct = 100;
+    double ge_good_loss_pct = 0;
+
+    double reorder_pct = 0;
+    double duplicate_pct = 0;
+
+    double rate_mbps = 0;
+    uint32_t burst_bytes = config::IMPAIR_DEFAULT_BURST;
+    uint32_t queue_limit = config::IMPAIR_DEFAULT_QUEUE_LIMIT;
+
+    uint64_t seed = 1;
+
+    bool enabled() const {
+        return delay_us > 0 || jitter_us > 0 || loss_pct > 0 || ge_p_pct > 0 ||
+               reorder_pct > 0 || duplicate_pct > 0 || rate_mbps > 0;
+    }
+
+    static bool parse(const std::string& spec, ImpairmentConfig& config);
+    std::string describe() const;
+};
+
+
+struct ImpairmentStats {
+    uint64_t submitted = 0;
+    uint64_t delivered = 0;
+    uint64_t lost = 0;
+    uint64_t queue_drops = 0;
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+    uint64_t max_queue = 0;
+
+    void print_summary() const;
+};
+
+
+// Draws from one seeded RNG, so a config and seed always give the same run.
+// The draws are built from the raw mt19937_64 output rather than the
+// implementation-defined std distributions, so that holds across libraries.
+class ImpairmentModel {
+private:
+    ImpairmentConfig config_;
+    std::mt19937_64 rng_;
+    double spare_normal_ = 0;
+    bool has_spare_normal_ = false;
+    bool ge_bad_state_ = false;
+    double tokens_ = 0;
+    timestamp_t tokens_updated_ns_ = 0;
+
+public:
+    explicit ImpairmentModel(const ImpairmentConfig& config);
+
+
+    bool is_lost();
+    bool is_duplicated();
+    bool is_reordered();
+    timestamp_t sample_delay_ns();
+
+    timestamp_t take_tokens(size_t size, timestamp_t now);
+
+
+    const ImpairmentConfig& get_config() const { return config_; }
+
+private:
+    double uniform();
+    double normal();
+};
+
+
+// Delayed datagrams wait in a preallocated min-heap for a release thread.
+// Unimpaired, it installs no sink and is a plain Socket.
+class ImpairedSocket : public Socket, private DatagramSink {
+private:
+    struct Queued {
+        timestamp_t release_ns;
+        uint64_t order;
+        uint32_t slot;
+        sockaddr_in dest;
+
+        bool operator>(const Queued& other) const {
+            return release_ns != other.release_ns ? release_ns > other.release_ns : order > other.order;
+        }
+    };
+
+    ImpairmentModel model_;
+    bool enabled_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Queued> heap_;
+    std::vector<std::vector<uint8_t>> buffers_;
+    std::vector<size_t> buffer_sizes_;
+    std::vector<uint32_t> free_slots_;
+    uint64_t next_order_ = 0;
+
+    ImpairmentStats stats_;
+    std::atomic<bool> running_{false};
+    std::thread release_thread_;
+
+public:
+    ImpairedSocket(int fd, const ImpairmentConfig& config);
+    ~ImpairedSocket() override;
+
+
+    bool is_impaired() const { return enabled_; }
+    const ImpairmentConfig& get_config() const { return model_.get_config(); }
+    ImpairmentStats get_stats();
+
+private:
+    ssize_t send_datagram(const void* data, size_t size, const sockaddr_in& dest) override;
+    bool enqueue_locked(const void* data, size_t size, const sockaddr_in& dest, timestamp_t release_ns);
+    void release_loop();
+};
+
+}
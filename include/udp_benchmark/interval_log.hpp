@@ -0,0 +1,194 @@
+#pragma once
+
+#include "common.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+// Log-linear latency histogram in ns, about 3% per bucket.
+class LatencyHistogram {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 5;
+    static constexpr uint32_t MAX_VALUE_BITS = 40;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ns_ = 0;
+    uint64_t max_ns_ = 0;
+
+public:
+    LatencyHistogram() : counts_(BUCKET_COUNT, 0) {}
+
+    static size_t bucket_of(uint64_t value_ns) {
+        if (value_ns < SUB_BUCKETS) {
+            return static_cast<size_t>(value_ns);
+        }
+        uint32_t shift = static_cast<uint32_t>(63 - __builtin_clzll(value_ns)) - SUB_BUCKET_BITS;
+        size_t bucket = (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value_ns >> shift) - SUB_BUCKETS);
+        return std::min(bucket, BUCKET_COUNT - 1);
+    }
+
+    static uint64_t lowest_value(size_t bucket);
+    static uint64_t highest_value(size_t bucket);
+
+    void record(uint64_t value_ns) {
+        counts_[bucket_of(value_ns)]++;
+        total_++;
+        sum_ns_ += value_ns;
+        max_ns_ = std::max(max_ns_, value_ns);
+    }
+
+    void add(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t get_count() const { return total_; }
+    uint64_t get_max_ns() const { return max_ns_; }
+    double get_mean_us() const { return total_ > 0 ? static_cast<double>(sum_ns_) / total_ / 1000.0 : 0.0; }
+
+    double get_percentile_us(double p) const;
+
+
+    // Sparse encoding: the occupied buckets as (gap, count) varint pairs.
+    void encode(std::string& out) const;
+    bool decode(const uint8_t*& data, const uint8_t* end);
+};
+
+
+struct IntervalRecord {
+    timestamp_t start_ns = 0;
+    timestamp_t end_ns = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t losses = 0;
+    uint64_t retransmits = 0;
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;
+    uint64_t loss_bursts = 0;
+    uint64_t jitter_ns = 0;
+    LatencyHistogram latency;
+};
+
+// The log keeps deltas of these, except for jitter.
+struct IntervalTotals {
+    uint64_t losses = 0;
+    uint64_t retransmits = 0;
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;
+    uint64_t loss_bursts = 0;
+    uint64_t jitter_ns = 0;
+};
+
+struct IntervalLogHeader {
+    uint32_t role = 0;
+    uint32_t interval_ms = 0;
+    uint64_t run_id = 0;
+    uint64_t start_unix_ns = 0;
+    timestamp_t start_ns = 0;
+};
+
+
+// Cuts a run into fixed intervals and appends each to a log as it closes.
+// One recording thread writes lock-free; the log thread swaps buffers.
+class IntervalRecorder {
+public:
+    using TotalsSource = std::function<IntervalTotals()>;
+
+private:
+    struct Buffer {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        LatencyHistogram latency;
+    };
+
+    Buffer buffers_[2];
+    std::atomic<Buffer*> active_{&buffers_[0]};
+    std::atomic<uint64_t> writer_seq_{0};
+
+    std::ofstream file_;
+    IntervalLogHeader header_;
+    TotalsSource totals_source_;
+    IntervalTotals last_totals_;
+    timestamp_t interval_start_ns_ = 0;
+    uint64_t intervals_written_ = 0;
+    std::string record_;
+
+    std::thread thread_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_requested_ = false;
+
+public:
+    IntervalRecorder() = default;
+    ~IntervalRecorder();
+
+    IntervalRecorder(const IntervalRecorder&) = delete;
+    IntervalRecorder& operator=(const IntervalRecorder&) = delete;
+
+
+    // role is 1 for a sender and 2 for a receiver, as in LiveRole.
+    bool start(const std::string& path, uint32_t interval_ms, uint32_t role, uint64_t run_id,
+               TotalsSource totals_source = nullptr);
+    bool is_running() const { return thread_.joinable(); }
+
+    void stop();
+
+    uint64_t get_intervals_written() const { return intervals_written_; }
+
+
+    void add_packet(size_t bytes) {
+        Buffer* buffer = enter();
+        buffer->packets++;
+        buffer->bytes += bytes;
+        leave();
+    }
+
+    void add_latency(timestamp_t latency_ns) {
+        Buffer* buffer = enter();
+        buffer->latency.record(latency_ns);
+        leave();
+    }
+
+private:
+
+    // The count is odd while the writer holds a buffer, so a swap can wait it out.
+    Buffer* enter() {
+        writer_seq_.store(writer_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+        return active_.load(std::memory_order_seq_cst);
+    }
+
+    void leave() {
+        writer_seq_.store(writer_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void run();
+    void close_interval();
+};
+
+
+class IntervalLogReader {
+private:
+    std::ifstream file_;
+    IntervalLogHeader header_;
+    std::string record_;
+    timestamp_t previous_end_ns_ = 0;
+
+public:
+    bool open(const std::string& path);
+    const IntervalLogHeader& get_header() const { return header_; }
+
+    bool next(IntervalRecord& record);
+};
+
+}
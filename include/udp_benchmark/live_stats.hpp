@@ -0,0 +1,171 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+constexpr uint32_t LIVE_STATS_MAGIC = 0x55445053;
+constexpr uint32_t LIVE_STATS_VERSION = 1;
+constexpr size_t LIVE_STATS_SECTIONS = 4;
+
+// Bucket i counts latencies below 2^i μs; the last also takes everything above.
+constexpr size_t LIVE_HISTOGRAM_BUCKETS = 24;
+
+enum class LiveRole : uint32_t {
+    SENDER = 1,
+    RECEIVER = 2
+};
+
+
+// Counters run from the session start and udp_stat sums them across sections.
+struct LiveValues {
+    uint64_t messages = 0;
+    uint64_t packets_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t packets_received = 0;
+    uint64_t bytes_received = 0;
+    uint64_t acks = 0;
+    uint64_t retransmits = 0;
+    uint64_t losses = 0;
+    uint64_t duplicates = 0;
+
+    uint64_t cwnd = 0;
+    uint64_t inflight = 0;
+    uint64_t srtt_ns = 0;
+    uint64_t min_rtt_ns = 0;
+
+    uint64_t latency_count = 0;
+    uint64_t latency_sum_ns = 0;
+    uint64_t histogram[LIVE_HISTOGRAM_BUCKETS] = {};
+
+    uint64_t window_histogram[LIVE_HISTOGRAM_BUCKETS] = {};
+    uint64_t window_count = 0;
+
+    void add(const LiveValues& other);
+};
+
+
+// Seqlock: the count is odd while the single writer is mid-update.
+struct alignas(64) LiveSection {
+    std::atomic<uint64_t> seq;
+    char name[16];
+    LiveValues values;
+};
+
+struct LiveStatsSegment {
+    uint32_t magic;
+    uint32_t version;
+    LiveRole role;
+    uint32_t section_count;
+    int32_t pid;
+    std::atomic<uint32_t> finished;
+    uint64_t run_id;
+    uint64_t total_messages;
+    uint64_t start_unix_ns;
+    LiveSection sections[LIVE_STATS_SECTIONS];
+};
+
+
+size_t live_histogram_bucket(timestamp_t latency_ns);
+
+double live_histogram_percentile_us(const uint64_t* buckets, double p);
+
+
+// Publishing is plain stores into shared memory between begin() and end().
+class LiveStatsWriter {
+private:
+    LiveSection* section_ = nullptr;
+    uint64_t window_[LIVE_HISTOGRAM_BUCKETS] = {};
+    uint64_t window_count_ = 0;
+    timestamp_t window_end_ns_ = 0;
+
+public:
+    LiveStatsWriter() = default;
+    explicit LiveStatsWriter(LiveSection* section) : section_(section) {}
+
+    bool is_enabled() const { return section_ != nullptr; }
+
+    LiveValues* begin() {
+        if (!section_) {
+            return nullptr;
+        }
+        uint64_t seq = section_->seq.load(std::memory_order_relaxed);
+        section_->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return &section_->values;
+    }
+
+    void end() {
+        section_->seq.store(section_->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void add_latency(LiveValues* live, timestamp_t now_ns, timestamp_t latency_ns);
+};
+
+
+// POSIX shared memory segment /udp_benchmark.NAME, removed when the run ends.
+class LiveStats {
+private:
+    LiveStatsSegment* segment_ = nullptr;
+    std::string shm_name_;
+
+public:
+    LiveStats() = default;
+    ~LiveStats();
+
+    LiveStats(const LiveStats&) = delete;
+    LiveStats& operator=(const LiveStats&) = delete;
+
+
+    bool create(const std::string& name, LiveRole role, uint64_t run_id, uint64_t total_messages);
+    bool is_open() const { return segment_ != nullptr; }
+    const std::string& get_shm_name() const { return shm_name_; }
+
+    // Call before the threads start.
+    LiveStatsWriter add_section(const char* name);
+
+    void set_session(uint64_t run_id, uint64_t total_messages);
+    void finish();
+    void close();
+};
+
+
+struct LiveSnapshot {
+    LiveRole role = LiveRole::SENDER;
+    int32_t pid = 0;
+    bool finished = false;
+    uint64_t run_id = 0;
+    uint64_t total_messages = 0;
+    uint64_t start_unix_ns = 0;
+    LiveValues total;
+};
+
+
+class LiveStatsReader {
+private:
+    const LiveStatsSegment* segment_ = nullptr;
+    std::string name_;
+
+public:
+    LiveStatsReader() = default;
+    ~LiveStatsReader();
+
+    LiveStatsReader(const LiveStatsReader&) = delete;
+    LiveStatsReader& operator=(const LiveStatsReader&) = delete;
+
+
+    bool attach(const std::string& name);
+    const std::string& get_name() const { return name_; }
+
+    // False if a section stayed mid-update, i.e. its writer died there.
+    bool read(LiveSnapshot& snapshot) const;
+
+    bool is_writer_alive() const;
+
+    static std::vector<std::string> list();
+};
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "common.hpp"
+#include "interval_log.hpp"
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+enum LogField : uint8_t {
+    LOG_SEQ,
+    LOG_SEND_TS,
+    LOG_ACK_RECV_TS,
+    LOG_RETRANSMITS,
+    LOG_INTENDED_TS,
+    LOG_TX_SCHED_TS,
+    LOG_TX_TS,
+    LOG_RECV_TS,
+    LOG_CLOCK_OFFSET,
+    LOG_KERNEL_RX_TS,
+    LOG_FIELD_COUNT,
+    LOG_IGNORED = LOG_FIELD_COUNT
+};
+
+struct LogRow {
+    int64_t values[LOG_FIELD_COUNT];
+
+    uint64_t seq() const { return static_cast<uint64_t>(values[LOG_SEQ]); }
+};
+
+
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    void release(const char* begin, const char* end) const;
+};
+
+
+// Chunks ahead of the reader are parsed on worker threads and released once read.
+class LogStream {
+private:
+    struct Chunk {
+        std::vector<LogRow> rows;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        uint64_t malformed = 0;
+    };
+
+    MappedFile file_;
+    std::string path_;
+    std::vector<LogField> columns_;
+    uint32_t present_ = 0;
+    uint64_t run_id_ = 0;
+
+    size_t chunk_bytes_ = 0;
+    size_t depth_ = 1;
+    const char* next_ = nullptr;
+    std::deque<std::future<Chunk>> pending_;
+    Chunk current_;
+    size_t index_ = 0;
+    uint64_t rows_ = 0;
+    uint64_t malformed_ = 0;
+
+    static Chunk parse_chunk(const char* begin, const char* end, const std::vector<LogField>& columns);
+
+    void schedule();
+    bool advance();
+
+public:
+    bool open(const std::string& path, size_t depth, size_t chunk_bytes);
+
+    bool has(LogField field) const { return (present_ >> field) & 1; }
+    uint64_t get_run_id() const { return run_id_; }
+    size_t get_size() const { return file_.size(); }
+    uint64_t get_rows() const { return rows_; }
+    uint64_t get_malformed() const { return malformed_; }
+
+
+    const LogRow* peek() {
+        if (index_ < current_.rows.size() || advance()) {
+            return &current_.rows[index_];
+        }
+        return nullptr;
+    }
+
+    void pop() { index_++; }
+};
+
+
+// Joins sender and receiver logs on sequence in one pass; percentiles come
+// from histograms, so they are within about 3% of analyze.py.
+class LogAnalyzer {
+private:
+    enum SlotFlags : uint32_t {
+        HAS_SENDER = 1,
+        HAS_RECEIVER = 2
+    };
+
+    struct Slot {
+        uint64_t seq = 0;
+        uint32_t flags = 0;
+        uint32_t retransmits = 0;
+        int64_t send_ts = 0;
+        int64_t ack_recv_ts = 0;
+        int64_t intended_ts = 0;
+        int64_t tx_sched_ts = 0;
+        int64_t tx_ts = 0;
+        int64_t recv_ts = 0;
+        int64_t clock_offset = 0;
+        int64_t kernel_rx_ts = 0;
+    };
+
+    static constexpr size_t STAGE_COUNT = 5;
+
+    std::vector<Slot> slots_;
+    uint64_t mask_ = 0;
+    uint64_t base_ = 0;
+
+    bool sender_intended_ = false;
+    bool sender_rtt_ = false;
+    bool joined_send_ts_ = false;
+    bool stages_ = false;
+
+    uint64_t sent_ = 0;
+    uint64_t received_ = 0;
+    uint64_t retransmits_ = 0;
+    uint64_t late_sender_ = 0;
+    uint64_t late_receiver_ = 0;
+    int64_t first_recv_ts_ = INT64_MAX;
+    int64_t last_recv_ts_ = INT64_MIN;
+
+    LatencyHistogram oneway_;
+    LatencyHistogram oneway_corrected_;
+    int64_t oneway_min_ns_ = INT64_MAX;
+    uint64_t oneway_negative_ = 0;
+    LatencyHistogram rtt_;
+    LatencyHistogram rtt_corrected_;
+    uint64_t stage_packets_ = 0;
+    LatencyHistogram stage_latency_[STAGE_COUNT];
+    uint64_t stage_negative_[STAGE_COUNT] = {};
+
+    void add_sender(const LogRow& row);
+    void add_receiver(const LogRow& row);
+    void settle(const Slot& slot);
+    void settle_until(uint64_t seq);
+
+public:
+    explicit LogAnalyzer(size_t reorder_window);
+
+    void run(LogStream& sender, LogStream& receiver);
+    void print_report() const;
+
+    uint64_t get_late_rows() const { return late_sender_ + late_receiver_; }
+};
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common.hpp"
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct LossStats {
+    uint64_t losses_detected = 0;
+    uint64_t retransmits = 0;
+    uint64_t spurious_retransmits = 0;
+    uint64_t tail_probes = 0;
+
+    double get_spurious_rate() const {
+        return retransmits > 0 ? static_cast<double>(spurious_retransmits) / retransmits : 0.0;
+    }
+
+    void print_summary() const;
+};
+
+
+// RACK-style time-based loss detection (RFC 8985). With FEC a first
+// transmission's deadline runs from when its block's parity has gone out.
+class LossDetector {
+private:
+    struct Sent {
+        sequence_t seq;
+        timestamp_t xmit_ts_ns;
+        timestamp_t from_ns;
+    };
+
+    std::deque<Sent> sent_;
+    std::deque<Sent> held_;
+    bool hold_for_fec_ = false;
+    timestamp_t rack_xmit_ns_ = 0;
+    timestamp_t rack_rtt_ns_ = 0;
+    timestamp_t min_rtt_ns_ = 0;
+    timestamp_t srtt_ns_ = 0;
+    uint32_t reo_wnd_mult_ = 1;
+    timestamp_t reo_wnd_grown_ns_ = 0;
+    uint32_t recoveries_ = 0;
+
+    LossStats stats_;
+
+public:
+    LossDetector() = default;
+
+
+    void on_sent(const Pending& packet);
+    void set_hold_for_fec(bool hold) { hold_for_fec_ = hold; }
+    void release_held(sequence_t through, timestamp_t now);
+    void on_delivered(const Pending& packet, timestamp_t now);
+    std::vector<sequence_t> detect_losses(const std::map<sequence_t, Pending>& pending,
+                                          timestamp_t now, timestamp_t& next_deadline);
+    void on_retransmit(Pending& packet, timestamp_t now);
+    void on_tail_probe(Pending& packet, timestamp_t now);
+    void on_spurious(timestamp_t now);
+    void on_recovery();
+
+
+    timestamp_t get_pto_ns(uint32_t max_ack_delay_us, uint32_t backoff = 0) const;
+
+
+    timestamp_t get_reorder_window_ns() const;
+    timestamp_t get_min_rtt_ns() const { return min_rtt_ns_; }
+    timestamp_t get_srtt_ns() const { return srtt_ns_; }
+    const LossStats& get_stats() const { return stats_; }
+};
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "common.hpp"
+#include "packet.hpp"
+#include "network_utils.hpp"
+#include "stats.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct MulticastSenderStats {
+    uint64_t data_sent = 0;
+    uint64_t nacks_received = 0;
+    uint64_t nack_entries = 0;
+    uint64_t repairs_sent = 0;
+    uint64_t repairs_coalesced = 0;
+    uint64_t repairs_unavailable = 0;
+
+    void print_summary() const;
+};
+
+
+struct MulticastSubscriberInfo {
+    sockaddr_in addr{};
+    uint64_t nacks = 0;
+    bool fin_acked = false;
+    FinAckFrame summary{};
+};
+
+
+// Subscribers send only NACKs; a NACKed packet is re-sent to the group at
+// most once per REPAIR_HOLDOFF_US.
+class MulticastSender {
+private:
+    struct History {
+        sequence_t seq = 0;
+        timestamp_t send_ts = 0;
+        timestamp_t intended_ts = 0;
+        timestamp_t repaired_ns = 0;
+    };
+
+    Socket* socket_;
+    sockaddr_in group_addr_;
+    uint32_t expected_subscribers_;
+    Packet data_packet_;
+    Packet repair_packet_;
+    std::vector<uint8_t> recv_buf_;
+    std::vector<sequence_t> nack_seqs_;
+
+    std::mutex history_mutex_;
+    std::vector<History> history_;
+
+    std::vector<MulticastSubscriberInfo> subscribers_;
+    MulticastSenderStats stats_;
+    uint64_t run_id_ = 0;
+    std::atomic<bool> running_{false};
+
+public:
+    MulticastSender(Socket* socket, const sockaddr_in& group_addr, size_t packet_size,
+                    uint32_t expected_subscribers);
+
+
+    // True if at least one subscriber joined.
+    bool announce(const HelloFrame& hello);
+
+
+    // The socket must be non-blocking.
+    void run(uint64_t total_msgs, RateLimiter& limiter);
+
+
+    bool drain(sequence_t final_seq);
+
+
+    const MulticastSenderStats& get_stats() const { return stats_; }
+    const std::vector<MulticastSubscriberInfo>& get_subscribers() const { return subscribers_; }
+    size_t get_fin_acked_count() const;
+    void print_summary() const;
+
+private:
+    void poll_feedback(int64_t timeout_us);
+    void process_feedback(const uint8_t* data, size_t size, const sockaddr_in& src, timestamp_t now);
+    void process_nack(const uint8_t* data, size_t size, const sockaddr_in& src, timestamp_t now);
+    MulticastSubscriberInfo* find_subscriber(const sockaddr_in& addr);
+};
+
+
+struct MulticastSubscriberStats {
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t repaired = 0;
+    uint64_t unrecovered = 0;
+    uint64_t nacks_sent = 0;
+    uint64_t nack_entries = 0;
+    uint64_t stray = 0;
+};
+
+
+// NACKs leave from a separate feedback socket, after NACK_DELAY_US plus a
+// random share of it, so subscribers that lost the same packet do not all NACK.
+class MulticastSubscriber {
+private:
+    struct Gap {
+        timestamp_t nack_at_ns;
+        int nacks;
+    };
+
+    Socket* socket_;
+    Socket* feedback_;
+    int index_;
+    LatencyLogger* logger_;
+    std::mt19937 rng_;
+
+    bool has_session_ = false;
+    bool finished_ = false;
+    HelloFrame session_{};
+    sockaddr_in sender_addr_{};
+    sequence_t highest_seq_ = 0;
+    sequence_t final_seq_ = 0;
+
+    std::map<sequence_t, Gap> missing_;
+    timestamp_t next_nack_ns_ = 0;
+    std::vector<timestamp_t> arrivals_;
+    std::vector<sequence_t> nack_seqs_;
+
+    LatencyStats latency_;
+    MulticastSubscriberStats stats_;
+
+public:
+    MulticastSubscriber(Socket* socket, Socket* feedback, int index, LatencyLogger* logger = nullptr);
+
+
+    void run(const std::atomic<bool>& stop);
+
+    void process_packet(const uint8_t* data, size_t size, const sockaddr_in& src, timestamp_t now);
+    int64_t get_nack_timeout_us() const;
+    void on_nack_timer();
+
+
+    int get_index() const { return index_; }
+    bool has_session() const { return has_session_; }
+    bool is_finished() const { return finished_; }
+    const HelloFrame& get_session() const { return session_; }
+    const LatencyStats& get_latency() const { return latency_; }
+    const MulticastSubscriberStats& get_stats() const { return stats_; }
+
+    timestamp_t get_arrival(sequence_t seq) const { return seq < arrivals_.size() ? arrivals_[seq] : 0; }
+
+private:
+    void start_session(const HelloFrame& hello, const sockaddr_in& src);
+    void process_data(sequence_t seq, timestamp_t send_ts, timestamp_t intended_ts, timestamp_t now);
+    void add_gaps(sequence_t from, sequence_t to, timestamp_t now);
+    void maybe_finish();
+};
+
+
+void print_multicast_report(const std::vector<const MulticastSubscriber*>& subscribers);
+
+}
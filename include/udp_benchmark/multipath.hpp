@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.hpp"
+#include "interval_log.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct RedundancyStats {
+    uint32_t paths = 1;
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    uint64_t redundant_datagrams = 0;
+    uint64_t redundant_bytes = 0;
+    uint64_t redundant_failures = 0;
+    uint64_t retransmits = 0;
+    uint64_t retransmit_bytes = 0;
+
+    double get_overhead_percent() const {
+        return bytes > 0 ? 100.0 * static_cast<double>(redundant_bytes) / bytes : 0.0;
+    }
+
+    void print_summary(const char* title) const;
+};
+
+
+// Which path delivered each sequence first, and how far behind the copies were.
+class PathRace {
+private:
+    struct Entry {
+        sequence_t seq = 0;
+        timestamp_t first_ns = 0;
+        uint32_t paths = 0;
+    };
+
+    struct PathStats {
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        uint64_t copies = 0;
+        uint64_t wins = 0;
+        LatencyHistogram latency;
+    };
+
+    std::vector<Entry> ring_;
+    sequence_t mask_ = 0;
+    std::vector<PathStats> paths_;
+    uint64_t sequences_ = 0;
+    LatencyHistogram combined_;
+    LatencyHistogram lag_;
+
+public:
+    void reset(size_t count, size_t history = config::PATH_RACE_HISTORY);
+    size_t get_path_count() const { return paths_.size(); }
+
+
+    // True when the path had already delivered seq.
+    bool add_copy(size_t path, sequence_t seq, size_t bytes, timestamp_t recv_time, int64_t latency_ns, bool is_new);
+
+    void print_summary(const char* title, int first_port) const;
+};
+
+}
@@ -6,6 +6,8 @@
 #include <arpa/inet.h>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace udp_benchmark {
 
@@ -17,10 +19,22 @@ public:
                                        int recv_buf = config::DEFAULT_BUFFER_SIZE);
     static bool set_socket_nonblocking(int fd);
     static bool set_socket_reuseaddr(int fd);
+    static bool set_socket_reuseport(int fd);
 
 
     static bool parse_address(const std::string& ip, int port, sockaddr_in& addr);
     static bool bind_socket(int fd, const sockaddr_in& addr);
+    static bool wait_readable(int fd, int64_t timeout_us);
+
+    // The search starts at first, so a busy descriptor cannot starve the others.
+    static int wait_any_readable(const std::vector<int>& fds, size_t first, int64_t timeout_us);
+
+
+    static bool is_multicast(const sockaddr_in& addr);
+    static bool join_multicast_group(int fd, const sockaddr_in& group, const std::string& iface = "");
+    static bool set_multicast_ttl(int fd, int ttl);
+    static bool set_multicast_loop(int fd, bool enabled);
+    static bool set_multicast_interface(int fd, const std::string& iface);
 
 
     static bool is_valid_ip(const std::string& ip);
@@ -32,14 +46,40 @@ public:
 };
 
 
+// scheduled marks the qdisc (TX_SCHED) stamp rather than the device hand-off.
+struct TxTimestamp {
+    sequence_t seq = 0;
+    bool scheduled = false;
+    timestamp_t ts_ns = 0;
+};
+
+
+// Takes over a Socket's sends, to impair or simulate the path.
+class DatagramSink {
+public:
+    virtual ssize_t send_datagram(const void* data, size_t size, const sockaddr_in& dest) = 0;
+
+protected:
+    ~DatagramSink() = default;
+};
+
+
 class Socket {
 private:
     int fd_;
+    DatagramSink* sink_ = nullptr;
+
+
+    int timestamping_flags_ = 0;
+    std::mutex tx_mutex_;
+    uint32_t tx_next_id_ = 0;
+    std::vector<sequence_t> tx_ids_;
 
 public:
     Socket();
     explicit Socket(int fd);
-    ~Socket();
+    Socket(int fd, DatagramSink* sink);
+    virtual ~Socket();
 
 
     Socket(const Socket&) = delete;
@@ -56,10 +96,36 @@ public:
                           int recv_buf = config::DEFAULT_BUFFER_SIZE);
     bool set_nonblocking();
     bool set_reuseaddr();
+    bool set_reuseport();
     bool bind(const sockaddr_in& addr);
 
-    ssize_t send_to(const void* data, size_t size, const sockaddr_in& dest);
+
+    bool join_multicast(const sockaddr_in& group, const std::string& iface = "");
+    bool set_multicast_ttl(int ttl);
+    bool set_multicast_loop(bool enabled);
+    bool set_multicast_interface(const std::string& iface);
+
+    bool wait_readable(int64_t timeout_us = -1);
+
+    ssize_t send_to(const void* data, size_t size, const sockaddr_in& dest) {
+        if (__builtin_expect(sink_ != nullptr, 0)) {
+            return sink_->send_datagram(data, size, dest);
+        }
+        return send_direct(data, size, dest);
+    }
     ssize_t recv_from(void* data, size_t size, sockaddr_in* src = nullptr);
+
+
+    bool enable_tx_timestamps();
+    bool enable_rx_timestamps();
+    ssize_t recv_from(void* data, size_t size, sockaddr_in* src, timestamp_t* kernel_rx_ns);
+
+    size_t read_tx_timestamps(TxTimestamp* out, size_t max);
+
+protected:
+    void set_sink(DatagramSink* sink) { sink_ = sink; }
+
+    ssize_t send_direct(const void* data, size_t size, const sockaddr_in& dest);
 };
 
 }
\ No newline at end of file
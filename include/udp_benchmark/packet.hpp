@@ -23,8 +23,10 @@ public:
 
     void set_sequence(sequence_t seq);
     void set_timestamp(timestamp_t ts);
+    void set_intended_timestamp(timestamp_t ts);
     sequence_t get_sequence() const;
     timestamp_t get_timestamp() const;
+    timestamp_t get_intended_timestamp() const;
 
 
     bool has_valid_header() const;
@@ -36,7 +38,7 @@ private:
     std::vector<uint8_t> data_;
 
 public:
-    explicit AckPacket(size_t bitmap_bytes = config::DEFAULT_WINDOW_SIZE / 8);
+    explicit AckPacket(size_t bitmap_bytes = config::DEFAULT_WINDOW_SIZE / 8, size_t dsack_count = 0);
 
 
     uint8_t* data() { return data_.data(); }
@@ -47,9 +49,14 @@ public:
     void set_ack_sequence(sequence_t ack_seq);
     void set_bitmap_length(uint16_t len);
     void set_bitmap_bit(size_t index, bool value);
+    void set_ack_delay_us(uint32_t delay_us);
+    void set_timestamps(const AckTimestamps& timestamps);
+    void set_dsacks(const std::vector<sequence_t>& dsacks);
 
     sequence_t get_ack_sequence() const;
     uint16_t get_bitmap_length() const;
+    uint32_t get_ack_delay_us() const;
+    AckTimestamps get_timestamps() const;
     bool get_bitmap_bit(size_t index) const;
     uint8_t* get_bitmap_data() { return data_.data() + sizeof(AckHeader); }
     const uint8_t* get_bitmap_data() const { return data_.data() + sizeof(AckHeader); }
@@ -62,20 +69,66 @@ public:
 class PacketHandler {
 public:
 
-    static Packet create_data_packet(sequence_t seq, timestamp_t ts, size_t total_size);
+    // intended_ts defaults to ts for unpaced sends.
+    static Packet create_data_packet(sequence_t seq, timestamp_t ts, size_t total_size,
+                                     timestamp_t intended_ts = 0);
+
+    static Packet create_fragment_packet(sequence_t seq, timestamp_t ts, const FragmentLayout& layout,
+                                         timestamp_t intended_ts = 0);
+
+    static Packet create_batch_packet(sequence_t seq, timestamp_t ts, timestamp_t intended_ts,
+                                      const BatchEntry* messages, size_t count, size_t message_size);
+    static size_t batch_packet_size(size_t count, size_t message_size) {
+        return sizeof(PacketHeader) + sizeof(BatchHeader) + count * message_size;
+    }
     static AckPacket create_ack_packet(sequence_t ack_seq,
                                       const std::vector<sequence_t>& missing_seqs,
-                                      size_t window_size = config::DEFAULT_WINDOW_SIZE);
+                                      size_t window_size = config::DEFAULT_WINDOW_SIZE,
+                                      uint32_t ack_delay_us = 0,
+                                      const AckTimestamps& timestamps = AckTimestamps(),
+                                      const std::vector<sequence_t>& dsacks = {});
+    static Packet create_ack_frequency_packet(const AckFrequencyFrame& frame);
+    static Packet create_hello_packet(const HelloFrame& hello);
+    static Packet create_hello_ack_packet(const HelloAckFrame& hello_ack);
+    static Packet create_clock_sync_packet(const ClockSyncFrame& sync);
+    static Packet create_fin_packet(sequence_t final_seq);
+    static Packet create_fin_ack_packet(const FinAckFrame& summary);
+    static Packet create_nack_packet(const std::vector<sequence_t>& missing_seqs);
+    static Packet create_tx_timestamps_packet(const TxTimestampEntry* entries, size_t count);
+    static Packet create_parity_packet(const ParityHeader& parity, const uint8_t* symbol, size_t size);
 
 
     static bool parse_data_packet(const uint8_t* data, size_t size,
-                                 sequence_t& seq, timestamp_t& ts);
+                                 sequence_t& seq, timestamp_t& ts,
+                                 timestamp_t* intended_ts = nullptr);
+    static bool parse_fragment_header(const uint8_t* data, size_t size, FragmentHeader& fragment);
+
+    static bool parse_batch_packet(const uint8_t* data, size_t size, std::vector<BatchEntry>& messages);
     static bool parse_ack_packet(const uint8_t* data, size_t size,
-                                sequence_t& ack_seq, std::vector<sequence_t>& missing_seqs);
+                                sequence_t& ack_seq, std::vector<sequence_t>& missing_seqs,
+                                uint32_t* ack_delay_us = nullptr,
+                                sequence_t* window_end = nullptr,
+                                AckTimestamps* timestamps = nullptr,
+                                std::vector<sequence_t>* dsacks = nullptr);
+    static bool parse_control_type(const uint8_t* data, size_t size, ControlType& type);
+    static bool parse_ack_frequency_packet(const uint8_t* data, size_t size, AckFrequencyFrame& frame);
+    static bool parse_hello_packet(const uint8_t* data, size_t size, HelloFrame& hello);
+    static bool parse_hello_ack_packet(const uint8_t* data, size_t size, HelloAckFrame& hello_ack);
+    static bool parse_clock_sync_packet(const uint8_t* data, size_t size, ClockSyncFrame& sync);
+    static bool parse_fin_packet(const uint8_t* data, size_t size, sequence_t& final_seq);
+    static bool parse_fin_ack_packet(const uint8_t* data, size_t size, FinAckFrame& summary);
+    static bool parse_nack_packet(const uint8_t* data, size_t size, std::vector<sequence_t>& missing_seqs);
+    static bool parse_tx_timestamps_packet(const uint8_t* data, size_t size, std::vector<TxTimestampEntry>& entries);
+
+    static bool parse_parity_packet(const uint8_t* data, size_t size, ParityHeader& parity,
+                                    const uint8_t*& symbol, size_t& symbol_size);
 
 
     static bool is_valid_packet_size(size_t size);
     static bool is_valid_ack_size(size_t size);
+
+private:
+    static Packet create_control_packet(ControlType type, size_t payload_size);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    BRANCH_MISSES,
+    TASK_CLOCK,
+    CONTEXT_SWITCHES,
+    PAGE_FAULTS,
+    COUNT
+};
+
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::COUNT);
+
+// Scaled up for the time a multiplexed counter was not running.
+struct PerfReading {
+    uint64_t values[PERF_EVENT_COUNT] = {};
+
+    uint64_t get(PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    PerfReading delta_since(const PerfReading& start) const;
+};
+
+
+// Counters of the calling thread; events that cannot be opened are left out.
+class PerfCounters {
+private:
+    int fds_[PERF_EVENT_COUNT];
+    bool user_only_ = false;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+
+    bool open();
+    void close();
+
+    bool has(PerfEvent event) const { return fds_[static_cast<size_t>(event)] >= 0; }
+    bool has_hardware() const { return has(PerfEvent::CYCLES) && has(PerfEvent::INSTRUCTIONS); }
+    PerfReading read() const;
+    std::string describe() const;
+};
+
+
+struct PerfPhase {
+    std::string name;
+    uint64_t first_packet = 0;
+    uint64_t packets = 0;
+    PerfReading counts;
+};
+
+
+// Counters are read only at phase and interval boundaries.
+class PerfProfile {
+private:
+    PerfCounters counters_;
+    bool open_ = false;
+    uint64_t interval_packets_ = 0;
+
+    std::vector<PerfPhase> phases_;
+    std::vector<PerfPhase> intervals_;
+    PerfPhase phase_;
+    PerfPhase interval_;
+    bool in_phase_ = false;
+    PerfReading phase_start_;
+    PerfReading interval_start_;
+    uint64_t total_packets_ = 0;
+
+public:
+    // Must be called from the thread that calls every other method.
+    bool open(uint64_t interval_packets);
+    bool is_open() const { return open_; }
+
+    void begin_phase(const char* name);
+    void end_phase();
+
+    void add_packets(uint64_t count = 1) {
+        phase_.packets += count;
+        interval_.packets += count;
+        if (interval_packets_ > 0 && interval_.packets >= interval_packets_) {
+            close_interval();
+        }
+    }
+
+    void print_summary(const char* title) const;
+
+private:
+    void close_interval();
+    void print_phase(const PerfPhase& phase) const;
+};
+
+}
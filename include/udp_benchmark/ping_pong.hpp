@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.hpp"
+#include "packet.hpp"
+#include "network_utils.hpp"
+#include "stats.hpp"
+#include <functional>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct PingPongStats {
+    uint64_t requests = 0;
+    uint64_t responses = 0;
+    uint64_t timeouts = 0;
+    uint64_t late_responses = 0;
+    bool peer_unresponsive = false;
+
+    void print_summary(uint32_t max_outstanding) const;
+};
+
+
+// Closed-loop request/response client; a request unanswered after the
+// timeout counts as lost.
+class PingPongClient {
+public:
+    using SendCallback = std::function<void(sequence_t, timestamp_t)>;
+    // (seq, send_time, response_time, intended_send_time)
+    using RttCallback = std::function<void(sequence_t, timestamp_t, timestamp_t, timestamp_t)>;
+    using ControlCallback = std::function<void(const uint8_t*, size_t)>;
+
+private:
+    struct Request {
+        sequence_t seq = 0;
+        timestamp_t send_ts = 0;
+        timestamp_t intended_ts = 0;
+    };
+
+    Socket* socket_;
+    sockaddr_in peer_addr_;
+    Packet request_;
+    std::vector<uint8_t> recv_buf_;
+
+    std::vector<Request> slots_;
+    sequence_t slot_mask_ = 0;
+    uint32_t max_outstanding_;
+    uint32_t outstanding_ = 0;
+    sequence_t next_seq_ = 1;
+    sequence_t oldest_seq_ = 1;
+    timestamp_t timeout_ns_;
+    timestamp_t last_response_ns_ = 0;
+
+    PingPongStats stats_;
+    SendCallback send_callback_;
+    RttCallback rtt_callback_;
+    ControlCallback control_callback_;
+
+public:
+    PingPongClient(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size,
+                   uint32_t max_outstanding,
+                   timestamp_t timeout_ns = static_cast<timestamp_t>(config::PING_PONG_TIMEOUT_MS) * 1000000);
+
+
+    // The socket must be non-blocking.
+    void run(uint64_t total_requests, RateLimiter& limiter);
+
+
+    void set_send_callback(SendCallback callback) { send_callback_ = callback; }
+    void set_rtt_callback(RttCallback callback) { rtt_callback_ = callback; }
+    void set_control_callback(ControlCallback callback) { control_callback_ = callback; }
+    const PingPongStats& get_stats() const { return stats_; }
+    uint32_t get_outstanding() const { return outstanding_; }
+
+private:
+    bool send_request(sequence_t seq, timestamp_t intended_ts);
+    void process_response(const uint8_t* data, size_t size, timestamp_t now);
+    void expire_requests(timestamp_t now);
+    int64_t get_wait_us(uint64_t total_requests, timestamp_t now) const;
+};
+
+}
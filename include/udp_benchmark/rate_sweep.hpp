@@ -0,0 +1,79 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct SweepConfig {
+    double start_rate = 0;
+    double max_rate = 0;
+    double factor = 2.0;
+    int step_ms = config::SWEEP_STEP_MS;
+    double slo_p99_us = 0;
+
+    bool enabled() const { return max_rate > 0; }
+
+    static bool parse(const char* spec, SweepConfig& config);
+};
+
+// losses are the datagrams still unacknowledged after the step's drain.
+struct SweepStep {
+    double offered_rate = 0;
+    double achieved_rate = 0;
+    uint64_t sent = 0;
+    uint64_t datagrams = 0;
+    uint64_t measured = 0;
+    uint64_t losses = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double p999_us = 0;
+    double corrected_p99_us = 0;
+    double cpu_percent = 0;
+    bool meets_slo = true;
+
+    bool has_data() const { return measured > 0; }
+
+    double get_loss_percent() const {
+        return datagrams > 0 ? losses * 100.0 / datagrams : 0.0;
+    }
+};
+
+
+// Steps the rate geometrically until a step's p99 misses the SLO.
+class RateSweep {
+private:
+    SweepConfig config_;
+    std::vector<SweepStep> steps_;
+    double current_rate_;
+    bool done_ = false;
+
+public:
+    explicit RateSweep(const SweepConfig& config);
+
+
+    bool has_next() const { return !done_; }
+    double get_next_rate() const { return current_rate_; }
+    const SweepConfig& get_config() const { return config_; }
+
+    uint64_t get_planned_messages() const;
+
+
+    void record_step(SweepStep step);
+
+
+    double get_knee_rate() const;
+    const std::vector<SweepStep>& get_steps() const { return steps_; }
+
+
+    // JSON if path ends in ".json", else CSV.
+    bool write_results(const std::string& path) const;
+    void print_summary() const;
+
+
+    static double get_cpu_seconds();
+};
+
+}
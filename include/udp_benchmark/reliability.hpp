@@ -2,8 +2,13 @@
 
 #include "common.hpp"
 #include "packet.hpp"
+#include "loss_detection.hpp"
+#include "clock_sync.hpp"
+#include "congestion_control.hpp"
+#include "multipath.hpp"
+#include "fec.hpp"
+#include <deque>
 #include <map>
-#include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <thread>
@@ -17,78 +22,240 @@ namespace udp_benchmark {
 
 class Socket;
 
-class ReliabilityManager {
+template <class Clock, class Mutex = std::mutex>
+class BasicReliabilityManager {
 public:
     using RetransmitCallback = std::function<void(const Packet&, const sockaddr_in&)>;
-    using AckCallback = std::function<void(sequence_t, timestamp_t, timestamp_t, int)>;
+    // (seq, send_time, ack_recv_time, retransmits, intended_send_time)
+    using AckCallback = std::function<void(sequence_t, timestamp_t, timestamp_t, int, timestamp_t)>;
+    // Rebuilds datagram seq for retransmission.
+    using PacketBuilder = std::function<Packet(sequence_t, timestamp_t, timestamp_t)>;
 
 private:
+    struct Retransmitted {
+        sequence_t seq;
+        int unmatched;
+    };
+
     std::map<sequence_t, Pending> pending_packets_;
-    std::map<sequence_t, timestamp_t> send_times_;
-    mutable std::mutex pending_mutex_;
+    std::map<sequence_t, Pending> sacked_packets_;
+    mutable Mutex pending_mutex_;
     std::atomic<bool> running_{true};
 
+    LossDetector loss_detector_;
+    timestamp_t loss_deadline_ns_ = 0;
+    timestamp_t last_activity_ns_ = 0;
+    uint32_t probe_backoff_ = 0;
+    timestamp_t recovery_start_ns_ = 0;
+
+    // Retransmitted and since acknowledged, so a late D-SACK can be matched.
+    std::vector<Retransmitted> retransmitted_;
+    uint32_t max_ack_delay_us_ = config::DEFAULT_MAX_ACK_DELAY_US;
+    uint32_t reported_ack_delay_us_ = 0;
+    FragmentLayout layout_{config::MIN_MESSAGE_SIZE, 0};
+
     RetransmitCallback retransmit_callback_;
     AckCallback ack_callback_;
+    PacketBuilder packet_builder_;
+    EnhancedCongestionController* congestion_ = nullptr;
+    std::deque<sequence_t> lost_;
 
 
     int max_retransmits_ = 3;
     std::chrono::milliseconds ack_timeout_{1000};
 
 public:
-    explicit ReliabilityManager(RetransmitCallback retransmit_cb = nullptr,
-                               AckCallback ack_cb = nullptr);
-    ~ReliabilityManager();
+    explicit BasicReliabilityManager(RetransmitCallback retransmit_cb = nullptr,
+                                     AckCallback ack_cb = nullptr);
+    ~BasicReliabilityManager();
 
 
-    void add_pending_packet(sequence_t seq, timestamp_t send_time);
+    void add_pending_packet(sequence_t seq, timestamp_t send_time, timestamp_t intended_time = 0);
     void remove_pending_packet(sequence_t seq);
     bool is_packet_pending(sequence_t seq) const;
 
 
-    void process_ack(sequence_t ack_seq, const std::vector<sequence_t>& missing_seqs);
+    // missing_seqs are the holes in (ack_seq, window_end]; dsacks arrived twice.
+    // Returns how many packets the ACK reports delivered for the first time.
+    size_t process_ack(sequence_t ack_seq, const std::vector<sequence_t>& missing_seqs,
+                     sequence_t window_end, const std::vector<sequence_t>& dsacks = {});
+    void on_loss_timer();
+    int64_t get_loss_timeout_us() const;
+
+    // With FEC, loss detection waits until release_fec_block() covers the packet.
+    void set_hold_for_fec(bool hold);
+    void release_fec_block(sequence_t through, timestamp_t now);
+    int64_t get_pto_us() const;
+    timestamp_t get_srtt_ns() const;
+    timestamp_t get_min_rtt_ns() const;
 
 
     size_t get_pending_count() const;
     std::vector<sequence_t> get_pending_sequences() const;
+    LossStats get_loss_stats() const;
 
 
     void set_max_retransmits(int max_retransmits) { max_retransmits_ = max_retransmits; }
     void set_ack_timeout(std::chrono::milliseconds timeout) { ack_timeout_ = timeout; }
+    void set_packet_size(size_t packet_size) { layout_ = FragmentLayout(static_cast<uint32_t>(packet_size), 0); }
+    void set_fragment_layout(const FragmentLayout& layout) { layout_ = layout; }
+    void set_max_ack_delay_us(uint32_t delay_us) { max_ack_delay_us_ = delay_us; }
+
+    // The probe timeout allows for the largest reported ACK delay.
+    void on_ack_delay(uint32_t ack_delay_us);
     void set_retransmit_callback(RetransmitCallback callback) { retransmit_callback_ = callback; }
     void set_ack_callback(AckCallback callback) { ack_callback_ = callback; }
+    void set_packet_builder(PacketBuilder builder) { packet_builder_ = builder; }
+
+    // The first loss of each round halves the window.
+    void set_congestion_controller(EnhancedCongestionController* congestion) { congestion_ = congestion; }
 
 
     void start();
     void stop();
 
 private:
-    void retransmit_expired_packets();
+    void retransmit_expired_packets(timestamp_t now);
+    void on_dsack(sequence_t seq, timestamp_t now);
+    void on_packet_delivered(const Pending& packet);
+    void send_retransmission(sequence_t seq, Pending& pending, timestamp_t now);
+    timestamp_t get_probe_deadline() const;
+    void send_tail_probe(timestamp_t now);
+    Packet build_packet(sequence_t seq, const Pending& pending) const;
 };
 
+using ReliabilityManager = BasicReliabilityManager<SystemClock>;
+
+
+struct AckStats {
+    uint64_t data_packets = 0;
+    uint64_t acks = 0;
+    uint64_t immediate_acks = 0;
+    uint64_t timer_acks = 0;
+    uint64_t total_ack_delay_ns = 0;
+    uint64_t max_ack_delay_ns = 0;
+    uint64_t late_acks = 0;
+    uint64_t duplicate_packets = 0;
+    uint64_t send_failures = 0;
+
+    double get_acks_per_packet() const {
+        return data_packets > 0 ? static_cast<double>(acks) / data_packets : 0.0;
+    }
+
+    // Receiver: per-packet hold before its ACK left. Sender: hold reported per ACK.
+    double get_mean_ack_delay_us(uint64_t samples) const {
+        return samples > 0 ? static_cast<double>(total_ack_delay_ns) / (samples * 1000.0) : 0.0;
+    }
+
+    void print_summary(const char* title, bool per_packet_delay) const;
+};
 
-class AckManager {
+
+// Receive-path statistics per RFC 3550 (jitter) and RFC 4737 (reordering).
+struct ReceiveQualityStats {
+    // Power-of-two ranges: 1, 2, 3-4, 5-8 and so on; the last is open.
+    static constexpr size_t BUCKETS = 16;
+
+    uint64_t jitter_samples = 0;
+    double jitter_ns = 0.0;
+    double max_jitter_ns = 0.0;
+
+    uint64_t loss_bursts = 0;
+    uint64_t skipped = 0;
+    uint64_t max_burst = 0;
+    uint64_t burst_lengths[BUCKETS] = {};
+
+    uint64_t reordered = 0;
+    uint64_t max_reorder_distance = 0;
+    uint64_t reorder_distances[BUCKETS] = {};
+    uint64_t max_reorder_extent = 0;
+    uint64_t reorder_extents[BUCKETS] = {};
+    uint64_t extents_beyond_history = 0;
+
+    uint64_t duplicates = 0;
+
+    static size_t bucket_of(uint64_t value) {
+        return value <= 1 ? 0 : std::min<size_t>(64 - __builtin_clzll(value - 1), BUCKETS - 1);
+    }
+
+    uint64_t get_missing() const { return skipped - reordered; }
+
+    void print_summary(const char* title) const;
+};
+
+class ReceiveQuality {
 private:
-    std::unordered_map<sequence_t, timestamp_t> received_packets_;
+    struct Advance {
+        sequence_t seq;
+        uint64_t arrival;
+    };
+
+    ReceiveQualityStats stats_;
+    std::vector<Advance> advances_;
+    size_t advance_head_ = 0;
+    size_t advance_count_ = 0;
+    bool advances_dropped_ = false;
+    sequence_t highest_ = 0;
+    uint64_t arrivals_ = 0;
+    int64_t last_transit_ns_ = 0;
+    bool has_transit_ = false;
+
+public:
+    ReceiveQuality() : advances_(config::REORDER_EXTENT_HISTORY) {}
+
+    // A new, non-duplicate arrival; send_ts is 0 when the packet carries none.
+    void add_arrival(sequence_t seq, timestamp_t recv_time, timestamp_t send_ts);
+    void add_duplicate() { stats_.duplicates++; }
+
+    const ReceiveQualityStats& get_stats() const { return stats_; }
+};
+
+
+// ACKs every ack_period packets or max_ack_delay_us after the oldest
+// unacknowledged arrival; gaps and duplicates are ACKed at once.
+template <class Mutex>
+class BasicAckManager {
+private:
+    std::vector<timestamp_t> recv_ring_;
+    sequence_t ring_mask_ = 0;
     sequence_t highest_contiguous_ = 0;
-    mutable std::mutex received_mutex_;
+    sequence_t highest_received_ = 0;
+    uint64_t received_count_ = 0;
+    mutable Mutex received_mutex_;
 
 
     int window_size_ = config::DEFAULT_WINDOW_SIZE;
     int ack_period_ = config::DEFAULT_ACK_PERIOD;
+    uint32_t max_ack_delay_us_ = config::DEFAULT_MAX_ACK_DELAY_US;
     uint64_t packets_since_ack_ = 0;
+    timestamp_t oldest_unacked_ns_ = 0;
+    timestamp_t unacked_recv_sum_ns_ = 0;
+    bool ack_immediately_ = false;
+    bool expect_copies_ = false;
+    bool expect_repairs_ = false;
+    AckStats stats_;
+    ReceiveQuality quality_;
+
+
+    timestamp_t echo_send_ts_ = 0;
+    timestamp_t echo_recv_ts_ = 0;
+    std::vector<sequence_t> dsacks_;
 
 public:
-    explicit AckManager(int window_size = config::DEFAULT_WINDOW_SIZE,
-                       int ack_period = config::DEFAULT_ACK_PERIOD);
+    explicit BasicAckManager(int window_size = config::DEFAULT_WINDOW_SIZE,
+                             int ack_period = config::DEFAULT_ACK_PERIOD,
+                             uint32_t max_ack_delay_us = config::DEFAULT_MAX_ACK_DELAY_US,
+                             size_t max_inflight = config::MAX_CWND);
 
 
-    bool add_received_packet(sequence_t seq, timestamp_t recv_time);
+    bool add_received_packet(sequence_t seq, timestamp_t recv_time, timestamp_t send_ts = 0);
+    void add_dsack(sequence_t seq);
     bool is_duplicate(sequence_t seq) const;
 
 
-    bool should_send_ack() const;
-    AckPacket generate_ack();
+    bool should_send_ack(timestamp_t now) const;
+    timestamp_t get_ack_deadline() const;
+    AckPacket generate_ack(timestamp_t now);
     void force_ack();
 
 
@@ -97,67 +264,264 @@ public:
     std::vector<sequence_t> get_missing_sequences(sequence_t up_to_seq) const;
 
 
-    void set_window_size(int window_size) { window_size_ = window_size; }
+    void set_window_size(int window_size) { reserve_window(window_size, recv_ring_.size()); }
     void set_ack_period(int ack_period) { ack_period_ = ack_period; }
+    void set_ack_policy(int ack_period, uint32_t max_ack_delay_us);
+
+    // With redundant paths duplicates are expected and do not force an ACK.
+    void set_expect_copies(bool expect_copies) { expect_copies_ = expect_copies; }
+
+    // With FEC only a filled hole forces an immediate ACK.
+    void set_expect_repairs(bool expect_repairs) { expect_repairs_ = expect_repairs; }
+    AckStats get_ack_stats() const;
+    ReceiveQualityStats get_receive_quality() const;
 
 
-    void cleanup_old_packets(sequence_t before_seq);
+    void reserve_window(int window_size, size_t max_inflight);
+
+    // Drops holes too old to fit seq in the ring; used without retransmission.
+    void make_room(sequence_t seq);
+
+private:
+    bool is_received_locked(sequence_t seq) const;
 };
 
+using AckManager = BasicAckManager<std::mutex>;
+
+
+template <class Clock, class Mutex = std::mutex>
+class BasicSenderReliability {
+public:
+    using Manager = BasicReliabilityManager<Clock, Mutex>;
 
-class SenderReliability {
 private:
-    ReliabilityManager reliability_mgr_;
+    Manager reliability_mgr_;
     Socket* socket_;
     sockaddr_in peer_addr_;
-    size_t packet_size_;
+    FragmentLayout layout_;
+    typename Manager::PacketBuilder packet_builder_;
+
+    AckStats ack_stats_;
+    mutable Mutex ack_stats_mutex_;
+
+    std::atomic<bool> hello_acked_{false};
+    uint64_t run_id_ = 0;
+
+    AckFrequencyFrame ack_frequency_{};
+    timestamp_t ack_frequency_sent_ns_ = 0;
+    std::atomic<bool> ack_frequency_acked_{true};
+
+    std::atomic<bool> fin_acked_{false};
+    FinAckFrame receiver_summary_{};
+
+    ClockSync clock_sync_;
+    uint64_t clock_sync_epoch_sent_ = UINT64_MAX;
+    uint64_t clock_sync_uncertainty_sent_ = 0;
+
+    struct SendPath {
+        Socket* socket;
+        sockaddr_in peer;
+        bool hello_acked;
+    };
+
+    std::vector<SendPath> paths_;
+    RedundancyStats redundancy_;
+    size_t retransmit_path_ = 0;
+
+    FecEncoder fec_;
+    std::vector<Packet> fec_parity_;
 
 public:
-    SenderReliability(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size);
+    BasicSenderReliability(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size);
+
+
+    // Data goes out on every path, retransmissions on each in turn.
+    void add_path(Socket* socket, const sockaddr_in& peer);
+    size_t get_path_count() const { return paths_.size() + 1; }
+    void poll_paths();
+    bool are_paths_acked() const;
+    RedundancyStats get_redundancy_stats() const;
+
+
+    // Set before the session starts; parity follows each block's last packet.
+    void set_fec_code(const FecCode& code);
+    const FecCode& get_fec_code() const { return fec_.get_code(); }
+    void flush_fec();
+    const FecSendStats& get_fec_stats() const { return fec_.get_stats(); }
+
+
+    // false only if the first send failed; the packet is pending either way.
+    bool send_packet(sequence_t seq, timestamp_t send_time, timestamp_t intended_time = 0);
+    // Packets newly delivered, or 0 if the datagram is not a valid ACK.
+    size_t process_ack_packet(const uint8_t* data, size_t size);
+    bool process_control_packet(const uint8_t* data, size_t size);
+
+    // Repeated every probe timeout until the receiver echoes it.
+    bool send_ack_frequency(uint32_t ack_period, uint32_t max_ack_delay_us);
+    bool is_ack_frequency_acked() const;
+
 
+    bool send_hello(const HelloFrame& hello);
+    bool is_hello_acked() const { return hello_acked_.load(); }
 
-    bool send_packet(sequence_t seq, timestamp_t send_time);
-    void process_ack_packet(const uint8_t* data, size_t size);
 
+    bool send_fin(sequence_t final_seq);
+    bool is_fin_acked() const { return fin_acked_.load(); }
+    FinAckFrame get_receiver_summary() const;
 
-    void set_ack_callback(ReliabilityManager::AckCallback callback);
+
+    ClockEstimate get_clock_estimate() const;
+
+
+    void set_ack_callback(typename Manager::AckCallback callback);
+    void set_congestion_controller(EnhancedCongestionController* congestion) {
+        reliability_mgr_.set_congestion_controller(congestion);
+    }
+
+
+    void set_fragment_layout(const FragmentLayout& layout);
+    const FragmentLayout& get_fragment_layout() const { return layout_; }
+
+
+    // Replaces the built-in data packets, e.g. with coalesced batches.
+    void set_packet_builder(typename Manager::PacketBuilder builder);
 
 
     size_t get_pending_count() const { return reliability_mgr_.get_pending_count(); }
+    bool is_packet_pending(sequence_t seq) const { return reliability_mgr_.is_packet_pending(seq); }
+    AckStats get_ack_stats() const;
+    LossStats get_loss_stats() const { return reliability_mgr_.get_loss_stats(); }
+
+
+    // Microseconds until the next reorder-window expiry, or -1 when none is armed.
+    int64_t get_loss_timeout_us() const;
+    int64_t get_pto_us() const { return reliability_mgr_.get_pto_us(); }
+    timestamp_t get_srtt_ns() const { return reliability_mgr_.get_srtt_ns(); }
+    timestamp_t get_min_rtt_ns() const { return reliability_mgr_.get_min_rtt_ns(); }
+    void on_loss_timer();
 
 
     void start() { reliability_mgr_.start(); }
     void stop() { reliability_mgr_.stop(); }
 
 private:
+    void send_copies(const Packet& packet, ssize_t sent);
+    void send_parity();
     void retransmit_packet(const Packet& packet, const sockaddr_in& dest);
-    void handle_ack(sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits);
+    void handle_ack(sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits,
+                    timestamp_t intended_time);
+    void add_clock_sample(timestamp_t t1, timestamp_t t2, timestamp_t t3, timestamp_t t4);
 };
 
+using SenderReliability = BasicSenderReliability<SystemClock>;
 
-class ReceiverReliability {
+
+template <class Clock, class Mutex = std::mutex>
+class BasicReceiverReliability {
 private:
-    AckManager ack_mgr_;
+    BasicAckManager<Mutex> ack_mgr_;
     Socket* socket_;
     sockaddr_in sender_addr_;
     bool sender_addr_set_ = false;
 
+    HelloFrame session_{};
+    bool session_started_ = false;
+    uint64_t stray_packets_ = 0;
+    uint32_t ack_frequency_id_ = 0;
+
+    sequence_t fin_seq_ = 0;
+    bool fin_received_ = false;
+    bool finished_ = false;
+
+    ClockEstimate clock_estimate_;
+
+    struct ReceivePath {
+        Socket* socket;
+        sockaddr_in peer;
+        bool has_peer;
+    };
+
+    std::vector<ReceivePath> paths_;
+    PathRace race_;
+
+    FecDecoder fec_;
+    std::vector<Packet> fec_rebuilt_;
+    std::deque<Packet> recovered_;
+
 public:
-    explicit ReceiverReliability(Socket* socket,
-                                int window_size = config::DEFAULT_WINDOW_SIZE,
-                                int ack_period = config::DEFAULT_ACK_PERIOD);
+    explicit BasicReceiverReliability(Socket* socket,
+                                      int window_size = config::DEFAULT_WINDOW_SIZE,
+                                      int ack_period = config::DEFAULT_ACK_PERIOD,
+                                      uint32_t max_ack_delay_us = config::DEFAULT_MAX_ACK_DELAY_US);
 
 
-    bool process_data_packet(const uint8_t* data, size_t size, const sockaddr_in& sender);
+    bool process_data_packet(const uint8_t* data, size_t size, const sockaddr_in& sender, size_t path = 0);
+    bool process_control_packet(const uint8_t* data, size_t size, const sockaddr_in& sender, size_t path = 0);
     void send_ack_if_needed();
     void force_ack();
 
 
+    // Microseconds until the delayed-ACK timer fires, or -1 when nothing is owed.
+    int64_t get_ack_timeout_us() const;
+    void on_ack_timer() { send_ack_if_needed(); }
+
+
     size_t get_received_count() const { return ack_mgr_.get_received_count(); }
     sequence_t get_highest_contiguous() const { return ack_mgr_.get_highest_contiguous(); }
+    AckStats get_ack_stats() const { return ack_mgr_.get_ack_stats(); }
+    ReceiveQualityStats get_receive_quality() const { return ack_mgr_.get_receive_quality(); }
+
+
+    // Data is accepted only from the address whose HELLO opened the session.
+    bool has_session() const { return session_started_; }
+    const HelloFrame& get_session() const { return session_; }
+    uint64_t get_stray_count() const { return stray_packets_; }
+
+
+    bool is_echo_mode() const { return session_started_ && (session_.flags & HELLO_FLAG_ECHO) != 0; }
+
+
+    // Answers HELLOs on its own socket; copies beyond the first are duplicates.
+    size_t add_path(Socket* socket);
+    size_t get_path_count() const { return paths_.size() + 1; }
+    const PathRace& get_path_race() const { return race_; }
+
+
+    // Packets rebuilt from parity, for the caller to handle as arrivals.
+    bool take_recovered(Packet& packet);
+    void finish_fec() { fec_.finish(); }
+    const FecCode& get_fec_code() const { return fec_.get_code(); }
+    const FecReceiveStats& get_fec_stats() const { return fec_.get_stats(); }
+
+
+    // Zero until the first CLOCK_SYNC.
+    int64_t get_clock_offset_ns(timestamp_t send_ts) const {
+        return clock_estimate_.is_valid() ? clock_estimate_.offset_at(send_ts) : 0;
+    }
+    const ClockEstimate& get_clock_estimate() const { return clock_estimate_; }
+    bool is_session_peer(const sockaddr_in& addr) const;
+
+
+    // True once every packet up to the sender's FIN has arrived and been FIN-ACKed.
+    bool is_finished() const { return finished_; }
 
 private:
     void send_ack();
+    void send_fin_ack_if_complete();
+    void send_fin_ack();
+    void accept_recovered();
 };
 
+using ReceiverReliability = BasicReceiverReliability<SystemClock>;
+
+
+extern template class BasicAckManager<std::mutex>;
+extern template class BasicAckManager<NullMutex>;
+extern template class BasicReliabilityManager<SystemClock>;
+extern template class BasicReliabilityManager<VirtualClock, NullMutex>;
+extern template class BasicSenderReliability<SystemClock>;
+extern template class BasicSenderReliability<VirtualClock, NullMutex>;
+extern template class BasicReceiverReliability<SystemClock>;
+extern template class BasicReceiverReliability<VirtualClock, NullMutex>;
+
 }
\ No newline at end of file
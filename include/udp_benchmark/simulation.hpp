@@ -0,0 +1,182 @@
+#pragma once
+
+#include "common.hpp"
+#include "impairment.hpp"
+#include "reliability.hpp"
+#include "congestion_control.hpp"
+#include "stats.hpp"
+#include "fec.hpp"
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+struct SimConfig {
+    size_t msg_size = 128;
+    double rate = 0;
+    uint64_t total = 100000;
+    uint32_t ack_period = config::DEFAULT_ACK_PERIOD;
+    uint32_t max_ack_delay_us = config::DEFAULT_MAX_ACK_DELAY_US;
+
+    ImpairmentConfig forward;
+    ImpairmentConfig reverse;
+
+    FecCode fec;
+
+    uint64_t time_limit_s = config::SIM_TIME_LIMIT_S;
+};
+
+
+struct SimLinkStats {
+    uint64_t offered = 0;
+    uint64_t delivered = 0;
+    uint64_t lost = 0;
+    uint64_t queue_drops = 0;
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+    uint64_t max_queue = 0;
+};
+
+
+// One direction of the path: loss, a token-bucket bottleneck, then delay.
+class SimLink {
+private:
+    ImpairmentModel model_;
+    std::deque<timestamp_t> backlog_;
+    SimLinkStats stats_;
+    LatencyStats queue_delay_;
+
+public:
+    explicit SimLink(const ImpairmentConfig& config);
+
+
+    int transmit(size_t size, timestamp_t now, timestamp_t arrivals[2]);
+
+
+    const SimLinkStats& get_stats() const { return stats_; }
+    const LatencyStats& get_queue_delay() const { return queue_delay_; }
+};
+
+
+struct SimResult {
+    bool completed = false;
+    timestamp_t virtual_ns = 0;
+    double wall_seconds = 0;
+    uint64_t events = 0;
+
+    uint64_t total = 0;
+    uint64_t delivered = 0;
+    uint64_t bytes_delivered = 0;
+
+    LatencyStats rtt;
+    LatencyStats one_way;
+    LatencyStats queue_delay;
+    LatencyStats recovery;
+
+    LossStats loss;
+    SimLinkStats forward;
+    SimLinkStats reverse;
+
+    FecCode fec;
+    FecSendStats fec_sent;
+    FecReceiveStats fec_received;
+
+    // FNV-1a over every delivery and the finish time.
+    uint64_t digest = 0;
+
+    double get_goodput() const {
+        return virtual_ns > 0 ? delivered * 1e9 / virtual_ns : 0.0;
+    }
+
+    void print_summary() const;
+    bool write_json(const std::string& path) const;
+
+    // Tail latency against parity cost, one row per run of the same links and seeds.
+    static void print_comparison(const std::vector<SimResult>& results);
+};
+
+
+class SimLinkSink;
+
+// In virtual time and without locks, since one thread drives both ends.
+using SimSender = BasicSenderReliability<VirtualClock, NullMutex>;
+using SimReceiver = BasicReceiverReliability<VirtualClock, NullMutex>;
+
+// Discrete-event run of the real protocol code over a pair of SimLinks.
+class Simulation {
+private:
+    enum class EventType : uint8_t { TO_RECEIVER, TO_SENDER, SENDER_WAKE, SENDER_TIMER, RECEIVER_TIMER };
+    enum class Phase { HELLO, DATA, FIN, DONE };
+
+    struct Event {
+        timestamp_t time;
+        uint64_t order;
+        uint32_t arg;
+        EventType type;
+
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : order > other.order;
+        }
+    };
+
+    SimConfig config_;
+    SimLink forward_;
+    SimLink reverse_;
+    sockaddr_in sender_addr_{};
+    sockaddr_in receiver_addr_{};
+
+    std::unique_ptr<SimLinkSink> sender_sink_;
+    std::unique_ptr<SimLinkSink> receiver_sink_;
+    Socket sender_socket_;
+    Socket receiver_socket_;
+    std::unique_ptr<SimSender> sender_;
+    std::unique_ptr<SimReceiver> receiver_;
+    EnhancedCongestionController congestion_;
+    RateLimiter rate_limiter_;
+
+    std::vector<Event> events_;
+    uint64_t next_order_ = 0;
+    std::vector<std::vector<uint8_t>> buffers_;
+    std::vector<size_t> buffer_sizes_;
+    std::vector<uint32_t> free_slots_;
+    Packet recovered_;
+
+    Phase phase_ = Phase::HELLO;
+    sequence_t next_seq_ = 1;
+    timestamp_t next_control_ns_ = 0;
+    timestamp_t start_ns_ = 0;
+    timestamp_t wake_at_ = 0;
+    timestamp_t sender_timer_at_ = 0;
+    uint32_t sender_timer_gen_ = 0;
+    timestamp_t receiver_timer_at_ = 0;
+    uint32_t receiver_timer_gen_ = 0;
+
+    SimResult result_;
+
+    friend class SimLinkSink;
+
+public:
+    explicit Simulation(const SimConfig& config);
+    ~Simulation();
+
+
+    SimResult run();
+
+private:
+    void transmit(bool from_sender, const void* data, size_t size);
+    void schedule(timestamp_t time, EventType type, uint32_t arg = 0);
+
+    void deliver_to_receiver(const uint8_t* data, size_t size, timestamp_t now);
+    void record_delivery(const uint8_t* data, size_t size, timestamp_t now);
+    void deliver_to_sender(const uint8_t* data, size_t size);
+    void drive_sender(timestamp_t now);
+    void wake_sender_at(timestamp_t time);
+    void arm_sender_timer(timestamp_t now);
+    void arm_receiver_timer(timestamp_t now);
+    void mix_digest(uint64_t value);
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "traffic.hpp"
 #include <string>
 #include <fstream>
 #include <vector>
@@ -10,6 +11,7 @@
 namespace udp_benchmark {
 
 
+// Rows are formatted into a buffer and written out in large chunks.
 class LatencyLogger {
 private:
     std::ofstream file_;
@@ -17,6 +19,11 @@ private:
     std::string filename_;
     bool header_written_ = false;
 
+    std::string buffer_;
+    size_t buffer_limit_ = config::LOG_BUFFER_SIZE;
+    uint64_t run_id_ = 0;
+    bool kernel_timestamps_ = false;
+
 public:
     explicit LatencyLogger(const std::string& filename);
     ~LatencyLogger();
@@ -24,12 +31,23 @@ public:
     bool is_open() const { return file_.is_open(); }
 
 
+    void set_run_id(uint64_t run_id) { run_id_ = run_id; }
+
+    // Set before the first row.
+    void set_kernel_timestamps(bool enabled) { kernel_timestamps_ = enabled; }
+    void reserve_buffer(size_t bytes);
+
+
     void log_sender_data(sequence_t seq, timestamp_t send_ts,
-                        timestamp_t ack_recv_ts, int retransmits);
+                        timestamp_t ack_recv_ts, int retransmits,
+                        timestamp_t intended_ts = 0, timestamp_t tx_sched_ns = 0,
+                        timestamp_t tx_ns = 0);
 
 
+    // clock_offset_ns is the (receiver - sender) offset applied to this packet.
     void log_receiver_data(sequence_t seq, timestamp_t recv_ts,
-                          timestamp_t send_ts);
+                          timestamp_t send_ts, int64_t clock_offset_ns = 0,
+                          timestamp_t intended_ts = 0, timestamp_t kernel_rx_ns = 0);
 
 
     void log_csv_row(const std::vector<std::string>& values);
@@ -40,6 +58,10 @@ public:
 private:
     void write_sender_header();
     void write_receiver_header();
+    void write_run_id();
+    void append_value(uint64_t value, char separator);
+    void append_value(int64_t value, char separator);
+    void flush_buffer_if_full();
 };
 
 
@@ -48,6 +70,7 @@ struct LatencyStats {
     uint64_t total_latency_ns = 0;
     uint64_t min_latency_ns = UINT64_MAX;
     uint64_t max_latency_ns = 0;
+    uint64_t negative_count = 0;
 
     std::vector<uint64_t> latencies;
 
@@ -76,11 +99,14 @@ struct LatencyStats {
     uint64_t get_percentile_latency_ns(double percentile) const;
     double get_percentile_latency_us(double percentile) const;
 
+    void print_distribution(const char* title) const;
+
     void reset() {
         packet_count = 0;
         total_latency_ns = 0;
         min_latency_ns = UINT64_MAX;
         max_latency_ns = 0;
+        negative_count = 0;
         latencies.clear();
     }
 };
@@ -103,12 +129,14 @@ struct ThroughputStats {
 
     double get_packet_rate() const {
         double duration = get_duration_seconds();
-        return duration > 0 ? packets_sent / duration : 0.0;
+        uint64_t packets = packets_sent > 0 ? packets_sent : packets_received;
+        return duration > 0 ? packets / duration : 0.0;
     }
 
     double get_throughput_mbps() const {
         double duration = get_duration_seconds();
-        return duration > 0 ? (bytes_sent * 8.0) / (duration * 1e6) : 0.0;
+        uint64_t bytes = bytes_sent > 0 ? bytes_sent : bytes_received;
+        return duration > 0 ? (bytes * 8.0) / (duration * 1e6) : 0.0;
     }
 
     double get_loss_rate() const {
@@ -129,47 +157,52 @@ struct ThroughputStats {
 class StatsCollector {
 private:
     LatencyStats latency_stats_;
+    LatencyStats corrected_latency_stats_;
     ThroughputStats throughput_stats_;
     mutable std::mutex stats_mutex_;
 
-
-    uint64_t progress_interval_ = 1000;
-    uint64_t last_progress_count_ = 0;
-    timestamp_t last_progress_time_ = 0;
-
 public:
     StatsCollector() = default;
 
 
-    void add_latency_measurement(timestamp_t send_ts, timestamp_t recv_ts);
+    // intended_ts of 0 means the packet was on time.
+    void add_latency_measurement(timestamp_t send_ts, timestamp_t recv_ts,
+                                 timestamp_t intended_ts = 0);
     void add_packet_sent(size_t bytes);
     void add_packet_received(size_t bytes);
 
 
     LatencyStats get_latency_stats() const;
+    LatencyStats get_corrected_latency_stats() const;
     ThroughputStats get_throughput_stats() const;
 
 
-    void set_progress_interval(uint64_t interval) { progress_interval_ = interval; }
-    bool should_report_progress();
-    void print_progress_summary();
-
-
     void start_collection();
     void end_collection();
     void reset();
 
 
+    void reserve(uint64_t expected_packets);
+
+
     void print_final_summary() const;
     void print_latency_distribution() const;
 };
 
 
+// Message k is due at start + k * interval, or at the generator's k-th offset.
+// A stall is caught up with at most PACER_MAX_BURST messages back to back.
 class RateLimiter {
 private:
     double target_rate_;
-    double interval_us_;
-    timestamp_t last_send_time_ = 0;
+    double interval_ns_;
+    timestamp_t schedule_start_ns_ = 0;
+    uint64_t scheduled_count_ = 0;
+    uint64_t stalls_ = 0;
+    timestamp_t skipped_ns_ = 0;
+
+    TrafficGenerator* generator_ = nullptr;
+    TrafficEvent next_event_;
 
 public:
     explicit RateLimiter(double rate_msgs_per_sec);
@@ -177,37 +210,24 @@ public:
     void set_rate(double rate_msgs_per_sec);
     double get_rate() const { return target_rate_; }
 
-
-    bool can_send();
-
-
-    void wait_for_next_send();
+    void set_generator(TrafficGenerator* generator);
 
 
-    void mark_sent();
-};
+    bool can_send();
+    bool can_send(timestamp_t now) const { return now >= get_next_send_time(); }
+    timestamp_t get_next_send_time() const;
 
+    uint32_t get_next_size() const { return next_event_.size; }
 
-class ProgressReporter {
-private:
-    uint64_t total_work_;
-    uint64_t completed_work_ = 0;
-    timestamp_t start_time_;
-    timestamp_t last_report_time_;
-    uint64_t report_interval_;
-
-public:
-    ProgressReporter(uint64_t total_work, uint64_t report_interval = 1000);
 
-    void update(uint64_t completed);
-    void increment(uint64_t amount = 1) { update(completed_work_ + amount); }
+    // Both return the scheduled (intended) send time of the message.
+    timestamp_t wait_for_next_send();
+    timestamp_t mark_sent();
+    timestamp_t mark_sent(timestamp_t now);
 
-    double get_progress_percentage() const;
-    double get_estimated_remaining_seconds() const;
-    void print_progress();
 
-    bool is_complete() const { return completed_work_ >= total_work_; }
-    void finish();
+    uint64_t get_stalls() const { return stalls_; }
+    timestamp_t get_skipped_ns() const { return skipped_ns_; }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "common.hpp"
+#include "network_utils.hpp"
+#include "stats.hpp"
+#include <vector>
+
+namespace udp_benchmark {
+
+
+// One-way latency split at the kernel timestamps: app -> TX (-> TX_SCHED),
+// TX -> RX and RX -> app. Negative samples are counted, not recorded.
+struct LatencyStages {
+    LatencyStats app_to_sched;
+    LatencyStats sched_to_tx;
+    LatencyStats app_to_tx;
+    LatencyStats tx_to_rx;
+    LatencyStats rx_to_app;
+    uint64_t inconsistent = 0;
+
+    void reserve(uint64_t expected_packets);
+
+    void add_send_path(timestamp_t send_ts, timestamp_t sched_ns, timestamp_t tx_ns);
+
+    void add_packet(timestamp_t send_ts, timestamp_t tx_ns, timestamp_t kernel_rx_ns, timestamp_t app_rx_ns,
+                    int64_t clock_offset_ns);
+
+    void print_summary(const char* title) const;
+};
+
+
+// Only the first stamp of each kind is kept, so retransmissions do not replace it.
+class TxTimestampTable {
+private:
+    struct Slot {
+        sequence_t seq = 0;
+        timestamp_t sched_ns = 0;
+        timestamp_t tx_ns = 0;
+    };
+
+    std::vector<Slot> slots_;
+
+public:
+    TxTimestampTable() : slots_(config::TIMESTAMP_TABLE_SIZE) {}
+
+    void add(const TxTimestamp& stamp);
+
+    bool find(sequence_t seq, timestamp_t& sched_ns, timestamp_t& tx_ns) const;
+};
+
+
+class RxTimestampTable {
+private:
+    struct Slot {
+        sequence_t seq = 0;
+        timestamp_t send_ts = 0;
+        timestamp_t kernel_rx_ns = 0;
+        timestamp_t app_rx_ns = 0;
+    };
+
+    std::vector<Slot> slots_;
+
+public:
+    RxTimestampTable() : slots_(config::TIMESTAMP_TABLE_SIZE) {}
+
+    void add(sequence_t seq, timestamp_t send_ts, timestamp_t kernel_rx_ns, timestamp_t app_rx_ns);
+
+    bool take(sequence_t seq, timestamp_t& send_ts, timestamp_t& kernel_rx_ns, timestamp_t& app_rx_ns);
+};
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+enum class TraceEvent : uint8_t {
+    SEND,
+    RETRANSMIT,
+    ACK_RECV,
+    RECV,
+    ACK_SEND,
+    CWND,
+    LOSS,
+    TIMEOUT,
+    PACER_WAIT,
+    LOG_FLUSH
+};
+
+// duration_ns is 0 for instant events; arg0 and arg1 depend on the event.
+struct TraceRecord {
+    timestamp_t ts_ns;
+    uint64_t arg0;
+    uint32_t arg1;
+    uint32_t duration_ns;
+    TraceEvent type;
+};
+
+
+// Written only by its thread; a dump drops what the writer may have overwritten.
+class TraceRing {
+private:
+    std::vector<TraceRecord> records_;
+    std::atomic<uint64_t> head_{0};
+    uint32_t tid_;
+    std::string name_;
+
+public:
+    TraceRing(size_t capacity, uint32_t tid);
+
+    void push(const TraceRecord& record) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        records_[head & (records_.size() - 1)] = record;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    void snapshot(std::vector<TraceRecord>& out) const;
+
+    uint32_t get_tid() const { return tid_; }
+    const std::string& get_name() const { return name_; }
+    void set_name(const std::string& name) { name_ = name; }
+};
+
+
+extern bool g_trace_enabled;
+
+// Per-thread rings written out as Chrome trace JSON at exit and on SIGUSR1.
+class Tracer {
+public:
+    // Call before any thread records.
+    static void enable(const std::string& path, size_t ring_events = config::TRACE_RING_EVENTS);
+    static bool is_enabled() { return g_trace_enabled; }
+
+    static void set_thread_name(const char* name);
+
+    static void record(TraceEvent type, timestamp_t ts_ns, timestamp_t end_ns, uint64_t arg0, uint32_t arg1);
+
+    // Called from the event loops, since a signal handler cannot do the I/O.
+    static void poll();
+
+    static bool dump();
+
+private:
+    static bool write_json(const std::string& path);
+};
+
+}
+
+
+// Compiled out, arguments included, without UDP_BENCHMARK_TRACING.
+#ifdef UDP_BENCHMARK_TRACING
+#define UDP_TRACE_INSTANT(type, arg0, arg1)                                                               \
+    do {                                                                                                  \
+        if (::udp_benchmark::Tracer::is_enabled()) {                                                      \
+            ::udp_benchmark::timestamp_t trace_ts_ = ::udp_benchmark::get_timestamp_ns();                 \
+            ::udp_benchmark::Tracer::record(::udp_benchmark::TraceEvent::type, trace_ts_, trace_ts_,      \
+                                            (arg0), static_cast<uint32_t>(arg1));                         \
+        }                                                                                                 \
+    } while (0)
+#define UDP_TRACE_SPAN(type, start_ns, arg0, arg1)                                                        \
+    do {                                                                                                  \
+        if (::udp_benchmark::Tracer::is_enabled()) {                                                      \
+            ::udp_benchmark::Tracer::record(::udp_benchmark::TraceEvent::type, (start_ns),                \
+                                            ::udp_benchmark::get_timestamp_ns(), (arg0),                  \
+                                            static_cast<uint32_t>(arg1));                                 \
+        }                                                                                                 \
+    } while (0)
+#define UDP_TRACE_SPAN_START(var) \
+    ::udp_benchmark::timestamp_t var = ::udp_benchmark::Tracer::is_enabled() ? ::udp_benchmark::get_timestamp_ns() : 0
+#define UDP_TRACE_THREAD(name) ::udp_benchmark::Tracer::set_thread_name(name)
+#define UDP_TRACE_POLL() ::udp_benchmark::Tracer::poll()
+#else
+#define UDP_TRACE_INSTANT(type, arg0, arg1) ((void)0)
+#define UDP_TRACE_SPAN(type, start_ns, arg0, arg1) ((void)0)
+#define UDP_TRACE_SPAN_START(var) ((void)0)
+#define UDP_TRACE_THREAD(name) ((void)0)
+#define UDP_TRACE_POLL() ((void)0)
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "common.hpp"
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace udp_benchmark {
+
+
+enum class TrafficPattern { CONSTANT, POISSON, ON_OFF, TRACE };
+
+// rate is in msgs/sec; for ON_OFF it is the rate inside a burst.
+struct TrafficConfig {
+    TrafficPattern pattern = TrafficPattern::CONSTANT;
+    double rate = 0;
+    uint32_t burst = 0;
+    uint32_t gap_us = 0;
+    std::string trace_path;
+    uint32_t min_size = 0;
+    uint32_t max_size = 0;
+    uint64_t seed = 1;
+
+    bool varies_size() const { return pattern == TrafficPattern::TRACE || min_size < max_size; }
+
+    // Parses "constant", "poisson", "onoff:BURST:GAP_US" or "trace:PATH".
+    static bool parse(const std::string& spec, TrafficConfig& config);
+    std::string describe() const;
+};
+
+
+struct TrafficEvent {
+    timestamp_t offset_ns = 0;
+    uint32_t size = 0;
+};
+
+
+// next() does no allocation or I/O, so it can run between two sends.
+class TrafficGenerator {
+public:
+    virtual ~TrafficGenerator() = default;
+
+
+    virtual bool next(TrafficEvent& event) = 0;
+
+    // Messages in the pattern, or 0 when it never runs out.
+    virtual uint64_t get_message_count() const { return 0; }
+
+
+    // Returns null, after printing why, when a trace cannot be loaded.
+    static std::unique_ptr<TrafficGenerator> create(const TrafficConfig& config);
+};
+
+
+class MessageSizes {
+private:
+    uint32_t min_;
+    uint32_t max_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<uint32_t> dist_;
+
+public:
+    MessageSizes(uint32_t min_size, uint32_t max_size, uint64_t seed);
+
+    uint32_t next() { return min_ < max_ ? dist_(rng_) : max_; }
+};
+
+
+class ConstantTraffic : public TrafficGenerator {
+private:
+    double interval_ns_;
+    uint64_t count_ = 0;
+    MessageSizes sizes_;
+
+public:
+    explicit ConstantTraffic(const TrafficConfig& config);
+
+    bool next(TrafficEvent& event) override;
+};
+
+
+class PoissonTraffic : public TrafficGenerator {
+private:
+    double offset_ns_ = 0;
+    bool started_ = false;
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> gap_ns_;
+    MessageSizes sizes_;
+
+public:
+    explicit PoissonTraffic(const TrafficConfig& config);
+
+    bool next(TrafficEvent& event) override;
+};
+
+
+class OnOffTraffic : public TrafficGenerator {
+private:
+    double interval_ns_;
+    double gap_ns_;
+    uint32_t burst_;
+    double offset_ns_ = 0;
+    uint64_t count_ = 0;
+    MessageSizes sizes_;
+
+public:
+    explicit OnOffTraffic(const TrafficConfig& config);
+
+    bool next(TrafficEvent& event) override;
+};
+
+
+// A .csv trace has "timestamp_ns,size" lines; anything else is 12-byte
+// big-endian {uint64 timestamp_ns, uint32 size} records.
+class TraceTraffic : public TrafficGenerator {
+private:
+    std::vector<TrafficEvent> events_;
+    size_t position_ = 0;
+    timestamp_t trace_start_ns_ = 0;
+
+public:
+    TraceTraffic() = default;
+
+    bool load(const std::string& path, uint32_t max_size);
+
+    bool next(TrafficEvent& event) override;
+    uint64_t get_message_count() const override { return events_.size(); }
+
+private:
+    bool add_event(timestamp_t ts, uint32_t size, uint32_t max_size);
+};
+
+}
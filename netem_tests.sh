@@ -4,6 +4,13 @@ GREEN='\033[0;32m'
 YELLOW='\033[1;33m'
 NC='\033[0m'
 
+# --userspace applies the same scenarios with --impair instead of tc, so it
+# needs neither root nor Linux qdiscs. It is also used when not run as root.
+USERSPACE=0
+if [ "$1" = "--userspace" ]; then
+    USERSPACE=1
+    shift
+fi
 INTERFACE=${1:-lo}  
 PORT=9000
 MSG_SIZE=128
@@ -11,14 +18,14 @@ RATE=10000
 TOTAL=50000
 RESULTS_DIR="netem_results/$(date +%Y%m%d_%H%M%S)"
 
-if [[ "$OSTYPE" != "linux-gnu"* ]]; then
-    echo -e "${RED}Error: This script requires Linux with tc/netem support${NC}"
-    echo "On macOS, use Network Link Conditioner instead"
-    exit 1
+if [ "$USERSPACE" -eq 0 ] && [ "$EUID" -ne 0 ]; then
+    echo -e "${YELLOW}Not running as root; using the userspace impairment layer${NC}"
+    USERSPACE=1
 fi
 
-if [ "$EUID" -ne 0 ]; then 
-    echo -e "${RED}Please run with sudo for tc commands${NC}"
+if [ "$USERSPACE" -eq 0 ] && [[ "$OSTYPE" != "linux-gnu"* ]]; then
+    echo -e "${RED}Error: This script requires Linux with tc/netem support${NC}"
+    echo "On macOS, use Network Link Conditioner instead, or pass --userspace"
     exit 1
 fi
 
@@ -29,36 +36,52 @@ echo "Interface: $INTERFACE"
 echo "Results: $RESULTS_DIR"
 echo ""
 
+# netem on lo impairs every packet once, so in userspace mode both the data
+# and the ACK direction get the same --impair spec.
 run_netem_test() {
     local test_name=$1
     local netem_cmd=$2
+    local impair_spec=$3
+    local impair_args=()
     
     echo -e "${YELLOW}Running: $test_name${NC}"
-    echo "Netem: $netem_cmd"
-    
-    tc qdisc del dev $INTERFACE root 2>/dev/null || true
-    
-    if [ -n "$netem_cmd" ] && [ "$netem_cmd" != "none" ]; then
-        tc qdisc add dev $INTERFACE root $netem_cmd
+    if [ "$USERSPACE" -eq 1 ]; then
+        echo "Impair: ${impair_spec:-none}"
+        if [ -n "$impair_spec" ]; then
+            impair_args=(--impair "$impair_spec")
+        fi
+    else
+        echo "Netem: $netem_cmd"
+        tc qdisc del dev $INTERFACE root 2>/dev/null || true
+        
+        if [ -n "$netem_cmd" ] && [ "$netem_cmd" != "none" ]; then
+            tc qdisc add dev $INTERFACE root $netem_cmd
+        fi
     fi
     
     TEST_DIR="$RESULTS_DIR/$test_name"
     mkdir -p "$TEST_DIR"
     
-    ./udp_receiver $PORT "$TEST_DIR/recv.csv" > /dev/null 2>&1 &
+    ./udp_receiver $PORT "$TEST_DIR/recv.csv" "${impair_args[@]}" > /dev/null 2>&1 &
     RECV_PID=$!
     sleep 1
     
     taskset -cp 2 $RECV_PID 2>/dev/null || true
     
-    taskset -c 3 ./udp_sender_simple 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/send.csv" 2>/dev/null || \
-        ./udp_sender_simple 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/send.csv"
+    taskset -c 3 ./udp_sender 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/send.csv" "${impair_args[@]}" 2>/dev/null || \
+        ./udp_sender 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/send.csv" "${impair_args[@]}"
         
+    for i in $(seq 1 50); do
+        kill -0 $RECV_PID 2>/dev/null || break
+        sleep 0.1
+    done
     kill $RECV_PID 2>/dev/null || true
     wait $RECV_PID 2>/dev/null || true
     
     # Clear netem
-    tc qdisc del dev $INTERFACE root 2>/dev/null || true
+    if [ "$USERSPACE" -eq 0 ]; then
+        tc qdisc del dev $INTERFACE root 2>/dev/null || true
+    fi
     
     # Analyze
     echo "Analyzing..."
@@ -75,22 +98,22 @@ echo -e "${GREEN}Starting test suite...${NC}"
 echo ""
 
 # 1. Baseline
-run_netem_test "01_baseline" "none"
+run_netem_test "01_baseline" "none" ""
 
 # 2. Delay with jitter
-run_netem_test "02_delay_1ms" "netem delay 1ms 0.2ms"
+run_netem_test "02_delay_1ms" "netem delay 1ms 0.2ms" "delay=1000,jitter=200"
 
 # 3. Random loss
-run_netem_test "03_loss_0.1pct" "netem loss 0.1%"
+run_netem_test "03_loss_0.1pct" "netem loss 0.1%" "loss=0.1"
 
-# 4. Burst loss
-run_netem_test "04_burst_loss" "netem loss 1% 25%"
+# 4. Burst loss (userspace: Gilbert-Elliott with 1% mean loss, mean burst of 4)
+run_netem_test "04_burst_loss" "netem loss 1% 25%" "ge=0.25:25"
 
 # 5. Delay + loss
-run_netem_test "05_delay_loss" "netem delay 2ms 1ms loss 0.2%"
+run_netem_test "05_delay_loss" "netem delay 2ms 1ms loss 0.2%" "delay=2000,jitter=1000,loss=0.2"
 
 # 6. Congestion spike
-run_netem_test "06_congestion" "netem delay 5ms 2ms loss 0.5%"
+run_netem_test "06_congestion" "netem delay 5ms 2ms loss 0.5%" "delay=5000,jitter=2000,loss=0.5"
 
 # Generate summary
 echo -e "${GREEN}Generating summary report...${NC}"
@@ -99,6 +122,7 @@ Network Emulation Test Results
 ===============================
 Date: $(date)
 Interface: $INTERFACE
+Impairment: $([ "$USERSPACE" -eq 1 ] && echo "userspace (--impair)" || echo "tc netem")
 Message size: $MSG_SIZE bytes
 Rate: $RATE msgs/sec
 Total messages: $TOTAL
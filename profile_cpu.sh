@@ -9,6 +9,7 @@ MSG_SIZE=128
 RATE=10000
 TOTAL=50000
 DURATION=10
+PERF_INTERVAL=${PERF_INTERVAL:-1000}
 
 echo "=== CPU Performance Profiling ==="
 echo "Duration: $DURATION seconds"
@@ -16,7 +17,7 @@ echo ""
 
 # Start receiver with monitoring
 echo "Starting receiver with monitoring..."
-./udp_receiver $PORT profile_recv.csv &
+./udp_receiver $PORT profile_recv.csv --perf-counters $PERF_INTERVAL > profile_receiver.txt 2>&1 &
 RECV_PID=$!
 
 # Monitor receiver CPU
@@ -30,7 +31,8 @@ sleep 1
 
 # Start sender with monitoring
 echo "Starting sender..."
-./udp_sender_simple 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL profile_send.csv &
+./udp_sender 127.0.0.1 $PORT $MSG_SIZE $RATE $TOTAL profile_send.csv --perf-counters $PERF_INTERVAL \
+    > profile_sender.txt 2>&1 &
 SEND_PID=$!
 
 # Monitor sender CPU
@@ -44,8 +46,11 @@ echo "Sender PID: $SEND_PID"
 # Wait for completion
 wait $SEND_PID
 
-# Kill receiver
-sleep 2
+# Receiver exits after the FIN/FIN-ACK handshake; kill it only if it lingers
+for i in $(seq 1 50); do
+    kill -0 $RECV_PID 2>/dev/null || break
+    sleep 0.1
+done
 kill $RECV_PID 2>/dev/null || true
 
 # Generate report
@@ -57,13 +62,21 @@ awk '{sum+=$1; n++} END {print "  Average: " sum/n "%"}' sender_cpu.log
 echo "Receiver CPU usage:"
 awk '{sum+=$1; n++} END {print "  Average: " sum/n "%"}' receiver_cpu.log
 
+# In-process counters: cycles/packet and IPC where the PMU is visible,
+# CPU time per packet where it is not (e.g. in most VMs)
+echo ""
+echo "=== CPU Counters (per packet) ==="
+for f in profile_sender.txt profile_receiver.txt; do
+    tr '\r' '\n' < $f | awk '/^CPU Counters/ {show = 1} show && /^$/ {show = 0} show'
+done
+
 # Analyze latency
 echo ""
 echo "=== Latency Results ==="
 python3 analyze.py profile_send.csv profile_recv.csv 2>/dev/null | grep -E "Median|p99|Throughput"
 
 # Cleanup
-rm -f profile_*.csv sender_cpu.log receiver_cpu.log
+rm -f profile_*.csv profile_sender.txt profile_receiver.txt sender_cpu.log receiver_cpu.log
 
 echo ""
 echo "✅ Profiling complete"
\ No newline at end of file
@@ -91,10 +91,13 @@ run_test() {
         ./udp_sender $RECV_IP $PORT $MSG_SIZE $RATE $TOTAL "$TEST_DIR/sender_log.csv"
     fi
     
-    # Wait for receiver to process final messages
-    sleep 2
+    # The receiver exits on its own after the FIN/FIN-ACK handshake
+    for i in $(seq 1 50); do
+        kill -0 $RECV_PID 2>/dev/null || break
+        sleep 0.1
+    done
     
-    # Kill receiver
+    # Kill receiver if the handshake did not complete
     kill $RECV_PID 2>/dev/null || true
     wait $RECV_PID 2>/dev/null || true
     
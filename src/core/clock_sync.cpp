@@ -0,0 +1,160 @@
+#include "udp_benchmark/clock_sync.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+ClockSyncFrame ClockEstimate::to_frame() const {
+    ClockSyncFrame frame;
+    frame.ref_ts = ref_ts;
+    frame.offset_ns = offset_ns;
+    frame.drift_ppb = drift_ppb;
+    frame.uncertainty_ns = uncertainty_ns;
+    frame.samples = samples;
+    return frame;
+}
+
+ClockEstimate ClockEstimate::from_frame(const ClockSyncFrame& frame) {
+    ClockEstimate estimate;
+    estimate.ref_ts = frame.ref_ts;
+    estimate.offset_ns = frame.offset_ns;
+    estimate.drift_ppb = frame.drift_ppb;
+    estimate.uncertainty_ns = frame.uncertainty_ns;
+    estimate.samples = frame.samples;
+    return estimate;
+}
+
+void ClockEstimate::print_summary(const char* title) const {
+    std::cout << "\n" << title << ":\n";
+    if (!is_valid()) {
+        std::cout << "  Not synchronized (no samples, or none that fit); one-way latency is uncorrected\n";
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Offset (receiver - sender): " << (offset_ns / 1000.0)
+              << " μs ± " << (uncertainty_ns / 1000.0) << " μs\n";
+    std::cout << "  Drift: " << (drift_ppb / 1000.0) << " ppm\n";
+    std::cout << "  Samples: " << samples << "\n";
+}
+
+
+bool ClockSync::add_sample(timestamp_t t1, timestamp_t t2, timestamp_t t3, timestamp_t t4) {
+    if (t1 == 0 || t4 < t1) {
+        return false;
+    }
+
+    int64_t rtt_ns = static_cast<int64_t>(t4 - t1) - static_cast<int64_t>(t3 - t2);
+    EpochSample sample;
+    sample.local_ts = t1 + (t4 - t1) / 2;
+    sample.offset_ns = (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2;
+    sample.delay_ns = rtt_ns > 0 ? static_cast<uint64_t>(rtt_ns) : 0;
+    total_samples_++;
+
+
+    timestamp_t epoch_ns = static_cast<timestamp_t>(config::CLOCK_SYNC_EPOCH_MS) * 1000000;
+    if (current_valid_ && sample.local_ts - current_start_ns_ >= epoch_ns) {
+        epochs_[epoch_head_] = current_;
+        epoch_head_ = (epoch_head_ + 1) % epochs_.size();
+        epoch_count_ = std::min(epoch_count_ + 1, epochs_.size());
+        epochs_closed_++;
+        current_valid_ = false;
+    }
+
+    bool changed = false;
+    if (!current_valid_) {
+        current_ = sample;
+        current_start_ns_ = sample.local_ts;
+        current_valid_ = true;
+        changed = true;
+    } else if (sample.delay_ns < current_.delay_ns) {
+        current_ = sample;
+        changed = true;
+    }
+
+    if (changed) {
+        update_estimate();
+    }
+    estimate_.samples = synchronized_ ? total_samples_ : 0;
+    return changed;
+}
+
+void ClockSync::update_estimate() {
+    timestamp_t ref_ts = current_.local_ts;
+
+
+    // A round trip well above the lowest recent one was queued.
+    uint64_t min_delay = current_.delay_ns;
+    for (size_t i = 0; i < epoch_count_; ++i) {
+        min_delay = std::min(min_delay, epochs_[i].delay_ns);
+    }
+    uint64_t max_delay = config::CLOCK_SYNC_MAX_DELAY_FACTOR * std::max<uint64_t>(min_delay, 1000);
+
+    std::array<const EpochSample*, config::CLOCK_SYNC_EPOCHS + 1> fit{};
+    size_t n = 0;
+    const EpochSample* best = &current_;
+    for (size_t i = 0; i < epoch_count_; ++i) {
+        if (epochs_[i].delay_ns <= max_delay) {
+            fit[n++] = &epochs_[i];
+        }
+        if (epochs_[i].delay_ns < best->delay_ns) {
+            best = &epochs_[i];
+        }
+    }
+    if (current_.delay_ns <= max_delay) {
+        fit[n++] = &current_;
+    }
+
+
+    if (n < 3) {
+        estimate_.ref_ts = best->local_ts;
+        estimate_.offset_ns = best->offset_ns;
+        estimate_.drift_ppb = 0;
+        estimate_.uncertainty_ns = best->delay_ns / 2;
+        synchronized_ = true;
+        return;
+    }
+
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double x = static_cast<double>(static_cast<int64_t>(fit[i]->local_ts - ref_ts)) / 1e9;
+        double y = static_cast<double>(fit[i]->offset_ns - current_.offset_ns);
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    double denom = n * sum_xx - sum_x * sum_x;
+    double slope = denom > 0 ? (n * sum_xy - sum_x * sum_y) / denom : 0.0;
+    double intercept = (sum_y - slope * sum_x) / n;
+
+    double sum_sq = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double x = static_cast<double>(static_cast<int64_t>(fit[i]->local_ts - ref_ts)) / 1e9;
+        double r = static_cast<double>(fit[i]->offset_ns - current_.offset_ns) - (intercept + slope * x);
+        sum_sq += r * r;
+    }
+    double rms = std::sqrt(sum_sq / n);
+    int64_t offset_ns = current_.offset_ns + static_cast<int64_t>(std::llround(intercept));
+
+
+    // Much more drift than a crystal's tens of ppm means the fit describes noise.
+    if (std::fabs(slope) > config::CLOCK_SYNC_MAX_DRIFT_PPM * 1000.0 ||
+        (rms > std::fabs(static_cast<double>(offset_ns)) && rms > static_cast<double>(min_delay))) {
+        rejected_fits_++;
+        synchronized_ = false;
+        estimate_ = ClockEstimate();
+        return;
+    }
+
+    estimate_.ref_ts = ref_ts;
+    estimate_.offset_ns = offset_ns;
+    estimate_.drift_ppb = static_cast<int64_t>(std::llround(slope));
+    estimate_.uncertainty_ns = min_delay / 2 + static_cast<uint64_t>(rms);
+    synchronized_ = true;
+}
+
+}
@@ -1,8 +1,160 @@
 #include "udp_benchmark/common.hpp"
+#include <sstream>
+#include <thread>
+
+#ifdef UDP_BENCHMARK_HAS_TSC
+#include <cpuid.h>
+#include <time.h>
+#endif
 
 namespace udp_benchmark {
 
 
 std::mutex g_log_mutex;
+ClockSkew g_clock_skew;
+TscClock g_tsc_clock;
+
+
+void inject_clock_skew(int64_t offset_ns, double drift_ppm) {
+    g_clock_skew.enabled = false;
+    g_clock_skew.origin_ns = get_timestamp_ns();
+    g_clock_skew.offset_ns = offset_ns;
+    g_clock_skew.drift_ppm = drift_ppm;
+    g_clock_skew.enabled = offset_ns != 0 || drift_ppm != 0.0;
+}
+
+timestamp_t apply_clock_skew(timestamp_t ts_ns) {
+    double elapsed_ns = static_cast<double>(ts_ns - g_clock_skew.origin_ns);
+    int64_t drift_ns = static_cast<int64_t>(elapsed_ns * g_clock_skew.drift_ppm / 1e6);
+    return static_cast<timestamp_t>(static_cast<int64_t>(ts_ns) + g_clock_skew.offset_ns + drift_ns);
+}
+
+
+void wait_until_ns(timestamp_t deadline_ns, uint32_t spin_us) {
+    timestamp_t spin_ns = static_cast<timestamp_t>(spin_us) * 1000;
+    for (timestamp_t now = get_timestamp_ns(); now < deadline_ns; now = get_timestamp_ns()) {
+        if (deadline_ns - now > spin_ns) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(deadline_ns - now - spin_ns));
+        }
+    }
+}
+
+
+#ifdef UDP_BENCHMARK_HAS_TSC
+namespace {
+
+// CPUID.80000007H:EDX[8]: the TSC ticks at a constant rate.
+bool tsc_is_invariant() {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+
+void read_clock_pair(uint64_t& ticks, timestamp_t& ns) {
+    uint64_t best_window = UINT64_MAX;
+    ticks = 0;
+    ns = 0;
+    for (int i = 0; i < 8; ++i) {
+        timespec ts;
+        uint64_t before = __rdtsc();
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t after = __rdtsc();
+        if (after - before < best_window) {
+            best_window = after - before;
+            ticks = before + (after - before) / 2;
+            ns = static_cast<timestamp_t>(ts.tv_sec) * 1000000000ULL + static_cast<timestamp_t>(ts.tv_nsec);
+        }
+    }
+}
+
+uint64_t to_mult(double ns_per_tick) {
+    return static_cast<uint64_t>(ns_per_tick * 4294967296.0);
+}
+
+timestamp_t ticks_to_ns(uint64_t ticks) {
+    const TscClock& clock = g_tsc_clock;
+    uint64_t delta = ticks - clock.base_ticks.load(std::memory_order_relaxed);
+    return clock.base_ns.load(std::memory_order_relaxed) +
+           static_cast<timestamp_t>((static_cast<unsigned __int128>(delta) * clock.mult.load(std::memory_order_relaxed)) >> 32);
+}
+
+void publish_tsc(uint64_t base_ticks, timestamp_t base_ns, uint64_t mult) {
+    TscClock& clock = g_tsc_clock;
+    uint32_t sequence = clock.sequence.load(std::memory_order_relaxed);
+    clock.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    clock.base_ticks.store(base_ticks, std::memory_order_relaxed);
+    clock.base_ns.store(base_ns, std::memory_order_relaxed);
+    clock.mult.store(mult, std::memory_order_relaxed);
+    clock.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+// Slews the error against CLOCK_MONOTONIC out over the next interval,
+// capped at 10% of it. Only this thread writes the parameters.
+void resync_tsc_loop() {
+    TscClock& clock = g_tsc_clock;
+    double interval_ns = static_cast<double>(config::TSC_RESYNC_INTERVAL_MS) * 1e6;
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(config::TSC_RESYNC_INTERVAL_MS));
+
+        uint64_t mono_ticks;
+        timestamp_t mono_ns;
+        read_clock_pair(mono_ticks, mono_ns);
+        double ns_per_tick = static_cast<double>(mono_ns - clock.calibration_ns) /
+                             static_cast<double>(mono_ticks - clock.calibration_ticks);
+        double error_ns = static_cast<double>(static_cast<int64_t>(mono_ns - ticks_to_ns(mono_ticks)));
+        error_ns = std::max(-interval_ns / 10, std::min(interval_ns / 10, error_ns));
+
+
+        uint64_t base_ticks = __rdtsc();
+        publish_tsc(base_ticks, ticks_to_ns(base_ticks), to_mult(ns_per_tick * (interval_ns + error_ns) / interval_ns));
+    }
+}
+
+}
+#endif
+
+
+bool init_time_source(bool allow_tsc) {
+#ifdef UDP_BENCHMARK_HAS_TSC
+    if (allow_tsc && tsc_is_invariant()) {
+        uint64_t start_ticks, end_ticks;
+        timestamp_t start_ns, end_ns;
+        read_clock_pair(start_ticks, start_ns);
+        std::this_thread::sleep_for(std::chrono::milliseconds(config::TSC_CALIBRATION_MS));
+        read_clock_pair(end_ticks, end_ns);
+
+        double ns_per_tick = static_cast<double>(end_ns - start_ns) / static_cast<double>(end_ticks - start_ticks);
+        TscClock& clock = g_tsc_clock;
+        clock.calibration_ticks = start_ticks;
+        clock.calibration_ns = start_ns;
+        clock.ticks_per_ns = 1.0 / ns_per_tick;
+        publish_tsc(end_ticks, end_ns, to_mult(ns_per_tick));
+        clock.enabled = true;
+        std::thread(resync_tsc_loop).detach();
+        return true;
+    }
+#else
+    (void)allow_tsc;
+#endif
+    g_tsc_clock.enabled = false;
+    return false;
+}
+
+std::string describe_time_source() {
+    std::ostringstream out;
+    if (g_tsc_clock.enabled) {
+        out.precision(3);
+        out << std::fixed << "invariant TSC at " << g_tsc_clock.ticks_per_ns << " GHz, re-synced to CLOCK_MONOTONIC every "
+            << config::TSC_RESYNC_INTERVAL_MS << " ms";
+    } else {
+        out << "steady_clock";
+    }
+    return out.str();
+}
 
-}
\ No newline at end of file
+}
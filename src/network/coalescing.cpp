@@ -0,0 +1,100 @@
+#include "udp_benchmark/coalescing.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+void CoalescingStats::add_datagram(timestamp_t send_ts, const BatchEntry* entries, size_t count) {
+    datagrams++;
+    messages += count;
+    for (size_t i = 0; i < count; ++i) {
+        hold_delay.add_latency(send_ts > entries[i].ts ? send_ts - entries[i].ts : 0);
+    }
+}
+
+void CoalescingStats::print_summary(const char* title, double seconds) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Messages: " << messages << " in " << datagrams << " datagrams ("
+              << get_messages_per_datagram() << " per datagram)\n";
+    if (full_flushes + timer_flushes > 0) {
+        std::cout << "  Flushes: " << full_flushes << " full, " << timer_flushes << " on hold timer\n";
+    }
+    if (seconds > 0) {
+        std::cout << "  Rate: " << messages / seconds << " msgs/sec in " << datagrams / seconds << " datagrams/sec\n";
+    }
+    if (hold_delay.packet_count > 0) {
+        std::cout << "  Hold delay: mean " << hold_delay.get_mean_latency_us() << " μs, p50 "
+                  << hold_delay.get_percentile_latency_us(50.0) << " μs, p99 "
+                  << hold_delay.get_percentile_latency_us(99.0) << " μs, max "
+                  << hold_delay.get_max_latency_us() << " μs\n";
+    }
+}
+
+
+MessageCoalescer::MessageCoalescer(size_t message_size, size_t max_bytes, uint32_t max_hold_us,
+                                   size_t max_inflight, uint64_t expected_messages)
+    : message_size_(message_size), max_hold_ns_(static_cast<timestamp_t>(max_hold_us) * 1000) {
+    size_t overhead = PacketHandler::batch_packet_size(0, message_size);
+    capacity_ = max_bytes > overhead ? std::max<size_t>((max_bytes - overhead) / message_size, 1) : 1;
+    open_.reserve(capacity_);
+
+
+    size_t batches = 1;
+    while (batches <= max_inflight) {
+        batches <<= 1;
+    }
+    batches_.resize(batches);
+    batch_mask_ = batches - 1;
+    messages_.resize(batches * capacity_);
+
+    stats_.hold_delay.latencies.reserve(std::min<uint64_t>(expected_messages, config::MAX_PREALLOCATED_SAMPLES));
+}
+
+bool MessageCoalescer::add(sequence_t seq, timestamp_t ts, timestamp_t intended_ts) {
+    open_.push_back({seq, ts, intended_ts != 0 ? intended_ts : ts});
+    return open_.size() >= capacity_;
+}
+
+timestamp_t MessageCoalescer::flush(sequence_t seq, timestamp_t send_ts, bool timer_expired) {
+    if (open_.empty()) {
+        return 0;
+    }
+
+    size_t slot = seq & batch_mask_;
+    batches_[slot].seq = seq;
+    batches_[slot].count = static_cast<uint32_t>(open_.size());
+    std::copy(open_.begin(), open_.end(), messages_.begin() + slot * capacity_);
+
+    stats_.add_datagram(send_ts, open_.data(), open_.size());
+    if (timer_expired) {
+        stats_.timer_flushes++;
+    } else {
+        stats_.full_flushes++;
+    }
+
+    timestamp_t intended_ts = open_.front().intended_ts;
+    open_.clear();
+    return intended_ts;
+}
+
+Packet MessageCoalescer::build(sequence_t seq, timestamp_t send_ts, timestamp_t intended_ts) const {
+    size_t slot = seq & batch_mask_;
+    if (batches_[slot].seq != seq) {
+        std::cerr << "Error: batch " << seq << " was overwritten by batch " << batches_[slot].seq
+                  << " while still pending\n";
+        std::abort();
+    }
+    return PacketHandler::create_batch_packet(seq, send_ts, intended_ts, messages_.data() + slot * capacity_,
+                                              batches_[slot].count, message_size_);
+}
+
+size_t MessageCoalescer::get_datagram_size(sequence_t seq) const {
+    const Batch& batch = batches_[seq & batch_mask_];
+    return PacketHandler::batch_packet_size(batch.seq == seq ? batch.count : 0, message_size_);
+}
+
+}
@@ -0,0 +1,148 @@
+#include "udp_benchmark/fragmentation.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+void Reassembler::reset(const FragmentLayout& layout, size_t max_inflight, bool keep_payload,
+                        uint64_t expected_messages) {
+    layout_ = layout;
+
+
+    size_t messages = std::max<size_t>(max_inflight / layout.fragment_count + 1, 1) * 2;
+    size_t slots = config::MIN_REASSEMBLY_SLOTS;
+    while (slots < messages) {
+        slots <<= 1;
+    }
+
+    slots_.assign(slots, Slot());
+    slot_mask_ = slots - 1;
+    bitmap_words_ = (layout.fragment_count + 63) / 64;
+    bitmaps_.assign(slots * bitmap_words_, 0);
+    if (keep_payload) {
+        payloads_.assign(slots * layout.message_size, 0);
+    } else {
+        payloads_.clear();
+    }
+
+    open_ = 0;
+    timeout_ns_ = static_cast<timestamp_t>(config::REASSEMBLY_TIMEOUT_MS) * 1000000;
+    next_sweep_ns_ = 0;
+    stats_ = ReassemblyStats();
+    reassembly_time_.reset();
+    reassembly_time_.latencies.reserve(std::min<uint64_t>(expected_messages, config::MAX_PREALLOCATED_SAMPLES));
+}
+
+const ReassembledMessage* Reassembler::add_fragment(uint64_t message_id, uint32_t index, timestamp_t send_ts,
+                                                    timestamp_t intended_ts, timestamp_t now,
+                                                    const uint8_t* payload, size_t payload_size,
+                                                    int retransmits) {
+    if (slots_.empty() || message_id == 0 || index >= layout_.fragment_count) {
+        return nullptr;
+    }
+    stats_.fragments++;
+
+    size_t slot_index = message_id & slot_mask_;
+    Slot& slot = slots_[slot_index];
+    uint64_t* bitmap = bitmaps_.data() + slot_index * bitmap_words_;
+
+    if (slot.message_id != message_id) {
+        if (slot.message_id > message_id) {
+            stats_.stale_fragments++;
+            return nullptr;
+        }
+        if (slot.message_id != 0) {
+            evict(slot);
+        }
+        std::fill(bitmap, bitmap + bitmap_words_, 0);
+        slot.message_id = message_id;
+        slot.received = 0;
+        slot.retransmits = 0;
+        slot.first_send_ts = 0;
+        slot.intended_ts = intended_ts;
+        slot.first_arrival_ns = now;
+        open_++;
+        stats_.max_open = std::max(stats_.max_open, open_);
+    }
+
+    uint64_t bit = 1ULL << (index % 64);
+    if (bitmap[index / 64] & bit) {
+        stats_.duplicate_fragments++;
+        return nullptr;
+    }
+    bitmap[index / 64] |= bit;
+    slot.received++;
+    slot.retransmits += retransmits;
+    slot.last_arrival_ns = now;
+    if (index == 0) {
+        slot.first_send_ts = send_ts;
+    }
+
+    uint8_t* message = nullptr;
+    if (!payloads_.empty()) {
+        message = payloads_.data() + slot_index * layout_.message_size;
+        size_t offset = static_cast<size_t>(index) * layout_.payload_size;
+        if (payload && offset < layout_.message_size) {
+            std::memcpy(message + offset, payload, std::min<size_t>(payload_size, layout_.message_size - offset));
+        }
+    }
+
+    if (slot.received < layout_.fragment_count) {
+        return nullptr;
+    }
+
+    completed_.message_id = message_id;
+    completed_.first_send_ts = slot.first_send_ts;
+    completed_.intended_ts = slot.intended_ts;
+    completed_.first_arrival_ns = slot.first_arrival_ns;
+    completed_.last_arrival_ns = slot.last_arrival_ns;
+    completed_.retransmits = slot.retransmits;
+    completed_.payload = message;
+
+    reassembly_time_.add_latency(slot.last_arrival_ns - slot.first_arrival_ns);
+    stats_.messages_completed++;
+    slot.message_id = 0;
+    open_--;
+    return &completed_;
+}
+
+void Reassembler::evict_expired(timestamp_t now) {
+    if (now < next_sweep_ns_ || open_ == 0) {
+        return;
+    }
+    next_sweep_ns_ = now + timeout_ns_ / 4;
+
+    for (Slot& slot : slots_) {
+        if (slot.message_id != 0 && now - slot.first_arrival_ns >= timeout_ns_) {
+            evict(slot);
+        }
+    }
+}
+
+void Reassembler::evict(Slot& slot) {
+    slot.message_id = 0;
+    open_--;
+    stats_.messages_evicted++;
+}
+
+void Reassembler::print_summary(const char* title) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Layout: " << layout_.message_size << " byte messages in " << layout_.fragment_count
+              << " fragments of up to " << layout_.fragment_size << " bytes\n";
+    std::cout << "  Fragments: " << stats_.fragments << " (" << stats_.duplicate_fragments << " duplicate, "
+              << stats_.stale_fragments << " stale)\n";
+    std::cout << "  Messages completed: " << stats_.messages_completed << ", evicted: " << stats_.messages_evicted
+              << ", incomplete at end: " << open_ << "\n";
+    std::cout << "  Reassembly table: " << slots_.size() << " slots, at most " << stats_.max_open << " open\n";
+    if (reassembly_time_.packet_count > 0) {
+        std::cout << "  First to last fragment: p50 " << reassembly_time_.get_percentile_latency_us(50.0)
+                  << " μs, p99 " << reassembly_time_.get_percentile_latency_us(99.0)
+                  << " μs, max " << reassembly_time_.get_max_latency_us() << " μs\n";
+    }
+}
+
+}
@@ -0,0 +1,352 @@
+#include "udp_benchmark/impairment.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace udp_benchmark {
+
+
+namespace {
+
+bool parse_number(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && value >= 0;
+}
+
+}
+
+bool ImpairmentConfig::parse(const std::string& spec, ImpairmentConfig& config) {
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        double number = 0;
+
+        if (key == "dist") {
+            if (value == "uniform") {
+                config.distribution = JitterDistribution::UNIFORM;
+            } else if (value == "normal") {
+                config.distribution = JitterDistribution::NORMAL;
+            } else if (value == "pareto") {
+                config.distribution = JitterDistribution::PARETO;
+            } else {
+                return false;
+            }
+        } else if (key == "ge") {
+            double fields[4] = {0, 0, 100, 0};
+            std::stringstream parts(value);
+            std::string part;
+            int count = 0;
+            while (std::getline(parts, part, ':')) {
+                if (count == 4 || !parse_number(part, fields[count])) {
+                    return false;
+                }
+                count++;
+            }
+            if (count < 2 || fields[1] <= 0) {
+                return false;
+            }
+            config.ge_p_pct = fields[0];
+            config.ge_r_pct = fields[1];
+            config.ge_bad_loss_pct = fields[2];
+            config.ge_good_loss_pct = fields[3];
+        } else if (!parse_number(value, number)) {
+            return false;
+        } else if (key == "delay") {
+            config.delay_us = static_cast<uint32_t>(number);
+        } else if (key == "jitter") {
+            config.jitter_us = static_cast<uint32_t>(number);
+        } else if (key == "loss") {
+            config.loss_pct = number;
+        } else if (key == "reorder") {
+            config.reorder_pct = number;
+        } else if (key == "dup") {
+            config.duplicate_pct = number;
+        } else if (key == "rate") {
+            config.rate_mbps = number;
+        } else if (key == "burst") {
+            config.burst_bytes = static_cast<uint32_t>(number);
+        } else if (key == "limit") {
+            config.queue_limit = std::max<uint32_t>(1, static_cast<uint32_t>(number));
+        } else if (key == "seed") {
+            config.seed = static_cast<uint64_t>(number);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string ImpairmentConfig::describe() const {
+    static const char* dist_names[] = {"uniform", "normal", "pareto"};
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    const char* sep = "";
+    if (delay_us > 0 || jitter_us > 0) {
+        out << "delay " << delay_us << " μs ± " << jitter_us << " μs ("
+            << dist_names[static_cast<int>(distribution)] << ")";
+        sep = ", ";
+    }
+    if (loss_pct > 0) {
+        out << sep << "loss " << loss_pct << "%";
+        sep = ", ";
+    }
+    if (ge_p_pct > 0) {
+        out << sep << "Gilbert-Elliott loss p=" << ge_p_pct << "% r=" << ge_r_pct << "% (bad "
+            << ge_bad_loss_pct << "%, good " << ge_good_loss_pct << "%)";
+        sep = ", ";
+    }
+    if (reorder_pct > 0) {
+        out << sep << "reorder " << reorder_pct << "%";
+        sep = ", ";
+    }
+    if (duplicate_pct > 0) {
+        out << sep << "duplicate " << duplicate_pct << "%";
+        sep = ", ";
+    }
+    if (rate_mbps > 0) {
+        out << sep << "rate " << rate_mbps << " Mbps (burst " << burst_bytes << " B, limit "
+            << queue_limit << " packets)";
+    }
+    return out.str();
+}
+
+
+void ImpairmentStats::print_summary() const {
+    std::cout << "\nImpairment (outgoing):\n";
+    std::cout << "  Datagrams: " << submitted << " submitted, " << delivered << " delivered\n";
+    std::cout << "  Lost: " << lost << ", queue drops: " << queue_drops << "\n";
+    std::cout << "  Duplicated: " << duplicated << ", reordered: " << reordered << "\n";
+    std::cout << "  Max queue depth: " << max_queue << "\n";
+}
+
+
+ImpairmentModel::ImpairmentModel(const ImpairmentConfig& config) : config_(config), rng_(config.seed) {}
+
+// [0, 1) from the top 53 bits of one draw.
+double ImpairmentModel::uniform() {
+    return static_cast<double>(rng_() >> 11) * 0x1.0p-53;
+}
+
+// Box-Muller, one pair of uniforms for every two samples.
+double ImpairmentModel::normal() {
+    if (has_spare_normal_) {
+        has_spare_normal_ = false;
+        return spare_normal_;
+    }
+    double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    double angle = 2.0 * M_PI * uniform();
+    spare_normal_ = radius * std::sin(angle);
+    has_spare_normal_ = true;
+    return radius * std::cos(angle);
+}
+
+bool ImpairmentModel::is_lost() {
+    if (config_.ge_p_pct > 0) {
+        double u = uniform() * 100;
+        ge_bad_state_ = ge_bad_state_ ? u >= config_.ge_r_pct : u < config_.ge_p_pct;
+        double loss_pct = ge_bad_state_ ? config_.ge_bad_loss_pct : config_.ge_good_loss_pct;
+        if (loss_pct > 0 && uniform() * 100 < loss_pct) {
+            return true;
+        }
+    }
+    return config_.loss_pct > 0 && uniform() * 100 < config_.loss_pct;
+}
+
+bool ImpairmentModel::is_duplicated() {
+    return config_.duplicate_pct > 0 && uniform() * 100 < config_.duplicate_pct;
+}
+
+bool ImpairmentModel::is_reordered() {
+    return config_.reorder_pct > 0 && uniform() * 100 < config_.reorder_pct;
+}
+
+timestamp_t ImpairmentModel::sample_delay_ns() {
+    double delay_us = config_.delay_us;
+    if (config_.jitter_us > 0) {
+        switch (config_.distribution) {
+            case JitterDistribution::UNIFORM:
+                delay_us += config_.jitter_us * (2 * uniform() - 1);
+                break;
+            case JitterDistribution::NORMAL:
+                delay_us += config_.jitter_us * normal();
+                break;
+            case JitterDistribution::PARETO:
+                // Shape 3 tail scaled to a mean of jitter_us above the base delay.
+                delay_us += config_.jitter_us * 2 * (std::pow(1 - uniform(), -1.0 / 3) - 1);
+                break;
+        }
+    }
+    return delay_us > 0 ? static_cast<timestamp_t>(delay_us * 1000) : 0;
+}
+
+timestamp_t ImpairmentModel::take_tokens(size_t size, timestamp_t now) {
+    double bytes_per_ns = config_.rate_mbps / 8000.0;
+    if (tokens_updated_ns_ == 0) {
+        tokens_ = config_.burst_bytes;
+    } else if (now > tokens_updated_ns_) {
+        tokens_ = std::min<double>(config_.burst_bytes, tokens_ + (now - tokens_updated_ns_) * bytes_per_ns);
+    }
+    tokens_updated_ns_ = std::max(now, tokens_updated_ns_);
+
+    tokens_ -= static_cast<double>(size);
+    return tokens_ >= 0 ? now : now + static_cast<timestamp_t>(-tokens_ / bytes_per_ns);
+}
+
+
+ImpairedSocket::ImpairedSocket(int fd, const ImpairmentConfig& config)
+    : Socket(fd), model_(config), enabled_(config.enabled()) {
+    if (!enabled_) {
+        return;
+    }
+    set_sink(this);
+
+    size_t slots = static_cast<size_t>(config.queue_limit) + 1;
+    heap_.reserve(slots);
+    buffers_.resize(slots);
+    buffer_sizes_.resize(slots, 0);
+    free_slots_.reserve(slots);
+    for (size_t i = 0; i < slots; ++i) {
+        buffers_[i].resize(config::MAX_PACKET_SIZE);
+        free_slots_.push_back(static_cast<uint32_t>(slots - 1 - i));
+    }
+
+    running_ = true;
+    release_thread_ = std::thread(&ImpairedSocket::release_loop, this);
+}
+
+ImpairedSocket::~ImpairedSocket() {
+    if (release_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        release_thread_.join();
+    }
+}
+
+ssize_t ImpairedSocket::send_datagram(const void* data, size_t size, const sockaddr_in& dest) {
+    timestamp_t now = get_timestamp_ns();
+    int send_inline = 0;
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.submitted++;
+        if (model_.is_lost()) {
+            stats_.lost++;
+            return static_cast<ssize_t>(size);
+        }
+
+        int copies = 1;
+        if (model_.is_duplicated()) {
+            copies = 2;
+            stats_.duplicated++;
+        }
+
+        for (int copy = 0; copy < copies; ++copy) {
+            if (heap_.size() >= get_config().queue_limit) {
+                stats_.queue_drops++;
+                continue;
+            }
+
+            timestamp_t release_ns = get_config().rate_mbps > 0 ? model_.take_tokens(size, now) : now;
+            if (model_.is_reordered()) {
+                stats_.reordered++;
+            } else {
+                release_ns += model_.sample_delay_ns();
+            }
+
+            if (release_ns <= now && heap_.empty()) {
+                send_inline++;
+                stats_.delivered++;
+            } else if (enqueue_locked(data, size, dest, release_ns)) {
+                notify |= heap_.front().order == next_order_ - 1;
+            } else {
+                stats_.queue_drops++;
+            }
+        }
+    }
+
+    if (notify) {
+        cv_.notify_one();
+    }
+    for (int i = 0; i < send_inline; ++i) {
+        send_direct(data, size, dest);
+    }
+    return static_cast<ssize_t>(size);
+}
+
+ImpairmentStats ImpairedSocket::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool ImpairedSocket::enqueue_locked(const void* data, size_t size, const sockaddr_in& dest,
+                                    timestamp_t release_ns) {
+    if (free_slots_.empty()) {
+        return false;
+    }
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+
+    if (buffers_[slot].size() < size) {
+        buffers_[slot].resize(size);
+    }
+    std::copy_n(static_cast<const uint8_t*>(data), size, buffers_[slot].data());
+    buffer_sizes_[slot] = size;
+
+    heap_.push_back(Queued{release_ns, next_order_++, slot, dest});
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<Queued>());
+    stats_.max_queue = std::max<uint64_t>(stats_.max_queue, heap_.size());
+    return true;
+}
+
+void ImpairedSocket::release_loop() {
+    timestamp_t spin_ns = static_cast<timestamp_t>(config::IMPAIR_SPIN_US) * 1000;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Queued datagrams are still sent after stop, so a final FIN-ACK is not lost.
+    while (running_ || !heap_.empty()) {
+        if (heap_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        timestamp_t now = get_timestamp_ns();
+        timestamp_t release_ns = heap_.front().release_ns;
+        if (release_ns > now + spin_ns) {
+            cv_.wait_for(lock, std::chrono::nanoseconds(release_ns - now - spin_ns));
+            continue;
+        }
+        if (release_ns > now) {
+            lock.unlock();
+            while (get_timestamp_ns() < release_ns) {
+                std::this_thread::yield();
+            }
+            lock.lock();
+            continue;
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Queued>());
+        Queued head = heap_.back();
+        heap_.pop_back();
+        stats_.delivered++;
+
+        lock.unlock();
+        send_direct(buffers_[head.slot].data(), buffer_sizes_[head.slot], head.dest);
+        lock.lock();
+        free_slots_.push_back(head.slot);
+    }
+}
+
+}
@@ -0,0 +1,490 @@
+#include "udp_benchmark/multicast.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+namespace udp_benchmark {
+
+
+void MulticastSenderStats::print_summary() const {
+    std::cout << "\nMulticast Repair:\n";
+    std::cout << "  Data packets sent: " << data_sent << "\n";
+    std::cout << "  NACKs received: " << nacks_received << " (" << nack_entries << " sequences)\n";
+    std::cout << "  Repairs sent: " << repairs_sent << ", coalesced: " << repairs_coalesced
+              << ", no longer held: " << repairs_unavailable << "\n";
+}
+
+
+MulticastSender::MulticastSender(Socket* socket, const sockaddr_in& group_addr, size_t packet_size,
+                                 uint32_t expected_subscribers)
+    : socket_(socket), group_addr_(group_addr), expected_subscribers_(std::max<uint32_t>(expected_subscribers, 1)),
+      data_packet_(packet_size), repair_packet_(packet_size), recv_buf_(config::MAX_PACKET_SIZE),
+      history_(config::MULTICAST_HISTORY) {
+    nack_seqs_.reserve(config::NACK_MAX_ENTRIES);
+}
+
+bool MulticastSender::announce(const HelloFrame& hello) {
+    run_id_ = hello.run_id;
+    timestamp_t start = get_timestamp_ns();
+    timestamp_t timeout_ns = static_cast<timestamp_t>(config::HELLO_TIMEOUT_MS) * 1000000;
+    timestamp_t retry_ns = static_cast<timestamp_t>(config::HELLO_RETRY_MS) * 1000000;
+
+    while (subscribers_.size() < expected_subscribers_ && get_timestamp_ns() - start < timeout_ns) {
+        HelloFrame stamped = hello;
+        stamped.flags |= HELLO_FLAG_MULTICAST;
+        stamped.send_ts = get_timestamp_ns();
+        Packet packet = PacketHandler::create_hello_packet(stamped);
+        socket_->send_to(packet.data(), packet.size(), group_addr_);
+
+        while (subscribers_.size() < expected_subscribers_ && get_timestamp_ns() - stamped.send_ts < retry_ns) {
+            poll_feedback(1000);
+        }
+    }
+    return !subscribers_.empty();
+}
+
+void MulticastSender::run(uint64_t total_msgs, RateLimiter& limiter) {
+    running_ = true;
+    std::thread feedback_thread([this]() {
+        while (running_) {
+            poll_feedback(1000);
+        }
+    });
+
+    for (sequence_t seq = 1; seq <= total_msgs; ++seq) {
+        timestamp_t intended_ts = limiter.wait_for_next_send();
+        timestamp_t send_ts = get_timestamp_ns();
+        {
+            std::lock_guard<std::mutex> lock(history_mutex_);
+            History& entry = history_[seq & (config::MULTICAST_HISTORY - 1)];
+            entry.seq = seq;
+            entry.send_ts = send_ts;
+            entry.intended_ts = intended_ts;
+            entry.repaired_ns = 0;
+        }
+
+        data_packet_.set_sequence(seq);
+        data_packet_.set_timestamp(send_ts);
+        data_packet_.set_intended_timestamp(intended_ts);
+        if (socket_->send_to(data_packet_.data(), data_packet_.size(), group_addr_) > 0) {
+            stats_.data_sent++;
+        }
+    }
+
+    running_ = false;
+    feedback_thread.join();
+}
+
+bool MulticastSender::drain(sequence_t final_seq) {
+    timestamp_t start = get_timestamp_ns();
+    timestamp_t timeout_ns = static_cast<timestamp_t>(config::DRAIN_TIMEOUT_MS) * 1000000;
+    timestamp_t next_fin_ns = 0;
+
+    while (get_fin_acked_count() < subscribers_.size()) {
+        timestamp_t now = get_timestamp_ns();
+        if (now - start >= timeout_ns) {
+            return false;
+        }
+        if (now >= next_fin_ns) {
+            Packet fin = PacketHandler::create_fin_packet(final_seq);
+            socket_->send_to(fin.data(), fin.size(), group_addr_);
+            next_fin_ns = now + static_cast<timestamp_t>(config::INITIAL_PTO_US) * 1000;
+        }
+        poll_feedback(1000);
+    }
+    return true;
+}
+
+size_t MulticastSender::get_fin_acked_count() const {
+    return static_cast<size_t>(std::count_if(subscribers_.begin(), subscribers_.end(),
+                                             [](const MulticastSubscriberInfo& s) { return s.fin_acked; }));
+}
+
+void MulticastSender::print_summary() const {
+    stats_.print_summary();
+    std::cout << "\nSubscribers (" << subscribers_.size() << " joined):\n";
+    for (const MulticastSubscriberInfo& subscriber : subscribers_) {
+        char ip_str[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &subscriber.addr.sin_addr, ip_str, INET_ADDRSTRLEN);
+        std::cout << "  " << ip_str << ":" << ntohs(subscriber.addr.sin_port) << " - ";
+        if (subscriber.fin_acked) {
+            std::cout << subscriber.summary.packets_received << "/" << subscriber.summary.final_seq
+                      << " received, " << subscriber.summary.duplicate_packets << " duplicates, ";
+        } else {
+            std::cout << "no FIN-ACK, ";
+        }
+        std::cout << subscriber.nacks << " NACKs\n";
+    }
+}
+
+void MulticastSender::poll_feedback(int64_t timeout_us) {
+    if (!socket_->wait_readable(timeout_us)) {
+        return;
+    }
+
+    ssize_t n;
+    sockaddr_in src;
+    while ((n = socket_->recv_from(recv_buf_.data(), recv_buf_.size(), &src)) > 0) {
+        process_feedback(recv_buf_.data(), static_cast<size_t>(n), src, get_timestamp_ns());
+    }
+}
+
+void MulticastSender::process_feedback(const uint8_t* data, size_t size, const sockaddr_in& src, timestamp_t now) {
+    ControlType type;
+    if (!PacketHandler::parse_control_type(data, size, type)) {
+        return;
+    }
+
+    if (type == ControlType::NACK) {
+        process_nack(data, size, src, now);
+    } else if (type == ControlType::HELLO_ACK) {
+        HelloAckFrame hello_ack;
+        if (PacketHandler::parse_hello_ack_packet(data, size, hello_ack) && hello_ack.run_id == run_id_ &&
+            find_subscriber(src) == nullptr) {
+            MulticastSubscriberInfo subscriber;
+            subscriber.addr = src;
+            subscribers_.push_back(subscriber);
+        }
+    } else if (type == ControlType::FIN_ACK) {
+        MulticastSubscriberInfo* subscriber = find_subscriber(src);
+        FinAckFrame summary;
+        if (subscriber && PacketHandler::parse_fin_ack_packet(data, size, summary)) {
+            subscriber->fin_acked = true;
+            subscriber->summary = summary;
+        }
+    }
+}
+
+void MulticastSender::process_nack(const uint8_t* data, size_t size, const sockaddr_in& src, timestamp_t now) {
+    if (!PacketHandler::parse_nack_packet(data, size, nack_seqs_)) {
+        return;
+    }
+    stats_.nacks_received++;
+    stats_.nack_entries += nack_seqs_.size();
+    if (MulticastSubscriberInfo* subscriber = find_subscriber(src)) {
+        subscriber->nacks++;
+    }
+
+    timestamp_t holdoff_ns = static_cast<timestamp_t>(config::REPAIR_HOLDOFF_US) * 1000;
+    std::lock_guard<std::mutex> lock(history_mutex_);
+    for (sequence_t seq : nack_seqs_) {
+        History& entry = history_[seq & (config::MULTICAST_HISTORY - 1)];
+        if (entry.seq != seq || seq == 0) {
+            stats_.repairs_unavailable++;
+            continue;
+        }
+        if (entry.repaired_ns != 0 && now - entry.repaired_ns < holdoff_ns) {
+            stats_.repairs_coalesced++;
+            continue;
+        }
+
+        entry.repaired_ns = now;
+        repair_packet_.set_sequence(seq);
+        repair_packet_.set_timestamp(entry.send_ts);
+        repair_packet_.set_intended_timestamp(entry.intended_ts);
+        socket_->send_to(repair_packet_.data(), repair_packet_.size(), group_addr_);
+        stats_.repairs_sent++;
+    }
+}
+
+MulticastSubscriberInfo* MulticastSender::find_subscriber(const sockaddr_in& addr) {
+    for (MulticastSubscriberInfo& subscriber : subscribers_) {
+        if (subscriber.addr.sin_addr.s_addr == addr.sin_addr.s_addr && subscriber.addr.sin_port == addr.sin_port) {
+            return &subscriber;
+        }
+    }
+    return nullptr;
+}
+
+
+MulticastSubscriber::MulticastSubscriber(Socket* socket, Socket* feedback, int index, LatencyLogger* logger)
+    : socket_(socket), feedback_(feedback), index_(index), logger_(logger), rng_(std::random_device{}() + static_cast<unsigned>(index)) {
+    nack_seqs_.reserve(config::NACK_MAX_ENTRIES);
+}
+
+void MulticastSubscriber::run(const std::atomic<bool>& stop) {
+    std::vector<uint8_t> buf(config::MAX_DATAGRAM_SIZE);
+    sockaddr_in src;
+
+    while (!stop) {
+
+        int64_t timeout_us = get_nack_timeout_us();
+        if (finished_) {
+            timeout_us = static_cast<int64_t>(config::FIN_LINGER_MS) * 1000;
+        } else if (timeout_us < 0 || timeout_us > 100000) {
+            timeout_us = 100000;
+        }
+
+        if (socket_->wait_readable(timeout_us)) {
+            ssize_t n = socket_->recv_from(buf.data(), buf.size(), &src);
+            if (n > 0) {
+                process_packet(buf.data(), static_cast<size_t>(n), src, get_timestamp_ns());
+            }
+        } else if (finished_) {
+            break;
+        }
+
+        if (get_nack_timeout_us() == 0) {
+            on_nack_timer();
+        }
+    }
+}
+
+void MulticastSubscriber::process_packet(const uint8_t* data, size_t size, const sockaddr_in& src,
+                                         timestamp_t now) {
+    ControlType type;
+    if (PacketHandler::parse_control_type(data, size, type)) {
+        if (type == ControlType::HELLO) {
+            HelloFrame hello;
+            if (!PacketHandler::parse_hello_packet(data, size, hello)) {
+                return;
+            }
+            if (!has_session_) {
+                start_session(hello, src);
+            }
+            if (hello.run_id == session_.run_id) {
+                HelloAckFrame hello_ack;
+                hello_ack.run_id = hello.run_id;
+                hello_ack.echo_ts = hello.send_ts;
+                hello_ack.recv_ts = now;
+                hello_ack.ack_ts = get_timestamp_ns();
+                Packet packet = PacketHandler::create_hello_ack_packet(hello_ack);
+                feedback_->send_to(packet.data(), packet.size(), sender_addr_);
+            }
+        } else if (type == ControlType::FIN && has_session_) {
+            sequence_t final_seq;
+            if (!PacketHandler::parse_fin_packet(data, size, final_seq)) {
+                return;
+            }
+            final_seq_ = std::min<sequence_t>(std::max<sequence_t>(final_seq, 1), arrivals_.size() - 1);
+            if (final_seq_ > highest_seq_) {
+                add_gaps(highest_seq_ + 1, final_seq_, now);
+                highest_seq_ = final_seq_;
+            }
+
+            maybe_finish();
+        }
+        return;
+    }
+
+    sequence_t seq;
+    timestamp_t send_ts;
+    timestamp_t intended_ts;
+    if (!PacketHandler::parse_data_packet(data, size, seq, send_ts, &intended_ts)) {
+        return;
+    }
+    if (!has_session_ || seq == 0 || seq >= arrivals_.size()) {
+        stats_.stray++;
+        return;
+    }
+    process_data(seq, send_ts, intended_ts, now);
+}
+
+void MulticastSubscriber::start_session(const HelloFrame& hello, const sockaddr_in& src) {
+    has_session_ = true;
+    session_ = hello;
+    sender_addr_ = src;
+    arrivals_.assign(hello.total_count + 1, 0);
+    latency_.latencies.reserve(std::min<uint64_t>(hello.total_count, config::MAX_PREALLOCATED_SAMPLES));
+    if (logger_) {
+        logger_->set_run_id(hello.run_id);
+    }
+}
+
+void MulticastSubscriber::process_data(sequence_t seq, timestamp_t send_ts, timestamp_t intended_ts,
+                                       timestamp_t now) {
+    if (arrivals_[seq] != 0) {
+        stats_.duplicates++;
+        return;
+    }
+    arrivals_[seq] = now;
+    stats_.received++;
+
+    if (seq > highest_seq_) {
+        if (seq > highest_seq_ + 1) {
+            add_gaps(highest_seq_ + 1, seq - 1, now);
+        }
+        highest_seq_ = seq;
+    } else {
+        auto it = missing_.find(seq);
+        if (it != missing_.end()) {
+            if (it->second.nacks > 0) {
+                stats_.repaired++;
+            }
+            missing_.erase(it);
+        }
+    }
+
+    if (now >= send_ts) {
+        latency_.add_latency(now - send_ts);
+    } else {
+        latency_.negative_count++;
+    }
+    if (logger_) {
+        logger_->log_receiver_data(seq, now, send_ts, 0, intended_ts);
+    }
+    if (!finished_ && final_seq_ != 0) {
+        maybe_finish();
+    }
+}
+
+void MulticastSubscriber::add_gaps(sequence_t from, sequence_t to, timestamp_t now) {
+
+    // The sender holds only MULTICAST_HISTORY packets; older ones cannot be repaired.
+    if (to - from + 1 > config::MULTICAST_HISTORY) {
+        stats_.unrecovered += to - from + 1 - config::MULTICAST_HISTORY;
+        from = to - config::MULTICAST_HISTORY + 1;
+    }
+
+    std::uniform_int_distribution<uint32_t> backoff_us(0, config::NACK_DELAY_US);
+    timestamp_t nack_at_ns = now + static_cast<timestamp_t>(config::NACK_DELAY_US + backoff_us(rng_)) * 1000;
+    for (sequence_t seq = from; seq <= to; ++seq) {
+        if (arrivals_[seq] == 0 && missing_.emplace(seq, Gap{nack_at_ns, 0}).second) {
+            next_nack_ns_ = next_nack_ns_ == 0 ? nack_at_ns : std::min(next_nack_ns_, nack_at_ns);
+        }
+    }
+}
+
+int64_t MulticastSubscriber::get_nack_timeout_us() const {
+    if (missing_.empty()) {
+        return -1;
+    }
+    timestamp_t now = get_timestamp_ns();
+    return next_nack_ns_ > now ? static_cast<int64_t>((next_nack_ns_ - now + 999) / 1000) : 0;
+}
+
+void MulticastSubscriber::on_nack_timer() {
+    timestamp_t now = get_timestamp_ns();
+    timestamp_t retry_ns = static_cast<timestamp_t>(config::NACK_RETRY_US) * 1000;
+    nack_seqs_.clear();
+    next_nack_ns_ = 0;
+
+    for (auto it = missing_.begin(); it != missing_.end();) {
+        Gap& gap = it->second;
+        if (gap.nack_at_ns <= now && gap.nacks >= config::NACK_MAX_RETRIES) {
+            stats_.unrecovered++;
+            it = missing_.erase(it);
+            continue;
+        }
+
+
+        if (gap.nack_at_ns <= now && nack_seqs_.size() < config::NACK_MAX_ENTRIES) {
+            nack_seqs_.push_back(it->first);
+            gap.nacks++;
+            gap.nack_at_ns = now + retry_ns;
+        }
+        next_nack_ns_ = next_nack_ns_ == 0 ? gap.nack_at_ns : std::min(next_nack_ns_, gap.nack_at_ns);
+        ++it;
+    }
+
+    if (!nack_seqs_.empty()) {
+        Packet nack = PacketHandler::create_nack_packet(nack_seqs_);
+        feedback_->send_to(nack.data(), nack.size(), sender_addr_);
+        stats_.nacks_sent++;
+        stats_.nack_entries += nack_seqs_.size();
+    }
+    if (!finished_ && final_seq_ != 0) {
+        maybe_finish();
+    }
+}
+
+void MulticastSubscriber::maybe_finish() {
+    if (final_seq_ == 0 || !missing_.empty()) {
+        return;
+    }
+    finished_ = true;
+
+    FinAckFrame summary;
+    summary.final_seq = final_seq_;
+    summary.packets_received = stats_.received;
+    summary.duplicate_packets = stats_.duplicates;
+    summary.acks_sent = stats_.nacks_sent;
+    Packet packet = PacketHandler::create_fin_ack_packet(summary);
+    feedback_->send_to(packet.data(), packet.size(), sender_addr_);
+}
+
+
+void print_multicast_report(const std::vector<const MulticastSubscriber*>& subscribers) {
+    auto print_latency = [](const LatencyStats& stats) {
+        std::cout << "p50 " << stats.get_percentile_latency_us(50.0) << " μs, p99 "
+                  << stats.get_percentile_latency_us(99.0) << " μs, p99.9 "
+                  << stats.get_percentile_latency_us(99.9) << " μs, max " << stats.get_max_latency_us() << " μs";
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nMulticast Subscribers (one-way latency):\n";
+
+    LatencyStats aggregate;
+    const MulticastSubscriber* fastest = nullptr;
+    const MulticastSubscriber* slowest = nullptr;
+    for (const MulticastSubscriber* subscriber : subscribers) {
+        const MulticastSubscriberStats& stats = subscriber->get_stats();
+        const LatencyStats& latency = subscriber->get_latency();
+        std::cout << "  #" << subscriber->get_index() << ": " << stats.received << "/"
+                  << subscriber->get_session().total_count << " received, " << stats.repaired << " repaired, "
+                  << stats.unrecovered << " unrecovered, " << stats.duplicates << " duplicates, "
+                  << stats.nacks_sent << " NACKs\n";
+        if (latency.packet_count == 0) {
+            continue;
+        }
+        std::cout << "      ";
+        print_latency(latency);
+        std::cout << "\n";
+
+        aggregate.latencies.reserve(aggregate.latencies.size() + latency.latencies.size());
+        for (uint64_t sample : latency.latencies) {
+            aggregate.add_latency(sample);
+        }
+        double p50 = latency.get_percentile_latency_us(50.0);
+        if (!fastest || p50 < fastest->get_latency().get_percentile_latency_us(50.0)) {
+            fastest = subscriber;
+        }
+        if (!slowest || p50 > slowest->get_latency().get_percentile_latency_us(50.0)) {
+            slowest = subscriber;
+        }
+    }
+
+    if (aggregate.packet_count == 0) {
+        return;
+    }
+    std::cout << "  All subscribers: ";
+    print_latency(aggregate);
+    std::cout << " (" << aggregate.packet_count << " samples)\n";
+
+    if (subscribers.size() < 2) {
+        return;
+    }
+    std::cout << "  Fastest: #" << fastest->get_index() << " (p50 "
+              << fastest->get_latency().get_percentile_latency_us(50.0) << " μs), slowest: #"
+              << slowest->get_index() << " (p50 " << slowest->get_latency().get_percentile_latency_us(50.0)
+              << " μs)\n";
+
+
+    LatencyStats spread;
+    sequence_t total = subscribers.front()->get_session().total_count;
+    for (sequence_t seq = 1; seq <= total; ++seq) {
+        timestamp_t first = UINT64_MAX;
+        timestamp_t last = 0;
+        for (const MulticastSubscriber* subscriber : subscribers) {
+            timestamp_t arrival = subscriber->get_arrival(seq);
+            if (arrival == 0) {
+                first = UINT64_MAX;
+                break;
+            }
+            first = std::min(first, arrival);
+            last = std::max(last, arrival);
+        }
+        if (first != UINT64_MAX) {
+            spread.add_latency(last - first);
+        }
+    }
+    if (spread.packet_count > 0) {
+        std::cout << "  First-to-last spread: ";
+        print_latency(spread);
+        std::cout << " (" << spread.packet_count << " packets seen by all)\n";
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+#include "udp_benchmark/multipath.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+void RedundancyStats::print_summary(const char* title) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Paths: " << paths << "\n";
+    std::cout << "  Datagrams: " << datagrams << " on path 0, " << redundant_datagrams << " copies on the others";
+    if (redundant_failures > 0) {
+        std::cout << " (" << redundant_failures << " copies not sent)";
+    }
+    std::cout << "\n";
+    std::cout << "  Retransmissions: " << retransmits << ", each on one path\n";
+    std::cout << "  Bandwidth: " << (bytes + redundant_bytes + retransmit_bytes) / 1e6 << " MB for " << bytes / 1e6
+              << " MB of data (+" << get_overhead_percent() << "% in copies)\n";
+}
+
+
+void PathRace::reset(size_t count, size_t history) {
+    size_t capacity = 1;
+    while (capacity < history) {
+        capacity <<= 1;
+    }
+    ring_.assign(capacity, Entry());
+    mask_ = capacity - 1;
+    paths_.assign(count, PathStats());
+    sequences_ = 0;
+    combined_.reset();
+    lag_.reset();
+}
+
+bool PathRace::add_copy(size_t path, sequence_t seq, size_t bytes, timestamp_t recv_time, int64_t latency_ns,
+                        bool is_new) {
+    PathStats& stats = paths_[path];
+    stats.datagrams++;
+    stats.bytes += bytes;
+
+    Entry& entry = ring_[seq & mask_];
+    if (is_new) {
+        entry.seq = seq;
+        entry.first_ns = recv_time;
+        entry.paths = 1u << path;
+        sequences_++;
+        stats.copies++;
+        stats.wins++;
+        if (latency_ns > 0) {
+            stats.latency.record(static_cast<uint64_t>(latency_ns));
+            combined_.record(static_cast<uint64_t>(latency_ns));
+        }
+        return false;
+    }
+
+
+    // A second copy on the same path is a retransmission, not a racer.
+    if (entry.seq != seq) {
+        return false;
+    }
+    if ((entry.paths >> path) & 1) {
+        return true;
+    }
+    entry.paths |= 1u << path;
+    stats.copies++;
+    lag_.record(recv_time - entry.first_ns);
+    if (latency_ns > 0) {
+        stats.latency.record(static_cast<uint64_t>(latency_ns));
+    }
+    return false;
+}
+
+static void print_latency(const LatencyHistogram& latency) {
+    std::cout << "p50 " << latency.get_percentile_us(50.0) << ", p99 " << latency.get_percentile_us(99.0)
+              << ", p99.9 " << latency.get_percentile_us(99.9) << ", max " << latency.get_max_ns() / 1000.0 << " μs";
+}
+
+void PathRace::print_summary(const char* title, int first_port) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(1);
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < paths_.size(); ++i) {
+        const PathStats& stats = paths_[i];
+        datagrams += stats.datagrams;
+        bytes += stats.bytes;
+        uint64_t missed = sequences_ > stats.copies ? sequences_ - stats.copies : 0;
+        std::cout << "  Path " << i << " (port " << first_port + static_cast<int>(i) << "): " << stats.copies
+                  << " packets, " << (sequences_ > 0 ? 100.0 * missed / sequences_ : 0.0) << "% missing, first for "
+                  << stats.wins << " (" << (sequences_ > 0 ? 100.0 * stats.wins / sequences_ : 0.0) << "%)\n";
+        if (stats.latency.get_count() > 0) {
+            std::cout << "    Latency alone: ";
+            print_latency(stats.latency);
+            std::cout << "\n";
+        }
+    }
+    std::cout << "  Combined: " << sequences_ << " packets\n";
+    if (combined_.get_count() > 0) {
+        std::cout << "    Latency, first arrival: ";
+        print_latency(combined_);
+        std::cout << "\n";
+    }
+    if (lag_.get_count() > 0) {
+        std::cout << "  Runner-up lag: p50 " << lag_.get_percentile_us(50.0) << ", p99 " << lag_.get_percentile_us(99.0)
+                  << ", max " << lag_.get_max_ns() / 1000.0 << " μs over " << lag_.get_count() << " copies\n";
+    }
+    std::cout << "  Bandwidth: " << datagrams << " datagrams (" << std::setprecision(2) << bytes / 1e6 << " MB) for "
+              << sequences_ << " packets, " << (sequences_ > 0 ? static_cast<double>(datagrams) / sequences_ : 0.0)
+              << "x one path\n";
+}
+
+}
@@ -1,13 +1,35 @@
 #include "udp_benchmark/network_utils.hpp"
+#include <algorithm>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/select.h>
+#include <ctime>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
 
 namespace udp_benchmark {
 
 
+namespace {
+
+
+// Kernel timestamps are CLOCK_REALTIME; rebase them onto get_timestamp_ns().
+timestamp_t kernel_time_to_local(const timespec& ts) {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    timestamp_t local_now = get_timestamp_ns();
+    int64_t age_ns = (static_cast<int64_t>(now.tv_sec) - ts.tv_sec) * 1000000000LL + (now.tv_nsec - ts.tv_nsec);
+    return local_now - age_ns;
+}
+
+}
+
+
 int NetworkUtils::create_udp_socket() {
     int fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (fd < 0) {
@@ -50,6 +72,19 @@ bool NetworkUtils::set_socket_reuseaddr(int fd) {
     return true;
 }
 
+bool NetworkUtils::set_socket_reuseport(int fd) {
+#ifdef SO_REUSEPORT
+    int reuse = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        perror("setsockopt SO_REUSEPORT failed");
+        return false;
+    }
+#else
+    (void)fd;
+#endif
+    return true;
+}
+
 bool NetworkUtils::parse_address(const std::string& ip, int port, sockaddr_in& addr) {
     std::memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -70,6 +105,103 @@ bool NetworkUtils::bind_socket(int fd, const sockaddr_in& addr) {
     return true;
 }
 
+bool NetworkUtils::wait_readable(int fd, int64_t timeout_us) {
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(fd, &read_fds);
+
+    timeval tv;
+    timeval* tv_ptr = nullptr;
+    if (timeout_us >= 0) {
+        tv.tv_sec = timeout_us / 1000000;
+        tv.tv_usec = timeout_us % 1000000;
+        tv_ptr = &tv;
+    }
+
+    int ready = select(fd + 1, &read_fds, nullptr, nullptr, tv_ptr);
+    return ready > 0;
+}
+
+int NetworkUtils::wait_any_readable(const std::vector<int>& fds, size_t first, int64_t timeout_us) {
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    int max_fd = -1;
+    for (int fd : fds) {
+        FD_SET(fd, &read_fds);
+        max_fd = std::max(max_fd, fd);
+    }
+
+    timeval tv;
+    timeval* tv_ptr = nullptr;
+    if (timeout_us >= 0) {
+        tv.tv_sec = timeout_us / 1000000;
+        tv.tv_usec = timeout_us % 1000000;
+        tv_ptr = &tv;
+    }
+
+    if (select(max_fd + 1, &read_fds, nullptr, nullptr, tv_ptr) <= 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+        size_t index = (first + i) % fds.size();
+        if (FD_ISSET(fds[index], &read_fds)) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+bool NetworkUtils::is_multicast(const sockaddr_in& addr) {
+    return IN_MULTICAST(ntohl(addr.sin_addr.s_addr));
+}
+
+bool NetworkUtils::join_multicast_group(int fd, const sockaddr_in& group, const std::string& iface) {
+    ip_mreq mreq;
+    std::memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr = group.sin_addr;
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (!iface.empty() && inet_pton(AF_INET, iface.c_str(), &mreq.imr_interface) <= 0) {
+        std::cerr << "Invalid interface address: " << iface << std::endl;
+        return false;
+    }
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        perror("setsockopt IP_ADD_MEMBERSHIP failed");
+        return false;
+    }
+    return true;
+}
+
+bool NetworkUtils::set_multicast_ttl(int fd, int ttl) {
+    unsigned char value = static_cast<unsigned char>(ttl);
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value)) < 0) {
+        perror("setsockopt IP_MULTICAST_TTL failed");
+        return false;
+    }
+    return true;
+}
+
+bool NetworkUtils::set_multicast_loop(int fd, bool enabled) {
+    unsigned char value = enabled ? 1 : 0;
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &value, sizeof(value)) < 0) {
+        perror("setsockopt IP_MULTICAST_LOOP failed");
+        return false;
+    }
+    return true;
+}
+
+bool NetworkUtils::set_multicast_interface(int fd, const std::string& iface) {
+    in_addr addr;
+    if (inet_pton(AF_INET, iface.c_str(), &addr) <= 0) {
+        std::cerr << "Invalid interface address: " << iface << std::endl;
+        return false;
+    }
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) < 0) {
+        perror("setsockopt IP_MULTICAST_IF failed");
+        return false;
+    }
+    return true;
+}
+
 bool NetworkUtils::is_valid_ip(const std::string& ip) {
     sockaddr_in addr;
     return inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) > 0;
@@ -112,19 +244,29 @@ Socket::Socket() : fd_(-1) {}
 
 Socket::Socket(int fd) : fd_(fd) {}
 
+Socket::Socket(int fd, DatagramSink* sink) : fd_(fd), sink_(sink) {}
+
 Socket::~Socket() {
     close();
 }
 
-Socket::Socket(Socket&& other) noexcept : fd_(other.fd_) {
+Socket::Socket(Socket&& other) noexcept
+    : fd_(other.fd_), sink_(other.sink_), timestamping_flags_(other.timestamping_flags_), tx_next_id_(other.tx_next_id_),
+      tx_ids_(std::move(other.tx_ids_)) {
     other.fd_ = -1;
+    other.timestamping_flags_ = 0;
 }
 
 Socket& Socket::operator=(Socket&& other) noexcept {
     if (this != &other) {
         close();
         fd_ = other.fd_;
+        sink_ = other.sink_;
+        timestamping_flags_ = other.timestamping_flags_;
+        tx_next_id_ = other.tx_next_id_;
+        tx_ids_ = std::move(other.tx_ids_);
         other.fd_ = -1;
+        other.timestamping_flags_ = 0;
     }
     return *this;
 }
@@ -148,13 +290,51 @@ bool Socket::set_reuseaddr() {
     return NetworkUtils::set_socket_reuseaddr(fd_);
 }
 
+bool Socket::set_reuseport() {
+    return NetworkUtils::set_socket_reuseport(fd_);
+}
+
 bool Socket::bind(const sockaddr_in& addr) {
     return NetworkUtils::bind_socket(fd_, addr);
 }
 
-ssize_t Socket::send_to(const void* data, size_t size, const sockaddr_in& dest) {
-    return sendto(fd_, data, size, 0,
-                  reinterpret_cast<const sockaddr*>(&dest), sizeof(dest));
+bool Socket::join_multicast(const sockaddr_in& group, const std::string& iface) {
+    return NetworkUtils::join_multicast_group(fd_, group, iface);
+}
+
+bool Socket::set_multicast_ttl(int ttl) {
+    return NetworkUtils::set_multicast_ttl(fd_, ttl);
+}
+
+bool Socket::set_multicast_loop(bool enabled) {
+    return NetworkUtils::set_multicast_loop(fd_, enabled);
+}
+
+bool Socket::set_multicast_interface(const std::string& iface) {
+    return NetworkUtils::set_multicast_interface(fd_, iface);
+}
+
+bool Socket::wait_readable(int64_t timeout_us) {
+    return NetworkUtils::wait_readable(fd_, timeout_us);
+}
+
+ssize_t Socket::send_direct(const void* data, size_t size, const sockaddr_in& dest) {
+    if (tx_ids_.empty()) {
+        return sendto(fd_, data, size, 0,
+                      reinterpret_cast<const sockaddr*>(&dest), sizeof(dest));
+    }
+
+
+    // Sending under the lock keeps our numbering in the kernel's order.
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    ssize_t sent = sendto(fd_, data, size, 0,
+                          reinterpret_cast<const sockaddr*>(&dest), sizeof(dest));
+    if (sent >= 0) {
+        sequence_t seq_be = 0;
+        std::memcpy(&seq_be, data, std::min(size, sizeof(seq_be)));
+        tx_ids_[tx_next_id_++ & (tx_ids_.size() - 1)] = be64toh(seq_be);
+    }
+    return sent;
 }
 
 ssize_t Socket::recv_from(void* data, size_t size, sockaddr_in* src) {
@@ -163,4 +343,119 @@ ssize_t Socket::recv_from(void* data, size_t size, sockaddr_in* src) {
                     reinterpret_cast<sockaddr*>(src), src ? &src_len : nullptr);
 }
 
-}
\ No newline at end of file
+
+bool Socket::enable_tx_timestamps() {
+#ifdef SO_TIMESTAMPING
+    int flags = timestamping_flags_ | SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+                SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        std::cerr << "Failed to enable TX timestamps: " << NetworkUtils::get_socket_error() << std::endl;
+        return false;
+    }
+    timestamping_flags_ = flags;
+    tx_next_id_ = 0;
+    tx_ids_.assign(config::TIMESTAMP_TABLE_SIZE, 0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Socket::enable_rx_timestamps() {
+#ifdef SO_TIMESTAMPING
+    int flags = timestamping_flags_ | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        std::cerr << "Failed to enable RX timestamps: " << NetworkUtils::get_socket_error() << std::endl;
+        return false;
+    }
+    timestamping_flags_ = flags;
+    return true;
+#else
+    return false;
+#endif
+}
+
+ssize_t Socket::recv_from(void* data, size_t size, sockaddr_in* src, timestamp_t* kernel_rx_ns) {
+    *kernel_rx_ns = 0;
+#ifdef SO_TIMESTAMPING
+    if (timestamping_flags_ & SOF_TIMESTAMPING_RX_SOFTWARE) {
+        iovec iov{data, size};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+        msghdr msg{};
+        msg.msg_name = src;
+        msg.msg_namelen = src ? sizeof(*src) : 0;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd_, &msg, 0);
+        for (cmsghdr* cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : nullptr; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping stamps;
+                std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                if (stamps.ts[0].tv_sec != 0 || stamps.ts[0].tv_nsec != 0) {
+                    *kernel_rx_ns = kernel_time_to_local(stamps.ts[0]);
+                }
+            }
+        }
+        return n;
+    }
+#endif
+    return recv_from(data, size, src);
+}
+
+size_t Socket::read_tx_timestamps(TxTimestamp* out, size_t max) {
+    size_t count = 0;
+#ifdef SO_TIMESTAMPING
+    if (tx_ids_.empty()) {
+        return 0;
+    }
+
+    alignas(cmsghdr) char control[512];
+    while (count < max) {
+        char payload[64];
+        iovec iov{payload, sizeof(payload)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+
+        const timespec* ts = nullptr;
+        sock_extended_err err{};
+        bool have_err = false;
+        scm_timestamping stamps;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                ts = &stamps.ts[0];
+            } else if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR) {
+                std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                have_err = true;
+            }
+        }
+        if (!ts || !have_err || err.ee_origin != SO_EE_ORIGIN_TIMESTAMPING ||
+            (err.ee_info != SCM_TSTAMP_SCHED && err.ee_info != SCM_TSTAMP_SND)) {
+            continue;
+        }
+
+        TxTimestamp& stamp = out[count++];
+        {
+            std::lock_guard<std::mutex> lock(tx_mutex_);
+            stamp.seq = tx_ids_[err.ee_data & (tx_ids_.size() - 1)];
+        }
+        stamp.scheduled = err.ee_info == SCM_TSTAMP_SCHED;
+        stamp.ts_ns = kernel_time_to_local(*ts);
+    }
+#else
+    (void)out;
+    (void)max;
+#endif
+    return count;
+}
+
+}
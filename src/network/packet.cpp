@@ -1,5 +1,7 @@
 #include "udp_benchmark/packet.hpp"
 #include <algorithm>
+#include <arpa/inet.h>
+#include <cstddef>
 
 namespace udp_benchmark {
 
@@ -20,6 +22,13 @@ void Packet::set_timestamp(timestamp_t ts) {
     }
 }
 
+void Packet::set_intended_timestamp(timestamp_t ts) {
+    if (data_.size() >= sizeof(PacketHeader)) {
+        timestamp_t ts_be = htobe64(ts);
+        std::memcpy(data_.data() + offsetof(PacketHeader, intended_ts), &ts_be, sizeof(timestamp_t));
+    }
+}
+
 sequence_t Packet::get_sequence() const {
     if (data_.size() >= sizeof(sequence_t)) {
         sequence_t seq_be;
@@ -38,13 +47,22 @@ timestamp_t Packet::get_timestamp() const {
     return 0;
 }
 
+timestamp_t Packet::get_intended_timestamp() const {
+    if (data_.size() >= sizeof(PacketHeader)) {
+        timestamp_t ts_be;
+        std::memcpy(&ts_be, data_.data() + offsetof(PacketHeader, intended_ts), sizeof(timestamp_t));
+        return be64toh(ts_be);
+    }
+    return 0;
+}
+
 bool Packet::has_valid_header() const {
     return data_.size() >= sizeof(PacketHeader);
 }
 
 
-AckPacket::AckPacket(size_t bitmap_bytes)
-    : data_(sizeof(AckHeader) + bitmap_bytes, 0) {}
+AckPacket::AckPacket(size_t bitmap_bytes, size_t dsack_count)
+    : data_(sizeof(AckHeader) + bitmap_bytes + dsack_count * sizeof(sequence_t), 0) {}
 
 void AckPacket::set_ack_sequence(sequence_t ack_seq) {
     if (data_.size() >= sizeof(sequence_t)) {
@@ -65,7 +83,7 @@ void AckPacket::set_bitmap_bit(size_t index, bool value) {
     size_t byte_idx = index / 8;
     int bit_idx = index % 8;
 
-    size_t bitmap_size = data_.size() - sizeof(AckHeader);
+    size_t bitmap_size = get_bitmap_length();
     if (byte_idx < bitmap_size) {
         if (value) {
             bitmap[byte_idx] |= (1 << bit_idx);
@@ -75,6 +93,35 @@ void AckPacket::set_bitmap_bit(size_t index, bool value) {
     }
 }
 
+void AckPacket::set_ack_delay_us(uint32_t delay_us) {
+    if (data_.size() >= sizeof(AckHeader)) {
+        uint32_t delay_be = htonl(delay_us);
+        std::memcpy(data_.data() + offsetof(AckHeader, ack_delay_us), &delay_be, sizeof(uint32_t));
+    }
+}
+
+void AckPacket::set_timestamps(const AckTimestamps& timestamps) {
+    if (data_.size() >= sizeof(AckHeader)) {
+        timestamp_t echo_be = htobe64(timestamps.echo_ts);
+        timestamp_t recv_be = htobe64(timestamps.recv_ts);
+        timestamp_t ack_be = htobe64(timestamps.ack_ts);
+        std::memcpy(data_.data() + offsetof(AckHeader, echo_ts), &echo_be, sizeof(timestamp_t));
+        std::memcpy(data_.data() + offsetof(AckHeader, recv_ts), &recv_be, sizeof(timestamp_t));
+        std::memcpy(data_.data() + offsetof(AckHeader, ack_ts), &ack_be, sizeof(timestamp_t));
+    }
+}
+
+void AckPacket::set_dsacks(const std::vector<sequence_t>& dsacks) {
+    size_t offset = sizeof(AckHeader) + get_bitmap_length();
+    size_t count = std::min(dsacks.size(), (data_.size() - std::min(offset, data_.size())) / sizeof(sequence_t));
+    uint16_t count_be = htons(static_cast<uint16_t>(count));
+    std::memcpy(data_.data() + offsetof(AckHeader, dsack_count), &count_be, sizeof(uint16_t));
+    for (size_t i = 0; i < count; ++i) {
+        sequence_t seq_be = htobe64(dsacks[i]);
+        std::memcpy(data_.data() + offset + i * sizeof(sequence_t), &seq_be, sizeof(sequence_t));
+    }
+}
+
 sequence_t AckPacket::get_ack_sequence() const {
     if (data_.size() >= sizeof(sequence_t)) {
         sequence_t ack_be;
@@ -93,12 +140,34 @@ uint16_t AckPacket::get_bitmap_length() const {
     return 0;
 }
 
+uint32_t AckPacket::get_ack_delay_us() const {
+    if (data_.size() >= sizeof(AckHeader)) {
+        uint32_t delay_be;
+        std::memcpy(&delay_be, data_.data() + offsetof(AckHeader, ack_delay_us), sizeof(uint32_t));
+        return ntohl(delay_be);
+    }
+    return 0;
+}
+
+AckTimestamps AckPacket::get_timestamps() const {
+    AckTimestamps timestamps;
+    if (data_.size() >= sizeof(AckHeader)) {
+        std::memcpy(&timestamps.echo_ts, data_.data() + offsetof(AckHeader, echo_ts), sizeof(timestamp_t));
+        std::memcpy(&timestamps.recv_ts, data_.data() + offsetof(AckHeader, recv_ts), sizeof(timestamp_t));
+        std::memcpy(&timestamps.ack_ts, data_.data() + offsetof(AckHeader, ack_ts), sizeof(timestamp_t));
+        timestamps.echo_ts = be64toh(timestamps.echo_ts);
+        timestamps.recv_ts = be64toh(timestamps.recv_ts);
+        timestamps.ack_ts = be64toh(timestamps.ack_ts);
+    }
+    return timestamps;
+}
+
 bool AckPacket::get_bitmap_bit(size_t index) const {
     const uint8_t* bitmap = get_bitmap_data();
     size_t byte_idx = index / 8;
     int bit_idx = index % 8;
 
-    size_t bitmap_size = data_.size() - sizeof(AckHeader);
+    size_t bitmap_size = get_bitmap_length();
     if (byte_idx < bitmap_size) {
         return (bitmap[byte_idx] >> bit_idx) & 1;
     }
@@ -106,28 +175,70 @@ bool AckPacket::get_bitmap_bit(size_t index) const {
 }
 
 void AckPacket::clear_bitmap() {
-    if (data_.size() > sizeof(AckHeader)) {
-        std::memset(data_.data() + sizeof(AckHeader), 0,
-                   data_.size() - sizeof(AckHeader));
-    }
+    std::memset(get_bitmap_data(), 0, get_bitmap_length());
 }
 
 
-Packet PacketHandler::create_data_packet(sequence_t seq, timestamp_t ts, size_t total_size) {
+Packet PacketHandler::create_data_packet(sequence_t seq, timestamp_t ts, size_t total_size,
+                                        timestamp_t intended_ts) {
     Packet packet(std::max(total_size, sizeof(PacketHeader)));
     packet.set_sequence(seq);
     packet.set_timestamp(ts);
+    packet.set_intended_timestamp(intended_ts != 0 ? intended_ts : ts);
+    return packet;
+}
+
+Packet PacketHandler::create_fragment_packet(sequence_t seq, timestamp_t ts, const FragmentLayout& layout,
+                                            timestamp_t intended_ts) {
+    uint32_t index = layout.index_of(seq);
+    Packet packet = create_data_packet(seq, ts, layout.datagram_size(index), intended_ts);
+    if (!layout.enabled()) {
+        return packet;
+    }
+
+    FragmentHeader fragment;
+    fragment.message_id = htobe64(layout.message_of(seq));
+    fragment.message_size = htonl(layout.message_size);
+    fragment.index = htons(static_cast<uint16_t>(index));
+    fragment.count = htons(static_cast<uint16_t>(layout.fragment_count));
+    std::memcpy(packet.data() + sizeof(PacketHeader), &fragment, sizeof(fragment));
+    return packet;
+}
+
+Packet PacketHandler::create_batch_packet(sequence_t seq, timestamp_t ts, timestamp_t intended_ts,
+                                         const BatchEntry* messages, size_t count, size_t message_size) {
+    Packet packet = create_data_packet(seq, ts, batch_packet_size(count, message_size), intended_ts);
+
+    BatchHeader batch;
+    batch.count = htons(static_cast<uint16_t>(count));
+    batch.message_size = htons(static_cast<uint16_t>(message_size));
+    std::memcpy(packet.data() + sizeof(PacketHeader), &batch, sizeof(batch));
+
+    uint8_t* message = packet.data() + sizeof(PacketHeader) + sizeof(BatchHeader);
+    for (size_t i = 0; i < count; ++i, message += message_size) {
+        PacketHeader header;
+        header.seq = htobe64(messages[i].seq);
+        header.timestamp = htobe64(messages[i].ts);
+        header.intended_ts = htobe64(messages[i].intended_ts != 0 ? messages[i].intended_ts : messages[i].ts);
+        std::memcpy(message, &header, sizeof(header));
+    }
     return packet;
 }
 
 AckPacket PacketHandler::create_ack_packet(sequence_t ack_seq,
                                           const std::vector<sequence_t>& missing_seqs,
-                                          size_t window_size) {
+                                          size_t window_size,
+                                          uint32_t ack_delay_us,
+                                          const AckTimestamps& timestamps,
+                                          const std::vector<sequence_t>& dsacks) {
     size_t bitmap_bytes = window_size / 8;
-    AckPacket ack_packet(bitmap_bytes);
+    AckPacket ack_packet(bitmap_bytes, dsacks.size());
 
     ack_packet.set_ack_sequence(ack_seq);
     ack_packet.set_bitmap_length(bitmap_bytes);
+    ack_packet.set_ack_delay_us(ack_delay_us);
+    ack_packet.set_timestamps(timestamps);
+    ack_packet.set_dsacks(dsacks);
 
 
     for (sequence_t missing : missing_seqs) {
@@ -141,7 +252,8 @@ AckPacket PacketHandler::create_ack_packet(sequence_t ack_seq,
 }
 
 bool PacketHandler::parse_data_packet(const uint8_t* data, size_t size,
-                                     sequence_t& seq, timestamp_t& ts) {
+                                     sequence_t& seq, timestamp_t& ts,
+                                     timestamp_t* intended_ts) {
     if (!is_valid_packet_size(size)) {
         return false;
     }
@@ -154,12 +266,56 @@ bool PacketHandler::parse_data_packet(const uint8_t* data, size_t size,
 
     seq = be64toh(seq_be);
     ts = be64toh(ts_be);
+    if (intended_ts) {
+        timestamp_t intended_be;
+        std::memcpy(&intended_be, data + offsetof(PacketHeader, intended_ts), sizeof(timestamp_t));
+        *intended_ts = be64toh(intended_be);
+    }
+
+    return seq != config::CONTROL_MARKER;
+}
 
+bool PacketHandler::parse_fragment_header(const uint8_t* data, size_t size, FragmentHeader& fragment) {
+    if (size < FragmentLayout::header_size()) {
+        return false;
+    }
+
+    FragmentHeader frame;
+    std::memcpy(&frame, data + sizeof(PacketHeader), sizeof(frame));
+    fragment.message_id = be64toh(frame.message_id);
+    fragment.message_size = ntohl(frame.message_size);
+    fragment.index = ntohs(frame.index);
+    fragment.count = ntohs(frame.count);
+    return fragment.message_id != 0 && fragment.index < fragment.count;
+}
+
+bool PacketHandler::parse_batch_packet(const uint8_t* data, size_t size, std::vector<BatchEntry>& messages) {
+    messages.clear();
+    if (size < sizeof(PacketHeader) + sizeof(BatchHeader)) {
+        return false;
+    }
+
+    BatchHeader batch;
+    std::memcpy(&batch, data + sizeof(PacketHeader), sizeof(batch));
+    size_t count = ntohs(batch.count);
+    size_t message_size = ntohs(batch.message_size);
+    if (message_size < sizeof(PacketHeader) || batch_packet_size(count, message_size) > size) {
+        return false;
+    }
+
+    const uint8_t* message = data + sizeof(PacketHeader) + sizeof(BatchHeader);
+    for (size_t i = 0; i < count; ++i, message += message_size) {
+        PacketHeader header;
+        std::memcpy(&header, message, sizeof(header));
+        messages.push_back({be64toh(header.seq), be64toh(header.timestamp), be64toh(header.intended_ts)});
+    }
     return true;
 }
 
 bool PacketHandler::parse_ack_packet(const uint8_t* data, size_t size,
-                                    sequence_t& ack_seq, std::vector<sequence_t>& missing_seqs) {
+                                    sequence_t& ack_seq, std::vector<sequence_t>& missing_seqs,
+                                    uint32_t* ack_delay_us, sequence_t* window_end,
+                                    AckTimestamps* timestamps, std::vector<sequence_t>* dsacks) {
     if (!is_valid_ack_size(size)) {
         return false;
     }
@@ -167,35 +323,301 @@ bool PacketHandler::parse_ack_packet(const uint8_t* data, size_t size,
 
     sequence_t ack_be;
     uint16_t bitmap_len_be;
+    uint32_t delay_be;
+    uint16_t dsack_count_be;
 
     std::memcpy(&ack_be, data, sizeof(sequence_t));
     std::memcpy(&bitmap_len_be, data + sizeof(sequence_t), sizeof(uint16_t));
+    std::memcpy(&delay_be, data + offsetof(AckHeader, ack_delay_us), sizeof(uint32_t));
+    std::memcpy(&dsack_count_be, data + offsetof(AckHeader, dsack_count), sizeof(uint16_t));
 
     ack_seq = be64toh(ack_be);
     uint16_t bitmap_len = ntohs(bitmap_len_be);
+    uint16_t dsack_count = ntohs(dsack_count_be);
 
-    if (size < sizeof(AckHeader) + bitmap_len) {
+    if (ack_seq == config::CONTROL_MARKER ||
+        size < sizeof(AckHeader) + bitmap_len + dsack_count * sizeof(sequence_t)) {
         return false;
     }
 
+    if (ack_delay_us) {
+        *ack_delay_us = ntohl(delay_be);
+    }
+    if (window_end) {
+        *window_end = ack_seq + static_cast<sequence_t>(bitmap_len) * 8;
+    }
+    if (timestamps) {
+        AckHeader header;
+        std::memcpy(&header, data, sizeof(AckHeader));
+        timestamps->echo_ts = be64toh(header.echo_ts);
+        timestamps->recv_ts = be64toh(header.recv_ts);
+        timestamps->ack_ts = be64toh(header.ack_ts);
+    }
+
 
     missing_seqs.clear();
     const uint8_t* bitmap = data + sizeof(AckHeader);
 
-    size_t max_bits = bitmap_len * 8;
-    for (size_t i = 0; i < max_bits; ++i) {
-        size_t byte_idx = i / 8;
-        int bit_idx = i % 8;
-
-        if (byte_idx < bitmap_len) {
-            bool bit_set = (bitmap[byte_idx] >> bit_idx) & 1;
-            if (!bit_set) {
-                sequence_t missing_seq = ack_seq + 1 + i;
-                missing_seqs.push_back(missing_seq);
-            }
+    for (size_t byte_idx = 0; byte_idx < bitmap_len; ++byte_idx) {
+        for (unsigned bits = bitmap[byte_idx]; bits != 0; bits &= bits - 1) {
+            sequence_t missing_seq = ack_seq + 1 + byte_idx * 8 + __builtin_ctz(bits);
+            missing_seqs.push_back(missing_seq);
         }
     }
 
+    if (dsacks) {
+        dsacks->clear();
+        const uint8_t* entries = bitmap + bitmap_len;
+        for (size_t i = 0; i < dsack_count; ++i) {
+            sequence_t seq_be;
+            std::memcpy(&seq_be, entries + i * sizeof(sequence_t), sizeof(sequence_t));
+            dsacks->push_back(be64toh(seq_be));
+        }
+    }
+
+    return true;
+}
+
+Packet PacketHandler::create_control_packet(ControlType type, size_t payload_size) {
+    Packet packet(sizeof(ControlHeader) + payload_size);
+    packet.resize(sizeof(ControlHeader) + payload_size);
+
+    sequence_t marker_be = htobe64(config::CONTROL_MARKER);
+    std::memcpy(packet.data(), &marker_be, sizeof(sequence_t));
+    packet.data()[offsetof(ControlHeader, type)] = static_cast<uint8_t>(type);
+    return packet;
+}
+
+bool PacketHandler::parse_control_type(const uint8_t* data, size_t size, ControlType& type) {
+    if (size < sizeof(ControlHeader)) {
+        return false;
+    }
+
+    sequence_t marker_be;
+    std::memcpy(&marker_be, data, sizeof(sequence_t));
+    if (be64toh(marker_be) != config::CONTROL_MARKER) {
+        return false;
+    }
+
+    type = static_cast<ControlType>(data[offsetof(ControlHeader, type)]);
+    return true;
+}
+
+Packet PacketHandler::create_ack_frequency_packet(const AckFrequencyFrame& frame) {
+    Packet packet = create_control_packet(ControlType::ACK_FREQUENCY, sizeof(AckFrequencyFrame));
+
+    AckFrequencyFrame wire;
+    wire.request_id = htonl(frame.request_id);
+    wire.ack_period = htonl(frame.ack_period);
+    wire.max_ack_delay_us = htonl(frame.max_ack_delay_us);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &wire, sizeof(wire));
+    return packet;
+}
+
+bool PacketHandler::parse_ack_frequency_packet(const uint8_t* data, size_t size, AckFrequencyFrame& frame) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::ACK_FREQUENCY ||
+        size < sizeof(ControlHeader) + sizeof(AckFrequencyFrame)) {
+        return false;
+    }
+
+    AckFrequencyFrame wire;
+    std::memcpy(&wire, data + sizeof(ControlHeader), sizeof(wire));
+    frame.request_id = ntohl(wire.request_id);
+    frame.ack_period = ntohl(wire.ack_period);
+    frame.max_ack_delay_us = ntohl(wire.max_ack_delay_us);
+    return true;
+}
+
+Packet PacketHandler::create_hello_packet(const HelloFrame& hello) {
+    Packet packet = create_control_packet(ControlType::HELLO, sizeof(HelloFrame));
+
+    HelloFrame frame;
+    frame.run_id = htobe64(hello.run_id);
+    frame.send_ts = htobe64(hello.send_ts);
+    frame.total_count = htobe64(hello.total_count);
+    frame.msg_size = htonl(hello.msg_size);
+    frame.window_size = htonl(hello.window_size);
+    frame.max_inflight = htonl(hello.max_inflight);
+    frame.ack_period = htonl(hello.ack_period);
+    frame.max_ack_delay_us = htonl(hello.max_ack_delay_us);
+    frame.flags = htonl(hello.flags);
+    frame.datagram_size = htonl(hello.datagram_size);
+    frame.fec_data = htons(hello.fec_data);
+    frame.fec_parity = htons(hello.fec_parity);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &frame, sizeof(frame));
+    return packet;
+}
+
+bool PacketHandler::parse_hello_packet(const uint8_t* data, size_t size, HelloFrame& hello) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::HELLO ||
+        size < sizeof(ControlHeader) + sizeof(HelloFrame)) {
+        return false;
+    }
+
+    HelloFrame frame;
+    std::memcpy(&frame, data + sizeof(ControlHeader), sizeof(frame));
+    hello.run_id = be64toh(frame.run_id);
+    hello.send_ts = be64toh(frame.send_ts);
+    hello.total_count = be64toh(frame.total_count);
+    hello.msg_size = ntohl(frame.msg_size);
+    hello.window_size = ntohl(frame.window_size);
+    hello.max_inflight = ntohl(frame.max_inflight);
+    hello.ack_period = ntohl(frame.ack_period);
+    hello.max_ack_delay_us = ntohl(frame.max_ack_delay_us);
+    hello.flags = ntohl(frame.flags);
+    hello.datagram_size = ntohl(frame.datagram_size);
+    hello.fec_data = ntohs(frame.fec_data);
+    hello.fec_parity = ntohs(frame.fec_parity);
+    return true;
+}
+
+Packet PacketHandler::create_hello_ack_packet(const HelloAckFrame& hello_ack) {
+    Packet packet = create_control_packet(ControlType::HELLO_ACK, sizeof(HelloAckFrame));
+
+    HelloAckFrame frame;
+    frame.run_id = htobe64(hello_ack.run_id);
+    frame.echo_ts = htobe64(hello_ack.echo_ts);
+    frame.recv_ts = htobe64(hello_ack.recv_ts);
+    frame.ack_ts = htobe64(hello_ack.ack_ts);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &frame, sizeof(frame));
+    return packet;
+}
+
+bool PacketHandler::parse_hello_ack_packet(const uint8_t* data, size_t size, HelloAckFrame& hello_ack) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::HELLO_ACK ||
+        size < sizeof(ControlHeader) + sizeof(HelloAckFrame)) {
+        return false;
+    }
+
+    HelloAckFrame frame;
+    std::memcpy(&frame, data + sizeof(ControlHeader), sizeof(frame));
+    hello_ack.run_id = be64toh(frame.run_id);
+    hello_ack.echo_ts = be64toh(frame.echo_ts);
+    hello_ack.recv_ts = be64toh(frame.recv_ts);
+    hello_ack.ack_ts = be64toh(frame.ack_ts);
+    return true;
+}
+
+Packet PacketHandler::create_clock_sync_packet(const ClockSyncFrame& sync) {
+    Packet packet = create_control_packet(ControlType::CLOCK_SYNC, sizeof(ClockSyncFrame));
+
+    ClockSyncFrame frame;
+    frame.ref_ts = htobe64(sync.ref_ts);
+    frame.offset_ns = static_cast<int64_t>(htobe64(static_cast<uint64_t>(sync.offset_ns)));
+    frame.drift_ppb = static_cast<int64_t>(htobe64(static_cast<uint64_t>(sync.drift_ppb)));
+    frame.uncertainty_ns = htobe64(sync.uncertainty_ns);
+    frame.samples = htobe64(sync.samples);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &frame, sizeof(frame));
+    return packet;
+}
+
+bool PacketHandler::parse_clock_sync_packet(const uint8_t* data, size_t size, ClockSyncFrame& sync) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::CLOCK_SYNC ||
+        size < sizeof(ControlHeader) + sizeof(ClockSyncFrame)) {
+        return false;
+    }
+
+    ClockSyncFrame frame;
+    std::memcpy(&frame, data + sizeof(ControlHeader), sizeof(frame));
+    sync.ref_ts = be64toh(frame.ref_ts);
+    sync.offset_ns = static_cast<int64_t>(be64toh(static_cast<uint64_t>(frame.offset_ns)));
+    sync.drift_ppb = static_cast<int64_t>(be64toh(static_cast<uint64_t>(frame.drift_ppb)));
+    sync.uncertainty_ns = be64toh(frame.uncertainty_ns);
+    sync.samples = be64toh(frame.samples);
+    return true;
+}
+
+Packet PacketHandler::create_fin_packet(sequence_t final_seq) {
+    Packet packet = create_control_packet(ControlType::FIN, sizeof(FinFrame));
+
+    FinFrame frame;
+    frame.final_seq = htobe64(final_seq);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &frame, sizeof(frame));
+    return packet;
+}
+
+bool PacketHandler::parse_fin_packet(const uint8_t* data, size_t size, sequence_t& final_seq) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::FIN ||
+        size < sizeof(ControlHeader) + sizeof(FinFrame)) {
+        return false;
+    }
+
+    FinFrame frame;
+    std::memcpy(&frame, data + sizeof(ControlHeader), sizeof(frame));
+    final_seq = be64toh(frame.final_seq);
+    return true;
+}
+
+Packet PacketHandler::create_fin_ack_packet(const FinAckFrame& summary) {
+    Packet packet = create_control_packet(ControlType::FIN_ACK, sizeof(FinAckFrame));
+
+    FinAckFrame frame;
+    frame.final_seq = htobe64(summary.final_seq);
+    frame.packets_received = htobe64(summary.packets_received);
+    frame.duplicate_packets = htobe64(summary.duplicate_packets);
+    frame.acks_sent = htobe64(summary.acks_sent);
+    std::memcpy(packet.data() + sizeof(ControlHeader), &frame, sizeof(frame));
+    return packet;
+}
+
+bool PacketHandler::parse_fin_ack_packet(const uint8_t* data, size_t size, FinAckFrame& summary) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::FIN_ACK ||
+        size < sizeof(ControlHeader) + sizeof(FinAckFrame)) {
+        return false;
+    }
+
+    FinAckFrame frame;
+    std::memcpy(&frame, data + sizeof(ControlHeader), sizeof(frame));
+    summary.final_seq = be64toh(frame.final_seq);
+    summary.packets_received = be64toh(frame.packets_received);
+    summary.duplicate_packets = be64toh(frame.duplicate_packets);
+    summary.acks_sent = be64toh(frame.acks_sent);
+    return true;
+}
+
+Packet PacketHandler::create_nack_packet(const std::vector<sequence_t>& missing_seqs) {
+    size_t count = std::min(missing_seqs.size(), config::NACK_MAX_ENTRIES);
+    Packet packet = create_control_packet(ControlType::NACK, sizeof(NackHeader) + count * sizeof(sequence_t));
+
+    NackHeader header;
+    header.count = htons(static_cast<uint16_t>(count));
+    uint8_t* out = packet.data() + sizeof(ControlHeader);
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (size_t i = 0; i < count; ++i) {
+        sequence_t seq_be = htobe64(missing_seqs[i]);
+        std::memcpy(out + i * sizeof(sequence_t), &seq_be, sizeof(sequence_t));
+    }
+    return packet;
+}
+
+bool PacketHandler::parse_nack_packet(const uint8_t* data, size_t size, std::vector<sequence_t>& missing_seqs) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::NACK ||
+        size < sizeof(ControlHeader) + sizeof(NackHeader)) {
+        return false;
+    }
+
+    NackHeader header;
+    std::memcpy(&header, data + sizeof(ControlHeader), sizeof(header));
+    size_t count = ntohs(header.count);
+    const uint8_t* in = data + sizeof(ControlHeader) + sizeof(NackHeader);
+    if (size < static_cast<size_t>(in - data) + count * sizeof(sequence_t)) {
+        return false;
+    }
+
+    missing_seqs.clear();
+    for (size_t i = 0; i < count; ++i) {
+        sequence_t seq_be;
+        std::memcpy(&seq_be, in + i * sizeof(sequence_t), sizeof(sequence_t));
+        missing_seqs.push_back(be64toh(seq_be));
+    }
     return true;
 }
 
@@ -207,4 +629,83 @@ bool PacketHandler::is_valid_ack_size(size_t size) {
     return size >= sizeof(AckHeader);
 }
 
-}
\ No newline at end of file
+
+Packet PacketHandler::create_tx_timestamps_packet(const TxTimestampEntry* entries, size_t count) {
+    count = std::min(count, config::TX_REPORT_MAX_ENTRIES);
+    Packet packet = create_control_packet(ControlType::TX_TIMESTAMPS,
+                                          sizeof(TxTimestampsHeader) + count * sizeof(TxTimestampEntry));
+
+    TxTimestampsHeader header;
+    header.count = htons(static_cast<uint16_t>(count));
+    uint8_t* out = packet.data() + sizeof(ControlHeader);
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (size_t i = 0; i < count; ++i) {
+        TxTimestampEntry entry;
+        entry.seq = htobe64(entries[i].seq);
+        entry.tx_ts = htobe64(entries[i].tx_ts);
+        std::memcpy(out + i * sizeof(entry), &entry, sizeof(entry));
+    }
+    return packet;
+}
+
+bool PacketHandler::parse_tx_timestamps_packet(const uint8_t* data, size_t size,
+                                               std::vector<TxTimestampEntry>& entries) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::TX_TIMESTAMPS ||
+        size < sizeof(ControlHeader) + sizeof(TxTimestampsHeader)) {
+        return false;
+    }
+
+    TxTimestampsHeader header;
+    std::memcpy(&header, data + sizeof(ControlHeader), sizeof(header));
+    size_t count = ntohs(header.count);
+    const uint8_t* in = data + sizeof(ControlHeader) + sizeof(TxTimestampsHeader);
+    if (size < static_cast<size_t>(in - data) + count * sizeof(TxTimestampEntry)) {
+        return false;
+    }
+
+    entries.clear();
+    for (size_t i = 0; i < count; ++i) {
+        TxTimestampEntry entry;
+        std::memcpy(&entry, in + i * sizeof(entry), sizeof(entry));
+        entries.push_back({be64toh(entry.seq), be64toh(entry.tx_ts)});
+    }
+    return true;
+}
+
+Packet PacketHandler::create_parity_packet(const ParityHeader& parity, const uint8_t* symbol, size_t size) {
+    Packet packet = create_control_packet(ControlType::PARITY, sizeof(ParityHeader) + size);
+
+    ParityHeader header;
+    header.first_seq = htobe64(parity.first_seq);
+    header.encoded = htobe64(parity.encoded);
+    header.count = htons(parity.count);
+    header.index = parity.index;
+    header.parity_count = parity.parity_count;
+    std::memcpy(packet.data() + sizeof(ControlHeader), &header, sizeof(header));
+    std::memcpy(packet.data() + sizeof(ControlHeader) + sizeof(header), symbol, size);
+    return packet;
+}
+
+bool PacketHandler::parse_parity_packet(const uint8_t* data, size_t size, ParityHeader& parity,
+                                        const uint8_t*& symbol, size_t& symbol_size) {
+    ControlType type;
+    if (!parse_control_type(data, size, type) || type != ControlType::PARITY ||
+        size < sizeof(ControlHeader) + sizeof(ParityHeader) + sizeof(uint16_t)) {
+        return false;
+    }
+
+    ParityHeader header;
+    std::memcpy(&header, data + sizeof(ControlHeader), sizeof(header));
+    parity.first_seq = be64toh(header.first_seq);
+    parity.encoded = be64toh(header.encoded);
+    parity.count = ntohs(header.count);
+    parity.index = header.index;
+    parity.parity_count = header.parity_count;
+    symbol = data + sizeof(ControlHeader) + sizeof(ParityHeader);
+    symbol_size = size - sizeof(ControlHeader) - sizeof(ParityHeader);
+    return true;
+}
+
+}
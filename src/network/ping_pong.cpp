@@ -0,0 +1,150 @@
+#include "udp_benchmark/ping_pong.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+void PingPongStats::print_summary(uint32_t max_outstanding) const {
+    std::cout << "\nPing-Pong (" << max_outstanding << " outstanding):\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Requests: " << requests << "\n";
+    std::cout << "  Responses: " << responses << "\n";
+    std::cout << "  Timed out: " << timeouts << " ("
+              << (requests > 0 ? timeouts * 100.0 / requests : 0.0) << "%)\n";
+    std::cout << "  Late responses: " << late_responses << "\n";
+    if (peer_unresponsive) {
+        std::cout << "  Stopped early: no response for " << config::PING_PONG_GIVE_UP_MS << " ms\n";
+    }
+}
+
+
+PingPongClient::PingPongClient(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size,
+                               uint32_t max_outstanding, timestamp_t timeout_ns)
+    : socket_(socket), peer_addr_(peer_addr), request_(packet_size),
+      recv_buf_(std::max<size_t>(packet_size, config::MAX_PACKET_SIZE)),
+      max_outstanding_(std::max<uint32_t>(max_outstanding, 1)), timeout_ns_(timeout_ns) {
+
+    // Twice the window, so a lost request only blocks its slot's successor.
+    size_t capacity = 2;
+    while (capacity < 2 * static_cast<size_t>(max_outstanding_)) {
+        capacity <<= 1;
+    }
+    slots_.resize(capacity);
+    slot_mask_ = capacity - 1;
+}
+
+bool PingPongClient::send_request(sequence_t seq, timestamp_t intended_ts) {
+    timestamp_t send_ts = get_timestamp_ns();
+    request_.set_sequence(seq);
+    request_.set_timestamp(send_ts);
+    request_.set_intended_timestamp(intended_ts);
+    if (socket_->send_to(request_.data(), request_.size(), peer_addr_) <= 0) {
+        return false;
+    }
+
+    Request& slot = slots_[seq & slot_mask_];
+    slot.seq = seq;
+    slot.send_ts = send_ts;
+    slot.intended_ts = intended_ts;
+    outstanding_++;
+    stats_.requests++;
+    if (send_callback_) {
+        send_callback_(seq, send_ts);
+    }
+    return true;
+}
+
+void PingPongClient::process_response(const uint8_t* data, size_t size, timestamp_t now) {
+    sequence_t seq;
+    timestamp_t send_ts;
+    if (!PacketHandler::parse_data_packet(data, size, seq, send_ts)) {
+        return;
+    }
+
+    Request& slot = slots_[seq & slot_mask_];
+    if (slot.send_ts == 0 || slot.seq != seq || slot.send_ts != send_ts) {
+        stats_.late_responses++;
+        return;
+    }
+
+    slot.send_ts = 0;
+    outstanding_--;
+    stats_.responses++;
+    last_response_ns_ = now;
+    if (rtt_callback_) {
+        rtt_callback_(seq, send_ts, now, slot.intended_ts);
+    }
+}
+
+void PingPongClient::expire_requests(timestamp_t now) {
+    while (oldest_seq_ < next_seq_) {
+        Request& slot = slots_[oldest_seq_ & slot_mask_];
+        if (slot.send_ts != 0 && slot.seq == oldest_seq_) {
+            if (now - slot.send_ts < timeout_ns_) {
+                break;
+            }
+            slot.send_ts = 0;
+            outstanding_--;
+            stats_.timeouts++;
+        }
+        oldest_seq_++;
+    }
+}
+
+int64_t PingPongClient::get_wait_us(uint64_t total_requests, timestamp_t now) const {
+
+    if (next_seq_ <= total_requests && outstanding_ < max_outstanding_ &&
+        slots_[next_seq_ & slot_mask_].send_ts == 0) {
+        return 10;
+    }
+
+    const Request& oldest = slots_[oldest_seq_ & slot_mask_];
+    if (oldest.send_ts == 0 || oldest.seq != oldest_seq_) {
+        return 1000;
+    }
+    timestamp_t deadline = oldest.send_ts + timeout_ns_;
+    return deadline > now ? static_cast<int64_t>((deadline - now + 999) / 1000) : 0;
+}
+
+void PingPongClient::run(uint64_t total_requests, RateLimiter& limiter) {
+    timestamp_t give_up_ns = static_cast<timestamp_t>(config::PING_PONG_GIVE_UP_MS) * 1000000;
+    last_response_ns_ = get_timestamp_ns();
+
+    while (next_seq_ <= total_requests || outstanding_ > 0) {
+        while (next_seq_ <= total_requests && outstanding_ < max_outstanding_ &&
+               slots_[next_seq_ & slot_mask_].send_ts == 0 && limiter.can_send()) {
+            if (!send_request(next_seq_, limiter.mark_sent())) {
+                break;
+            }
+            next_seq_++;
+        }
+
+        timestamp_t now = get_timestamp_ns();
+        expire_requests(now);
+        if (now - last_response_ns_ >= give_up_ns) {
+            stats_.peer_unresponsive = true;
+            break;
+        }
+        if (!socket_->wait_readable(get_wait_us(total_requests, now))) {
+            continue;
+        }
+
+
+        ssize_t n;
+        while ((n = socket_->recv_from(recv_buf_.data(), recv_buf_.size())) > 0) {
+            now = get_timestamp_ns();
+            ControlType control_type;
+            if (PacketHandler::parse_control_type(recv_buf_.data(), n, control_type)) {
+                if (control_callback_) {
+                    control_callback_(recv_buf_.data(), n);
+                }
+            } else {
+                process_response(recv_buf_.data(), n, now);
+            }
+        }
+    }
+}
+
+}
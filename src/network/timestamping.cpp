@@ -0,0 +1,111 @@
+#include "udp_benchmark/timestamping.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+namespace udp_benchmark {
+
+
+void LatencyStages::reserve(uint64_t expected_packets) {
+    size_t samples = static_cast<size_t>(std::min<uint64_t>(expected_packets, config::MAX_PREALLOCATED_SAMPLES));
+    for (LatencyStats* stage : {&app_to_sched, &sched_to_tx, &app_to_tx, &tx_to_rx, &rx_to_app}) {
+        stage->latencies.reserve(samples);
+    }
+}
+
+void LatencyStages::add_send_path(timestamp_t send_ts, timestamp_t sched_ns, timestamp_t tx_ns) {
+    if (tx_ns < send_ts || (sched_ns != 0 && (sched_ns < send_ts || sched_ns > tx_ns))) {
+        inconsistent++;
+        return;
+    }
+    app_to_tx.add_latency(tx_ns - send_ts);
+    if (sched_ns != 0) {
+        app_to_sched.add_latency(sched_ns - send_ts);
+        sched_to_tx.add_latency(tx_ns - sched_ns);
+    }
+}
+
+void LatencyStages::add_packet(timestamp_t send_ts, timestamp_t tx_ns, timestamp_t kernel_rx_ns,
+                               timestamp_t app_rx_ns, int64_t clock_offset_ns) {
+    int64_t wire_ns = static_cast<int64_t>(kernel_rx_ns - tx_ns) - clock_offset_ns;
+    if (tx_ns < send_ts || app_rx_ns < kernel_rx_ns || wire_ns < 0) {
+        inconsistent++;
+        return;
+    }
+    app_to_tx.add_latency(tx_ns - send_ts);
+    tx_to_rx.add_latency(static_cast<uint64_t>(wire_ns));
+    rx_to_app.add_latency(app_rx_ns - kernel_rx_ns);
+}
+
+void LatencyStages::print_summary(const char* title) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << "  Packets: " << std::max(app_to_tx.packet_count, rx_to_app.packet_count)
+              << " decomposed, " << inconsistent << " inconsistent\n";
+
+    const std::pair<const char*, const LatencyStats*> stages[] = {
+        {"app -> qdisc (TX_SCHED)", &app_to_sched},
+        {"qdisc -> device (TX_SOFTWARE)", &sched_to_tx},
+        {"app -> kernel TX", &app_to_tx},
+        {"kernel TX -> kernel RX", &tx_to_rx},
+        {"kernel RX -> app", &rx_to_app},
+    };
+    for (const auto& stage : stages) {
+        stage.second->print_distribution((std::string(title) + ", " + stage.first).c_str());
+    }
+}
+
+
+void TxTimestampTable::add(const TxTimestamp& stamp) {
+    Slot& slot = slots_[stamp.seq & (slots_.size() - 1)];
+    if (slot.seq != stamp.seq) {
+        if (slot.seq > stamp.seq) {
+            return;
+        }
+        slot = Slot();
+        slot.seq = stamp.seq;
+    }
+
+    timestamp_t& ts = stamp.scheduled ? slot.sched_ns : slot.tx_ns;
+    if (ts == 0) {
+        ts = stamp.ts_ns;
+    }
+}
+
+bool TxTimestampTable::find(sequence_t seq, timestamp_t& sched_ns, timestamp_t& tx_ns) const {
+    const Slot& slot = slots_[seq & (slots_.size() - 1)];
+    if (slot.seq != seq || slot.tx_ns == 0) {
+        return false;
+    }
+    sched_ns = slot.sched_ns;
+    tx_ns = slot.tx_ns;
+    return true;
+}
+
+
+void RxTimestampTable::add(sequence_t seq, timestamp_t send_ts, timestamp_t kernel_rx_ns, timestamp_t app_rx_ns) {
+    if (kernel_rx_ns == 0) {
+        return;
+    }
+    Slot& slot = slots_[seq & (slots_.size() - 1)];
+    slot.seq = seq;
+    slot.send_ts = send_ts;
+    slot.kernel_rx_ns = kernel_rx_ns;
+    slot.app_rx_ns = app_rx_ns;
+}
+
+bool RxTimestampTable::take(sequence_t seq, timestamp_t& send_ts, timestamp_t& kernel_rx_ns,
+                            timestamp_t& app_rx_ns) {
+    Slot& slot = slots_[seq & (slots_.size() - 1)];
+    if (slot.seq != seq || seq == 0) {
+        return false;
+    }
+    send_ts = slot.send_ts;
+    kernel_rx_ns = slot.kernel_rx_ns;
+    app_rx_ns = slot.app_rx_ns;
+    slot.seq = 0;
+    return true;
+}
+
+}
@@ -1,4 +1,5 @@
 #include "udp_benchmark/congestion_control.hpp"
+#include "udp_benchmark/trace.hpp"
 #include <algorithm>
 #include <iostream>
 
@@ -30,11 +31,11 @@ void CongestionController::packet_lost() {
     }
 }
 
-void CongestionController::on_ack_received(bool has_loss) {
+void CongestionController::on_ack_received(bool has_loss, uint64_t acked) {
     if (has_loss) {
         decrease_cwnd_on_loss();
     } else {
-        increase_cwnd();
+        increase_cwnd(acked);
     }
 }
 
@@ -67,20 +68,26 @@ void CongestionController::set_max_cwnd(uint64_t max_cwnd) {
     const_cast<uint64_t&>(max_cwnd_) = max_cwnd;
 }
 
-void CongestionController::increase_cwnd() {
-    uint64_t current_cwnd = cwnd_.load();
-    uint64_t current_ssthresh = ssthresh_.load();
-    uint64_t new_cwnd;
-
-    if (current_cwnd < current_ssthresh) {
-
-        new_cwnd = std::min(current_cwnd * 2, max_cwnd_);
-    } else {
-
-        new_cwnd = std::min(current_cwnd + 1, max_cwnd_);
+void CongestionController::increase_cwnd(uint64_t acked) {
+    uint64_t cwnd = cwnd_.load();
+    uint64_t ssthresh = ssthresh_.load();
+
+    // One step per delivered packet in slow start, one per window's worth
+    // after, so the window doubles, then grows by one, each round trip.
+    if (cwnd < ssthresh) {
+        uint64_t step = std::min(acked, ssthresh - cwnd);
+        cwnd += step;
+        acked -= step;
+    }
+    if (acked > 0) {
+        uint64_t count = avoidance_acks_.fetch_add(acked) + acked;
+        if (count >= cwnd) {
+            avoidance_acks_.store(count - cwnd);
+            cwnd++;
+        }
     }
 
-    cwnd_.store(new_cwnd);
+    cwnd_.store(std::min(cwnd, max_cwnd_));
 }
 
 void CongestionController::decrease_cwnd_on_loss() {
@@ -109,16 +116,18 @@ EnhancedCongestionController::EnhancedCongestionController(uint64_t initial_cwnd
     stats_.reset();
 }
 
-void EnhancedCongestionController::on_ack_received_with_stats(bool has_loss) {
+void EnhancedCongestionController::on_ack_received_with_stats(bool has_loss, uint64_t acked) {
     stats_.total_acks++;
 
     if (has_loss) {
         stats_.total_losses++;
+        uint64_t old_cwnd = get_cwnd();
         if (verbose_logging_) {
-            uint64_t current_cwnd = get_cwnd();
-            safe_log("LOSS event: cwnd=", current_cwnd, " -> ");
+            safe_log("LOSS event: cwnd=", old_cwnd, " -> ");
         }
         decrease_cwnd_on_loss();
+        UDP_TRACE_INSTANT(LOSS, old_cwnd, get_cwnd());
+        UDP_TRACE_INSTANT(CWND, get_cwnd(), 0);
         if (verbose_logging_) {
             safe_log(get_cwnd(), " (loss rate: ",
                     static_cast<int>(stats_.get_loss_rate() * 100), "%)\n");
@@ -131,29 +140,29 @@ void EnhancedCongestionController::on_ack_received_with_stats(bool has_loss) {
             stats_.congestion_avoidance_events++;
         }
 
-        increase_cwnd();
+        increase_cwnd(acked);
 
-        if (verbose_logging_) {
-            uint64_t new_cwnd = get_cwnd();
-            if (new_cwnd != old_cwnd) {
+        uint64_t new_cwnd = get_cwnd();
+        if (new_cwnd != old_cwnd) {
+            UDP_TRACE_INSTANT(CWND, new_cwnd, 0);
+            if (verbose_logging_) {
                 safe_log("CWND increase: ", old_cwnd, " -> ", new_cwnd, "\n");
             }
         }
     }
-
-
-    CongestionController::on_ack_received(has_loss);
 }
 
 void EnhancedCongestionController::on_timeout_with_stats() {
     stats_.total_timeouts++;
 
+    uint64_t old_cwnd = get_cwnd();
     if (verbose_logging_) {
-        uint64_t old_cwnd = get_cwnd();
         safe_log("TIMEOUT event: cwnd=", old_cwnd, " -> ");
     }
 
     on_timeout();
+    UDP_TRACE_INSTANT(TIMEOUT, old_cwnd, get_cwnd());
+    UDP_TRACE_INSTANT(CWND, get_cwnd(), 0);
 
     if (verbose_logging_) {
         safe_log(get_cwnd(), " (entering slow start)\n");
@@ -0,0 +1,518 @@
+#include "udp_benchmark/fec.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace udp_benchmark {
+
+
+struct Gf256Tables {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    Gf256Tables() {
+        unsigned x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+};
+
+static const Gf256Tables g_gf256;
+
+
+uint8_t Gf256::mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    return g_gf256.exp[g_gf256.log[a] + g_gf256.log[b]];
+}
+
+uint8_t Gf256::div(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    return g_gf256.exp[g_gf256.log[a] + 255 - g_gf256.log[b]];
+}
+
+uint8_t Gf256::inverse(uint8_t a) {
+    return a == 0 ? 0 : g_gf256.exp[255 - g_gf256.log[a]];
+}
+
+void Gf256::xor_region(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= size; i += 32) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, s));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, s));
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+
+// coef * b is low[b & 15] ^ high[b >> 4]; pshufb does 16 lookups at once.
+void Gf256::mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size) {
+    if (coef == 0) {
+        return;
+    }
+    if (coef == 1) {
+        xor_region(dst, src, size);
+        return;
+    }
+
+    alignas(16) uint8_t low[16];
+    alignas(16) uint8_t high[16];
+    for (uint8_t x = 0; x < 16; ++x) {
+        low[x] = mul(coef, x);
+        high[x] = mul(coef, static_cast<uint8_t>(x << 4));
+    }
+
+    size_t i = 0;
+#if defined(__AVX2__)
+    {
+        __m256i low_table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(low)));
+        __m256i high_table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(high)));
+        __m256i nibble = _mm256_set1_epi8(0x0f);
+        for (; i + 32 <= size; i += 32) {
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i product = _mm256_xor_si256(
+                _mm256_shuffle_epi8(low_table, _mm256_and_si256(s, nibble)),
+                _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi64(s, 4), nibble)));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, product));
+        }
+    }
+#endif
+#if defined(__SSSE3__)
+    {
+        __m128i low_table = _mm_load_si128(reinterpret_cast<const __m128i*>(low));
+        __m128i high_table = _mm_load_si128(reinterpret_cast<const __m128i*>(high));
+        __m128i nibble = _mm_set1_epi8(0x0f);
+        for (; i + 16 <= size; i += 16) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i product = _mm_xor_si128(_mm_shuffle_epi8(low_table, _mm_and_si128(s, nibble)),
+                                            _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi64(s, 4), nibble)));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, product));
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] ^= low[src[i] & 0x0f] ^ high[src[i] >> 4];
+    }
+}
+
+const char* Gf256::get_simd_name() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSSE3__)
+    return "SSSE3";
+#else
+    return "scalar";
+#endif
+}
+
+
+// Cauchy entries 1 / (row + FEC_MAX_PARITY + column), scaled so row 0 is all ones.
+uint8_t FecCode::coefficient(uint32_t row, uint32_t column) {
+    uint8_t y = static_cast<uint8_t>(config::FEC_MAX_PARITY + column);
+    return Gf256::div(y, static_cast<uint8_t>(row) ^ y);
+}
+
+std::string FecCode::describe() const {
+    std::ostringstream out;
+    out << data << ":" << parity << " (" << (parity == 1 ? "XOR parity" : "Reed-Solomon") << ", rate "
+        << std::fixed << std::setprecision(2) << get_rate() << ", +" << std::setprecision(0)
+        << get_overhead_percent() << "% packets, " << Gf256::get_simd_name() << ")";
+    return out.str();
+}
+
+bool FecCode::parse(const char* spec, FecCode& code) {
+    char* end = nullptr;
+    unsigned long data = std::strtoul(spec, &end, 10);
+    if (end == spec || *end != ':') {
+        return false;
+    }
+    const char* parity_spec = end + 1;
+    unsigned long parity = std::strtoul(parity_spec, &end, 10);
+    if (end == parity_spec || *end != '\0' || data < 1 || data > config::FEC_MAX_DATA || parity < 1 ||
+        parity > config::FEC_MAX_PARITY) {
+        return false;
+    }
+    code.data = static_cast<uint32_t>(data);
+    code.parity = static_cast<uint32_t>(parity);
+    return true;
+}
+
+
+void FecSendStats::print_summary(const char* title, const FecCode& code) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << "  Code: " << code.describe() << "\n";
+    std::cout << "  Blocks: " << blocks << " (" << data_packets << " data packets)\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Parity: " << parity_packets << " packets, " << parity_bytes / 1e6 << " MB (+"
+              << get_overhead_percent() << "% over " << data_bytes / 1e6 << " MB of data)\n";
+}
+
+
+void FecEncoder::set_code(const FecCode& code) {
+    code_ = code;
+    parity_.assign(code.parity, std::vector<uint8_t>());
+    block_ = UINT64_MAX;
+    count_ = 0;
+    encoded_ = 0;
+    symbol_size_ = 0;
+    closed_through_ = 0;
+}
+
+void FecEncoder::add(sequence_t seq, const uint8_t* data, size_t size, std::vector<Packet>& parity) {
+    uint64_t block = code_.block_of(seq);
+    if (block != block_) {
+        if (count_ > 0) {
+            finish_block(parity);
+        }
+        block_ = block;
+    }
+
+    size_t symbol_size = sizeof(uint16_t) + size;
+    if (symbol_size > symbol_size_) {
+        for (std::vector<uint8_t>& row : parity_) {
+            row.resize(symbol_size, 0);
+        }
+        symbol_size_ = symbol_size;
+    }
+
+    uint32_t index = code_.index_of(seq);
+    uint8_t length[2] = {static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size)};
+    for (uint32_t row = 0; row < code_.parity; ++row) {
+        uint8_t coef = FecCode::coefficient(row, index);
+        Gf256::mul_add_region(parity_[row].data(), length, coef, sizeof(length));
+        Gf256::mul_add_region(parity_[row].data() + sizeof(length), data, coef, size);
+    }
+    count_ = std::max(count_, index + 1);
+    encoded_ |= 1ULL << index;
+    stats_.data_packets++;
+    stats_.data_bytes += size;
+
+    if (index + 1 == code_.data) {
+        finish_block(parity);
+    }
+}
+
+void FecEncoder::flush(std::vector<Packet>& parity) {
+    if (count_ > 0) {
+        finish_block(parity);
+    }
+}
+
+void FecEncoder::finish_block(std::vector<Packet>& parity) {
+    ParityHeader header;
+    header.first_seq = block_ * code_.data + 1;
+    header.encoded = encoded_;
+    header.count = static_cast<uint16_t>(count_);
+    header.parity_count = static_cast<uint8_t>(code_.parity);
+    for (uint32_t row = 0; row < code_.parity; ++row) {
+        header.index = static_cast<uint8_t>(row);
+        parity.push_back(PacketHandler::create_parity_packet(header, parity_[row].data(), symbol_size_));
+        stats_.parity_packets++;
+        stats_.parity_bytes += parity.back().size();
+        parity_[row].clear();
+    }
+    stats_.blocks++;
+    closed_through_ = header.first_seq + code_.data - 1;
+    count_ = 0;
+    encoded_ = 0;
+    symbol_size_ = 0;
+}
+
+
+void FecReceiveStats::print_summary(const char* title, const FecCode& code) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << "  Code: " << code.describe() << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Blocks: " << blocks << ", parity received: " << parity_packets << " packets, "
+              << parity_bytes / 1e6 << " MB (+" << (data_bytes > 0 ? 100.0 * parity_bytes / data_bytes : 0.0)
+              << "% over data)\n";
+    std::cout << "  Repaired: " << recovered_packets << " packets in " << repaired_blocks << " blocks";
+    if (recovered_latency.get_count() > 0) {
+        std::cout << std::setprecision(1) << ", latency p50 " << recovered_latency.get_percentile_us(50.0)
+                  << ", p99 " << recovered_latency.get_percentile_us(99.0) << ", max "
+                  << recovered_latency.get_max_ns() / 1000.0 << " μs";
+    }
+    std::cout << "\n";
+    std::cout << "  Not repaired: " << unrepaired_packets << " packets in " << unrepaired_blocks
+              << " blocks (arrived after their block's parity, or never)\n";
+    if (corrupt_blocks > 0) {
+        std::cout << "  Corrupt blocks: " << corrupt_blocks << "\n";
+    }
+    if (late_packets > 0) {
+        std::cout << "  Outside the FEC window: " << late_packets << " packets\n";
+    }
+}
+
+
+void FecDecoder::reset(const FecCode& code, size_t history) {
+    code_ = code;
+    size_t capacity = 1;
+    while (capacity < history) {
+        capacity <<= 1;
+    }
+    blocks_.assign(code.enabled() ? capacity : 0, Block());
+    mask_ = capacity - 1;
+    stats_ = FecReceiveStats();
+}
+
+FecDecoder::Block* FecDecoder::find_block(uint64_t id) {
+    Block& block = blocks_[id & mask_];
+    if (block.id == id) {
+        return &block;
+    }
+    if (block.id != UINT64_MAX && block.id > id) {
+        return nullptr;
+    }
+
+    retire(block);
+    block.id = id;
+    block.count = 0;
+    block.data_received = 0;
+    block.parity_received = 0;
+    block.after_parity = 0;
+    block.data_mask = 0;
+    block.encoded_mask = 0;
+    block.parity_mask = 0;
+    block.symbol_size = 0;
+    block.done = false;
+    block.symbols.resize(code_.data + code_.parity);
+    stats_.blocks++;
+    return &block;
+}
+
+void FecDecoder::retire(Block& block) {
+    if (block.id == UINT64_MAX) {
+        return;
+    }
+    uint32_t count = block.count != 0 ? block.count : code_.data;
+    uint64_t missing = block.done                ? 0
+                       : block.encoded_mask != 0 ? __builtin_popcountll(block.encoded_mask & ~block.data_mask)
+                                                 : count - std::min(count, block.data_received);
+    if (block.after_parity > 0 || missing > 0) {
+        stats_.unrepaired_blocks++;
+        stats_.unrepaired_packets += block.after_parity + missing;
+    }
+    block.id = UINT64_MAX;
+}
+
+void FecDecoder::add_data(sequence_t seq, const uint8_t* data, size_t size, std::vector<Packet>& recovered) {
+    stats_.data_packets++;
+    stats_.data_bytes += size;
+    Block* block = find_block(code_.block_of(seq));
+    if (!block) {
+        stats_.late_packets++;
+        return;
+    }
+
+    uint32_t index = code_.index_of(seq);
+    if (block->done || (block->data_mask >> index) & 1) {
+        return;
+    }
+    if (block->parity_received > 0) {
+        block->after_parity++;
+    }
+
+    std::vector<uint8_t>& symbol = block->symbols[index];
+    symbol.resize(sizeof(uint16_t) + size);
+    symbol[0] = static_cast<uint8_t>(size >> 8);
+    symbol[1] = static_cast<uint8_t>(size);
+    std::memcpy(symbol.data() + sizeof(uint16_t), data, size);
+    block->data_mask |= 1ULL << index;
+    block->data_received++;
+    try_recover(*block, recovered);
+}
+
+void FecDecoder::add_parity(const uint8_t* data, size_t size, std::vector<Packet>& recovered) {
+    ParityHeader header;
+    const uint8_t* symbol;
+    size_t symbol_size;
+    if (!PacketHandler::parse_parity_packet(data, size, header, symbol, symbol_size) || header.first_seq == 0 ||
+        code_.index_of(header.first_seq) != 0 || header.count == 0 || header.count > code_.data ||
+        header.index >= code_.parity || header.encoded == 0 || (header.encoded >> (header.count - 1)) > 1) {
+        return;
+    }
+    stats_.parity_packets++;
+    stats_.parity_bytes += size;
+
+    Block* block = find_block(code_.block_of(header.first_seq));
+    if (!block) {
+        stats_.late_packets++;
+        return;
+    }
+    if (block->done || (block->parity_mask >> header.index) & 1) {
+        return;
+    }
+
+    block->count = header.count;
+    block->encoded_mask = header.encoded;
+    block->symbol_size = symbol_size;
+    block->symbols[code_.data + header.index].assign(symbol, symbol + symbol_size);
+    block->parity_mask |= 1ULL << header.index;
+    block->parity_received++;
+    try_recover(*block, recovered);
+}
+
+void FecDecoder::finish() {
+    for (Block& block : blocks_) {
+        retire(block);
+    }
+}
+
+
+// Folds the received data out of e parity rows and inverts the square
+// Cauchy submatrix left over by Gauss-Jordan elimination.
+void FecDecoder::try_recover(Block& block, std::vector<Packet>& recovered) {
+    if (block.done) {
+        return;
+    }
+    uint32_t count = block.count != 0 ? block.count : code_.data;
+    if (block.data_received >= count) {
+        block.done = true;
+        return;
+    }
+    if (block.count == 0) {
+        return;
+    }
+
+
+    // Packets the sender's socket refused are not in the parity.
+    uint64_t lost = block.encoded_mask & ~block.data_mask;
+    uint32_t erasures = static_cast<uint32_t>(__builtin_popcountll(lost));
+    if (erasures == 0) {
+        block.done = true;
+        return;
+    }
+    if (erasures > block.parity_received) {
+        return;
+    }
+
+    uint32_t missing[config::FEC_MAX_PARITY];
+    uint32_t rows[config::FEC_MAX_PARITY];
+    for (uint32_t i = 0, e = 0; i < count; ++i) {
+        if ((lost >> i) & 1) {
+            missing[e++] = i;
+        }
+    }
+    uint32_t found = 0;
+    for (uint32_t row = 0; row < code_.parity && found < erasures; ++row) {
+        if ((block.parity_mask >> row) & 1) {
+            rows[found++] = row;
+        }
+    }
+
+    block.done = true;
+    size_t size = block.symbol_size;
+    for (uint32_t a = 0; a < erasures; ++a) {
+        std::vector<uint8_t>& folded = block.symbols[code_.data + rows[a]];
+        if (folded.size() != size) {
+            stats_.corrupt_blocks++;
+            return;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (((block.data_mask & block.encoded_mask) >> i) & 1) {
+                const std::vector<uint8_t>& symbol = block.symbols[i];
+                if (symbol.size() > size) {
+                    stats_.corrupt_blocks++;
+                    return;
+                }
+                Gf256::mul_add_region(folded.data(), symbol.data(), FecCode::coefficient(rows[a], i), symbol.size());
+            }
+        }
+    }
+
+    uint8_t matrix[config::FEC_MAX_PARITY][config::FEC_MAX_PARITY];
+    uint8_t inverse[config::FEC_MAX_PARITY][config::FEC_MAX_PARITY];
+    for (uint32_t a = 0; a < erasures; ++a) {
+        for (uint32_t b = 0; b < erasures; ++b) {
+            matrix[a][b] = FecCode::coefficient(rows[a], missing[b]);
+            inverse[a][b] = a == b ? 1 : 0;
+        }
+    }
+    for (uint32_t column = 0; column < erasures; ++column) {
+        uint32_t pivot = column;
+        while (pivot < erasures && matrix[pivot][column] == 0) {
+            pivot++;
+        }
+        if (pivot == erasures) {
+            stats_.corrupt_blocks++;
+            return;
+        }
+        std::swap(matrix[pivot], matrix[column]);
+        std::swap(inverse[pivot], inverse[column]);
+
+        uint8_t scale = Gf256::inverse(matrix[column][column]);
+        for (uint32_t b = 0; b < erasures; ++b) {
+            matrix[column][b] = Gf256::mul(matrix[column][b], scale);
+            inverse[column][b] = Gf256::mul(inverse[column][b], scale);
+        }
+        for (uint32_t a = 0; a < erasures; ++a) {
+            uint8_t factor = matrix[a][column];
+            if (a == column || factor == 0) {
+                continue;
+            }
+            for (uint32_t b = 0; b < erasures; ++b) {
+                matrix[a][b] ^= Gf256::mul(factor, matrix[column][b]);
+                inverse[a][b] ^= Gf256::mul(factor, inverse[column][b]);
+            }
+        }
+    }
+
+    sequence_t first_seq = block.id * code_.data + 1;
+    for (uint32_t b = 0; b < erasures; ++b) {
+        std::vector<uint8_t>& symbol = block.symbols[missing[b]];
+        symbol.assign(size, 0);
+        for (uint32_t a = 0; a < erasures; ++a) {
+            Gf256::mul_add_region(symbol.data(), block.symbols[code_.data + rows[a]].data(), inverse[b][a], size);
+        }
+
+        size_t length = (static_cast<size_t>(symbol[0]) << 8) | symbol[1];
+        if (length < sizeof(PacketHeader) || sizeof(uint16_t) + length > size) {
+            stats_.corrupt_blocks++;
+            return;
+        }
+        Packet packet(length);
+        std::memcpy(packet.data(), symbol.data() + sizeof(uint16_t), length);
+        if (packet.get_sequence() != first_seq + missing[b]) {
+            stats_.corrupt_blocks++;
+            return;
+        }
+        recovered.push_back(std::move(packet));
+        stats_.recovered_packets++;
+    }
+    stats_.repaired_blocks++;
+}
+
+}
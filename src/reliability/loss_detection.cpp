@@ -0,0 +1,131 @@
+#include "udp_benchmark/loss_detection.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+void LossStats::print_summary() const {
+    std::cout << "\nLoss Detection:\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Losses detected: " << losses_detected << "\n";
+    std::cout << "  Retransmits: " << retransmits << "\n";
+    std::cout << "  Spurious retransmits: " << spurious_retransmits
+              << " (" << (get_spurious_rate() * 100) << "%)\n";
+    std::cout << "  Tail-loss probes: " << tail_probes << "\n";
+}
+
+
+void LossDetector::on_sent(const Pending& packet) {
+    if (hold_for_fec_ && packet.retransmits == 0) {
+        held_.push_back({packet.seq, packet.xmit_ts_ns, packet.xmit_ts_ns});
+    } else {
+        sent_.push_back({packet.seq, packet.xmit_ts_ns, packet.xmit_ts_ns});
+    }
+}
+
+void LossDetector::release_held(sequence_t through, timestamp_t now) {
+    while (!held_.empty() && held_.front().seq <= through) {
+        sent_.push_back({held_.front().seq, held_.front().xmit_ts_ns, now});
+        held_.pop_front();
+    }
+}
+
+void LossDetector::on_delivered(const Pending& packet, timestamp_t now) {
+    timestamp_t rtt_ns = now > packet.xmit_ts_ns ? now - packet.xmit_ts_ns : 0;
+
+
+    // Sooner than min_rtt after a retransmission, the ACK is for the original.
+    if (packet.retransmits > 0 && min_rtt_ns_ > 0 && rtt_ns < min_rtt_ns_) {
+        return;
+    }
+
+    if (min_rtt_ns_ == 0 || rtt_ns < min_rtt_ns_) {
+        min_rtt_ns_ = rtt_ns;
+    }
+    srtt_ns_ = srtt_ns_ == 0 ? rtt_ns : (7 * srtt_ns_ + rtt_ns) / 8;
+
+    if (packet.xmit_ts_ns >= rack_xmit_ns_) {
+        rack_xmit_ns_ = packet.xmit_ts_ns;
+        rack_rtt_ns_ = rtt_ns;
+    }
+}
+
+timestamp_t LossDetector::get_reorder_window_ns() const {
+    timestamp_t reo_wnd = reo_wnd_mult_ * min_rtt_ns_ / 4;
+    return srtt_ns_ > 0 ? std::min(reo_wnd, srtt_ns_) : reo_wnd;
+}
+
+std::vector<sequence_t> LossDetector::detect_losses(const std::map<sequence_t, Pending>& pending,
+                                                    timestamp_t now, timestamp_t& next_deadline) {
+    std::vector<sequence_t> lost;
+    next_deadline = 0;
+    timestamp_t reo_wnd = get_reorder_window_ns();
+
+    while (!sent_.empty()) {
+        const Sent& sent = sent_.front();
+        auto it = pending.find(sent.seq);
+        if (it == pending.end() || it->second.xmit_ts_ns != sent.xmit_ts_ns) {
+            sent_.pop_front();
+            continue;
+        }
+        if (rack_xmit_ns_ == 0 || sent.from_ns > rack_xmit_ns_) {
+            break;
+        }
+
+
+        timestamp_t deadline = sent.from_ns + rack_rtt_ns_ + reo_wnd;
+        if (deadline > now) {
+            next_deadline = deadline;
+            break;
+        }
+        lost.push_back(sent.seq);
+        sent_.pop_front();
+    }
+
+    stats_.losses_detected += lost.size();
+    return lost;
+}
+
+void LossDetector::on_retransmit(Pending& packet, timestamp_t now) {
+    packet.retransmits++;
+    packet.xmit_ts_ns = now;
+    stats_.retransmits++;
+    on_sent(packet);
+}
+
+void LossDetector::on_tail_probe(Pending& packet, timestamp_t now) {
+    on_retransmit(packet, now);
+    stats_.tail_probes++;
+}
+
+// RFC 8985 section 6.2.
+void LossDetector::on_spurious(timestamp_t now) {
+    stats_.spurious_retransmits++;
+    if (now >= reo_wnd_grown_ns_ + srtt_ns_) {
+        reo_wnd_mult_++;
+        reo_wnd_grown_ns_ = now;
+        recoveries_ = 0;
+    }
+}
+
+void LossDetector::on_recovery() {
+    if (++recoveries_ >= config::REO_WND_PERSIST) {
+        reo_wnd_mult_ = 1;
+        recoveries_ = 0;
+    }
+}
+
+timestamp_t LossDetector::get_pto_ns(uint32_t max_ack_delay_us, uint32_t backoff) const {
+    timestamp_t pto_ns;
+    if (srtt_ns_ == 0) {
+        pto_ns = static_cast<timestamp_t>(config::INITIAL_PTO_US) * 1000;
+    } else {
+        pto_ns = std::max<timestamp_t>(2 * srtt_ns_ + static_cast<timestamp_t>(max_ack_delay_us) * 1000,
+                                       static_cast<timestamp_t>(config::MIN_PTO_US) * 1000);
+    }
+    return pto_ns << std::min(backoff, config::MAX_PTO_BACKOFF);
+}
+
+}
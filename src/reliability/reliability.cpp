@@ -1,169 +1,717 @@
 #include "udp_benchmark/reliability.hpp"
 #include "udp_benchmark/network_utils.hpp"
+#include "udp_benchmark/trace.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <limits>
 
 namespace udp_benchmark {
 
 
-ReliabilityManager::ReliabilityManager(RetransmitCallback retransmit_cb, AckCallback ack_cb)
-    : retransmit_callback_(retransmit_cb), ack_callback_(ack_cb) {}
+template <class Clock, class Mutex>
+BasicReliabilityManager<Clock, Mutex>::BasicReliabilityManager(RetransmitCallback retransmit_cb, AckCallback ack_cb)
+    : retransmitted_(config::DSACK_HISTORY, Retransmitted{0, 0}),
+      retransmit_callback_(retransmit_cb), ack_callback_(ack_cb) {}
 
-ReliabilityManager::~ReliabilityManager() {
+template <class Clock, class Mutex>
+BasicReliabilityManager<Clock, Mutex>::~BasicReliabilityManager() {
     stop();
 }
 
-void ReliabilityManager::add_pending_packet(sequence_t seq, timestamp_t send_time) {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
-    pending_packets_[seq] = Pending(seq, send_time, 0);
-    send_times_[seq] = send_time;
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::add_pending_packet(sequence_t seq, timestamp_t send_time,
+                                                               timestamp_t intended_time) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    Pending& pending = pending_packets_[seq] = Pending(seq, send_time, 0, intended_time);
+    last_activity_ns_ = send_time;
+    loss_detector_.on_sent(pending);
 }
 
-void ReliabilityManager::remove_pending_packet(sequence_t seq) {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::remove_pending_packet(sequence_t seq) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
     pending_packets_.erase(seq);
-    send_times_.erase(seq);
+    sacked_packets_.erase(seq);
 }
 
-bool ReliabilityManager::is_packet_pending(sequence_t seq) const {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
-    return pending_packets_.find(seq) != pending_packets_.end();
+template <class Clock, class Mutex>
+bool BasicReliabilityManager<Clock, Mutex>::is_packet_pending(sequence_t seq) const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return pending_packets_.count(seq) != 0 || sacked_packets_.count(seq) != 0;
 }
 
-void ReliabilityManager::process_ack(sequence_t ack_seq, const std::vector<sequence_t>& missing_seqs) {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
+template <class Clock, class Mutex>
+size_t BasicReliabilityManager<Clock, Mutex>::process_ack(sequence_t ack_seq, const std::vector<sequence_t>& missing_seqs,
+                                                          sequence_t window_end, const std::vector<sequence_t>& dsacks) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    timestamp_t now = Clock::now();
+    size_t delivered = 0;
+    last_activity_ns_ = now;
+    probe_backoff_ = 0;
+
+
+    // Both maps are in sequence order; merge them so callbacks see it too.
+    auto it = pending_packets_.begin();
+    auto sacked_it = sacked_packets_.begin();
+    while (true) {
+        bool from_pending = it != pending_packets_.end() && it->first <= ack_seq;
+        bool from_sacked = sacked_it != sacked_packets_.end() && sacked_it->first <= ack_seq;
+        if (!from_pending && !from_sacked) {
+            break;
+        }
+        if (from_pending && from_sacked) {
+            from_pending = it->first < sacked_it->first;
+        }
 
+        const Pending& packet = from_pending ? it->second : sacked_it->second;
+        if (from_pending) {
+            loss_detector_.on_delivered(packet, now);
+            on_packet_delivered(packet);
+            delivered++;
+        }
+        if (ack_callback_) {
+            ack_callback_(packet.seq, packet.send_ts_ns, now, packet.retransmits, packet.intended_ts_ns);
+        }
+        if (packet.retransmits > packet.spurious) {
+            retransmitted_[packet.seq & (retransmitted_.size() - 1)] = {packet.seq,
+                                                                        packet.retransmits - packet.spurious};
+        }
 
-    std::vector<sequence_t> to_remove;
-    for (auto& [seq, pending] : pending_packets_) {
-        if (seq <= ack_seq) {
-            to_remove.push_back(seq);
+        if (from_pending) {
+            it = pending_packets_.erase(it);
+        } else {
+            sacked_it = sacked_packets_.erase(sacked_it);
+        }
+    }
 
 
-            if (ack_callback_) {
-                timestamp_t send_time = send_times_.count(seq) ? send_times_[seq] : pending.send_ts_ns;
-                ack_callback_(seq, send_time, get_timestamp_ns(), pending.retransmits);
-            }
+    auto missing_it = missing_seqs.begin();
+    while (it != pending_packets_.end() && it->first <= window_end) {
+        while (missing_it != missing_seqs.end() && *missing_it < it->first) {
+            ++missing_it;
+        }
+        if (missing_it != missing_seqs.end() && *missing_it == it->first) {
+            ++it;
+            continue;
         }
+        it->second.sacked = true;
+        loss_detector_.on_delivered(it->second, now);
+        on_packet_delivered(it->second);
+        delivered++;
+        auto next = std::next(it);
+        sacked_packets_.insert(sacked_packets_.end(), pending_packets_.extract(it));
+        it = next;
     }
 
-    for (sequence_t seq : to_remove) {
-        pending_packets_.erase(seq);
-        send_times_.erase(seq);
+    for (sequence_t seq : dsacks) {
+        on_dsack(seq, now);
     }
 
+    retransmit_expired_packets(now);
+    return delivered;
+}
 
-    for (sequence_t missing : missing_seqs) {
-        auto it = pending_packets_.find(missing);
-        if (it != pending_packets_.end()) {
-            it->second.retransmits++;
-
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::on_packet_delivered(const Pending& packet) {
+    if (congestion_ && !packet.lost) {
+        congestion_->packet_acked();
+    }
+}
 
-            if (retransmit_callback_) {
-                Packet packet = PacketHandler::create_data_packet(
-                    missing, it->second.send_ts_ns, config::MIN_MESSAGE_SIZE);
-                sockaddr_in dummy_addr{};
-                retransmit_callback_(packet, dummy_addr);
-            }
+// Each retransmission is matched against a duplicate at most once.
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::on_dsack(sequence_t seq, timestamp_t now) {
+    auto it = sacked_packets_.find(seq);
+    if (it != sacked_packets_.end()) {
+        if (it->second.retransmits > it->second.spurious) {
+            it->second.spurious++;
+            loss_detector_.on_spurious(now);
         }
+        return;
+    }
+
+    Retransmitted& entry = retransmitted_[seq & (retransmitted_.size() - 1)];
+    if (entry.seq == seq && entry.unmatched > 0) {
+        entry.unmatched--;
+        loss_detector_.on_spurious(now);
+    }
+}
+
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::on_loss_timer() {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    timestamp_t now = Clock::now();
+    if (loss_deadline_ns_ != 0 && loss_deadline_ns_ <= now) {
+        retransmit_expired_packets(now);
     }
+
+    timestamp_t probe_deadline = get_probe_deadline();
+    if (probe_deadline != 0 && probe_deadline <= now) {
+        send_tail_probe(now);
+    }
+}
+
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::set_hold_for_fec(bool hold) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    loss_detector_.set_hold_for_fec(hold);
 }
 
-size_t ReliabilityManager::get_pending_count() const {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
-    return pending_packets_.size();
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::release_fec_block(sequence_t through, timestamp_t now) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    loss_detector_.release_held(through, now);
 }
 
-std::vector<sequence_t> ReliabilityManager::get_pending_sequences() const {
-    std::lock_guard<std::mutex> lock(pending_mutex_);
+template <class Clock, class Mutex>
+int64_t BasicReliabilityManager<Clock, Mutex>::get_loss_timeout_us() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    timestamp_t deadline = get_probe_deadline();
+    if (loss_deadline_ns_ != 0 && (deadline == 0 || loss_deadline_ns_ < deadline)) {
+        deadline = loss_deadline_ns_;
+    }
+    if (deadline == 0) {
+        return -1;
+    }
+    timestamp_t now = Clock::now();
+    return deadline > now ? static_cast<int64_t>((deadline - now + 999) / 1000) : 0;
+}
+
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::on_ack_delay(uint32_t ack_delay_us) {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    reported_ack_delay_us_ = std::max(reported_ack_delay_us_, ack_delay_us);
+}
+
+template <class Clock, class Mutex>
+int64_t BasicReliabilityManager<Clock, Mutex>::get_pto_us() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return static_cast<int64_t>(loss_detector_.get_pto_ns(std::max(max_ack_delay_us_, reported_ack_delay_us_)) / 1000);
+}
+
+template <class Clock, class Mutex>
+timestamp_t BasicReliabilityManager<Clock, Mutex>::get_srtt_ns() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return loss_detector_.get_srtt_ns();
+}
+
+template <class Clock, class Mutex>
+timestamp_t BasicReliabilityManager<Clock, Mutex>::get_min_rtt_ns() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return loss_detector_.get_min_rtt_ns();
+}
+
+template <class Clock, class Mutex>
+LossStats BasicReliabilityManager<Clock, Mutex>::get_loss_stats() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return loss_detector_.get_stats();
+}
+
+template <class Clock, class Mutex>
+size_t BasicReliabilityManager<Clock, Mutex>::get_pending_count() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
+    return pending_packets_.size() + sacked_packets_.size();
+}
+
+template <class Clock, class Mutex>
+std::vector<sequence_t> BasicReliabilityManager<Clock, Mutex>::get_pending_sequences() const {
+    std::lock_guard<Mutex> lock(pending_mutex_);
     std::vector<sequence_t> sequences;
     for (const auto& [seq, _] : pending_packets_) {
         sequences.push_back(seq);
     }
+    for (const auto& [seq, _] : sacked_packets_) {
+        sequences.push_back(seq);
+    }
+    std::sort(sequences.begin(), sequences.end());
     return sequences;
 }
 
-void ReliabilityManager::start() {
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::start() {
     running_.store(true);
 }
 
-void ReliabilityManager::stop() {
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::stop() {
     running_.store(false);
 }
 
-void ReliabilityManager::retransmit_expired_packets() {
+template <class Clock, class Mutex>
+timestamp_t BasicReliabilityManager<Clock, Mutex>::get_probe_deadline() const {
+    if (pending_packets_.empty()) {
+        return 0;
+    }
+    uint32_t ack_delay_us = std::max(max_ack_delay_us_, reported_ack_delay_us_);
+    return last_activity_ns_ + loss_detector_.get_pto_ns(ack_delay_us, probe_backoff_);
+}
+
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::send_tail_probe(timestamp_t now) {
 
 
+    // Probe with the newest outstanding packet, whatever the window.
+    if (!pending_packets_.empty()) {
+        auto it = std::prev(pending_packets_.end());
+        if (it->second.lost && congestion_) {
+            congestion_->packet_sent();
+        }
+        it->second.lost = false;
+        loss_detector_.on_tail_probe(it->second, now);
+        UDP_TRACE_INSTANT(RETRANSMIT, it->first, it->second.retransmits);
+        if (retransmit_callback_) {
+            Packet packet = build_packet(it->first, it->second);
+            sockaddr_in dummy_addr{};
+            retransmit_callback_(packet, dummy_addr);
+        }
+    }
+
+    last_activity_ns_ = now;
+    probe_backoff_++;
 }
 
+template <class Clock, class Mutex>
+Packet BasicReliabilityManager<Clock, Mutex>::build_packet(sequence_t seq, const Pending& pending) const {
+    if (packet_builder_) {
+        return packet_builder_(seq, pending.send_ts_ns, pending.intended_ts_ns);
+    }
+    return PacketHandler::create_fragment_packet(seq, pending.send_ts_ns, layout_, pending.intended_ts_ns);
+}
+
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::retransmit_expired_packets(timestamp_t now) {
+    std::vector<sequence_t> lost = loss_detector_.detect_losses(pending_packets_, now, loss_deadline_ns_);
+
+    bool new_round = false;
+    for (sequence_t seq : lost) {
+        Pending& pending = pending_packets_[seq];
+        new_round = new_round || pending.xmit_ts_ns > recovery_start_ns_;
+        pending.lost = true;
+        lost_.push_back(seq);
+        if (congestion_) {
+            congestion_->packet_lost();
+        }
+    }
+
+    if (new_round) {
+        recovery_start_ns_ = now;
+        loss_detector_.on_recovery();
+        if (congestion_) {
+            congestion_->on_ack_received_with_stats(true);
+        }
+    }
 
-AckManager::AckManager(int window_size, int ack_period)
-    : window_size_(window_size), ack_period_(ack_period) {}
 
-bool AckManager::add_received_packet(sequence_t seq, timestamp_t recv_time) {
-    std::lock_guard<std::mutex> lock(received_mutex_);
+    while (!lost_.empty()) {
+        auto it = pending_packets_.find(lost_.front());
+        if (it == pending_packets_.end() || !it->second.lost) {
+            lost_.pop_front();
+            continue;
+        }
+        if (congestion_) {
+            if (!congestion_->can_send()) {
+                break;
+            }
+            congestion_->packet_sent();
+        }
+        lost_.pop_front();
+        send_retransmission(it->first, it->second, now);
+    }
+}
 
+template <class Clock, class Mutex>
+void BasicReliabilityManager<Clock, Mutex>::send_retransmission(sequence_t seq, Pending& pending, timestamp_t now) {
+    pending.lost = false;
+    loss_detector_.on_retransmit(pending, now);
+    UDP_TRACE_INSTANT(RETRANSMIT, seq, pending.retransmits);
 
-    if (received_packets_.find(seq) != received_packets_.end()) {
+    if (retransmit_callback_) {
+        Packet packet = build_packet(seq, pending);
+        sockaddr_in dummy_addr{};
+        retransmit_callback_(packet, dummy_addr);
+    }
+}
+
+
+void AckStats::print_summary(const char* title, bool per_packet_delay) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Data packets: " << data_packets << "\n";
+    std::cout << "  ACKs: " << acks << " (" << get_acks_per_packet() << " per data packet)\n";
+    if (per_packet_delay) {
+        std::cout << "  Immediate ACKs: " << immediate_acks << ", timer ACKs: " << timer_acks << "\n";
+        std::cout << "  Duplicate packets: " << duplicate_packets << "\n";
+        std::cout << "  Added RTT (mean ACK hold per packet): "
+                  << get_mean_ack_delay_us(data_packets) << " μs\n";
+    } else {
+        std::cout << "  Added RTT (mean reported ACK delay): "
+                  << get_mean_ack_delay_us(acks) << " μs\n";
+    }
+    std::cout << "  Max ACK delay: " << static_cast<double>(max_ack_delay_ns) / 1000.0 << " μs\n";
+    if (late_acks > 0) {
+        std::cout << "  ACKs held past the max ACK delay: " << late_acks << "\n";
+    }
+    if (send_failures > 0) {
+        std::cout << "  Failed sends (left to loss recovery): " << send_failures << "\n";
+    }
+}
+
+
+static void print_buckets(const char* label, const uint64_t* counts) {
+    std::cout << "    " << label << ":";
+    const char* separator = " ";
+    for (size_t i = 0; i < ReceiveQualityStats::BUCKETS; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        uint64_t high = uint64_t{1} << i;
+        std::cout << separator;
+        if (i + 1 == ReceiveQualityStats::BUCKETS) {
+            std::cout << (high >> 1) + 1 << "+";
+        } else if (i < 2) {
+            std::cout << high;
+        } else {
+            std::cout << (high >> 1) + 1 << "-" << high;
+        }
+        std::cout << ": " << counts[i];
+        separator = ", ";
+    }
+    std::cout << "\n";
+}
+
+void ReceiveQualityStats::print_summary(const char* title) const {
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Jitter (RFC 3550): " << jitter_ns / 1000.0 << " μs (max " << max_jitter_ns / 1000.0
+              << " μs over " << jitter_samples << " samples)\n";
+    std::cout << "  Loss bursts: " << loss_bursts << " (" << skipped << " sequences skipped, longest " << max_burst
+              << ", " << get_missing() << " never arrived)\n";
+    if (loss_bursts > 0) {
+        print_buckets("Burst lengths", burst_lengths);
+    }
+    std::cout << "  Reordered: " << reordered << " (max distance " << max_reorder_distance << ", max extent "
+              << max_reorder_extent << ")\n";
+    if (reordered > 0) {
+        print_buckets("Distances", reorder_distances);
+        print_buckets("Extents", reorder_extents);
+        if (extents_beyond_history > 0) {
+            std::cout << "    Extents beyond the last " << config::REORDER_EXTENT_HISTORY
+                      << " advances (lower bounds): " << extents_beyond_history << "\n";
+        }
+    }
+    std::cout << "  Duplicates: " << duplicates << "\n";
+}
+
+
+void ReceiveQuality::add_arrival(sequence_t seq, timestamp_t recv_time, timestamp_t send_ts) {
+    uint64_t arrival = ++arrivals_;
+    size_t mask = advances_.size() - 1;
+
+    if (seq > highest_) {
+        uint64_t burst = seq - highest_ - 1;
+        if (burst > 0) {
+            stats_.loss_bursts++;
+            stats_.skipped += burst;
+            stats_.max_burst = std::max(stats_.max_burst, burst);
+            stats_.burst_lengths[ReceiveQualityStats::bucket_of(burst)]++;
+        }
+        highest_ = seq;
+
+        if (advance_count_ == advances_.size()) {
+            advance_head_ = (advance_head_ + 1) & mask;
+            advance_count_--;
+            advances_dropped_ = true;
+        }
+        advances_[(advance_head_ + advance_count_) & mask] = {seq, arrival};
+        advance_count_++;
+
+
+        // A retransmission keeps its original send time, so leave it out.
+        if (send_ts != 0) {
+            int64_t transit_ns = static_cast<int64_t>(recv_time - send_ts);
+            if (has_transit_) {
+                double delta_ns = std::abs(static_cast<double>(transit_ns - last_transit_ns_));
+                stats_.jitter_ns += (delta_ns - stats_.jitter_ns) / 16.0;
+                stats_.max_jitter_ns = std::max(stats_.max_jitter_ns, stats_.jitter_ns);
+                stats_.jitter_samples++;
+            }
+            last_transit_ns_ = transit_ns;
+            has_transit_ = true;
+        }
+        return;
+    }
+
+    uint64_t distance = highest_ - seq;
+    stats_.reordered++;
+    stats_.max_reorder_distance = std::max(stats_.max_reorder_distance, distance);
+    stats_.reorder_distances[ReceiveQualityStats::bucket_of(distance)]++;
+
+
+    size_t low = 0;
+    size_t high = advance_count_ - 1;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (advances_[(advance_head_ + mid) & mask].seq > seq) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    if (low == 0 && advances_dropped_) {
+        stats_.extents_beyond_history++;
+    }
+    uint64_t extent = arrival - advances_[(advance_head_ + low) & mask].arrival;
+    stats_.max_reorder_extent = std::max(stats_.max_reorder_extent, extent);
+    stats_.reorder_extents[ReceiveQualityStats::bucket_of(extent)]++;
+}
+
+
+// Largest bitmap that fits in a datagram alongside a full D-SACK list.
+static constexpr sequence_t MAX_ACK_BITS =
+    (config::MAX_PACKET_SIZE - sizeof(AckHeader) - config::MAX_DSACKS * sizeof(sequence_t)) * 8;
+
+template <class Mutex>
+BasicAckManager<Mutex>::BasicAckManager(int window_size, int ack_period, uint32_t max_ack_delay_us, size_t max_inflight)
+    : ack_period_(ack_period), max_ack_delay_us_(max_ack_delay_us) {
+    reserve_window(window_size, max_inflight);
+}
+
+template <class Mutex>
+void BasicAckManager<Mutex>::reserve_window(int window_size, size_t max_inflight) {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    window_size_ = window_size;
+
+    size_t capacity = 1;
+    while (capacity < std::max<size_t>(max_inflight, static_cast<size_t>(window_size))) {
+        capacity <<= 1;
+    }
+    if (capacity == recv_ring_.size()) {
+        return;
+    }
+
+    std::vector<timestamp_t> ring(capacity, 0);
+    for (sequence_t seq = highest_contiguous_ + 1; seq <= highest_received_; ++seq) {
+        if (seq - highest_contiguous_ <= capacity && is_received_locked(seq)) {
+            ring[seq & (capacity - 1)] = recv_ring_[seq & ring_mask_];
+        }
+    }
+    recv_ring_.swap(ring);
+    ring_mask_ = capacity - 1;
+}
+
+template <class Mutex>
+void BasicAckManager<Mutex>::make_room(sequence_t seq) {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    sequence_t capacity = recv_ring_.size();
+    if (seq <= highest_contiguous_ || seq - highest_contiguous_ <= capacity) {
+        return;
+    }
+
+    sequence_t new_base = seq - capacity;
+    if (new_base - highest_contiguous_ >= capacity) {
+        std::fill(recv_ring_.begin(), recv_ring_.end(), 0);
+    } else {
+        for (sequence_t s = highest_contiguous_ + 1; s <= new_base; ++s) {
+            recv_ring_[s & ring_mask_] = 0;
+        }
+    }
+    highest_contiguous_ = new_base;
+    highest_received_ = std::max(highest_received_, highest_contiguous_);
+
+    while (highest_contiguous_ < highest_received_ &&
+           recv_ring_[(highest_contiguous_ + 1) & ring_mask_] != 0) {
+        highest_contiguous_++;
+        recv_ring_[highest_contiguous_ & ring_mask_] = 0;
+    }
+}
+
+template <class Mutex>
+bool BasicAckManager<Mutex>::is_received_locked(sequence_t seq) const {
+    if (seq <= highest_contiguous_) {
+        return true;
+    }
+    return seq - highest_contiguous_ <= recv_ring_.size() && recv_ring_[seq & ring_mask_] != 0;
+}
+
+template <class Mutex>
+bool BasicAckManager<Mutex>::add_received_packet(sequence_t seq, timestamp_t recv_time, timestamp_t send_ts) {
+    std::lock_guard<Mutex> lock(received_mutex_);
+
+
+    if (is_received_locked(seq)) {
+        ack_immediately_ = ack_immediately_ || !expect_copies_;
+        if (!expect_copies_ && dsacks_.size() < config::MAX_DSACKS) {
+            dsacks_.push_back(seq);
+        }
+        stats_.duplicate_packets++;
+        quality_.add_duplicate();
         return false;
     }
 
-    received_packets_[seq] = recv_time;
+
+    if (seq - highest_contiguous_ > recv_ring_.size()) {
+        return false;
+    }
+
+    bool in_order = seq == highest_contiguous_ + 1;
+    bool had_gap = highest_received_ > highest_contiguous_;
+
+    recv_ring_[seq & ring_mask_] = recv_time != 0 ? recv_time : 1;
+    highest_received_ = std::max(highest_received_, seq);
+    received_count_++;
+    quality_.add_arrival(seq, recv_time, send_ts);
+
+    if (packets_since_ack_ == 0) {
+        oldest_unacked_ns_ = recv_time;
+    }
     packets_since_ack_++;
+    unacked_recv_sum_ns_ += recv_time;
+    stats_.data_packets++;
+
+    if (send_ts != 0) {
+        echo_send_ts_ = send_ts;
+        echo_recv_ts_ = recv_time;
+    }
 
 
-    while (received_packets_.find(highest_contiguous_ + 1) != received_packets_.end()) {
+    while (highest_contiguous_ < highest_received_ &&
+           recv_ring_[(highest_contiguous_ + 1) & ring_mask_] != 0) {
         highest_contiguous_++;
+        recv_ring_[highest_contiguous_ & ring_mask_] = 0;
+    }
+
+    if (expect_repairs_ ? in_order && had_gap : !in_order || had_gap) {
+        ack_immediately_ = true;
     }
 
     return true;
 }
 
-bool AckManager::is_duplicate(sequence_t seq) const {
-    std::lock_guard<std::mutex> lock(received_mutex_);
-    return received_packets_.find(seq) != received_packets_.end();
+template <class Mutex>
+void BasicAckManager<Mutex>::add_dsack(sequence_t seq) {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    if (dsacks_.size() < config::MAX_DSACKS) {
+        dsacks_.push_back(seq);
+    }
 }
 
-bool AckManager::should_send_ack() const {
-    return packets_since_ack_ >= static_cast<uint64_t>(ack_period_);
+template <class Mutex>
+bool BasicAckManager<Mutex>::is_duplicate(sequence_t seq) const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    return is_received_locked(seq);
 }
 
-AckPacket AckManager::generate_ack() {
-    std::lock_guard<std::mutex> lock(received_mutex_);
+template <class Mutex>
+bool BasicAckManager<Mutex>::should_send_ack(timestamp_t now) const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    if (ack_immediately_) {
+        return true;
+    }
+    if (packets_since_ack_ == 0) {
+        return false;
+    }
+    return packets_since_ack_ >= static_cast<uint64_t>(ack_period_) ||
+           now - oldest_unacked_ns_ >= static_cast<timestamp_t>(max_ack_delay_us_) * 1000;
+}
+
+template <class Mutex>
+timestamp_t BasicAckManager<Mutex>::get_ack_deadline() const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    if (packets_since_ack_ == 0) {
+        return 0;
+    }
+    return oldest_unacked_ns_ + static_cast<timestamp_t>(max_ack_delay_us_) * 1000;
+}
+
+template <class Mutex>
+AckPacket BasicAckManager<Mutex>::generate_ack(timestamp_t now) {
+    std::lock_guard<Mutex> lock(received_mutex_);
 
 
     std::vector<sequence_t> missing_seqs;
-    sequence_t window_end = highest_contiguous_ + window_size_;
+    sequence_t span = std::min<sequence_t>((highest_received_ - highest_contiguous_ + 7) / 8 * 8, MAX_ACK_BITS);
+    sequence_t window_end = highest_contiguous_ + span;
 
     for (sequence_t seq = highest_contiguous_ + 1; seq <= window_end; ++seq) {
-        if (received_packets_.find(seq) == received_packets_.end()) {
+        if (seq > highest_received_ || recv_ring_[seq & ring_mask_] == 0) {
             missing_seqs.push_back(seq);
         }
     }
 
+
+    timestamp_t hold_ns = packets_since_ack_ > 0 && now > oldest_unacked_ns_ ? now - oldest_unacked_ns_ : 0;
+    stats_.acks++;
+    if (ack_immediately_) {
+        stats_.immediate_acks++;
+    } else if (packets_since_ack_ < static_cast<uint64_t>(ack_period_)) {
+        stats_.timer_acks++;
+    }
+    if (packets_since_ack_ > 0 && now * packets_since_ack_ > unacked_recv_sum_ns_) {
+        stats_.total_ack_delay_ns += now * packets_since_ack_ - unacked_recv_sum_ns_;
+    }
+    stats_.max_ack_delay_ns = std::max(stats_.max_ack_delay_ns, hold_ns);
+    stats_.late_acks += hold_ns > (static_cast<timestamp_t>(max_ack_delay_us_) + config::ACK_TIMER_SPIN_US) * 1000;
+
     packets_since_ack_ = 0;
-    return PacketHandler::create_ack_packet(highest_contiguous_, missing_seqs, window_size_);
+    unacked_recv_sum_ns_ = 0;
+    ack_immediately_ = false;
+
+    AckTimestamps timestamps;
+    timestamps.echo_ts = echo_send_ts_;
+    timestamps.recv_ts = echo_recv_ts_;
+    timestamps.ack_ts = now;
+    AckPacket ack = PacketHandler::create_ack_packet(highest_contiguous_, missing_seqs, span,
+                                                     static_cast<uint32_t>(hold_ns / 1000), timestamps, dsacks_);
+    dsacks_.clear();
+    return ack;
+}
+
+template <class Mutex>
+void BasicAckManager<Mutex>::force_ack() {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    ack_immediately_ = true;
+}
+
+template <class Mutex>
+void BasicAckManager<Mutex>::set_ack_policy(int ack_period, uint32_t max_ack_delay_us) {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    ack_period_ = std::max(ack_period, 1);
+    max_ack_delay_us_ = max_ack_delay_us;
+}
+
+template <class Mutex>
+AckStats BasicAckManager<Mutex>::get_ack_stats() const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    return stats_;
 }
 
-void AckManager::force_ack() {
-    packets_since_ack_ = ack_period_;
+template <class Mutex>
+ReceiveQualityStats BasicAckManager<Mutex>::get_receive_quality() const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    return quality_.get_stats();
 }
 
-size_t AckManager::get_received_count() const {
-    std::lock_guard<std::mutex> lock(received_mutex_);
-    return received_packets_.size();
+template <class Mutex>
+size_t BasicAckManager<Mutex>::get_received_count() const {
+    std::lock_guard<Mutex> lock(received_mutex_);
+    return received_count_;
 }
 
-sequence_t AckManager::get_highest_contiguous() const {
+template <class Mutex>
+sequence_t BasicAckManager<Mutex>::get_highest_contiguous() const {
     return highest_contiguous_;
 }
 
-std::vector<sequence_t> AckManager::get_missing_sequences(sequence_t up_to_seq) const {
-    std::lock_guard<std::mutex> lock(received_mutex_);
+template <class Mutex>
+std::vector<sequence_t> BasicAckManager<Mutex>::get_missing_sequences(sequence_t up_to_seq) const {
+    std::lock_guard<Mutex> lock(received_mutex_);
     std::vector<sequence_t> missing;
 
     for (sequence_t seq = highest_contiguous_ + 1; seq <= up_to_seq; ++seq) {
-        if (received_packets_.find(seq) == received_packets_.end()) {
+        if (!is_received_locked(seq)) {
             missing.push_back(seq);
         }
     }
@@ -171,21 +719,12 @@ std::vector<sequence_t> AckManager::get_missing_sequences(sequence_t up_to_seq)
     return missing;
 }
 
-void AckManager::cleanup_old_packets(sequence_t before_seq) {
-    std::lock_guard<std::mutex> lock(received_mutex_);
-    auto it = received_packets_.begin();
-    while (it != received_packets_.end()) {
-        if (it->first < before_seq) {
-            it = received_packets_.erase(it);
-        } else {
-            ++it;
-        }
-    }
-}
 
+template <class Clock, class Mutex>
+BasicSenderReliability<Clock, Mutex>::BasicSenderReliability(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size)
+    : socket_(socket), peer_addr_(peer_addr), layout_(static_cast<uint32_t>(packet_size), 0) {
 
-SenderReliability::SenderReliability(Socket* socket, const sockaddr_in& peer_addr, size_t packet_size)
-    : socket_(socket), peer_addr_(peer_addr), packet_size_(packet_size) {
+    reliability_mgr_.set_packet_size(packet_size);
 
 
     reliability_mgr_.set_retransmit_callback(
@@ -195,50 +734,366 @@ SenderReliability::SenderReliability(Socket* socket, const sockaddr_in& peer_add
 
 
     reliability_mgr_.set_ack_callback(
-        [this](sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits) {
-            this->handle_ack(seq, send_time, recv_time, retransmits);
+        [this](sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits,
+               timestamp_t intended_time) {
+            this->handle_ack(seq, send_time, recv_time, retransmits, intended_time);
         });
 }
 
-bool SenderReliability::send_packet(sequence_t seq, timestamp_t send_time) {
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::send_packet(sequence_t seq, timestamp_t send_time, timestamp_t intended_time) {
+
+    Packet packet = packet_builder_ ? packet_builder_(seq, send_time, intended_time)
+                                    : PacketHandler::create_fragment_packet(seq, send_time, layout_, intended_time);
 
-    Packet packet = PacketHandler::create_data_packet(seq, send_time, packet_size_);
-    ssize_t sent = socket_->send_to(packet.data(), packet.size(), peer_addr_);
 
+    // Pending before the first send, so a refused send is recovered as a loss.
+    reliability_mgr_.add_pending_packet(seq, send_time, intended_time);
+    ssize_t sent = socket_->send_to(packet.data(), packet.size(), peer_addr_);
+    if (!paths_.empty()) {
+        send_copies(packet, sent);
+    }
+    if (fec_.enabled() && sent > 0) {
+        fec_.add(seq, packet.data(), packet.size(), fec_parity_);
+    }
+    if (!fec_parity_.empty()) {
+        send_parity();
+    }
     if (sent > 0) {
-        reliability_mgr_.add_pending_packet(seq, send_time);
+        UDP_TRACE_INSTANT(SEND, seq, sent);
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        ack_stats_.data_packets++;
         return true;
     }
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    ack_stats_.send_failures++;
     return false;
 }
 
-void SenderReliability::process_ack_packet(const uint8_t* data, size_t size) {
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::send_copies(const Packet& packet, ssize_t sent) {
+    uint64_t copies = 0;
+    uint64_t failures = 0;
+    for (const SendPath& path : paths_) {
+        if (path.socket->send_to(packet.data(), packet.size(), path.peer) > 0) {
+            copies++;
+        } else {
+            failures++;
+        }
+    }
+
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    if (sent > 0) {
+        redundancy_.datagrams++;
+        redundancy_.bytes += packet.size();
+    }
+    redundancy_.redundant_datagrams += copies;
+    redundancy_.redundant_bytes += copies * packet.size();
+    redundancy_.redundant_failures += failures;
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::send_parity() {
+    for (const Packet& parity : fec_parity_) {
+        socket_->send_to(parity.data(), parity.size(), peer_addr_);
+    }
+    fec_parity_.clear();
+    reliability_mgr_.release_fec_block(fec_.get_closed_through(), Clock::now());
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::set_fec_code(const FecCode& code) {
+    fec_.set_code(code);
+    reliability_mgr_.set_hold_for_fec(code.enabled());
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::flush_fec() {
+    if (fec_.enabled()) {
+        fec_.flush(fec_parity_);
+        send_parity();
+        reliability_mgr_.release_fec_block(std::numeric_limits<sequence_t>::max(), Clock::now());
+    }
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::add_path(Socket* socket, const sockaddr_in& peer) {
+    paths_.push_back({socket, peer, false});
+    redundancy_.paths = static_cast<uint32_t>(paths_.size() + 1);
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::poll_paths() {
+    uint8_t buf[config::MAX_PACKET_SIZE];
+    for (SendPath& path : paths_) {
+        ssize_t n;
+        while ((n = path.socket->recv_from(buf, sizeof(buf))) > 0) {
+            HelloAckFrame hello_ack;
+            if (PacketHandler::parse_hello_ack_packet(buf, static_cast<size_t>(n), hello_ack) &&
+                hello_ack.run_id == run_id_) {
+                path.hello_acked = true;
+            }
+        }
+    }
+}
+
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::are_paths_acked() const {
+    return std::all_of(paths_.begin(), paths_.end(), [](const SendPath& path) { return path.hello_acked; });
+}
+
+template <class Clock, class Mutex>
+RedundancyStats BasicSenderReliability<Clock, Mutex>::get_redundancy_stats() const {
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    return redundancy_;
+}
+
+template <class Clock, class Mutex>
+size_t BasicSenderReliability<Clock, Mutex>::process_ack_packet(const uint8_t* data, size_t size) {
+    timestamp_t recv_time = Clock::now();
     sequence_t ack_seq;
     std::vector<sequence_t> missing_seqs;
+    uint32_t ack_delay_us = 0;
+    sequence_t window_end = 0;
+    AckTimestamps timestamps;
+    std::vector<sequence_t> dsacks;
+
+    if (!PacketHandler::parse_ack_packet(data, size, ack_seq, missing_seqs, &ack_delay_us, &window_end,
+                                         &timestamps, &dsacks)) {
+        return 0;
+    }
 
-    if (PacketHandler::parse_ack_packet(data, size, ack_seq, missing_seqs)) {
-        reliability_mgr_.process_ack(ack_seq, missing_seqs);
+    UDP_TRACE_INSTANT(ACK_RECV, ack_seq, missing_seqs.size());
+    add_clock_sample(timestamps.echo_ts, timestamps.recv_ts, timestamps.ack_ts, recv_time);
+    {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        uint64_t ack_delay_ns = static_cast<uint64_t>(ack_delay_us) * 1000;
+        ack_stats_.acks++;
+        ack_stats_.total_ack_delay_ns += ack_delay_ns;
+        ack_stats_.max_ack_delay_ns = std::max(ack_stats_.max_ack_delay_ns, ack_delay_ns);
     }
+    reliability_mgr_.on_ack_delay(ack_delay_us);
+    return reliability_mgr_.process_ack(ack_seq, missing_seqs, window_end, dsacks);
 }
 
-void SenderReliability::set_ack_callback(ReliabilityManager::AckCallback callback) {
-    reliability_mgr_.set_ack_callback(callback);
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::process_control_packet(const uint8_t* data, size_t size) {
+    timestamp_t recv_time = Clock::now();
+    HelloAckFrame hello_ack;
+    if (PacketHandler::parse_hello_ack_packet(data, size, hello_ack)) {
+        if (hello_ack.run_id == run_id_) {
+            add_clock_sample(hello_ack.echo_ts, hello_ack.recv_ts, hello_ack.ack_ts, recv_time);
+            hello_acked_.store(true);
+        }
+        return true;
+    }
+
+    AckFrequencyFrame ack_frequency;
+    if (PacketHandler::parse_ack_frequency_packet(data, size, ack_frequency)) {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        if (!ack_frequency_acked_ && ack_frequency.request_id == ack_frequency_.request_id) {
+            ack_frequency_acked_ = true;
+            reliability_mgr_.set_max_ack_delay_us(ack_frequency_.max_ack_delay_us);
+        }
+        return true;
+    }
+
+    FinAckFrame summary;
+    if (!PacketHandler::parse_fin_ack_packet(data, size, summary)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        receiver_summary_ = summary;
+    }
+
+
+    // The FIN-ACK doubles as the last cumulative ACK.
+    reliability_mgr_.process_ack(summary.final_seq, {}, summary.final_seq);
+    fin_acked_.store(true);
+    return true;
+}
+
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::send_ack_frequency(uint32_t ack_period, uint32_t max_ack_delay_us) {
+    Packet packet;
+    {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        uint32_t previous_us = ack_frequency_.request_id != 0 ? ack_frequency_.max_ack_delay_us : max_ack_delay_us;
+        ack_frequency_.request_id++;
+        ack_frequency_.ack_period = ack_period;
+        ack_frequency_.max_ack_delay_us = max_ack_delay_us;
+        ack_frequency_acked_ = false;
+        ack_frequency_sent_ns_ = Clock::now();
+        reliability_mgr_.set_max_ack_delay_us(std::max(previous_us, max_ack_delay_us));
+        packet = PacketHandler::create_ack_frequency_packet(ack_frequency_);
+    }
+    return socket_->send_to(packet.data(), packet.size(), peer_addr_) > 0;
 }
 
-void SenderReliability::retransmit_packet(const Packet& packet, const sockaddr_in& /* dest */) {
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::is_ack_frequency_acked() const {
+    return ack_frequency_acked_.load();
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::on_loss_timer() {
+    reliability_mgr_.on_loss_timer();
+    if (ack_frequency_acked_.load()) {
+        return;
+    }
+
+    Packet packet;
+    {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        timestamp_t now = Clock::now();
+        if (ack_frequency_acked_ ||
+            now - ack_frequency_sent_ns_ < static_cast<timestamp_t>(reliability_mgr_.get_pto_us()) * 1000) {
+            return;
+        }
+        ack_frequency_sent_ns_ = now;
+        packet = PacketHandler::create_ack_frequency_packet(ack_frequency_);
+    }
     socket_->send_to(packet.data(), packet.size(), peer_addr_);
 }
 
-void SenderReliability::handle_ack(sequence_t /* seq */, timestamp_t /* send_time */, timestamp_t /* recv_time */, int /* retransmits */) {
+template <class Clock, class Mutex>
+int64_t BasicSenderReliability<Clock, Mutex>::get_loss_timeout_us() const {
+    int64_t timeout_us = reliability_mgr_.get_loss_timeout_us();
+    if (ack_frequency_acked_.load()) {
+        return timeout_us;
+    }
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    timestamp_t due = ack_frequency_sent_ns_ + static_cast<timestamp_t>(reliability_mgr_.get_pto_us()) * 1000;
+    timestamp_t now = Clock::now();
+    int64_t due_us = due > now ? static_cast<int64_t>((due - now + 999) / 1000) : 0;
+    return timeout_us < 0 ? due_us : std::min(timeout_us, due_us);
+}
+
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::send_hello(const HelloFrame& hello) {
+    run_id_ = hello.run_id;
+    reliability_mgr_.set_max_ack_delay_us(hello.max_ack_delay_us);
+
+    HelloFrame stamped = hello;
+    stamped.send_ts = Clock::now();
+    stamped.fec_data = static_cast<uint16_t>(fec_.get_code().data);
+    stamped.fec_parity = static_cast<uint16_t>(fec_.get_code().parity);
+    Packet packet = PacketHandler::create_hello_packet(stamped);
+    bool sent = socket_->send_to(packet.data(), packet.size(), peer_addr_) > 0;
+    for (const SendPath& path : paths_) {
+        if (!path.hello_acked) {
+            path.socket->send_to(packet.data(), packet.size(), path.peer);
+        }
+    }
+    return sent;
+}
+
+template <class Clock, class Mutex>
+bool BasicSenderReliability<Clock, Mutex>::send_fin(sequence_t final_seq) {
+    Packet packet = PacketHandler::create_fin_packet(final_seq);
+    return socket_->send_to(packet.data(), packet.size(), peer_addr_) > 0;
+}
+
+template <class Clock, class Mutex>
+FinAckFrame BasicSenderReliability<Clock, Mutex>::get_receiver_summary() const {
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    return receiver_summary_;
+}
+
+template <class Clock, class Mutex>
+ClockEstimate BasicSenderReliability<Clock, Mutex>::get_clock_estimate() const {
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    return clock_sync_.get_estimate();
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::add_clock_sample(timestamp_t t1, timestamp_t t2, timestamp_t t3, timestamp_t t4) {
+    ClockSyncFrame frame;
+    {
+        std::lock_guard<Mutex> lock(ack_stats_mutex_);
+        if (!clock_sync_.add_sample(t1, t2, t3, t4)) {
+            return;
+        }
+
+        const ClockEstimate& estimate = clock_sync_.get_estimate();
+        if (clock_sync_.get_epochs_closed() == clock_sync_epoch_sent_ &&
+            estimate.uncertainty_ns * 2 > clock_sync_uncertainty_sent_) {
+            return;
+        }
+        clock_sync_epoch_sent_ = clock_sync_.get_epochs_closed();
+        clock_sync_uncertainty_sent_ = estimate.uncertainty_ns;
+        frame = estimate.to_frame();
+    }
+
+    Packet packet = PacketHandler::create_clock_sync_packet(frame);
+    socket_->send_to(packet.data(), packet.size(), peer_addr_);
+}
+
+template <class Clock, class Mutex>
+AckStats BasicSenderReliability<Clock, Mutex>::get_ack_stats() const {
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    return ack_stats_;
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::set_ack_callback(typename Manager::AckCallback callback) {
+    reliability_mgr_.set_ack_callback(callback);
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::set_fragment_layout(const FragmentLayout& layout) {
+    layout_ = layout;
+    reliability_mgr_.set_fragment_layout(layout);
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::set_packet_builder(typename Manager::PacketBuilder builder) {
+    packet_builder_ = builder;
+    reliability_mgr_.set_packet_builder(builder);
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::retransmit_packet(const Packet& packet, const sockaddr_in& /* dest */) {
+    if (paths_.empty()) {
+        socket_->send_to(packet.data(), packet.size(), peer_addr_);
+        return;
+    }
+
+    size_t path = retransmit_path_++ % (paths_.size() + 1);
+    ssize_t sent = path == 0 ? socket_->send_to(packet.data(), packet.size(), peer_addr_)
+                             : paths_[path - 1].socket->send_to(packet.data(), packet.size(), paths_[path - 1].peer);
+    std::lock_guard<Mutex> lock(ack_stats_mutex_);
+    if (sent > 0) {
+        redundancy_.retransmits++;
+        redundancy_.retransmit_bytes += packet.size();
+    }
+}
+
+template <class Clock, class Mutex>
+void BasicSenderReliability<Clock, Mutex>::handle_ack(sequence_t /* seq */, timestamp_t /* send_time */, timestamp_t /* recv_time */, int /* retransmits */,
+                                                      timestamp_t /* intended_time */) {
     // TODO: Implement ACK handling logic if needed
 }
 
 
-ReceiverReliability::ReceiverReliability(Socket* socket, int window_size, int ack_period)
-    : ack_mgr_(window_size, ack_period), socket_(socket) {}
+template <class Clock, class Mutex>
+BasicReceiverReliability<Clock, Mutex>::BasicReceiverReliability(Socket* socket, int window_size, int ack_period,
+                                                                 uint32_t max_ack_delay_us)
+    : ack_mgr_(window_size, ack_period, max_ack_delay_us), socket_(socket) {}
+
+template <class Clock, class Mutex>
+size_t BasicReceiverReliability<Clock, Mutex>::add_path(Socket* socket) {
+    paths_.push_back({socket, sockaddr_in{}, false});
+    race_.reset(paths_.size() + 1);
+    ack_mgr_.set_expect_copies(true);
+    return paths_.size();
+}
 
-bool ReceiverReliability::process_data_packet(const uint8_t* data, size_t size,
-                                            const sockaddr_in& sender) {
+template <class Clock, class Mutex>
+bool BasicReceiverReliability<Clock, Mutex>::process_data_packet(const uint8_t* data, size_t size,
+                                                                 const sockaddr_in& sender, size_t path) {
     sequence_t seq;
     timestamp_t send_ts;
 
@@ -246,37 +1101,258 @@ bool ReceiverReliability::process_data_packet(const uint8_t* data, size_t size,
         return false;
     }
 
+    bool from_peer = path == 0 ? is_session_peer(sender)
+                               : paths_[path - 1].has_peer &&
+                                 sender.sin_addr.s_addr == paths_[path - 1].peer.sin_addr.s_addr &&
+                                 sender.sin_port == paths_[path - 1].peer.sin_port;
+    if (!from_peer) {
+        stray_packets_++;
+        return false;
+    }
 
-    if (!sender_addr_set_) {
-        sender_addr_ = sender;
-        sender_addr_set_ = true;
+    if (is_echo_mode()) {
+        socket_->send_to(data, size, sender_addr_);
+        ack_mgr_.make_room(seq);
+        return ack_mgr_.add_received_packet(seq, Clock::now());
     }
 
-    timestamp_t recv_time = get_timestamp_ns();
-    bool is_new = ack_mgr_.add_received_packet(seq, recv_time);
+    timestamp_t recv_time = Clock::now();
+    bool is_new = ack_mgr_.add_received_packet(seq, recv_time, send_ts);
+    if (!paths_.empty()) {
+        int64_t latency_ns = static_cast<int64_t>(recv_time - send_ts) - get_clock_offset_ns(send_ts);
+        if (race_.add_copy(path, seq, size, recv_time, latency_ns, is_new)) {
+            ack_mgr_.add_dsack(seq);
+        }
+    }
+    if (is_new && fec_.enabled()) {
+        fec_.add_data(seq, data, size, fec_rebuilt_);
+        accept_recovered();
+    }
 
 
     send_ack_if_needed();
+    if (fin_received_) {
+        send_fin_ack_if_complete();
+    }
 
     return is_new;
 }
 
-void ReceiverReliability::send_ack_if_needed() {
-    if (ack_mgr_.should_send_ack() && sender_addr_set_) {
+template <class Clock, class Mutex>
+bool BasicReceiverReliability<Clock, Mutex>::process_control_packet(const uint8_t* data, size_t size,
+                                                                    const sockaddr_in& sender, size_t path) {
+    timestamp_t recv_time = Clock::now();
+    sequence_t final_seq;
+    HelloFrame hello;
+    ClockSyncFrame sync;
+
+
+    if (path > 0) {
+        if (!PacketHandler::parse_hello_packet(data, size, hello) || !session_started_ ||
+            hello.run_id != session_.run_id) {
+            stray_packets_++;
+            return false;
+        }
+        ReceivePath& receive_path = paths_[path - 1];
+        receive_path.peer = sender;
+        receive_path.has_peer = true;
+
+        HelloAckFrame hello_ack;
+        hello_ack.run_id = session_.run_id;
+        hello_ack.echo_ts = hello.send_ts;
+        hello_ack.recv_ts = recv_time;
+        hello_ack.ack_ts = Clock::now();
+        Packet packet = PacketHandler::create_hello_ack_packet(hello_ack);
+        receive_path.socket->send_to(packet.data(), packet.size(), sender);
+        return true;
+    }
+
+    if (PacketHandler::parse_hello_packet(data, size, hello)) {
+        if (!session_started_) {
+            session_ = hello;
+            session_started_ = true;
+            sender_addr_ = sender;
+            sender_addr_set_ = true;
+
+            int window_size = std::max<int>(8, static_cast<int>(hello.window_size) / 8 * 8);
+            ack_mgr_.reserve_window(window_size, hello.max_inflight);
+            ack_mgr_.set_ack_policy(static_cast<int>(hello.ack_period), hello.max_ack_delay_us);
+            if (hello.fec_data > 0 && hello.fec_data <= config::FEC_MAX_DATA && hello.fec_parity > 0 &&
+                hello.fec_parity <= config::FEC_MAX_PARITY && !is_echo_mode()) {
+                fec_.reset(FecCode{hello.fec_data, hello.fec_parity});
+                ack_mgr_.set_expect_repairs(true);
+            }
+        } else if (hello.run_id != session_.run_id || !is_session_peer(sender)) {
+            stray_packets_++;
+            return false;
+        }
+
+
+        HelloAckFrame hello_ack;
+        hello_ack.run_id = session_.run_id;
+        hello_ack.echo_ts = hello.send_ts;
+        hello_ack.recv_ts = recv_time;
+        hello_ack.ack_ts = Clock::now();
+        Packet packet = PacketHandler::create_hello_ack_packet(hello_ack);
+        socket_->send_to(packet.data(), packet.size(), sender_addr_);
+        return true;
+    }
+
+    if (!is_session_peer(sender)) {
+        stray_packets_++;
+        return false;
+    }
+
+    ControlType type;
+    if (PacketHandler::parse_control_type(data, size, type) && type == ControlType::PARITY) {
+        if (fec_.enabled()) {
+            fec_.add_parity(data, size, fec_rebuilt_);
+            accept_recovered();
+            send_ack_if_needed();
+            if (fin_received_) {
+                send_fin_ack_if_complete();
+            }
+        }
+        return true;
+    }
+
+    AckFrequencyFrame ack_frequency;
+    if (PacketHandler::parse_ack_frequency_packet(data, size, ack_frequency)) {
+        // An older request is echoed again but not applied.
+        if (ack_frequency.request_id > ack_frequency_id_) {
+            ack_frequency_id_ = ack_frequency.request_id;
+            ack_mgr_.set_ack_policy(static_cast<int>(ack_frequency.ack_period), ack_frequency.max_ack_delay_us);
+        }
+        Packet echo = PacketHandler::create_ack_frequency_packet(ack_frequency);
+        socket_->send_to(echo.data(), echo.size(), sender_addr_);
+        return true;
+    }
+
+    if (PacketHandler::parse_clock_sync_packet(data, size, sync)) {
+        clock_estimate_ = ClockEstimate::from_frame(sync);
+        return true;
+    }
+
+    if (PacketHandler::parse_fin_packet(data, size, final_seq)) {
+        fin_seq_ = final_seq;
+        fin_received_ = true;
+
+
+        if (is_echo_mode()) {
+            send_fin_ack();
+            return true;
+        }
+
+
+        send_fin_ack_if_complete();
+        if (!finished_) {
+            force_ack();
+        }
+        return true;
+    }
+    return false;
+}
+
+// Rebuilt packets carry no send time, so they skip jitter and clock sync.
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::accept_recovered() {
+    if (fec_rebuilt_.empty()) {
+        return;
+    }
+    timestamp_t now = Clock::now();
+    for (Packet& packet : fec_rebuilt_) {
+        sequence_t seq = packet.get_sequence();
+        timestamp_t send_ts = packet.get_timestamp();
+        if (ack_mgr_.add_received_packet(seq, now, 0)) {
+            int64_t latency_ns = static_cast<int64_t>(now - send_ts) - get_clock_offset_ns(send_ts);
+            if (latency_ns > 0) {
+                fec_.add_recovered_latency(static_cast<uint64_t>(latency_ns));
+            }
+            recovered_.push_back(std::move(packet));
+        }
+    }
+    fec_rebuilt_.clear();
+}
+
+template <class Clock, class Mutex>
+bool BasicReceiverReliability<Clock, Mutex>::take_recovered(Packet& packet) {
+    if (recovered_.empty()) {
+        return false;
+    }
+    packet = std::move(recovered_.front());
+    recovered_.pop_front();
+    return true;
+}
+
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::send_ack_if_needed() {
+    if (sender_addr_set_ && !is_echo_mode() && ack_mgr_.should_send_ack(Clock::now())) {
         send_ack();
     }
 }
 
-void ReceiverReliability::force_ack() {
+template <class Clock, class Mutex>
+int64_t BasicReceiverReliability<Clock, Mutex>::get_ack_timeout_us() const {
+    timestamp_t deadline = ack_mgr_.get_ack_deadline();
+    if (deadline == 0 || is_echo_mode()) {
+        return -1;
+    }
+    timestamp_t now = Clock::now();
+    return deadline > now ? static_cast<int64_t>((deadline - now + 999) / 1000) : 0;
+}
+
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::force_ack() {
     ack_mgr_.force_ack();
     if (sender_addr_set_) {
         send_ack();
     }
 }
 
-void ReceiverReliability::send_ack() {
-    AckPacket ack = ack_mgr_.generate_ack();
+template <class Clock, class Mutex>
+bool BasicReceiverReliability<Clock, Mutex>::is_session_peer(const sockaddr_in& addr) const {
+    return session_started_ &&
+           addr.sin_addr.s_addr == sender_addr_.sin_addr.s_addr &&
+           addr.sin_port == sender_addr_.sin_port;
+}
+
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::send_fin_ack_if_complete() {
+    if (!sender_addr_set_ || ack_mgr_.get_highest_contiguous() < fin_seq_) {
+        return;
+    }
+    send_fin_ack();
+}
+
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::send_fin_ack() {
+    AckStats ack_stats = ack_mgr_.get_ack_stats();
+    FinAckFrame summary;
+    summary.final_seq = fin_seq_;
+    summary.packets_received = ack_stats.data_packets;
+    summary.duplicate_packets = ack_stats.duplicate_packets;
+    summary.acks_sent = ack_stats.acks;
+
+    Packet packet = PacketHandler::create_fin_ack_packet(summary);
+    socket_->send_to(packet.data(), packet.size(), sender_addr_);
+    finished_ = true;
+}
+
+template <class Clock, class Mutex>
+void BasicReceiverReliability<Clock, Mutex>::send_ack() {
+    AckPacket ack = ack_mgr_.generate_ack(Clock::now());
     socket_->send_to(ack.data(), ack.size(), sender_addr_);
+    UDP_TRACE_INSTANT(ACK_SEND, ack_mgr_.get_highest_contiguous(), ack.size());
 }
 
+
+template class BasicAckManager<std::mutex>;
+template class BasicAckManager<NullMutex>;
+template class BasicReliabilityManager<SystemClock>;
+template class BasicReliabilityManager<VirtualClock, NullMutex>;
+template class BasicSenderReliability<SystemClock>;
+template class BasicSenderReliability<VirtualClock, NullMutex>;
+template class BasicReceiverReliability<SystemClock>;
+template class BasicReceiverReliability<VirtualClock, NullMutex>;
+
 }
\ No newline at end of file
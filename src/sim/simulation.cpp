@@ -0,0 +1,457 @@
+#include "udp_benchmark/simulation.hpp"
+#include "udp_benchmark/packet.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+namespace udp_benchmark {
+
+
+// The protocol code treats time 0 as "unset".
+static constexpr timestamp_t SIM_EPOCH_NS = 1000000000ULL;
+
+class SimLinkSink : public DatagramSink {
+private:
+    Simulation* sim_;
+    bool from_sender_;
+
+public:
+    SimLinkSink(Simulation* sim, bool from_sender) : sim_(sim), from_sender_(from_sender) {}
+
+    ssize_t send_datagram(const void* data, size_t size, const sockaddr_in&) override {
+        sim_->transmit(from_sender_, data, size);
+        return static_cast<ssize_t>(size);
+    }
+};
+
+
+SimLink::SimLink(const ImpairmentConfig& config) : model_(config) {}
+
+int SimLink::transmit(size_t size, timestamp_t now, timestamp_t arrivals[2]) {
+    const ImpairmentConfig& config = model_.get_config();
+    stats_.offered++;
+    if (model_.is_lost()) {
+        stats_.lost++;
+        return 0;
+    }
+
+    int copies = 1;
+    if (model_.is_duplicated()) {
+        copies = 2;
+        stats_.duplicated++;
+    }
+
+    int surviving = 0;
+    for (int copy = 0; copy < copies; ++copy) {
+        timestamp_t depart_ns = now;
+        if (config.rate_mbps > 0) {
+            while (!backlog_.empty() && backlog_.front() <= now) {
+                backlog_.pop_front();
+            }
+            if (backlog_.size() >= config.queue_limit) {
+                stats_.queue_drops++;
+                continue;
+            }
+
+            depart_ns = model_.take_tokens(size, now);
+            backlog_.push_back(depart_ns);
+            stats_.max_queue = std::max<uint64_t>(stats_.max_queue, backlog_.size());
+
+            timestamp_t serialization_ns = static_cast<timestamp_t>(size * 8000.0 / config.rate_mbps);
+            queue_delay_.add_latency(depart_ns > now + serialization_ns ? depart_ns - now - serialization_ns : 0);
+        }
+
+        if (model_.is_reordered()) {
+            stats_.reordered++;
+        } else {
+            depart_ns += model_.sample_delay_ns();
+        }
+        arrivals[surviving++] = depart_ns;
+        stats_.delivered++;
+    }
+    return surviving;
+}
+
+
+void SimResult::print_summary() const {
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\nSimulation (" << (completed ? "completed" : "stopped at time limit") << "):\n";
+    std::cout << "  Virtual time: " << virtual_ns / 1e9 << " s, wall time: " << wall_seconds << " s ("
+              << std::setprecision(1) << (wall_seconds > 0 ? virtual_ns / 1e9 / wall_seconds : 0.0)
+              << "x real time, " << (wall_seconds > 0 ? events / wall_seconds / 1e6 : 0.0) << "M events/s)\n";
+    std::cout << "  Delivered: " << delivered << "/" << total << "\n";
+    std::cout << std::setprecision(2);
+    std::cout << "  Goodput: " << get_goodput() << " msgs/sec, "
+              << (virtual_ns > 0 ? bytes_delivered * 8e3 / virtual_ns : 0.0) << " Mbps\n";
+
+    auto print_latency = [](const char* title, const LatencyStats& stats) {
+        if (stats.packet_count == 0) {
+            return;
+        }
+        std::cout << "  " << title << ": p50 " << stats.get_percentile_latency_us(50.0)
+                  << " μs, p99 " << stats.get_percentile_latency_us(99.0)
+                  << " μs, p99.9 " << stats.get_percentile_latency_us(99.9)
+                  << " μs, max " << stats.get_max_latency_us() << " μs (" << stats.packet_count << " samples)\n";
+    };
+    print_latency("RTT", rtt);
+    print_latency("One-way", one_way);
+    print_latency("Bottleneck queueing delay", queue_delay);
+    print_latency("Recovery time (retransmitted)", recovery);
+
+    auto print_link = [](const char* title, const SimLinkStats& link) {
+        std::cout << "  " << title << ": " << link.offered << " offered, " << link.lost << " lost, "
+                  << link.queue_drops << " queue drops, " << link.duplicated << " duplicated, "
+                  << link.reordered << " reordered, max queue " << link.max_queue << "\n";
+    };
+    print_link("Forward link", forward);
+    print_link("Reverse link", reverse);
+
+    loss.print_summary();
+    if (fec.enabled()) {
+        fec_sent.print_summary("Forward Error Correction (sender)", fec);
+        fec_received.print_summary("Forward Error Correction (receiver)", fec);
+    }
+    std::cout << "  Digest: " << std::hex << std::setw(16) << std::setfill('0') << digest
+              << std::dec << std::setfill(' ') << "\n";
+}
+
+void SimResult::print_comparison(const std::vector<SimResult>& results) {
+    if (results.empty()) {
+        return;
+    }
+    const SimResult& base = results.front();
+    double base_p99 = base.one_way.get_percentile_latency_us(99.0);
+
+    std::cout << "\nFEC code comparison (same links and seeds; one-way latency in μs):\n";
+    std::cout << "  " << std::left << std::setw(8) << "Code" << std::right << std::setw(7) << "Rate"
+              << std::setw(10) << "Parity" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::setw(10) << "p99 vs"
+              << std::setw(10) << "Rebuilt" << std::setw(10) << "Retrans" << std::setw(10) << "Done" << "\n";
+    for (const SimResult& result : results) {
+        std::string code = result.fec.enabled()
+                               ? std::to_string(result.fec.data) + ":" + std::to_string(result.fec.parity)
+                               : "none";
+        double p99 = result.one_way.get_percentile_latency_us(99.0);
+        std::cout << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(8) << code << std::right
+                  << std::setw(7) << result.fec.get_rate() << std::setprecision(1) << std::setw(9)
+                  << result.fec_sent.get_overhead_percent() << "%" << std::setw(10)
+                  << result.one_way.get_percentile_latency_us(50.0) << std::setw(10) << p99 << std::setw(10)
+                  << result.one_way.get_percentile_latency_us(99.9) << std::setw(10)
+                  << result.one_way.get_max_latency_us() << std::setw(9)
+                  << (base_p99 > 0 ? 100.0 * (p99 - base_p99) / base_p99 : 0.0) << "%" << std::setw(10)
+                  << result.fec_received.recovered_packets << std::setw(10) << result.loss.retransmits
+                  << std::setw(10) << (result.completed ? "yes" : "no") << "\n";
+    }
+    std::cout << "  Parity is bytes sent over data bytes; p99 vs is the change from the first row.\n";
+}
+
+bool SimResult::write_json(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    auto latency = [&](const char* name, const LatencyStats& stats) {
+        out << "  \"" << name << "_p50_us\": " << stats.get_percentile_latency_us(50.0) << ",\n"
+            << "  \"" << name << "_p99_us\": " << stats.get_percentile_latency_us(99.0) << ",\n"
+            << "  \"" << name << "_max_us\": " << stats.get_max_latency_us() << ",\n";
+    };
+
+    out << std::fixed << std::setprecision(3) << "{\n";
+    out << "  \"completed\": " << (completed ? "true" : "false") << ",\n";
+    out << "  \"virtual_s\": " << virtual_ns / 1e9 << ",\n";
+    out << "  \"wall_s\": " << wall_seconds << ",\n";
+    out << "  \"events\": " << events << ",\n";
+    out << "  \"delivered\": " << delivered << ",\n";
+    out << "  \"goodput_msgs_per_s\": " << get_goodput() << ",\n";
+    latency("rtt", rtt);
+    latency("one_way", one_way);
+    latency("queue_delay", queue_delay);
+    latency("recovery", recovery);
+    out << "  \"recovered_packets\": " << recovery.packet_count << ",\n";
+    out << "  \"losses_detected\": " << loss.losses_detected << ",\n";
+    out << "  \"retransmits\": " << loss.retransmits << ",\n";
+    out << "  \"spurious_retransmits\": " << loss.spurious_retransmits << ",\n";
+    out << "  \"forward_lost\": " << forward.lost << ",\n";
+    out << "  \"forward_queue_drops\": " << forward.queue_drops << ",\n";
+    out << "  \"forward_max_queue\": " << forward.max_queue << ",\n";
+    if (fec.enabled()) {
+        out << "  \"fec_code\": \"" << fec.data << ":" << fec.parity << "\",\n";
+        out << "  \"fec_parity_bytes\": " << fec_sent.parity_bytes << ",\n";
+        out << "  \"fec_rebuilt_packets\": " << fec_received.recovered_packets << ",\n";
+    }
+    out << "  \"digest\": \"" << std::hex << std::setw(16) << std::setfill('0') << digest << std::dec << "\"\n";
+    out << "}\n";
+    return true;
+}
+
+
+Simulation::Simulation(const SimConfig& config)
+    : config_(config), forward_(config.forward), reverse_(config.reverse),
+      sender_sink_(std::make_unique<SimLinkSink>(this, true)),
+      receiver_sink_(std::make_unique<SimLinkSink>(this, false)),
+      sender_socket_(-1, sender_sink_.get()), receiver_socket_(-1, receiver_sink_.get()),
+      congestion_(1000, 5000, false), rate_limiter_(config.rate) {
+    NetworkUtils::parse_address("10.0.0.1", 40000, sender_addr_);
+    NetworkUtils::parse_address("10.0.0.2", 9000, receiver_addr_);
+
+    sender_ = std::make_unique<SimSender>(&sender_socket_, receiver_addr_, config_.msg_size);
+    receiver_ = std::make_unique<SimReceiver>(&receiver_socket_);
+    sender_->set_fec_code(config_.fec);
+
+    sender_->set_ack_callback([this](sequence_t, timestamp_t send_time, timestamp_t recv_time, int retransmits,
+                                     timestamp_t) {
+        result_.rtt.add_latency(recv_time - send_time);
+        if (retransmits > 0) {
+            result_.recovery.add_latency(recv_time - send_time);
+        }
+    });
+    sender_->set_congestion_controller(&congestion_);
+
+    result_.total = config_.total;
+    result_.fec = config_.fec;
+    result_.rtt.latencies.reserve(std::min<uint64_t>(config_.total, config::MAX_PREALLOCATED_SAMPLES));
+    result_.one_way.latencies.reserve(std::min<uint64_t>(config_.total, config::MAX_PREALLOCATED_SAMPLES));
+    events_.reserve(4096);
+}
+
+Simulation::~Simulation() = default;
+
+SimResult Simulation::run() {
+    auto wall_start = std::chrono::steady_clock::now();
+    VirtualClock::now_ns = SIM_EPOCH_NS;
+
+    sender_->start();
+    wake_sender_at(SIM_EPOCH_NS);
+
+    timestamp_t time_limit_ns = SIM_EPOCH_NS + config_.time_limit_s * 1000000000ULL;
+    result_.digest = 0xcbf29ce484222325ULL;
+
+    while (!events_.empty() && phase_ != Phase::DONE) {
+        std::pop_heap(events_.begin(), events_.end(), std::greater<Event>());
+        Event event = events_.back();
+        events_.pop_back();
+        if (event.time > time_limit_ns) {
+            break;
+        }
+
+        VirtualClock::now_ns = std::max(VirtualClock::now_ns, event.time);
+        timestamp_t now = VirtualClock::now_ns;
+        result_.events++;
+
+        switch (event.type) {
+            case EventType::TO_RECEIVER:
+                deliver_to_receiver(buffers_[event.arg].data(), buffer_sizes_[event.arg], now);
+                free_slots_.push_back(event.arg);
+                arm_receiver_timer(now);
+                break;
+            case EventType::TO_SENDER:
+                deliver_to_sender(buffers_[event.arg].data(), buffer_sizes_[event.arg]);
+                free_slots_.push_back(event.arg);
+                drive_sender(now);
+                arm_sender_timer(now);
+                break;
+            case EventType::SENDER_WAKE:
+                if (event.time == wake_at_) {
+                    wake_at_ = 0;
+                    drive_sender(now);
+                    arm_sender_timer(now);
+                }
+                break;
+            case EventType::SENDER_TIMER:
+                if (event.arg == sender_timer_gen_) {
+                    sender_timer_at_ = 0;
+                    sender_->on_loss_timer();
+                    arm_sender_timer(now);
+                }
+                break;
+            case EventType::RECEIVER_TIMER:
+                if (event.arg == receiver_timer_gen_) {
+                    receiver_timer_at_ = 0;
+                    receiver_->on_ack_timer();
+                    arm_receiver_timer(now);
+                }
+                break;
+        }
+    }
+
+    timestamp_t end_ns = VirtualClock::now_ns;
+
+    result_.completed = phase_ == Phase::DONE;
+    result_.virtual_ns = start_ns_ != 0 && end_ns > start_ns_ ? end_ns - start_ns_ : 0;
+    result_.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    result_.loss = sender_->get_loss_stats();
+    result_.forward = forward_.get_stats();
+    result_.reverse = reverse_.get_stats();
+    result_.queue_delay = forward_.get_queue_delay();
+    result_.fec_sent = sender_->get_fec_stats();
+    receiver_->finish_fec();
+    result_.fec_received = receiver_->get_fec_stats();
+    mix_digest(result_.virtual_ns);
+    return result_;
+}
+
+void Simulation::transmit(bool from_sender, const void* data, size_t size) {
+    timestamp_t now = VirtualClock::now_ns;
+    timestamp_t arrivals[2];
+    int copies = (from_sender ? forward_ : reverse_).transmit(size, now, arrivals);
+
+    for (int i = 0; i < copies; ++i) {
+        uint32_t slot;
+        if (free_slots_.empty()) {
+            slot = static_cast<uint32_t>(buffers_.size());
+            buffers_.emplace_back();
+            buffer_sizes_.push_back(0);
+        } else {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        buffers_[slot].assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        buffer_sizes_[slot] = size;
+        schedule(arrivals[i], from_sender ? EventType::TO_RECEIVER : EventType::TO_SENDER, slot);
+    }
+}
+
+void Simulation::schedule(timestamp_t time, EventType type, uint32_t arg) {
+    events_.push_back(Event{time, next_order_++, arg, type});
+    std::push_heap(events_.begin(), events_.end(), std::greater<Event>());
+}
+
+void Simulation::deliver_to_receiver(const uint8_t* data, size_t size, timestamp_t now) {
+    ControlType control_type;
+    if (PacketHandler::parse_control_type(data, size, control_type)) {
+        receiver_->process_control_packet(data, size, sender_addr_);
+    } else if (receiver_->process_data_packet(data, size, sender_addr_)) {
+        record_delivery(data, size, now);
+    }
+
+    while (receiver_->take_recovered(recovered_)) {
+        record_delivery(recovered_.data(), recovered_.size(), now);
+    }
+}
+
+void Simulation::record_delivery(const uint8_t* data, size_t size, timestamp_t now) {
+    sequence_t seq;
+    timestamp_t send_ts;
+    if (PacketHandler::parse_data_packet(data, size, seq, send_ts)) {
+        result_.delivered++;
+        result_.bytes_delivered += size;
+        result_.one_way.add_latency(now - send_ts);
+        mix_digest(seq);
+        mix_digest(now);
+    }
+}
+
+void Simulation::deliver_to_sender(const uint8_t* data, size_t size) {
+    ControlType control_type;
+    if (PacketHandler::parse_control_type(data, size, control_type)) {
+        sender_->process_control_packet(data, size);
+    } else {
+        if (size_t acked = sender_->process_ack_packet(data, size)) {
+            congestion_.on_ack_received_with_stats(false, acked);
+        }
+    }
+}
+
+// Same steps as the udp_sender main loop: HELLO, paced data, then FIN.
+void Simulation::drive_sender(timestamp_t now) {
+    if (phase_ == Phase::HELLO) {
+        if (sender_->is_hello_acked()) {
+            phase_ = Phase::DATA;
+            start_ns_ = now;
+        } else if (now >= next_control_ns_) {
+            HelloFrame hello;
+            hello.run_id = config_.forward.seed;
+            hello.total_count = config_.total;
+            hello.msg_size = static_cast<uint32_t>(config_.msg_size);
+            hello.window_size = config::DEFAULT_WINDOW_SIZE;
+            hello.max_inflight = static_cast<uint32_t>(config::MAX_CWND);
+            hello.ack_period = config_.ack_period;
+            hello.max_ack_delay_us = config_.max_ack_delay_us;
+            hello.flags = 0;
+            hello.datagram_size = 0;
+            sender_->send_hello(hello);
+            next_control_ns_ = now + static_cast<timestamp_t>(config::HELLO_RETRY_MS) * 1000000;
+            wake_sender_at(next_control_ns_);
+            return;
+        } else {
+            return;
+        }
+    }
+
+    if (phase_ == Phase::DATA) {
+        while (next_seq_ <= config_.total) {
+            if (!congestion_.can_send()) {
+                return;
+            }
+            if (!rate_limiter_.can_send(now)) {
+                wake_sender_at(rate_limiter_.get_next_send_time());
+                return;
+            }
+            timestamp_t intended_time = rate_limiter_.mark_sent(now);
+            congestion_.packet_sent();
+            sender_->send_packet(next_seq_, now, intended_time);
+            next_seq_++;
+        }
+        sender_->flush_fec();
+        phase_ = Phase::FIN;
+        next_control_ns_ = now;
+    }
+
+    if (phase_ == Phase::FIN) {
+        if (sender_->is_fin_acked()) {
+            phase_ = Phase::DONE;
+        } else if (now >= next_control_ns_) {
+            sender_->send_fin(config_.total);
+            next_control_ns_ = now + static_cast<timestamp_t>(sender_->get_pto_us()) * 1000;
+            wake_sender_at(next_control_ns_);
+        }
+    }
+}
+
+void Simulation::wake_sender_at(timestamp_t time) {
+    if (wake_at_ != 0 && wake_at_ <= time) {
+        return;
+    }
+    wake_at_ = time;
+    schedule(time, EventType::SENDER_WAKE);
+}
+
+// Re-arms only when the deadline moves earlier.
+void Simulation::arm_sender_timer(timestamp_t now) {
+    int64_t timeout_us = sender_->get_loss_timeout_us();
+    if (timeout_us < 0) {
+        return;
+    }
+    timestamp_t at = now + static_cast<timestamp_t>(std::max<int64_t>(timeout_us, 1)) * 1000;
+    if (sender_timer_at_ != 0 && sender_timer_at_ <= at) {
+        return;
+    }
+    sender_timer_at_ = at;
+    schedule(at, EventType::SENDER_TIMER, ++sender_timer_gen_);
+}
+
+void Simulation::arm_receiver_timer(timestamp_t now) {
+    int64_t timeout_us = receiver_->get_ack_timeout_us();
+    if (timeout_us < 0) {
+        return;
+    }
+    timestamp_t at = now + static_cast<timestamp_t>(std::max<int64_t>(timeout_us, 1)) * 1000;
+    if (receiver_timer_at_ != 0 && receiver_timer_at_ <= at) {
+        return;
+    }
+    receiver_timer_at_ = at;
+    schedule(at, EventType::RECEIVER_TIMER, ++receiver_timer_gen_);
+}
+
+void Simulation::mix_digest(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        result_.digest ^= (value >> (i * 8)) & 0xff;
+        result_.digest *= 0x100000001b3ULL;
+    }
+}
+
+}
@@ -1,25 +1,278 @@
 #include "udp_benchmark/network_utils.hpp"
+#include "udp_benchmark/impairment.hpp"
 #include "udp_benchmark/reliability.hpp"
 #include "udp_benchmark/stats.hpp"
+#include "udp_benchmark/multicast.hpp"
+#include "udp_benchmark/fragmentation.hpp"
+#include "udp_benchmark/coalescing.hpp"
+#include "udp_benchmark/timestamping.hpp"
+#include "udp_benchmark/trace.hpp"
+#include "udp_benchmark/perf_counters.hpp"
+#include "udp_benchmark/live_stats.hpp"
+#include "udp_benchmark/interval_log.hpp"
 #include <iostream>
+#include <cstring>
+#include <csignal>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 using namespace udp_benchmark;
 
+static volatile std::sig_atomic_t g_stop_requested = 0;
+
+static void handle_stop_signal(int) {
+    g_stop_requested = 1;
+}
+
+static int run_multicast(const std::string& group, int port, const std::string& logfile, int count,
+                         const std::string& iface, const ImpairmentConfig& impairment) {
+    sockaddr_in group_addr;
+    if (!NetworkUtils::parse_address(group, port, group_addr) || !NetworkUtils::is_multicast(group_addr)) {
+        std::cerr << "Error: " << group << " is not a multicast group address\n";
+        return 1;
+    }
+    if (count < 1) {
+        std::cerr << "Error: --subscribers must be at least 1\n";
+        return 1;
+    }
+
+    sockaddr_in bind_addr;
+    NetworkUtils::parse_address("0.0.0.0", port, bind_addr);
+
+    std::vector<std::unique_ptr<Socket>> sockets;
+    std::vector<std::unique_ptr<ImpairedSocket>> feedback_sockets;
+    std::vector<std::unique_ptr<LatencyLogger>> loggers;
+    std::vector<std::unique_ptr<MulticastSubscriber>> subscribers;
+    for (int i = 0; i < count; ++i) {
+        auto socket = std::make_unique<Socket>(NetworkUtils::create_udp_socket());
+        auto feedback = std::make_unique<ImpairedSocket>(NetworkUtils::create_udp_socket(), impairment);
+        if (!socket->is_valid() || !feedback->is_valid()) {
+            std::cerr << "Failed to create socket\n";
+            return 1;
+        }
+        socket->configure_buffers();
+        socket->set_reuseaddr();
+        socket->set_reuseport();
+        if (!socket->bind(bind_addr) || !socket->join_multicast(group_addr, iface)) {
+            std::cerr << "Failed to join " << group << ":" << port << "\n";
+            return 1;
+        }
+
+        std::string path = logfile;
+        if (count > 1) {
+            size_t dot = logfile.rfind('.');
+            std::string suffix = "_" + std::to_string(i);
+            path = dot == std::string::npos ? logfile + suffix : logfile.substr(0, dot) + suffix + logfile.substr(dot);
+        }
+        auto logger = std::make_unique<LatencyLogger>(path);
+        if (!logger->is_open()) {
+            std::cerr << "Failed to open log file " << path << "\n";
+            return 1;
+        }
+
+        subscribers.push_back(std::make_unique<MulticastSubscriber>(socket.get(), feedback.get(), i, logger.get()));
+        sockets.push_back(std::move(socket));
+        feedback_sockets.push_back(std::move(feedback));
+        loggers.push_back(std::move(logger));
+    }
+
+    std::cout << "UDP Receiver joined " << group << ":" << port << " with " << count << " subscriber(s) (logging to "
+              << logfile << (count > 1 ? ", one file per subscriber" : "") << ")\n";
+    if (impairment.enabled()) {
+        std::cout << "Impairing outgoing datagrams: " << impairment.describe() << "\n";
+    }
+
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> running{count};
+    std::vector<std::thread> threads;
+    for (auto& subscriber : subscribers) {
+        threads.emplace_back([&stop, &running, &subscriber]() {
+            subscriber->run(stop);
+            running--;
+        });
+    }
+    while (running > 0) {
+        if (g_stop_requested) {
+            stop = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<const MulticastSubscriber*> report;
+    for (size_t i = 0; i < subscribers.size(); ++i) {
+        loggers[i]->flush();
+        if (subscribers[i]->has_session()) {
+            report.push_back(subscribers[i].get());
+        }
+    }
+    std::cout << "\nReceiver finished.";
+    if (report.empty()) {
+        std::cout << " No session was received.\n";
+        return 0;
+    }
+    std::cout << " Session " << std::hex << report.front()->get_session().run_id << std::dec << ", "
+              << report.front()->get_session().total_count << " x " << report.front()->get_session().msg_size
+              << " bytes.\n";
+    print_multicast_report(report);
+    for (const auto& feedback : feedback_sockets) {
+        if (feedback->is_impaired()) {
+            feedback->get_stats().print_summary();
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <listen_port> <logfile.csv>\n";
+        std::cerr << "Usage: " << argv[0] << " <listen_port> <logfile.csv> [options]\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --ack-period N      ACK every N packets until the sender requests otherwise\n";
+        std::cerr << "  --ack-delay-us T    ACK at most T μs after the oldest unacknowledged packet\n";
+        std::cerr << "  --multicast GROUP   Join multicast GROUP and recover losses with NACKs instead of ACKs\n";
+        std::cerr << "  --subscribers N     Multicast: run N subscribers, each with its own socket and log (default 1)\n";
+        std::cerr << "  --mcast-if IP       Multicast: join on the interface with this address\n";
+        std::cerr << "  --impair SPEC       Impair outgoing datagrams in userspace, e.g. delay=1000,jitter=200,loss=0.1\n";
+        std::cerr << "  --paths K           Also listen on ports port+1..port+K-1 for the copies a sender with --paths K\n";
+        std::cerr << "                      sends, keep the first of each and report which path won (default 1)\n";
+        std::cerr << "  --perf-counters N   Count cycles, instructions, cache/branch misses and context switches in the\n";
+        std::cerr << "                      receive loop, per N packets (default off)\n";
+        std::cerr << "  --live-stats NAME   Publish live counters for udp_stat as NAME, or off (default receiver.PID)\n";
+        std::cerr << "  --interval-log PATH Append a latency histogram, throughput, duplicates, reordering and jitter to PATH\n";
+        std::cerr << "                      every interval, for long runs (read with udp_stat --interval-log)\n";
+        std::cerr << "  --interval-ms T     Length of each --interval-log interval (default " << config::INTERVAL_LOG_DEFAULT_MS << ")\n";
+        std::cerr << "  --trace PATH        Record hot-path events and write them to PATH as Chrome trace JSON at exit\n";
+        std::cerr << "                      and on SIGUSR1 (needs a build with TRACE=1)\n";
+        std::cerr << "  --clock auto|steady Timestamp source: the invariant TSC when available, or steady_clock (default auto)\n";
+        std::cerr << "  --clock-offset-ns N Add a synthetic N ns offset to this host's clock (testing)\n";
+        std::cerr << "  --clock-drift-ppm D Add a synthetic D ppm drift to this host's clock (testing)\n";
         return 1;
     }
 
     int port = std::atoi(argv[1]);
     std::string logfile = argv[2];
+    int ack_period = config::DEFAULT_ACK_PERIOD;
+    uint32_t ack_delay_us = config::DEFAULT_MAX_ACK_DELAY_US;
+    int64_t clock_offset_ns = 0;
+    double clock_drift_ppm = 0.0;
+    bool allow_tsc = true;
+    uint64_t perf_interval = 0;
+    std::string trace_path;
+    std::string live_stats_name = "receiver." + std::to_string(getpid());
+    std::string interval_log_path;
+    int interval_ms = config::INTERVAL_LOG_DEFAULT_MS;
+    ImpairmentConfig impairment;
+    std::string multicast_group;
+    int subscriber_count = 1;
+    std::string multicast_if;
+    uint32_t paths = 1;
+
+    if ((argc - 3) % 2 != 0) {
+        std::cerr << "Error: " << argv[argc - 1] << " needs a value\n";
+        return 1;
+    }
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--ack-period") == 0) {
+            ack_period = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--ack-delay-us") == 0) {
+            ack_delay_us = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--multicast") == 0) {
+            multicast_group = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--subscribers") == 0) {
+            subscriber_count = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--mcast-if") == 0) {
+            multicast_if = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--impair") == 0) {
+            if (!ImpairmentConfig::parse(argv[i + 1], impairment)) {
+                std::cerr << "Error: invalid --impair spec " << argv[i + 1] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--paths") == 0) {
+            paths = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--perf-counters") == 0) {
+            perf_interval = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            trace_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--live-stats") == 0) {
+            live_stats_name = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--interval-log") == 0) {
+            interval_log_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--interval-ms") == 0) {
+            interval_ms = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--clock") == 0) {
+            if (std::strcmp(argv[i + 1], "auto") != 0 && std::strcmp(argv[i + 1], "steady") != 0) {
+                std::cerr << "Error: --clock must be auto or steady\n";
+                return 1;
+            }
+            allow_tsc = std::strcmp(argv[i + 1], "auto") == 0;
+        } else if (std::strcmp(argv[i], "--clock-offset-ns") == 0) {
+            clock_offset_ns = std::strtoll(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--clock-drift-ppm") == 0) {
+            clock_drift_ppm = std::atof(argv[i + 1]);
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
 
     if (!NetworkUtils::is_valid_port(port)) {
         std::cerr << "Error: Invalid port number\n";
         return 1;
     }
 
-    Socket socket(NetworkUtils::create_udp_socket());
+    init_time_source(allow_tsc);
+    if (!trace_path.empty()) {
+#ifdef UDP_BENCHMARK_TRACING
+        Tracer::enable(trace_path);
+        UDP_TRACE_THREAD("recv");
+#else
+        std::cerr << "Error: --trace needs a build with tracing (make TRACE=1)\n";
+        return 1;
+#endif
+    }
+    inject_clock_skew(clock_offset_ns, clock_drift_ppm);
+    std::cout << "Clock: " << describe_time_source() << "\n";
+
+    if (!multicast_group.empty() && perf_interval > 0) {
+        std::cerr << "Error: --perf-counters covers the unicast receive loop only\n";
+        return 1;
+    }
+
+    if (!multicast_group.empty() && !interval_log_path.empty()) {
+        std::cerr << "Error: --interval-log covers the unicast receive loop only\n";
+        return 1;
+    }
+
+    if (!interval_log_path.empty() && interval_ms <= 0) {
+        std::cerr << "Error: --interval-ms must be positive\n";
+        return 1;
+    }
+
+    if (paths < 1 || paths > config::MAX_PATHS || !NetworkUtils::is_valid_port(port + static_cast<int>(paths) - 1)) {
+        std::cerr << "Error: --paths must be between 1 and " << config::MAX_PATHS
+                  << ", with every port up to port+K-1 valid\n";
+        return 1;
+    }
+
+    if (!multicast_group.empty() && paths > 1) {
+        std::cerr << "Error: --paths covers the unicast receive loop only\n";
+        return 1;
+    }
+
+    if (!multicast_group.empty()) {
+        int status = run_multicast(multicast_group, port, logfile, subscriber_count, multicast_if, impairment);
+        Tracer::dump();
+        return status;
+    }
+
+    ImpairedSocket socket(NetworkUtils::create_udp_socket(), impairment);
     if (!socket.is_valid()) {
         std::cerr << "Failed to create socket\n";
         return 1;
@@ -44,42 +297,364 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    ReceiverReliability reliability(&socket);
+    ReceiverReliability reliability(&socket, config::DEFAULT_WINDOW_SIZE, ack_period, ack_delay_us);
+
+
+    std::vector<std::unique_ptr<Socket>> path_sockets;
+    std::vector<int> path_fds = {socket.fd()};
+    for (uint32_t path = 1; path < paths; ++path) {
+        auto path_socket = std::make_unique<Socket>(NetworkUtils::create_udp_socket());
+        sockaddr_in path_addr = addr;
+        path_addr.sin_port = htons(static_cast<uint16_t>(port + static_cast<int>(path)));
+        if (!path_socket->is_valid() || !path_socket->set_reuseaddr() || !path_socket->bind(path_addr)) {
+            std::cerr << "Failed to bind socket for path " << path << " on port " << port + static_cast<int>(path) << "\n";
+            return 1;
+        }
+        path_socket->configure_buffers();
+        path_fds.push_back(path_socket->fd());
+        reliability.add_path(path_socket.get());
+        path_sockets.push_back(std::move(path_socket));
+    }
     StatsCollector stats;
+    FragmentLayout layout;
+    Reassembler reassembler;
+    bool coalesced = false;
+    std::vector<BatchEntry> batch;
+    CoalescingStats coalescing;
+
+    LiveStats live_stats;
+    if (live_stats_name != "off" && !live_stats.create(live_stats_name, LiveRole::RECEIVER, 0, 0)) {
+        return 1;
+    }
+    LiveStatsWriter live_recv = live_stats.add_section("recv");
+
+    IntervalRecorder interval_log;
+
+    std::cout << "UDP Receiver listening on port " << port;
+    if (paths > 1) {
+        std::cout << "-" << port + static_cast<int>(paths) - 1 << " (" << paths << " paths, first copy wins)";
+    }
+    std::cout << " (logging to " << logfile << ")\n";
+    if (impairment.enabled()) {
+        std::cout << "Impairing outgoing datagrams: " << impairment.describe() << "\n";
+    }
+    if (live_stats.is_open()) {
+        std::cout << "Live stats: udp_stat " << live_stats_name << "\n";
+    }
+    if (!interval_log_path.empty()) {
+        std::cout << "Interval log: " << interval_log_path << ", every " << interval_ms << " ms\n";
+    }
 
-    std::cout << "UDP Receiver listening on port " << port << " (logging to " << logfile << ")\n";
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
 
     stats.start_collection();
 
-    uint8_t buf[config::MAX_PACKET_SIZE];
+    std::vector<uint8_t> buf(config::MAX_PACKET_SIZE);
     sockaddr_in sender_addr;
+    size_t next_path = 0;
 
-    while (true) {
-        ssize_t n = socket.recv_from(buf, sizeof(buf), &sender_addr);
-        if (n <= 0) continue;
 
-        timestamp_t recv_time = get_timestamp_ns();
+    bool kernel_timestamps = false;
+    PerfProfile recv_perf;
+    RxTimestampTable rx_stamps;
+    LatencyStages stages;
+    std::vector<TxTimestampEntry> tx_report;
+
+
+    timestamp_t next_gauge_ns = 0;
+    auto publish_ack_counts = [&](timestamp_t now) {
+        if (!live_recv.is_enabled() || now < next_gauge_ns) {
+            return;
+        }
+        next_gauge_ns = now + static_cast<timestamp_t>(config::LIVE_STATS_GAUGE_US) * 1000;
+        AckStats ack_stats = reliability.get_ack_stats();
+        LiveValues* live = live_recv.begin();
+        live->acks = ack_stats.acks;
+        live->duplicates = ack_stats.duplicate_packets;
+        live_recv.end();
+    };
+
+    auto publish_message = [&](timestamp_t send_ns, timestamp_t recv_ns) {
+        if (LiveValues* live = live_recv.begin()) {
+            live->messages++;
+            if (!reliability.is_echo_mode() && recv_ns > send_ns) {
+                live_recv.add_latency(live, recv_ns, recv_ns - send_ns);
+            }
+            live_recv.end();
+        }
+        if (interval_log.is_running() && !reliability.is_echo_mode() && recv_ns > send_ns) {
+            interval_log.add_latency(recv_ns - send_ns);
+        }
+    };
 
+    auto deliver = [&](const uint8_t* data, size_t n, timestamp_t recv_time, timestamp_t kernel_rx_ns) {
         sequence_t seq;
         timestamp_t send_ts;
-        if (PacketHandler::parse_data_packet(buf, n, seq, send_ts)) {
-            bool is_new = reliability.process_data_packet(buf, n, sender_addr);
-            
-            if (is_new) {
-                logger.log_receiver_data(seq, recv_time, send_ts);
-                stats.add_packet_received(n);
-                stats.add_latency_measurement(send_ts, recv_time);
-                
-                if (stats.should_report_progress()) {
-                    std::cout << "Received packets: " << stats.get_throughput_stats().packets_received 
-                              << " (latest seq: " << seq << ")\r" << std::flush;
+        timestamp_t intended_ts;
+        if (!PacketHandler::parse_data_packet(data, n, seq, send_ts, &intended_ts)) {
+            return;
+        }
+        if (LiveValues* live = live_recv.begin()) {
+            live->packets_received++;
+            live->bytes_received += n;
+            live_recv.end();
+        }
+        if (interval_log.is_running()) {
+            interval_log.add_packet(n);
+        }
+
+        FragmentHeader fragment;
+        if (layout.enabled() && PacketHandler::parse_fragment_header(data, n, fragment)) {
+
+
+            reassembler.evict_expired(recv_time);
+            const ReassembledMessage* message = reassembler.add_fragment(
+                fragment.message_id, fragment.index, send_ts, intended_ts, recv_time,
+                data + FragmentLayout::header_size(), n - FragmentLayout::header_size());
+            if (message) {
+                int64_t offset_ns = reliability.get_clock_offset_ns(message->first_send_ts);
+                logger.log_receiver_data(message->message_id, recv_time, message->first_send_ts, offset_ns,
+                                         message->intended_ts);
+                stats.add_packet_received(layout.message_size);
+                stats.add_latency_measurement(message->first_send_ts + offset_ns, recv_time,
+                                              message->intended_ts + offset_ns);
+                publish_message(message->first_send_ts + offset_ns, recv_time);
+            }
+        } else if (coalesced && PacketHandler::parse_batch_packet(data, n, batch)) {
+
+
+            coalescing.add_datagram(send_ts, batch.data(), batch.size());
+            for (const BatchEntry& message : batch) {
+                int64_t offset_ns = reliability.get_clock_offset_ns(message.ts);
+                logger.log_receiver_data(message.seq, recv_time, message.ts, offset_ns, message.intended_ts);
+                stats.add_packet_received(reliability.get_session().msg_size);
+                stats.add_latency_measurement(message.ts + offset_ns, recv_time, message.intended_ts + offset_ns);
+                publish_message(message.ts + offset_ns, recv_time);
+            }
+        } else {
+            int64_t offset_ns = reliability.get_clock_offset_ns(send_ts);
+            if (kernel_timestamps) {
+                rx_stamps.add(seq, send_ts, kernel_rx_ns, recv_time);
+            }
+            logger.log_receiver_data(seq, recv_time, send_ts, offset_ns, intended_ts, kernel_rx_ns);
+            stats.add_packet_received(n);
+            if (!reliability.is_echo_mode()) {
+                stats.add_latency_measurement(send_ts + offset_ns, recv_time, intended_ts + offset_ns);
+            }
+            publish_message(send_ts + offset_ns, recv_time);
+        }
+    };
+
+    Packet recovered;
+    auto deliver_recovered = [&]() {
+        while (reliability.take_recovered(recovered)) {
+            deliver(recovered.data(), recovered.size(), get_timestamp_ns(), 0);
+        }
+    };
+
+    timestamp_t last_packet_ns = get_timestamp_ns();
+    timestamp_t idle_timeout_ns = static_cast<timestamp_t>(config::RECEIVER_IDLE_TIMEOUT_MS) * 1000000;
+    while (!g_stop_requested) {
+        UDP_TRACE_POLL();
+
+
+        // Every pass, so a steady stream cannot hold off an ACK that is due.
+        reliability.on_ack_timer();
+        int64_t timeout_us = reliability.get_ack_timeout_us();
+
+        if (timeout_us > 0) {
+            timeout_us = timeout_us > config::ACK_TIMER_SPIN_US ? timeout_us - config::ACK_TIMER_SPIN_US : 0;
+        }
+
+
+        if (reliability.is_finished()) {
+            timeout_us = static_cast<int64_t>(config::FIN_LINGER_MS) * 1000;
+        } else if (reliability.has_session()) {
+            timestamp_t idle_ns = get_timestamp_ns() - last_packet_ns;
+            if (idle_ns >= idle_timeout_ns) {
+                std::cerr << "Warning: nothing from the sender for " << config::RECEIVER_IDLE_TIMEOUT_MS
+                          << " ms; giving up before its FIN\n";
+                break;
+            }
+            int64_t idle_left_us = static_cast<int64_t>((idle_timeout_ns - idle_ns + 999) / 1000);
+            if (timeout_us < 0 || timeout_us > idle_left_us) {
+                timeout_us = idle_left_us;
+            }
+        }
+
+        int path = path_sockets.empty() ? (socket.wait_readable(timeout_us) ? 0 : -1)
+                                        : NetworkUtils::wait_any_readable(path_fds, next_path, timeout_us);
+        if (path < 0) {
+            if (reliability.is_finished()) {
+                break;
+            }
+            publish_ack_counts(get_timestamp_ns());
+            continue;
+        }
+        next_path = (static_cast<size_t>(path) + 1) % path_fds.size();
+
+        timestamp_t kernel_rx_ns = 0;
+        Socket& path_socket = path == 0 ? static_cast<Socket&>(socket) : *path_sockets[path - 1];
+        ssize_t n = path_socket.recv_from(buf.data(), buf.size(), &sender_addr, &kernel_rx_ns);
+        if (n <= 0) continue;
+
+        timestamp_t recv_time = get_timestamp_ns();
+        last_packet_ns = recv_time;
+        recv_perf.add_packets();
+
+        ControlType control_type;
+        if (PacketHandler::parse_control_type(buf.data(), n, control_type)) {
+            if (control_type == ControlType::TX_TIMESTAMPS) {
+                if (kernel_timestamps && reliability.is_session_peer(sender_addr) &&
+                    PacketHandler::parse_tx_timestamps_packet(buf.data(), n, tx_report)) {
+                    for (const TxTimestampEntry& entry : tx_report) {
+                        timestamp_t send_ts;
+                        timestamp_t rx_ns;
+                        timestamp_t app_rx_ns;
+                        if (rx_stamps.take(entry.seq, send_ts, rx_ns, app_rx_ns)) {
+                            stages.add_packet(send_ts, entry.tx_ts, rx_ns, app_rx_ns,
+                                              reliability.get_clock_offset_ns(send_ts));
+                        }
+                    }
                 }
+                continue;
             }
 
-            reliability.send_ack_if_needed();
+            bool had_session = reliability.has_session();
+            reliability.process_control_packet(buf.data(), n, sender_addr, static_cast<size_t>(path));
+            deliver_recovered();
+
+            if (!had_session && reliability.has_session()) {
+                const HelloFrame& session = reliability.get_session();
+                coalesced = (session.flags & HELLO_FLAG_COALESCED) != 0;
+                layout = FragmentLayout(session.msg_size, coalesced ? 0 : session.datagram_size);
+                size_t datagram_size = std::max(session.msg_size, session.datagram_size);
+                if (reliability.get_fec_code().enabled()) {
+                    datagram_size += FecCode::parity_overhead();
+                }
+                if (datagram_size > buf.size()) {
+                    buf.resize(std::min<size_t>(datagram_size, config::MAX_DATAGRAM_SIZE));
+                }
+                if (layout.enabled()) {
+                    reassembler.reset(layout, session.max_inflight, true, session.total_count);
+                }
+                if (coalesced) {
+                    batch.reserve(session.datagram_size / std::max<uint32_t>(session.msg_size, sizeof(PacketHeader)));
+                    coalescing.hold_delay.latencies.reserve(
+                        std::min<uint64_t>(session.total_count, config::MAX_PREALLOCATED_SAMPLES));
+                }
+                stats.reserve(session.total_count);
+                logger.set_run_id(session.run_id);
+                live_stats.set_session(session.run_id, session.total_count);
+                if (!interval_log_path.empty() &&
+                    !interval_log.start(interval_log_path, static_cast<uint32_t>(interval_ms),
+                                        static_cast<uint32_t>(LiveRole::RECEIVER), session.run_id, [&]() {
+                                            ReceiveQualityStats quality = reliability.get_receive_quality();
+                                            IntervalTotals totals;
+                                            totals.duplicates = quality.duplicates;
+                                            totals.reordered = quality.reordered;
+                                            totals.loss_bursts = quality.loss_bursts;
+                                            totals.jitter_ns = static_cast<uint64_t>(quality.jitter_ns);
+                                            return totals;
+                                        })) {
+                    return 1;
+                }
+                if (perf_interval > 0) {
+                    if (recv_perf.open(perf_interval)) {
+                        recv_perf.begin_phase("receive");
+                    } else {
+                        std::cerr << "Warning: perf_event_open is not available; no CPU counters\n";
+                    }
+                }
+                if (session.flags & HELLO_FLAG_KERNEL_TIMESTAMPS) {
+                    kernel_timestamps = socket.enable_rx_timestamps();
+                    logger.set_kernel_timestamps(kernel_timestamps);
+                    stages.reserve(session.total_count);
+                }
+
+                char ip_str[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &sender_addr.sin_addr, ip_str, INET_ADDRSTRLEN);
+                std::cout << "Session " << std::hex << session.run_id << std::dec
+                          << " from " << ip_str << ":" << ntohs(sender_addr.sin_port)
+                          << " (" << session.total_count << " x " << session.msg_size << " bytes, window "
+                          << session.window_size << ", ACK every " << session.ack_period << " packets or "
+                          << session.max_ack_delay_us << " μs)\n";
+                if (reliability.is_echo_mode()) {
+                    std::cout << "Echo mode: answering each packet; round-trip latency is measured by the sender\n";
+                }
+                if (layout.enabled()) {
+                    std::cout << "Fragmented: " << layout.fragment_count << " fragments of up to "
+                              << layout.fragment_size << " bytes per message; latency is per whole message\n";
+                }
+                if (reliability.get_fec_code().enabled()) {
+                    std::cout << "FEC: " << reliability.get_fec_code().describe()
+                              << "; rebuilt packets are logged when they are rebuilt\n";
+                }
+                if (coalesced) {
+                    std::cout << "Coalesced: up to " << session.datagram_size
+                              << " bytes per datagram; latency is per message, including its hold time\n";
+                }
+                if (session.flags & HELLO_FLAG_KERNEL_TIMESTAMPS) {
+                    std::cout << (kernel_timestamps ? "Kernel timestamps: splitting latency at the kernel TX and RX stamps\n"
+                                                    : "Warning: kernel RX timestamps are not available here\n");
+                }
+            }
+            continue;
+        }
+
+        sequence_t seq;
+        timestamp_t send_ts;
+        if (PacketHandler::parse_data_packet(buf.data(), n, seq, send_ts)) {
+            UDP_TRACE_INSTANT(RECV, seq, n);
+            if (reliability.process_data_packet(buf.data(), n, sender_addr, static_cast<size_t>(path))) {
+                deliver(buf.data(), n, recv_time, kernel_rx_ns);
+            }
+            deliver_recovered();
+            publish_ack_counts(recv_time);
         }
     }
 
+    recv_perf.end_phase();
     stats.end_collection();
+    next_gauge_ns = 0;
+    publish_ack_counts(get_timestamp_ns());
+    interval_log.stop();
+    live_stats.finish();
+    logger.flush();
+
+    std::cout << "Receiver finished. Received " << reliability.get_received_count() << " unique packets";
+    if (reliability.get_stray_count() > 0) {
+        std::cout << " (rejected " << reliability.get_stray_count() << " stray packets)";
+    }
+    std::cout << ".\n";
+    if (interval_log.get_intervals_written() > 0) {
+        std::cout << "Wrote " << interval_log.get_intervals_written() << " intervals to " << interval_log_path << ".\n";
+    }
+    stats.print_final_summary();
+    if (layout.enabled()) {
+        reassembler.print_summary("Message Reassembly");
+    }
+    if (coalesced) {
+        coalescing.print_summary("Coalescing", stats.get_throughput_stats().get_duration_seconds());
+    }
+    if (kernel_timestamps) {
+        stages.print_summary("Latency Stages (kernel timestamps)");
+    }
+    reliability.get_ack_stats().print_summary("ACK Statistics", true);
+    reliability.get_receive_quality().print_summary("Receive Quality");
+    if (paths > 1) {
+        reliability.get_path_race().print_summary("Redundant Paths (first arrival wins)", port);
+    }
+    if (reliability.get_fec_code().enabled()) {
+        reliability.finish_fec();
+        reliability.get_fec_stats().print_summary("Forward Error Correction", reliability.get_fec_code());
+    }
+    reliability.get_clock_estimate().print_summary("Clock Sync");
+    recv_perf.print_summary("CPU Counters (receive thread)");
+    if (socket.is_impaired()) {
+        socket.get_stats().print_summary();
+    }
+    Tracer::dump();
     return 0;
 }
\ No newline at end of file
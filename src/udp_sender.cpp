@@ -1,23 +1,79 @@
 #include "udp_benchmark/network_utils.hpp"
+#include "udp_benchmark/impairment.hpp"
 #include "udp_benchmark/reliability.hpp"
 #include "udp_benchmark/congestion_control.hpp"
 #include "udp_benchmark/stats.hpp"
+#include "udp_benchmark/ping_pong.hpp"
+#include "udp_benchmark/rate_sweep.hpp"
+#include "udp_benchmark/multicast.hpp"
+#include "udp_benchmark/fragmentation.hpp"
+#include "udp_benchmark/coalescing.hpp"
+#include "udp_benchmark/traffic.hpp"
+#include "udp_benchmark/timestamping.hpp"
+#include "udp_benchmark/trace.hpp"
+#include "udp_benchmark/perf_counters.hpp"
+#include "udp_benchmark/interval_log.hpp"
+#include "udp_benchmark/live_stats.hpp"
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <unistd.h>
 
 using namespace udp_benchmark;
 
 int main(int argc, char** argv) {
     if (argc < 7) {
-        std::cerr << "Usage: " << argv[0] << " <recv_ip> <port> <msg_size> <rate_msgs/s> <total_msgs> <log.csv>\n";
+        std::cerr << "Usage: " << argv[0] << " <recv_ip> <port> <msg_size> <rate_msgs/s> <total_msgs> <log.csv> [options]\n";
         std::cerr << "Parameters:\n";
-        std::cerr << "  recv_ip:     IP address of the receiver (e.g., 127.0.0.1 for localhost)\n";
+        std::cerr << "  recv_ip:     IP address of the receiver (e.g., 127.0.0.1), or a multicast group (e.g., 239.1.1.1)\n";
         std::cerr << "  port:        UDP port number (e.g., 9000)\n";
-        std::cerr << "  msg_size:    Total message size in bytes (minimum 16 for headers)\n";
+        std::cerr << "  msg_size:    Total message size in bytes (minimum 24 for headers, up to " << config::MAX_MESSAGE_SIZE << " when fragmented)\n";
         std::cerr << "  rate_msgs/s: Target sending rate in messages per second\n";
         std::cerr << "  total_msgs:  Total number of messages to send\n";
         std::cerr << "  log.csv:     Path to output CSV log file\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --ack-period N      Ask the receiver to ACK every N packets (default " << config::DEFAULT_ACK_PERIOD << ")\n";
+        std::cerr << "  --ack-delay-us T    Ask the receiver to ACK at most T μs after a packet (default " << config::DEFAULT_MAX_ACK_DELAY_US << ")\n";
+        std::cerr << "  --run-id ID         Run identifier announced in the HELLO (default: random)\n";
+        std::cerr << "  --fragment-size N   Split larger messages into fragments of at most N bytes (default " << config::DEFAULT_FRAGMENT_SIZE << ", 0 = never)\n";
+        std::cerr << "  --coalesce-us T     Pack messages into shared datagrams, holding each at most T μs\n";
+        std::cerr << "  --coalesce-bytes N  Largest coalesced datagram (default " << config::DEFAULT_COALESCE_BYTES << ")\n";
+        std::cerr << "  --traffic SPEC      Send pattern: constant, poisson, onoff:BURST:GAP_US or trace:PATH (default constant)\n";
+        std::cerr << "  --min-msg-size N    Vary message sizes uniformly between N and msg_size\n";
+        std::cerr << "  --ping-pong N       Request/response mode: receiver echoes, N requests outstanding\n";
+        std::cerr << "  --sweep MAX[:F]     Step the rate from rate_msgs/s up to MAX by factor F (default 2)\n";
+        std::cerr << "  --step-ms T         Duration of each sweep step (default " << config::SWEEP_STEP_MS << ")\n";
+        std::cerr << "  --slo-p99-us X      Stop the sweep at the first step whose p99 RTT exceeds X μs\n";
+        std::cerr << "  --sweep-out PATH    Write the sweep table to PATH (.json for JSON, otherwise CSV)\n";
+        std::cerr << "  --subscribers N     Multicast: wait for N subscribers before sending (default 1)\n";
+        std::cerr << "  --ttl N             Multicast: TTL of group datagrams (default " << config::MULTICAST_DEFAULT_TTL << ")\n";
+        std::cerr << "  --mcast-loop 0|1    Multicast: deliver to subscribers on this host (default 1)\n";
+        std::cerr << "  --mcast-if IP       Multicast: send from the interface with this address\n";
+        std::cerr << "  --kernel-timestamps 0|1  Split latency into stages with kernel TX/RX timestamps (default 0)\n";
+        std::cerr << "  --impair SPEC       Impair outgoing datagrams in userspace, e.g. delay=1000,jitter=200,loss=0.1\n";
+        std::cerr << "  --paths K           Send every data packet on K paths, to ports port..port+K-1, and let the\n";
+        std::cerr << "                      first copy win (default 1, at most " << config::MAX_PATHS << ")\n";
+        std::cerr << "  --path-src IP,...   Send path i from the i-th local address, to pick its interface\n";
+        std::cerr << "  --path-impair I:SPEC  Impair path I with SPEC instead of --impair (repeatable)\n";
+        std::cerr << "  --fec K:M           Follow every K data packets with M parity packets, so the receiver can\n";
+        std::cerr << "                      rebuild up to M losses without a retransmission (M = 1 is XOR parity)\n";
+        std::cerr << "  --perf-counters N   Count cycles, instructions, cache/branch misses and context switches in the\n";
+        std::cerr << "                      send and ACK threads, per phase and per N packets (default off)\n";
+        std::cerr << "  --live-stats NAME   Publish live counters for udp_stat as NAME, or off (default sender.PID)\n";
+        std::cerr << "  --interval-log PATH Append an RTT histogram, throughput, losses and retransmits to PATH every\n";
+        std::cerr << "                      interval, for long runs (read with udp_stat --interval-log)\n";
+        std::cerr << "  --interval-ms T     Length of each --interval-log interval (default " << config::INTERVAL_LOG_DEFAULT_MS << ")\n";
+        std::cerr << "  --trace PATH        Record hot-path events and write them to PATH as Chrome trace JSON at exit\n";
+        std::cerr << "                      and on SIGUSR1 (needs a build with TRACE=1)\n";
+        std::cerr << "  --clock auto|steady Timestamp source: the invariant TSC when available, or steady_clock (default auto)\n";
+        std::cerr << "  --clock-offset-ns N Add a synthetic N ns offset to this host's clock (testing)\n";
+        std::cerr << "  --clock-drift-ppm D Add a synthetic D ppm drift to this host's clock (testing)\n";
         return 1;
     }
 
@@ -27,37 +83,425 @@ int main(int argc, char** argv) {
     double rate = std::atof(argv[4]);
     uint64_t total_msgs = std::strtoull(argv[5], nullptr, 10);
     std::string logfile = argv[6];
+    uint32_t ack_period = config::DEFAULT_ACK_PERIOD;
+    uint32_t ack_delay_us = config::DEFAULT_MAX_ACK_DELAY_US;
+    uint64_t run_id = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ get_timestamp_ns();
+    int64_t clock_offset_ns = 0;
+    double clock_drift_ppm = 0.0;
+    bool allow_tsc = true;
+    std::string trace_path;
+    std::string live_stats_name = "sender." + std::to_string(getpid());
+    std::string interval_log_path;
+    int interval_ms = config::INTERVAL_LOG_DEFAULT_MS;
+    ImpairmentConfig impairment;
+    uint32_t ping_pong = 0;
+    SweepConfig sweep_config;
+    std::string sweep_out;
+    uint32_t subscribers = 1;
+    int multicast_ttl = config::MULTICAST_DEFAULT_TTL;
+    bool multicast_loop = true;
+    std::string multicast_if;
+    int fragment_size = config::DEFAULT_FRAGMENT_SIZE;
+    int64_t coalesce_us = -1;
+    int coalesce_bytes = config::DEFAULT_COALESCE_BYTES;
+    TrafficConfig traffic;
+    int min_msg_size = 0;
+    bool kernel_timestamps = false;
+    uint64_t perf_interval = 0;
+    uint32_t paths = 1;
+    std::vector<std::string> path_sources;
+    std::vector<std::pair<size_t, ImpairmentConfig>> path_impairment_overrides;
+    FecCode fec;
+
+    if ((argc - 7) % 2 != 0) {
+        std::cerr << "Error: " << argv[argc - 1] << " needs a value\n";
+        return 1;
+    }
+    for (int i = 7; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--ack-period") == 0) {
+            ack_period = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ack-delay-us") == 0) {
+            ack_delay_us = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--run-id") == 0) {
+            run_id = std::strtoull(argv[i + 1], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--fragment-size") == 0) {
+            fragment_size = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--coalesce-us") == 0) {
+            coalesce_us = std::strtoll(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--coalesce-bytes") == 0) {
+            coalesce_bytes = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--traffic") == 0) {
+            if (!TrafficConfig::parse(argv[i + 1], traffic)) {
+                std::cerr << "Error: --traffic expects constant, poisson, onoff:BURST:GAP_US or trace:PATH\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--min-msg-size") == 0) {
+            min_msg_size = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--ping-pong") == 0) {
+            ping_pong = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            if (!SweepConfig::parse(argv[i + 1], sweep_config)) {
+                std::cerr << "Error: --sweep expects MAX_RATE[:FACTOR] with FACTOR > 1\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--step-ms") == 0) {
+            sweep_config.step_ms = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--slo-p99-us") == 0) {
+            sweep_config.slo_p99_us = std::atof(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--sweep-out") == 0) {
+            sweep_out = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--subscribers") == 0) {
+            subscribers = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ttl") == 0) {
+            multicast_ttl = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--mcast-loop") == 0) {
+            multicast_loop = std::atoi(argv[i + 1]) != 0;
+        } else if (std::strcmp(argv[i], "--mcast-if") == 0) {
+            multicast_if = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--perf-counters") == 0) {
+            perf_interval = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--kernel-timestamps") == 0) {
+            kernel_timestamps = std::atoi(argv[i + 1]) != 0;
+        } else if (std::strcmp(argv[i], "--impair") == 0) {
+            if (!ImpairmentConfig::parse(argv[i + 1], impairment)) {
+                std::cerr << "Error: invalid --impair spec " << argv[i + 1] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--paths") == 0) {
+            paths = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--path-src") == 0) {
+            std::stringstream list(argv[i + 1]);
+            std::string source;
+            while (std::getline(list, source, ',')) {
+                path_sources.push_back(source);
+            }
+        } else if (std::strcmp(argv[i], "--path-impair") == 0) {
+            const char* colon = std::strchr(argv[i + 1], ':');
+            size_t path = colon ? std::strtoul(argv[i + 1], nullptr, 10) : config::MAX_PATHS;
+            ImpairmentConfig path_impairment;
+            if (path >= config::MAX_PATHS || !ImpairmentConfig::parse(colon + 1, path_impairment)) {
+                std::cerr << "Error: --path-impair expects PATH:SPEC, e.g. 1:loss=5\n";
+                return 1;
+            }
+            path_impairment_overrides.emplace_back(path, path_impairment);
+        } else if (std::strcmp(argv[i], "--fec") == 0) {
+            if (!FecCode::parse(argv[i + 1], fec)) {
+                std::cerr << "Error: --fec expects K:M with 1 to " << config::FEC_MAX_DATA << " data and 1 to "
+                          << config::FEC_MAX_PARITY << " parity packets per block\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            trace_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--live-stats") == 0) {
+            live_stats_name = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--interval-log") == 0) {
+            interval_log_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--interval-ms") == 0) {
+            interval_ms = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--clock") == 0) {
+            if (std::strcmp(argv[i + 1], "auto") != 0 && std::strcmp(argv[i + 1], "steady") != 0) {
+                std::cerr << "Error: --clock must be auto or steady\n";
+                return 1;
+            }
+            allow_tsc = std::strcmp(argv[i + 1], "auto") == 0;
+        } else if (std::strcmp(argv[i], "--clock-offset-ns") == 0) {
+            clock_offset_ns = std::strtoll(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--clock-drift-ppm") == 0) {
+            clock_drift_ppm = std::atof(argv[i + 1]);
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
 
     if (msg_size < config::MIN_MESSAGE_SIZE) {
         std::cerr << "Error: msg_size must be at least " << config::MIN_MESSAGE_SIZE << " bytes for headers\n";
         return 1;
     }
 
+    if (fragment_size != 0 && (fragment_size < config::MIN_FRAGMENT_SIZE || fragment_size > config::MAX_DATAGRAM_SIZE)) {
+        std::cerr << "Error: --fragment-size must be 0 or between " << config::MIN_FRAGMENT_SIZE << " and "
+                  << config::MAX_DATAGRAM_SIZE << " bytes\n";
+        return 1;
+    }
+
+    if (msg_size > config::MAX_MESSAGE_SIZE) {
+        std::cerr << "Error: msg_size must be at most " << config::MAX_MESSAGE_SIZE << " bytes\n";
+        return 1;
+    }
+
+    if (sweep_config.enabled() && ping_pong > 0) {
+        std::cerr << "Error: --sweep cannot be combined with --ping-pong\n";
+        return 1;
+    }
+
+    if (!interval_log_path.empty() && interval_ms <= 0) {
+        std::cerr << "Error: --interval-ms must be positive\n";
+        return 1;
+    }
+
+    if (sweep_config.enabled() && sweep_config.step_ms <= 0) {
+        std::cerr << "Error: --step-ms must be positive\n";
+        return 1;
+    }
+
+    // total_msgs caps the whole sweep.
+    sweep_config.start_rate = rate;
+    RateSweep sweep(sweep_config);
+    if (sweep_config.enabled()) {
+        if (total_msgs < sweep.get_planned_messages()) {
+            std::cerr << "Error: the sweep needs " << sweep.get_planned_messages()
+                      << " messages for all its steps; raise total_msgs or shorten --step-ms\n";
+            return 1;
+        }
+        total_msgs = sweep.get_planned_messages();
+    }
+
+    if (run_id == 0) {
+        run_id = 1;
+    }
+
+    init_time_source(allow_tsc);
+    if (!trace_path.empty()) {
+#ifdef UDP_BENCHMARK_TRACING
+        Tracer::enable(trace_path);
+        UDP_TRACE_THREAD("send");
+#else
+        std::cerr << "Error: --trace needs a build with tracing (make TRACE=1)\n";
+        return 1;
+#endif
+    }
+    inject_clock_skew(clock_offset_ns, clock_drift_ppm);
+
     if (!NetworkUtils::is_valid_ip(recv_ip) || !NetworkUtils::is_valid_port(port)) {
         std::cerr << "Error: Invalid IP address or port\n";
         return 1;
     }
 
+    sockaddr_in peer_addr;
+    if (!NetworkUtils::parse_address(recv_ip, port, peer_addr)) {
+        std::cerr << "Failed to parse address\n";
+        return 1;
+    }
+
+    bool multicast = NetworkUtils::is_multicast(peer_addr);
+    if (multicast && (ping_pong > 0 || sweep_config.enabled())) {
+        std::cerr << "Error: a multicast group cannot be combined with --ping-pong or --sweep\n";
+        return 1;
+    }
+
+    if (multicast && !interval_log_path.empty()) {
+        std::cerr << "Error: --interval-log cannot be combined with a multicast group\n";
+        return 1;
+    }
+
+    if (paths < 1 || paths > config::MAX_PATHS || !NetworkUtils::is_valid_port(port + static_cast<int>(paths) - 1)) {
+        std::cerr << "Error: --paths must be between 1 and " << config::MAX_PATHS
+                  << ", with every port up to port+K-1 valid\n";
+        return 1;
+    }
+
+    if (paths > 1 && (multicast || ping_pong > 0 || kernel_timestamps)) {
+        std::cerr << "Error: --paths cannot be combined with multicast, --ping-pong or --kernel-timestamps\n";
+        return 1;
+    }
+
+    if (path_sources.size() > paths) {
+        std::cerr << "Error: --path-src lists more addresses than --paths\n";
+        return 1;
+    }
+
+
+    std::vector<ImpairmentConfig> path_impairments(paths, impairment);
+    for (uint32_t path = 1; path < paths; ++path) {
+        path_impairments[path].seed += path;
+    }
+    for (const auto& [path, path_impairment] : path_impairment_overrides) {
+        if (path >= paths) {
+            std::cerr << "Error: --path-impair names path " << path << " of " << paths << "\n";
+            return 1;
+        }
+        path_impairments[path] = path_impairment;
+    }
+
+
+    bool whole_messages = ping_pong > 0 || sweep_config.enabled() || multicast;
+    FragmentLayout layout(static_cast<uint32_t>(msg_size), whole_messages ? 0 : static_cast<uint32_t>(fragment_size));
+    if (!layout.enabled() && msg_size > config::MAX_DATAGRAM_SIZE) {
+        std::cerr << "Error: msg_size above " << config::MAX_DATAGRAM_SIZE << " bytes must be fragmented, "
+                  << "which needs --fragment-size > 0 and no --ping-pong, --sweep or multicast\n";
+        return 1;
+    }
+
+    bool coalesce = coalesce_us >= 0;
+    if (coalesce && (whole_messages || layout.enabled())) {
+        std::cerr << "Error: --coalesce-us cannot be combined with --ping-pong, --sweep, multicast or fragmentation\n";
+        return 1;
+    }
+
+    if (coalesce && (coalesce_bytes > config::MAX_DATAGRAM_SIZE ||
+                     PacketHandler::batch_packet_size(1, msg_size) > static_cast<size_t>(coalesce_bytes))) {
+        std::cerr << "Error: --coalesce-bytes must hold at least one " << msg_size << " byte message ("
+                  << PacketHandler::batch_packet_size(1, msg_size) << " bytes) and be at most "
+                  << config::MAX_DATAGRAM_SIZE << "\n";
+        return 1;
+    }
+
+    traffic.rate = rate;
+    traffic.max_size = static_cast<uint32_t>(msg_size);
+    traffic.min_size = min_msg_size > 0 ? static_cast<uint32_t>(min_msg_size) : traffic.max_size;
+    if (min_msg_size != 0 && (min_msg_size < config::MIN_MESSAGE_SIZE || min_msg_size > msg_size)) {
+        std::cerr << "Error: --min-msg-size must be between " << config::MIN_MESSAGE_SIZE << " and msg_size\n";
+        return 1;
+    }
+
+    if (traffic.pattern == TrafficPattern::POISSON && rate <= 0) {
+        std::cerr << "Error: --traffic poisson needs a rate above 0\n";
+        return 1;
+    }
+
+
+    bool shaped = traffic.pattern != TrafficPattern::CONSTANT || traffic.varies_size();
+    if (shaped && sweep_config.enabled()) {
+        std::cerr << "Error: --traffic and --min-msg-size cannot be combined with --sweep\n";
+        return 1;
+    }
+
+    if (traffic.varies_size() && (whole_messages || layout.enabled() || coalesce)) {
+        std::cerr << "Error: varying message sizes need msg_size within one datagram and no --ping-pong, "
+                  << "multicast or --coalesce-us\n";
+        return 1;
+    }
+
+    if (perf_interval > 0 && multicast) {
+        std::cerr << "Error: --perf-counters covers the unicast send and ACK loops only\n";
+        return 1;
+    }
+
+    if (kernel_timestamps && (ping_pong > 0 || multicast || layout.enabled() || coalesce)) {
+        std::cerr << "Error: --kernel-timestamps needs one message per datagram and no --ping-pong, multicast "
+                  << "or --coalesce-us\n";
+        return 1;
+    }
+
+    if (fec.enabled() && (multicast || ping_pong > 0 || paths > 1 || kernel_timestamps)) {
+        std::cerr << "Error: --fec cannot be combined with multicast, --ping-pong, --paths or --kernel-timestamps\n";
+        return 1;
+    }
+
+    size_t largest_datagram = coalesce ? static_cast<size_t>(coalesce_bytes)
+                                       : layout.enabled() ? layout.fragment_size : msg_size;
+    if (fec.enabled() && largest_datagram + FecCode::parity_overhead() > config::MAX_DATAGRAM_SIZE) {
+        std::cerr << "Error: --fec needs datagrams of at most " << config::MAX_DATAGRAM_SIZE - FecCode::parity_overhead()
+                  << " bytes, so that their parity fits in one\n";
+        return 1;
+    }
+
+    std::unique_ptr<TrafficGenerator> traffic_generator;
+    if (shaped) {
+        traffic_generator = TrafficGenerator::create(traffic);
+        if (!traffic_generator) {
+            return 1;
+        }
+        if (traffic_generator->get_message_count() > 0) {
+            total_msgs = std::min(total_msgs, traffic_generator->get_message_count());
+        }
+    }
+
+    LiveStats live_stats;
+    if (live_stats_name != "off" && !multicast &&
+        !live_stats.create(live_stats_name, LiveRole::SENDER, run_id, total_msgs)) {
+        return 1;
+    }
+
     std::cout << "UDP Sender configuration:\n";
     std::cout << "  Target: " << recv_ip << ":" << port << "\n";
     std::cout << "  Message size: " << msg_size << " bytes\n";
+    if (layout.enabled()) {
+        std::cout << "  Fragmentation: " << layout.fragment_count << " fragments of up to " << layout.fragment_size
+                  << " bytes per message\n";
+    }
+    if (coalesce) {
+        std::cout << "  Coalescing: up to " << coalesce_bytes << " bytes per datagram, held at most "
+                  << coalesce_us << " μs\n";
+    }
     std::cout << "  Target rate: " << static_cast<int>(rate) << " msgs/sec\n";
+    if (traffic_generator) {
+        std::cout << "  Traffic: " << traffic.describe() << "\n";
+    }
     std::cout << "  Total messages: " << total_msgs << "\n";
+    if (sweep_config.enabled()) {
+        std::cout << "  Sweep: up to " << static_cast<int>(sweep_config.max_rate) << " msgs/sec, x"
+                  << sweep_config.factor << " per " << sweep_config.step_ms << " ms step";
+        if (sweep_config.slo_p99_us > 0) {
+            std::cout << ", p99 SLO " << sweep_config.slo_p99_us << " μs";
+        }
+        std::cout << "\n";
+    }
+    if (ping_pong > 0) {
+        std::cout << "  Mode: ping-pong, " << ping_pong << " outstanding\n";
+    } else if (multicast) {
+        std::cout << "  Mode: multicast to " << subscribers << " subscriber(s), TTL " << multicast_ttl
+                  << ", loopback " << (multicast_loop ? "on" : "off") << ", NACK repair\n";
+    } else {
+        std::cout << "  ACK policy: every " << ack_period << " packets or " << ack_delay_us << " μs\n";
+    }
+    if (kernel_timestamps) {
+        std::cout << "  Kernel timestamps: TX_SCHED/TX_SOFTWARE here, RX_SOFTWARE at the receiver\n";
+    }
+    std::cout << "  Clock: " << describe_time_source() << "\n";
+    std::cout << "  Run ID: " << std::hex << run_id << std::dec << "\n";
     std::cout << "  Logging to: " << logfile << "\n";
-
-    Socket socket(NetworkUtils::create_udp_socket());
-    if (!socket.is_valid()) {
-        std::cerr << "Failed to create socket\n";
-        return 1;
+    if (live_stats.is_open()) {
+        std::cout << "  Live stats: udp_stat " << live_stats_name << "\n";
+    }
+    if (!interval_log_path.empty()) {
+        std::cout << "  Interval log: " << interval_log_path << ", every " << interval_ms << " ms\n";
+    }
+    if (impairment.enabled()) {
+        std::cout << "  Impairment: " << impairment.describe() << "\n";
+    }
+    if (fec.enabled()) {
+        std::cout << "  FEC: " << fec.describe() << "\n";
+    }
+    if (paths > 1) {
+        std::cout << "  Paths: " << paths << ", to ports " << port << "-" << port + static_cast<int>(paths) - 1
+                  << ", every data packet on each\n";
+        for (uint32_t path = 0; path < paths; ++path) {
+            if (path < path_sources.size() || path_impairments[path].enabled()) {
+                std::cout << "    Path " << path << ": from "
+                          << (path < path_sources.size() ? path_sources[path] : std::string("any address"))
+                          << (path_impairments[path].enabled() ? ", " + path_impairments[path].describe() : "")
+                          << "\n";
+            }
+        }
     }
 
-    socket.configure_buffers();
-    socket.set_nonblocking();
-    socket.set_reuseaddr();
 
-    sockaddr_in peer_addr;
-    if (!NetworkUtils::parse_address(recv_ip, port, peer_addr)) {
-        std::cerr << "Failed to parse address\n";
+    // Path 0 carries the session and its control traffic.
+    std::vector<std::unique_ptr<ImpairedSocket>> path_sockets;
+    for (uint32_t path = 0; path < paths; ++path) {
+        path_sockets.push_back(std::make_unique<ImpairedSocket>(NetworkUtils::create_udp_socket(),
+                                                                path_impairments[path]));
+        ImpairedSocket& path_socket = *path_sockets.back();
+        if (!path_socket.is_valid()) {
+            std::cerr << "Failed to create socket\n";
+            return 1;
+        }
+        path_socket.configure_buffers();
+        path_socket.set_nonblocking();
+        path_socket.set_reuseaddr();
+
+        sockaddr_in source_addr;
+        if (path < path_sources.size() && (!NetworkUtils::parse_address(path_sources[path], 0, source_addr) ||
+                                           !path_socket.bind(source_addr))) {
+            std::cerr << "Error: cannot send path " << path << " from " << path_sources[path] << "\n";
+            return 1;
+        }
+    }
+    ImpairedSocket& socket = *path_sockets[0];
+    if (kernel_timestamps && !socket.enable_tx_timestamps()) {
+        std::cerr << "Error: kernel TX timestamps (SO_TIMESTAMPING) are not available here\n";
         return 1;
     }
 
@@ -66,69 +510,647 @@ int main(int argc, char** argv) {
         std::cerr << "Failed to open log file\n";
         return 1;
     }
+    logger.set_run_id(run_id);
+    logger.set_kernel_timestamps(kernel_timestamps);
+
+    RateLimiter rate_limiter(rate);
+    rate_limiter.set_generator(traffic_generator.get());
+    if (multicast) {
+        socket.set_multicast_ttl(multicast_ttl);
+        socket.set_multicast_loop(multicast_loop);
+        if (!multicast_if.empty() && !socket.set_multicast_interface(multicast_if)) {
+            return 1;
+        }
+
+        HelloFrame hello{};
+        hello.run_id = run_id;
+        hello.total_count = total_msgs;
+        hello.msg_size = static_cast<uint32_t>(msg_size);
+
+        MulticastSender sender(&socket, peer_addr, msg_size, subscribers);
+        if (!sender.announce(hello)) {
+            std::cerr << "Error: no subscriber answered on " << recv_ip << ":" << port
+                      << " after " << config::HELLO_TIMEOUT_MS << " ms\n";
+            return 1;
+        }
+        std::cout << sender.get_subscribers().size() << " subscriber(s) joined; per-packet latency is logged by the receivers\n";
+        std::cout << "Starting to send messages...\n";
+
+        timestamp_t start = get_timestamp_ns();
+        sender.run(total_msgs, rate_limiter);
+        double send_seconds = timestamp_diff_us(start, get_timestamp_ns()) / 1e6;
+        std::cout << "All messages sent in " << std::fixed << std::setprecision(2) << send_seconds
+                  << " s (" << (send_seconds > 0 ? total_msgs / send_seconds : 0.0) << " msgs/sec). Draining with FIN...\n";
+        if (!sender.drain(total_msgs)) {
+            std::cerr << "Warning: " << sender.get_subscribers().size() - sender.get_fin_acked_count()
+                      << " subscriber(s) sent no FIN-ACK after " << config::DRAIN_TIMEOUT_MS << " ms\n";
+        }
+
+        sender.print_summary();
+        if (socket.is_impaired()) {
+            socket.get_stats().print_summary();
+        }
+        Tracer::dump();
+        return 0;
+    }
 
     SenderReliability reliability(&socket, peer_addr, msg_size);
+    reliability.set_fragment_layout(layout);
+    reliability.set_fec_code(fec);
+    for (uint32_t path = 1; path < paths; ++path) {
+        sockaddr_in path_addr = peer_addr;
+        path_addr.sin_port = htons(static_cast<uint16_t>(port + static_cast<int>(path)));
+        reliability.add_path(path_sockets[path].get(), path_addr);
+    }
     EnhancedCongestionController congestion_ctrl(1000, 5000, true);
     StatsCollector stats;
-    RateLimiter rate_limiter(rate);
-    ProgressReporter progress(total_msgs);
+    stats.reserve(total_msgs);
+
+    LiveStatsWriter live_send = live_stats.add_section("send");
+    LiveStatsWriter live_ack = live_stats.add_section("ack");
+
+    IntervalRecorder interval_log;
+
+    StatsCollector step_stats;
+    std::atomic<timestamp_t> measure_from{UINT64_MAX};
+    std::atomic<timestamp_t> measure_until{0};
+    if (sweep_config.enabled()) {
+        step_stats.reserve(static_cast<uint64_t>(sweep_config.max_rate * sweep_config.step_ms / 1000.0));
+    }
 
-    reliability.set_ack_callback([&](sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits) {
-        logger.log_sender_data(seq, send_time, recv_time, retransmits);
-        stats.add_packet_received(msg_size);
-        congestion_ctrl.packet_acked();
+    std::unique_ptr<MessageCoalescer> coalescer;
+    if (coalesce) {
+        coalescer = std::make_unique<MessageCoalescer>(msg_size, coalesce_bytes, static_cast<uint32_t>(coalesce_us),
+                                                       config::MAX_CWND, total_msgs);
+        reliability.set_packet_builder([&](sequence_t seq, timestamp_t send_time, timestamp_t intended_time) {
+            return coalescer->build(seq, send_time, intended_time);
+        });
+    }
+
+    std::vector<uint32_t> message_sizes;
+    sequence_t size_mask = 0;
+    if (traffic.varies_size()) {
+        size_t slots = 1;
+        while (slots <= config::MAX_CWND) {
+            slots <<= 1;
+        }
+        message_sizes.assign(slots, static_cast<uint32_t>(msg_size));
+        size_mask = slots - 1;
+        reliability.set_packet_builder([&](sequence_t seq, timestamp_t send_time, timestamp_t intended_time) {
+            return PacketHandler::create_data_packet(seq, send_time, message_sizes[seq & size_mask], intended_time);
+        });
+    }
+    auto datagram_size = [&](sequence_t seq) -> size_t {
+        return message_sizes.empty() ? layout.datagram_size(layout.index_of(seq)) : message_sizes[seq & size_mask];
+    };
+
+    TxTimestampTable tx_stamps;
+    LatencyStages send_path;
+    std::vector<TxTimestampEntry> tx_report;
+    timestamp_t tx_report_due = 0;
+    if (kernel_timestamps) {
+        send_path.reserve(total_msgs);
+        tx_report.reserve(config::TX_REPORT_MAX_ENTRIES);
+    }
+
+    Reassembler acked_messages;
+    if (layout.enabled()) {
+        acked_messages.reset(layout, config::MAX_CWND, false, total_msgs);
+    }
+
+    reliability.set_ack_callback([&](sequence_t seq, timestamp_t send_time, timestamp_t recv_time, int retransmits,
+                                     timestamp_t intended_time) {
+        if (coalescer) {
+            stats.add_packet_received(coalescer->get_datagram_size(seq));
+            LiveValues* live = live_ack.begin();
+            coalescer->for_each_message(seq, [&](const BatchEntry& message) {
+                logger.log_sender_data(message.seq, message.ts, recv_time, retransmits, message.intended_ts);
+                if (live) {
+                    live_ack.add_latency(live, recv_time, recv_time - message.ts);
+                }
+                if (interval_log.is_running()) {
+                    interval_log.add_latency(recv_time - message.ts);
+                }
+            });
+            if (interval_log.is_running()) {
+                interval_log.add_packet(coalescer->get_datagram_size(seq));
+            }
+            if (live) {
+                live->packets_received++;
+                live->bytes_received += coalescer->get_datagram_size(seq);
+                live_ack.end();
+            }
+            return;
+        }
+
+        uint32_t index = layout.index_of(seq);
+        stats.add_packet_received(datagram_size(seq));
+        if (LiveValues* live = live_ack.begin()) {
+            live->packets_received++;
+            live->bytes_received += datagram_size(seq);
+            live_ack.end();
+        }
+        if (interval_log.is_running()) {
+            interval_log.add_packet(datagram_size(seq));
+        }
+        if (layout.enabled()) {
+            acked_messages.evict_expired(recv_time);
+            const ReassembledMessage* message = acked_messages.add_fragment(
+                layout.message_of(seq), index, send_time, intended_time, recv_time, nullptr, 0, retransmits);
+            if (!message) {
+                return;
+            }
+            seq = message->message_id;
+            send_time = message->first_send_ts;
+            intended_time = message->intended_ts;
+            retransmits = message->retransmits;
+        }
+
+        timestamp_t tx_sched_ns = 0;
+        timestamp_t tx_ns = 0;
+        if (kernel_timestamps && tx_stamps.find(seq, tx_sched_ns, tx_ns) && retransmits == 0) {
+            send_path.add_send_path(send_time, tx_sched_ns, tx_ns);
+            if (tx_report.empty()) {
+                tx_report_due = recv_time + static_cast<timestamp_t>(config::TX_REPORT_INTERVAL_US) * 1000;
+            }
+            tx_report.push_back({seq, tx_ns});
+        }
+        logger.log_sender_data(seq, send_time, recv_time, retransmits, intended_time, tx_sched_ns, tx_ns);
+        if (LiveValues* live = live_ack.begin()) {
+            live_ack.add_latency(live, recv_time, recv_time - send_time);
+            live_ack.end();
+        }
+        if (interval_log.is_running()) {
+            interval_log.add_latency(recv_time - send_time);
+        }
+        if (send_time >= measure_from.load(std::memory_order_relaxed) &&
+            send_time < measure_until.load(std::memory_order_relaxed)) {
+            step_stats.add_latency_measurement(send_time, recv_time, intended_time);
+        }
     });
+    reliability.set_congestion_controller(&congestion_ctrl);
+
+    auto send_tx_report = [&]() {
+        if (!tx_report.empty()) {
+            Packet packet = PacketHandler::create_tx_timestamps_packet(tx_report.data(), tx_report.size());
+            socket.send_to(packet.data(), packet.size(), peer_addr);
+            tx_report.clear();
+        }
+    };
+
+
+    // Stamps are collected before any ACK is handled.
+    auto collect_tx_timestamps = [&]() {
+        TxTimestamp stamps[64];
+        size_t count;
+        while ((count = socket.read_tx_timestamps(stamps, 64)) > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (stamps[i].seq != config::CONTROL_MARKER) {
+                    tx_stamps.add(stamps[i]);
+                }
+            }
+        }
+        if (tx_report.size() >= config::TX_REPORT_MAX_ENTRIES ||
+            (!tx_report.empty() && get_timestamp_ns() >= tx_report_due)) {
+            send_tx_report();
+        }
+    };
+
+    PerfProfile send_perf;
+    PerfProfile ack_perf;
+    if (perf_interval > 0 && !send_perf.open(perf_interval)) {
+        std::cerr << "Warning: perf_event_open is not available; no CPU counters\n";
+    }
+
+    timestamp_t next_gauge_ns = 0;
+    auto publish_ack_gauges = [&](timestamp_t now) {
+        if (!live_ack.is_enabled() || now < next_gauge_ns) {
+            return;
+        }
+        next_gauge_ns = now + static_cast<timestamp_t>(config::LIVE_STATS_GAUGE_US) * 1000;
+        LossStats losses = reliability.get_loss_stats();
+        timestamp_t srtt_ns = reliability.get_srtt_ns();
+        timestamp_t min_rtt_ns = reliability.get_min_rtt_ns();
+        LiveValues* live = live_ack.begin();
+        live->cwnd = congestion_ctrl.get_cwnd();
+        live->inflight = congestion_ctrl.get_inflight();
+        live->srtt_ns = srtt_ns;
+        live->min_rtt_ns = min_rtt_ns;
+        live->retransmits = losses.retransmits;
+        live->losses = losses.losses_detected;
+        live_ack.end();
+    };
 
     std::atomic<bool> running{true};
-    std::thread ack_thread([&]() {
+    auto ack_loop = [&]() {
+        UDP_TRACE_THREAD("ack");
+        if (send_perf.is_open() && ping_pong == 0 && ack_perf.open(perf_interval)) {
+            ack_perf.begin_phase("ACK loop");
+        }
         uint8_t buf[config::MAX_PACKET_SIZE];
         while (running) {
+            UDP_TRACE_POLL();
+            int64_t timeout_us = reliability.get_loss_timeout_us();
+            if (timeout_us < 0 || timeout_us > 1000) {
+                timeout_us = 1000;
+            }
+            bool readable = socket.wait_readable(timeout_us);
+            if (kernel_timestamps) {
+                collect_tx_timestamps();
+            }
+            publish_ack_gauges(get_timestamp_ns());
+            if (!readable) {
+                reliability.on_loss_timer();
+                continue;
+            }
             ssize_t n = socket.recv_from(buf, sizeof(buf));
-            if (n > 0) {
-                reliability.process_ack_packet(buf, n);
-                congestion_ctrl.on_ack_received_with_stats();
-            } else {
-                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ControlType control_type;
+            if (n > 0 && PacketHandler::parse_control_type(buf, n, control_type)) {
+                reliability.process_control_packet(buf, n);
+            } else if (n > 0 && ping_pong == 0) {
+                if (size_t acked = reliability.process_ack_packet(buf, n)) {
+                    congestion_ctrl.on_ack_received_with_stats(false, acked);
+                }
+                ack_perf.add_packets();
+                if (LiveValues* live = live_ack.begin()) {
+                    live->acks++;
+                    live_ack.end();
+                }
             }
         }
-    });
+        next_gauge_ns = 0;
+        publish_ack_gauges(get_timestamp_ns());
+        send_tx_report();
+        ack_perf.end_phase();
+    };
+    if (!interval_log_path.empty() &&
+        !interval_log.start(interval_log_path, static_cast<uint32_t>(interval_ms),
+                            static_cast<uint32_t>(LiveRole::SENDER), run_id, [&]() {
+                                LossStats losses = reliability.get_loss_stats();
+                                IntervalTotals totals;
+                                totals.losses = losses.losses_detected;
+                                totals.retransmits = losses.retransmits;
+                                return totals;
+                            })) {
+        return 1;
+    }
+    std::thread ack_thread(ack_loop);
 
     reliability.start();
+
+    HelloFrame hello;
+    hello.run_id = run_id;
+    hello.total_count = total_msgs;
+    hello.msg_size = static_cast<uint32_t>(msg_size);
+    hello.window_size = config::DEFAULT_WINDOW_SIZE;
+    hello.max_inflight = ping_pong > 0 ? 2 * ping_pong : static_cast<uint32_t>(config::MAX_CWND);
+    hello.ack_period = ack_period;
+    hello.max_ack_delay_us = ack_delay_us;
+    hello.flags = ping_pong > 0 ? static_cast<uint32_t>(HELLO_FLAG_ECHO) : 0;
+    hello.datagram_size = layout.enabled() ? layout.fragment_size : 0;
+    if (kernel_timestamps) {
+        hello.flags |= HELLO_FLAG_KERNEL_TIMESTAMPS;
+    }
+    if (coalesce) {
+        hello.flags |= HELLO_FLAG_COALESCED;
+        hello.datagram_size = static_cast<uint32_t>(coalesce_bytes);
+    }
+
+    send_perf.begin_phase("handshake");
+    timestamp_t hello_start = get_timestamp_ns();
+    timestamp_t hello_timeout_ns = static_cast<timestamp_t>(config::HELLO_TIMEOUT_MS) * 1000000;
+    auto session_ready = [&]() { return reliability.is_hello_acked() && reliability.are_paths_acked(); };
+    while (!session_ready() && get_timestamp_ns() - hello_start < hello_timeout_ns) {
+        reliability.send_hello(hello);
+        for (int waited_ms = 0; waited_ms < config::HELLO_RETRY_MS && !session_ready(); ++waited_ms) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            reliability.poll_paths();
+        }
+    }
+
+    if (!session_ready()) {
+        std::cerr << "Error: no HELLO-ACK from " << recv_ip << ":" << port;
+        if (reliability.is_hello_acked()) {
+            std::cerr << " on every path (is the receiver running with --paths " << paths << "?)";
+        }
+        std::cerr << " after " << config::HELLO_TIMEOUT_MS << " ms\n";
+        running = false;
+        ack_thread.join();
+        return 1;
+    }
+
+    std::cout << "Session established in " << std::fixed << std::setprecision(2)
+              << timestamp_diff_us(hello_start, get_timestamp_ns()) / 1000.0 << " ms\n";
     stats.start_collection();
 
     std::cout << "Starting to send messages...\n";
+    send_perf.begin_phase("send");
 
-    for (sequence_t seq = 1; seq <= total_msgs; ++seq) {
-        while (!congestion_ctrl.can_send()) {
+    PingPongStats ping_pong_stats;
+    if (ping_pong > 0) {
+
+        running = false;
+        ack_thread.join();
+
+        PingPongClient client(&socket, peer_addr, msg_size, ping_pong);
+        client.set_send_callback([&](sequence_t, timestamp_t) {
+            stats.add_packet_sent(msg_size);
+            send_perf.add_packets();
+            if (LiveValues* live = live_send.begin()) {
+                live->messages++;
+                live->packets_sent++;
+                live->bytes_sent += msg_size;
+                live_send.end();
+            }
+        });
+        client.set_rtt_callback([&](sequence_t seq, timestamp_t send_time, timestamp_t recv_time,
+                                    timestamp_t intended_time) {
+            logger.log_sender_data(seq, send_time, recv_time, 0, intended_time);
+            stats.add_packet_received(msg_size);
+            stats.add_latency_measurement(send_time, recv_time, intended_time);
+            if (LiveValues* live = live_send.begin()) {
+                live->packets_received++;
+                live->bytes_received += msg_size;
+                live_send.add_latency(live, recv_time, recv_time - send_time);
+                live_send.end();
+            }
+            if (interval_log.is_running()) {
+                interval_log.add_packet(msg_size);
+                interval_log.add_latency(recv_time - send_time);
+            }
+        });
+        client.set_control_callback([&](const uint8_t* data, size_t size) {
+            reliability.process_control_packet(data, size);
+        });
+        client.run(total_msgs, rate_limiter);
+        ping_pong_stats = client.get_stats();
+
+        running = true;
+        ack_thread = std::thread(ack_loop);
+    }
+
+    // A ring slot is reused only once the sequence that held it has been ACKed.
+    auto wait_for_slot = [&](sequence_t seq, size_t slots) {
+        while (seq > slots && reliability.is_packet_pending(seq - slots)) {
             std::this_thread::sleep_for(std::chrono::microseconds(10));
         }
+    };
 
-        rate_limiter.wait_for_next_send();
+    sequence_t datagram_seq = 0;
+    auto send_batch = [&](bool timer_expired) {
+        while (!congestion_ctrl.can_send()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+        wait_for_slot(datagram_seq + 1, coalescer->get_slot_count());
 
         timestamp_t send_time = get_timestamp_ns();
-        if (reliability.send_packet(seq, send_time)) {
+        timestamp_t intended_time = coalescer->flush(++datagram_seq, send_time, timer_expired);
+
+        // Counted before it leaves: its ACK can beat the return from send_packet.
+        congestion_ctrl.packet_sent();
+        bool sent = reliability.send_packet(datagram_seq, send_time, intended_time);
+        stats.add_packet_sent(coalescer->get_datagram_size(datagram_seq));
+        send_perf.add_packets();
+        if (LiveValues* live = live_send.begin()) {
+            live->packets_sent++;
+            live->bytes_sent += coalescer->get_datagram_size(datagram_seq);
+            live_send.end();
+        }
+        return sent;
+    };
+
+
+    auto wait_until = [](timestamp_t t) {
+        wait_until_ns(t, config::COALESCE_SPIN_US);
+    };
+
+
+    auto coalesce_next = [&](sequence_t message) {
+        bool sent = true;
+        while (!coalescer->empty() && rate_limiter.get_next_send_time() > coalescer->get_deadline()) {
+            wait_until(coalescer->get_deadline());
+            sent = send_batch(true);
+        }
+
+        wait_until(rate_limiter.get_next_send_time());
+        timestamp_t intended_time = rate_limiter.mark_sent();
+        timestamp_t produced = get_timestamp_ns();
+        if (LiveValues* live = live_send.begin()) {
+            live->messages++;
+            live_send.end();
+        }
+        if (coalescer->add(message, produced, intended_time)) {
+            sent = send_batch(false);
+        } else if (produced >= coalescer->get_deadline()) {
+            sent = send_batch(true);
+        }
+        return sent;
+    };
+
+
+    // Every fragment of a message shares its scheduled send time.
+    auto send_next = [&](sequence_t message) {
+        if (coalescer) {
+            return coalesce_next(message);
+        }
+
+        timestamp_t intended_time = 0;
+        bool sent = true;
+        for (uint32_t index = 0; index < layout.fragment_count; ++index) {
+            while (!congestion_ctrl.can_send()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+
+            sequence_t seq = layout.first_sequence(message) + index;
+            if (index == 0) {
+                if (!message_sizes.empty()) {
+                    wait_for_slot(seq, message_sizes.size());
+                    message_sizes[seq & size_mask] = rate_limiter.get_next_size();
+                }
+                intended_time = rate_limiter.wait_for_next_send();
+            }
+
+            timestamp_t send_time = get_timestamp_ns();
             congestion_ctrl.packet_sent();
-            stats.add_packet_sent(msg_size);
-            progress.increment();
-            
-            if (progress.get_progress_percentage() >= static_cast<int>(seq * 10 / total_msgs) * 10) {
-                progress.print_progress();
+            sent = reliability.send_packet(seq, send_time, intended_time) && sent;
+            stats.add_packet_sent(datagram_size(seq));
+            send_perf.add_packets();
+            if (LiveValues* live = live_send.begin()) {
+                live->messages += index + 1 == layout.fragment_count;
+                live->packets_sent++;
+                live->bytes_sent += datagram_size(seq);
+                live_send.end();
+            }
+        }
+        return sent;
+    };
+
+    sequence_t final_seq = total_msgs;
+    if (sweep_config.enabled()) {
+        sequence_t seq = 0;
+        while (sweep.has_next() && seq < total_msgs) {
+            SweepStep step;
+            step.offered_rate = sweep.get_next_rate();
+            rate_limiter.set_rate(step.offered_rate);
+            step_stats.reset();
+
+            timestamp_t step_start = get_timestamp_ns();
+            timestamp_t step_ns = static_cast<timestamp_t>(sweep_config.step_ms) * 1000000;
+            timestamp_t window_start = step_start + step_ns * config::SWEEP_WARMUP_PERCENT / 100;
+            timestamp_t step_end = step_start + step_ns;
+            measure_until = UINT64_MAX;
+
+
+            uint64_t datagrams_before = 0;
+            double cpu_before = 0;
+            bool measuring = false;
+            for (timestamp_t now = step_start; now < step_end && seq < total_msgs; now = get_timestamp_ns()) {
+                if (!measuring && now >= window_start) {
+                    measuring = true;
+                    window_start = now;
+                    measure_from = now;
+                    datagrams_before = stats.get_throughput_stats().packets_sent;
+                    cpu_before = RateSweep::get_cpu_seconds();
+                }
+                send_next(++seq);
+                step.sent += measuring;
+            }
+            timestamp_t window_end = get_timestamp_ns();
+            measure_until = window_end;
+            double window_s = measuring ? timestamp_diff_us(window_start, window_end) / 1e6 : 0.0;
+            double cpu_s = measuring ? RateSweep::get_cpu_seconds() - cpu_before : 0.0;
+            step.datagrams = measuring ? stats.get_throughput_stats().packets_sent - datagrams_before : 0;
+
+
+            // Any still unacknowledged after the drain count as lost.
+            timestamp_t drain_until = window_end + static_cast<timestamp_t>(config::SWEEP_DRAIN_MS) * 1000000;
+            while (reliability.get_pending_count() > 0 && get_timestamp_ns() < drain_until) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            measure_from = UINT64_MAX;
+
+            LatencyStats latency = step_stats.get_latency_stats();
+            step.measured = latency.packet_count;
+            step.achieved_rate = window_s > 0 ? step.sent / window_s : 0.0;
+            step.losses = step.datagrams - std::min(step.datagrams, step.measured);
+            step.p50_us = latency.get_percentile_latency_us(50.0);
+            step.p99_us = latency.get_percentile_latency_us(99.0);
+            step.p999_us = latency.get_percentile_latency_us(99.9);
+            step.corrected_p99_us = step_stats.get_corrected_latency_stats().get_percentile_latency_us(99.0);
+            step.cpu_percent = window_s > 0 ? cpu_s * 100.0 / window_s : 0.0;
+            sweep.record_step(step);
+
+            std::cout << std::fixed << std::setprecision(1) << "  Step " << sweep.get_steps().size() << ": "
+                      << step.offered_rate << " msgs/sec -> ";
+            if (step.has_data()) {
+                std::cout << "p99 " << step.p99_us << " μs, loss " << step.get_loss_percent() << "%\n";
+            } else {
+                std::cout << "no data (no ACK for the step's " << step.datagrams << " datagrams)\n";
             }
         }
+        final_seq = seq;
+    }
+
+    for (sequence_t seq = 1; ping_pong == 0 && !sweep_config.enabled() && seq <= total_msgs; ++seq) {
+        send_next(seq);
+    }
+
+    if (coalescer && !coalescer->empty()) {
+        send_batch(true);
     }
+    reliability.flush_fec();
+    sequence_t final_datagram = coalescer ? datagram_seq : layout.last_sequence(final_seq);
 
-    std::cout << "\n\nAll messages sent! Waiting for final ACKs...\n";
-    std::this_thread::sleep_for(std::chrono::seconds(2));
+    std::cout << "All messages sent! Draining with FIN...\n";
+    if (rate_limiter.get_stalls() > 0) {
+        std::cout << "  Pacer: " << rate_limiter.get_stalls() << " stalls of more than " << config::PACER_MAX_BURST
+                  << " messages; " << std::fixed << std::setprecision(2) << rate_limiter.get_skipped_ns() / 1e6
+                  << " ms of the schedule skipped instead of sent in a burst\n";
+    }
+    send_perf.begin_phase("drain");
+    timestamp_t drain_start = get_timestamp_ns();
+    timestamp_t drain_timeout_ns = static_cast<timestamp_t>(config::DRAIN_TIMEOUT_MS) * 1000000;
+    timestamp_t next_fin_time = 0;
 
+    while (!reliability.is_fin_acked()) {
+        timestamp_t now = get_timestamp_ns();
+        if (now - drain_start >= drain_timeout_ns) {
+            std::cerr << "Warning: no FIN-ACK after " << config::DRAIN_TIMEOUT_MS << " ms ("
+                      << reliability.get_pending_count() << " packets unacknowledged)\n";
+            break;
+        }
+        if (now >= next_fin_time) {
+            reliability.send_fin(final_datagram);
+            next_fin_time = now + static_cast<timestamp_t>(reliability.get_pto_us()) * 1000;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    std::cout << "Drain completed in " << std::fixed << std::setprecision(2)
+              << timestamp_diff_us(drain_start, get_timestamp_ns()) / 1000.0 << " ms\n";
+
+    send_perf.end_phase();
     running = false;
     ack_thread.join();
     reliability.stop();
     stats.end_collection();
+    interval_log.stop();
+    live_stats.finish();
 
-    std::cout << "Sender finished. Sent " << total_msgs << " messages.\n";
+    std::cout << "Sender finished. Sent " << final_seq << " messages";
+    if (layout.enabled() || coalescer) {
+        std::cout << " in " << final_datagram << (coalescer ? " datagrams" : " fragments");
+    }
+    std::cout << ".\n";
     std::cout << "Check " << logfile << " for results.\n";
+    if (!interval_log_path.empty()) {
+        std::cout << "Wrote " << interval_log.get_intervals_written() << " intervals to " << interval_log_path << ".\n";
+    }
 
     stats.print_final_summary();
+    if (ping_pong > 0) {
+        ping_pong_stats.print_summary(ping_pong);
+        stats.print_latency_distribution();
+    } else {
+        reliability.get_ack_stats().print_summary("ACK Statistics", false);
+        reliability.get_loss_stats().print_summary();
+    }
+    if (paths > 1) {
+        reliability.get_redundancy_stats().print_summary("Redundant Paths");
+    }
+    if (fec.enabled()) {
+        reliability.get_fec_stats().print_summary("Forward Error Correction", fec);
+    }
+    if (layout.enabled()) {
+        acked_messages.print_summary("Message Delivery (ACKed fragments)");
+    }
+    if (coalescer) {
+        coalescer->get_stats().print_summary("Coalescing", stats.get_throughput_stats().get_duration_seconds());
+    }
+    if (kernel_timestamps) {
+        send_path.print_summary("Send Path (kernel TX timestamps)");
+    }
+    reliability.get_clock_estimate().print_summary("Clock Sync");
+    send_perf.print_summary("CPU Counters (send thread)");
+    ack_perf.print_summary("CPU Counters (ACK thread)");
+    if (socket.is_impaired()) {
+        socket.get_stats().print_summary();
+    }
+    if (sweep_config.enabled()) {
+        sweep.print_summary();
+        if (!sweep_out.empty() && sweep.write_results(sweep_out)) {
+            std::cout << "  Sweep table written to " << sweep_out << "\n";
+        }
+    }
+
+    if (reliability.is_fin_acked()) {
+        FinAckFrame summary = reliability.get_receiver_summary();
+        std::cout << "\nReceiver Summary (FIN-ACK):\n";
+        std::cout << "  Packets received: " << summary.packets_received << "/" << summary.final_seq << "\n";
+        std::cout << "  Duplicate packets: " << summary.duplicate_packets << "\n";
+        std::cout << "  ACKs sent: " << summary.acks_sent << "\n";
+    }
 
+    Tracer::dump();
     return 0;
 }
\ No newline at end of file
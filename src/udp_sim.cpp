@@ -0,0 +1,155 @@
+#include "udp_benchmark/simulation.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace udp_benchmark;
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <msg_size> <rate_msgs/s> <total_msgs> [options]\n";
+        std::cerr << "Runs the sender and receiver protocol logic over a modeled link in virtual time.\n";
+        std::cerr << "Parameters:\n";
+        std::cerr << "  msg_size:    Message size in bytes (minimum " << config::MIN_MESSAGE_SIZE << ")\n";
+        std::cerr << "  rate_msgs/s: Offered rate; 0 sends as fast as the congestion window allows\n";
+        std::cerr << "  total_msgs:  Messages to deliver\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --link SPEC         Sender->receiver link, same keys as --impair (e.g. rate=100,delay=500,limit=100)\n";
+        std::cerr << "  --reverse-link SPEC Receiver->sender link (default: the forward delay and jitter only)\n";
+        std::cerr << "  --seed N            Seed for both links (default 1)\n";
+        std::cerr << "  --ack-period N      ACK every N packets (default " << config::DEFAULT_ACK_PERIOD << ")\n";
+        std::cerr << "  --ack-delay-us T    ACK at most T μs after a packet (default " << config::DEFAULT_MAX_ACK_DELAY_US << ")\n";
+        std::cerr << "  --time-limit-s S    Stop after S seconds of virtual time (default " << config::SIM_TIME_LIMIT_S << ")\n";
+        std::cerr << "  --fec K:M           Send M parity packets after every K data packets (M = 1 is XOR parity)\n";
+        std::cerr << "  --fec-compare K:M,...  Run without FEC and then with each code, and compare tail latency\n";
+        std::cerr << "                      against parity overhead\n";
+        std::cerr << "  --json PATH         Write the results as JSON\n";
+        return 1;
+    }
+
+    SimConfig sim;
+    sim.msg_size = static_cast<size_t>(std::atoi(argv[1]));
+    sim.rate = std::atof(argv[2]);
+    sim.total = std::strtoull(argv[3], nullptr, 10);
+
+    // A modeled link is a pure serializer unless a burst is asked for.
+    sim.forward.burst_bytes = 0;
+    std::string reverse_spec;
+    bool has_reverse = false;
+    uint64_t seed = 1;
+    std::string json_path;
+    std::vector<FecCode> compare_codes;
+
+    if ((argc - 4) % 2 != 0) {
+        std::cerr << "Error: " << argv[argc - 1] << " needs a value\n";
+        return 1;
+    }
+    for (int i = 4; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--link") == 0) {
+            if (!ImpairmentConfig::parse(argv[i + 1], sim.forward)) {
+                std::cerr << "Error: invalid --link spec " << argv[i + 1] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--reverse-link") == 0) {
+            reverse_spec = argv[i + 1];
+            has_reverse = true;
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ack-period") == 0) {
+            sim.ack_period = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ack-delay-us") == 0) {
+            sim.max_ack_delay_us = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--time-limit-s") == 0) {
+            sim.time_limit_s = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--fec") == 0) {
+            if (!FecCode::parse(argv[i + 1], sim.fec)) {
+                std::cerr << "Error: --fec expects K:M with 1 to " << config::FEC_MAX_DATA << " data and 1 to "
+                          << config::FEC_MAX_PARITY << " parity packets per block\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--fec-compare") == 0) {
+            std::stringstream list(argv[i + 1]);
+            std::string spec;
+            while (std::getline(list, spec, ',')) {
+                FecCode code;
+                if (!FecCode::parse(spec.c_str(), code)) {
+                    std::cerr << "Error: invalid --fec-compare code " << spec << "\n";
+                    return 1;
+                }
+                compare_codes.push_back(code);
+            }
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (sim.msg_size < config::MIN_MESSAGE_SIZE || sim.msg_size > config::MAX_PACKET_SIZE) {
+        std::cerr << "Error: msg_size must be between " << config::MIN_MESSAGE_SIZE << " and "
+                  << config::MAX_PACKET_SIZE << " bytes\n";
+        return 1;
+    }
+
+    if (!compare_codes.empty() && (sim.fec.enabled() || !json_path.empty())) {
+        std::cerr << "Error: --fec-compare chooses the codes itself and cannot be combined with --fec or --json\n";
+        return 1;
+    }
+
+    if (has_reverse) {
+        sim.reverse.burst_bytes = 0;
+        if (!ImpairmentConfig::parse(reverse_spec, sim.reverse)) {
+            std::cerr << "Error: invalid --reverse-link spec " << reverse_spec << "\n";
+            return 1;
+        }
+    } else {
+        sim.reverse.delay_us = sim.forward.delay_us;
+        sim.reverse.jitter_us = sim.forward.jitter_us;
+        sim.reverse.distribution = sim.forward.distribution;
+    }
+    sim.forward.seed = seed;
+    sim.reverse.seed = seed + 1;
+
+    std::cout << "UDP protocol simulation:\n";
+    std::cout << "  Messages: " << sim.total << " x " << sim.msg_size << " bytes";
+    if (sim.rate > 0) {
+        std::cout << " at " << static_cast<int>(sim.rate) << " msgs/sec";
+    }
+    std::cout << "\n";
+    std::cout << "  Forward link: " << (sim.forward.enabled() ? sim.forward.describe() : "ideal") << "\n";
+    std::cout << "  Reverse link: " << (sim.reverse.enabled() ? sim.reverse.describe() : "ideal") << "\n";
+    std::cout << "  ACK policy: every " << sim.ack_period << " packets or " << sim.max_ack_delay_us << " μs\n";
+    if (sim.fec.enabled()) {
+        std::cout << "  FEC: " << sim.fec.describe() << "\n";
+    }
+    std::cout << "  Seed: " << seed << "\n";
+
+
+    // Every run uses the same links and seeds.
+    if (!compare_codes.empty()) {
+        std::vector<SimResult> results;
+        compare_codes.insert(compare_codes.begin(), FecCode());
+        for (const FecCode& code : compare_codes) {
+            sim.fec = code;
+            Simulation simulation(sim);
+            results.push_back(simulation.run());
+            std::cout << "  Ran " << (code.enabled() ? code.describe() : std::string("without FEC")) << ": "
+                      << results.back().delivered << "/" << results.back().total << " delivered\n";
+        }
+        SimResult::print_comparison(results);
+        bool completed = std::all_of(results.begin(), results.end(), [](const SimResult& r) { return r.completed; });
+        return completed ? 0 : 2;
+    }
+
+    Simulation simulation(sim);
+    SimResult result = simulation.run();
+    result.print_summary();
+
+    if (!json_path.empty() && result.write_json(json_path)) {
+        std::cout << "Results written to " << json_path << "\n";
+    }
+    return result.completed ? 0 : 2;
+}
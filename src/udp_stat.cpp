@@ -0,0 +1,385 @@
+#include "udp_benchmark/interval_log.hpp"
+#include "udp_benchmark/live_stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+using namespace udp_benchmark;
+
+static uint64_t unix_time_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+static const char* role_name(LiveRole role) {
+    return role == LiveRole::RECEIVER ? "receiver" : "sender";
+}
+
+static std::string escape_label(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static int list_segments() {
+    std::vector<std::string> names = LiveStatsReader::list();
+    if (names.empty()) {
+        std::cout << "No live stats published (runs publish to /dev/shm/udp_benchmark.NAME)\n";
+        return 0;
+    }
+    std::cout << "Live stats:\n";
+    for (const std::string& name : names) {
+        LiveStatsReader reader;
+        LiveSnapshot snapshot;
+        if (!reader.attach(name) || !reader.read(snapshot)) {
+            std::cout << "  " << name << ": unreadable\n";
+            continue;
+        }
+        const char* state = snapshot.finished ? "finished" : reader.is_writer_alive() ? "running" : "stale";
+        std::cout << "  " << std::left << std::setw(24) << name << std::right << " " << role_name(snapshot.role)
+                  << ", pid " << snapshot.pid << ", " << state << ", " << snapshot.total.messages << "/"
+                  << snapshot.total_messages << " messages\n";
+    }
+    return 0;
+}
+
+
+static void write_prometheus(std::ostream& out, const std::string& name, const LiveSnapshot& snapshot) {
+    std::string labels = "name=\"" + escape_label(name) + "\",role=\"" + role_name(snapshot.role) + "\"";
+    const LiveValues& v = snapshot.total;
+    auto metric = [&](const char* metric_name, const char* type, const char* help, double value) {
+        out << "# HELP udp_benchmark_" << metric_name << " " << help << "\n";
+        out << "# TYPE udp_benchmark_" << metric_name << " " << type << "\n";
+        out << "udp_benchmark_" << metric_name << "{" << labels << "} " << value << "\n";
+    };
+
+    bool sender = snapshot.role == LiveRole::SENDER;
+    out << std::setprecision(15);
+    metric("start_time_seconds", "gauge", "Unix time the run started.", snapshot.start_unix_ns / 1e9);
+    metric("finished", "gauge", "1 once the run has ended.", snapshot.finished ? 1 : 0);
+    metric("messages_expected", "gauge", "Messages the run is set to send.", static_cast<double>(snapshot.total_messages));
+    metric("messages_total", "counter", "Messages sent (sender) or delivered (receiver).", static_cast<double>(v.messages));
+    metric("packets_received_total", "counter", "Packets acknowledged (sender) or new packets received (receiver).",
+           static_cast<double>(v.packets_received));
+    metric("bytes_received_total", "counter", "Bytes of the packets in packets_received_total.",
+           static_cast<double>(v.bytes_received));
+    metric("acks_total", "counter", "ACKs received (sender) or sent (receiver).", static_cast<double>(v.acks));
+    if (sender) {
+        metric("packets_sent_total", "counter", "Data packets sent, retransmissions included.",
+               static_cast<double>(v.packets_sent));
+        metric("bytes_sent_total", "counter", "Bytes of data packets sent.", static_cast<double>(v.bytes_sent));
+        metric("retransmits_total", "counter", "Packets retransmitted.", static_cast<double>(v.retransmits));
+        metric("losses_total", "counter", "Packets declared lost.", static_cast<double>(v.losses));
+        metric("cwnd_packets", "gauge", "Congestion window.", static_cast<double>(v.cwnd));
+        metric("inflight_packets", "gauge", "Packets sent and not yet acknowledged.", static_cast<double>(v.inflight));
+        metric("srtt_seconds", "gauge", "Smoothed RTT.", v.srtt_ns / 1e9);
+        metric("min_rtt_seconds", "gauge", "Minimum RTT.", v.min_rtt_ns / 1e9);
+    } else {
+        metric("duplicates_total", "counter", "Duplicate packets received.", static_cast<double>(v.duplicates));
+    }
+
+    out << "# HELP udp_benchmark_latency_seconds RTT (sender) or one-way latency (receiver).\n";
+    out << "# TYPE udp_benchmark_latency_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i + 1 < LIVE_HISTOGRAM_BUCKETS; ++i) {
+        cumulative += v.histogram[i];
+        out << "udp_benchmark_latency_seconds_bucket{" << labels << ",le=\"" << (1ULL << i) / 1e6 << "\"} "
+            << cumulative << "\n";
+    }
+    out << "udp_benchmark_latency_seconds_bucket{" << labels << ",le=\"+Inf\"} " << v.latency_count << "\n";
+    out << "udp_benchmark_latency_seconds_sum{" << labels << "} " << v.latency_sum_ns / 1e9 << "\n";
+    out << "udp_benchmark_latency_seconds_count{" << labels << "} " << v.latency_count << "\n";
+
+    out << "# HELP udp_benchmark_latency_window_seconds Latency percentiles over the last "
+        << config::LIVE_STATS_WINDOW_MS << " ms window, at bucket resolution.\n";
+    out << "# TYPE udp_benchmark_latency_window_seconds gauge\n";
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        out << "udp_benchmark_latency_window_seconds{" << labels << ",quantile=\"" << p / 100.0 << "\"} "
+            << live_histogram_percentile_us(v.window_histogram, p) / 1e6 << "\n";
+    }
+}
+
+static bool write_prometheus_file(const std::string& path, const std::string& name, const LiveSnapshot& snapshot) {
+
+    // Written aside and renamed, so a scraper never reads half a file.
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path);
+        write_prometheus(out, name, snapshot);
+        if (!out) {
+            std::cerr << "Error: cannot write " << tmp_path << "\n";
+            return false;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: cannot rename " << tmp_path << " to " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+static void print_header(const std::string& name, const LiveSnapshot& snapshot) {
+    std::cout << name << ": " << role_name(snapshot.role) << ", pid " << snapshot.pid << ", run " << std::hex
+              << snapshot.run_id << std::dec << ", " << snapshot.total_messages << " messages\n";
+    if (snapshot.role == LiveRole::SENDER) {
+        std::cout << "  time_s   messages   done     sent/s    acked/s    retx  losses   cwnd  inflight"
+                  << "  srtt_us   p50_us   p99_us\n";
+    } else {
+        std::cout << "  time_s   messages   done     recv/s     Mbit/s     dup      acks   p50_us   p99_us\n";
+    }
+}
+
+
+static void print_row(const LiveSnapshot& snapshot, const LiveValues& previous, double interval_s, double time_s) {
+    const LiveValues& v = snapshot.total;
+    const uint64_t* histogram = v.window_count > 0 ? v.window_histogram : v.histogram;
+    double done = snapshot.total_messages > 0 ? v.messages * 100.0 / snapshot.total_messages : 0.0;
+    auto rate = [&](uint64_t now, uint64_t before) { return interval_s > 0 ? (now - before) / interval_s : 0.0; };
+
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << time_s << std::setw(11) << v.messages
+              << std::setw(6) << done << "%" << std::setprecision(0);
+    if (snapshot.role == LiveRole::SENDER) {
+        std::cout << std::setw(11) << rate(v.packets_sent, previous.packets_sent) << std::setw(11)
+                  << rate(v.packets_received, previous.packets_received) << std::setw(8) << v.retransmits
+                  << std::setw(8) << v.losses << std::setw(7) << v.cwnd << std::setw(10) << v.inflight
+                  << std::setprecision(1) << std::setw(9) << v.srtt_ns / 1000.0;
+    } else {
+        std::cout << std::setw(11) << rate(v.packets_received, previous.packets_received) << std::setprecision(1)
+                  << std::setw(11) << rate(v.bytes_received, previous.bytes_received) * 8 / 1e6 << std::setw(8)
+                  << v.duplicates << std::setw(10) << v.acks;
+    }
+    std::cout << std::setprecision(0) << std::setw(9) << live_histogram_percentile_us(histogram, 50.0)
+              << std::setw(9) << live_histogram_percentile_us(histogram, 99.0) << "\n";
+}
+
+static void print_interval_row(const IntervalRecord& record, double time_s) {
+    double seconds = (record.end_ns - record.start_ns) / 1e9;
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << time_s << std::setprecision(0) << std::setw(11)
+              << (seconds > 0 ? record.packets / seconds : 0.0) << std::setw(8) << record.losses << std::setw(8)
+              << record.retransmits << std::setw(8) << record.duplicates << std::setw(9)
+              << record.latency.get_percentile_us(50.0) << std::setw(9) << record.latency.get_percentile_us(99.0)
+              << std::setw(10) << record.latency.get_max_ns() / 1000.0 << "\n";
+}
+
+
+static int report_interval_log(const std::string& path, double from_s, double to_s, bool rows) {
+    IntervalLogReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Error: " << path << " is not an interval log\n";
+        return 1;
+    }
+    const IntervalLogHeader& header = reader.get_header();
+    std::cout << path << ": " << role_name(static_cast<LiveRole>(header.role)) << ", run " << std::hex
+              << header.run_id << std::dec << ", " << header.interval_ms << " ms intervals\n";
+    if (rows) {
+        std::cout << "  time_s   packets/s  losses    retx     dup   p50_us   p99_us    max_us\n";
+    }
+
+    const size_t slowest_kept = 5;
+    std::vector<std::pair<double, double>> slowest;
+    IntervalRecord record;
+    IntervalRecord range;
+    uint64_t intervals = 0;
+    uint64_t idle = 0;
+    double first_s = 0.0;
+    double last_s = 0.0;
+    while (reader.next(record)) {
+        double start_s = (record.start_ns - header.start_ns) / 1e9;
+        if (start_s < from_s) {
+            continue;
+        }
+        if (start_s >= to_s) {
+            break;
+        }
+        if (intervals++ == 0) {
+            first_s = start_s;
+        }
+        last_s = (record.end_ns - header.start_ns) / 1e9;
+        range.packets += record.packets;
+        range.bytes += record.bytes;
+        range.losses += record.losses;
+        range.retransmits += record.retransmits;
+        range.duplicates += record.duplicates;
+        range.reordered += record.reordered;
+        range.loss_bursts += record.loss_bursts;
+        range.jitter_ns = std::max(range.jitter_ns, record.jitter_ns);
+        range.latency.add(record.latency);
+        if (record.packets == 0) {
+            idle++;
+        }
+        if (record.latency.get_count() > 0) {
+            slowest.emplace_back(record.latency.get_percentile_us(99.0), start_s);
+            std::sort(slowest.begin(), slowest.end(), std::greater<std::pair<double, double>>());
+            if (slowest.size() > slowest_kept) {
+                slowest.pop_back();
+            }
+        }
+        if (rows) {
+            print_interval_row(record, start_s);
+        }
+    }
+    if (intervals == 0) {
+        std::cout << "No intervals in the range.\n";
+        return 0;
+    }
+
+    double seconds = last_s - first_s;
+    std::cout << std::fixed << std::setprecision(1) << "\nRange " << first_s << " s to " << last_s << " s ("
+              << intervals << " intervals):\n";
+    std::cout << "  Packets: " << range.packets << " (" << std::setprecision(0)
+              << (seconds > 0 ? range.packets / seconds : 0.0) << "/s, " << std::setprecision(1)
+              << (seconds > 0 ? range.bytes * 8 / seconds / 1e6 : 0.0) << " Mbit/s)\n";
+    if (header.role == static_cast<uint32_t>(LiveRole::SENDER)) {
+        std::cout << "  Losses: " << range.losses << ", retransmits: " << range.retransmits << "\n";
+    } else {
+        std::cout << "  Duplicates: " << range.duplicates << ", reordered: " << range.reordered << ", loss bursts: "
+                  << range.loss_bursts << "\n";
+        std::cout << "  Max jitter: " << range.jitter_ns / 1000.0 << " μs\n";
+    }
+    std::cout << "  Idle intervals: " << idle << "\n";
+    const LatencyHistogram& latency = range.latency;
+    std::cout << "  Latency samples: " << latency.get_count() << "\n";
+    if (latency.get_count() > 0) {
+        std::cout << "  Mean latency: " << latency.get_mean_us() << " μs\n";
+        for (double p : {50.0, 90.0, 99.0, 99.9}) {
+            std::cout << "  P" << std::setprecision(p == 99.9 ? 1 : 0) << p << " latency: " << std::setprecision(1)
+                      << latency.get_percentile_us(p) << " μs\n";
+        }
+        std::cout << "  Max latency: " << latency.get_max_ns() / 1000.0 << " μs\n";
+        std::cout << "  Slowest intervals by p99:";
+        for (const auto& interval : slowest) {
+            std::cout << " " << interval.second << " s (" << interval.first << " μs)";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && (std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)) {
+        std::cerr << "Usage: " << argv[0] << " [name] [options]\n";
+        std::cerr << "       " << argv[0] << " --interval-log PATH [--from S] [--to S] [--rows 0|1]\n";
+        std::cerr << "Shows the live statistics a udp_sender or udp_receiver publishes (see --live-stats).\n";
+        std::cerr << "Without a name, lists the runs publishing on this host.\n";
+        std::cerr << "With --interval-log, summarizes the intervals of a log that start between S seconds\n";
+        std::cerr << "(--from, default 0) and S seconds (--to, default the end) into the run; --rows 1 lists them.\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --interval-ms T     Time between updates (default " << config::LIVE_STATS_VIEW_INTERVAL_MS << ")\n";
+        std::cerr << "  --count N           Stop after N updates (default 0: until the run ends)\n";
+        std::cerr << "  --prometheus PATH   Also write Prometheus text format to PATH at every update;\n";
+        std::cerr << "                      - prints it to stdout instead of the table\n";
+        return 1;
+    }
+    if (argc < 2) {
+        return list_segments();
+    }
+
+    if (std::strcmp(argv[1], "--interval-log") == 0) {
+        std::string path;
+        double from_s = 0.0;
+        double to_s = std::numeric_limits<double>::infinity();
+        bool rows = false;
+        for (int i = 1; i + 1 < argc; i += 2) {
+            if (std::strcmp(argv[i], "--interval-log") == 0) {
+                path = argv[i + 1];
+            } else if (std::strcmp(argv[i], "--from") == 0) {
+                from_s = std::atof(argv[i + 1]);
+            } else if (std::strcmp(argv[i], "--to") == 0) {
+                to_s = std::atof(argv[i + 1]);
+            } else if (std::strcmp(argv[i], "--rows") == 0) {
+                rows = std::atoi(argv[i + 1]) != 0;
+            } else {
+                std::cerr << "Error: Unknown option " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        if (path.empty()) {
+            std::cerr << "Error: --interval-log needs a path\n";
+            return 1;
+        }
+        return report_interval_log(path, from_s, to_s, rows);
+    }
+
+    std::string name = argv[1];
+    int interval_ms = config::LIVE_STATS_VIEW_INTERVAL_MS;
+    uint64_t count = 0;
+    std::string prometheus_path;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--interval-ms") == 0) {
+            interval_ms = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--count") == 0) {
+            count = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--prometheus") == 0) {
+            prometheus_path = argv[i + 1];
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (interval_ms <= 0) {
+        std::cerr << "Error: --interval-ms must be positive\n";
+        return 1;
+    }
+
+    LiveStatsReader reader;
+    if (!reader.attach(name)) {
+        std::cerr << "Error: no live stats named " << name << " (run " << argv[0] << " without arguments to list them)\n";
+        return 1;
+    }
+
+    bool table = prometheus_path != "-";
+    LiveSnapshot snapshot;
+    LiveValues previous;
+    uint64_t previous_ns = 0;
+    for (uint64_t update = 0; count == 0 || update < count; ++update) {
+        if (update > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        }
+        bool alive = reader.is_writer_alive();
+        if (!reader.read(snapshot)) {
+            std::cerr << "Error: " << name << " was left mid-update by process " << snapshot.pid << "\n";
+            return 1;
+        }
+
+        uint64_t now_ns = std::max(unix_time_ns(), snapshot.start_unix_ns);
+        if (update == 0) {
+            previous_ns = snapshot.start_unix_ns;
+            if (table) {
+                print_header(name, snapshot);
+            }
+        }
+        if (table) {
+            print_row(snapshot, previous, (now_ns - previous_ns) / 1e9, (now_ns - snapshot.start_unix_ns) / 1e9);
+        } else {
+            write_prometheus(std::cout, name, snapshot);
+            std::cout << std::endl;
+        }
+        if (!prometheus_path.empty() && table && !write_prometheus_file(prometheus_path, name, snapshot)) {
+            return 1;
+        }
+        previous = snapshot.total;
+        previous_ns = now_ns;
+
+        if (snapshot.finished || !alive) {
+            if (table) {
+                std::cout << (snapshot.finished ? "Run finished.\n" : "Publishing process exited without finishing.\n");
+            }
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "udp_benchmark/interval_log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace udp_benchmark {
+
+namespace {
+
+const char LOG_MAGIC[8] = {'U', 'D', 'P', 'I', 'V', 'L', '1', '\n'};
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool get_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool read_varint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+
+uint64_t LatencyHistogram::lowest_value(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t shift = static_cast<uint32_t>(bucket / SUB_BUCKETS) - 1;
+    return static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::highest_value(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t shift = static_cast<uint32_t>(bucket / SUB_BUCKETS) - 1;
+    return lowest_value(bucket) + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    sum_ns_ += other.sum_ns_;
+    max_ns_ = std::max(max_ns_, other.max_ns_);
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    sum_ns_ = 0;
+    max_ns_ = 0;
+}
+
+double LatencyHistogram::get_percentile_us(double p) const {
+    if (total_ == 0) {
+        return 0.0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * total_)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            uint64_t mid = lowest_value(i) + (highest_value(i) - lowest_value(i)) / 2;
+            return std::min(mid, max_ns_) / 1000.0;
+        }
+    }
+    return max_ns_ / 1000.0;
+}
+
+void LatencyHistogram::encode(std::string& out) const {
+    size_t occupied = static_cast<size_t>(std::count_if(counts_.begin(), counts_.end(),
+                                                        [](uint64_t count) { return count > 0; }));
+    put_varint(out, sum_ns_);
+    put_varint(out, max_ns_);
+    put_varint(out, occupied);
+    size_t next = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (counts_[i] > 0) {
+            put_varint(out, i - next);
+            put_varint(out, counts_[i]);
+            next = i + 1;
+        }
+    }
+}
+
+bool LatencyHistogram::decode(const uint8_t*& data, const uint8_t* end) {
+    reset();
+    uint64_t occupied;
+    if (!get_varint(data, end, sum_ns_) || !get_varint(data, end, max_ns_) || !get_varint(data, end, occupied)) {
+        return false;
+    }
+    size_t next = 0;
+    for (uint64_t i = 0; i < occupied; ++i) {
+        uint64_t gap;
+        uint64_t count;
+        if (!get_varint(data, end, gap) || !get_varint(data, end, count) || next + gap >= BUCKET_COUNT) {
+            return false;
+        }
+        counts_[next + gap] = count;
+        total_ += count;
+        next += gap + 1;
+    }
+    return true;
+}
+
+
+IntervalRecorder::~IntervalRecorder() {
+    stop();
+}
+
+bool IntervalRecorder::start(const std::string& path, uint32_t interval_ms, uint32_t role, uint64_t run_id,
+                             TotalsSource totals_source) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        std::cerr << "Error: cannot write interval log " << path << "\n";
+        return false;
+    }
+
+    header_.role = role;
+    header_.interval_ms = std::max<uint32_t>(interval_ms, 1);
+    header_.run_id = run_id;
+    header_.start_unix_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header_.start_ns = get_timestamp_ns();
+    interval_start_ns_ = header_.start_ns;
+    totals_source_ = std::move(totals_source);
+    last_totals_ = totals_source_ ? totals_source_() : IntervalTotals();
+
+    std::string header(LOG_MAGIC, sizeof(LOG_MAGIC));
+    put_varint(header, LatencyHistogram::SUB_BUCKET_BITS);
+    put_varint(header, LatencyHistogram::MAX_VALUE_BITS);
+    put_varint(header, header_.role);
+    put_varint(header, header_.interval_ms);
+    put_varint(header, header_.run_id);
+    put_varint(header, header_.start_unix_ns);
+    put_varint(header, header_.start_ns);
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file_.flush();
+
+    stop_requested_ = false;
+    thread_ = std::thread(&IntervalRecorder::run, this);
+    return true;
+}
+
+void IntervalRecorder::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop_requested_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+    file_.close();
+}
+
+void IntervalRecorder::run() {
+    auto interval = std::chrono::milliseconds(header_.interval_ms);
+    auto next = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_cv_.wait_until(lock, next, [this] { return stop_requested_; })) {
+        lock.unlock();
+        close_interval();
+        lock.lock();
+
+
+        auto now = std::chrono::steady_clock::now();
+        do {
+            next += interval;
+        } while (next <= now);
+    }
+    lock.unlock();
+    close_interval();
+}
+
+void IntervalRecorder::close_interval() {
+    Buffer* spare = active_.load(std::memory_order_relaxed) == &buffers_[0] ? &buffers_[1] : &buffers_[0];
+    Buffer* closed = active_.exchange(spare, std::memory_order_seq_cst);
+    uint64_t seq = writer_seq_.load(std::memory_order_seq_cst);
+    if (seq & 1) {
+        while (writer_seq_.load(std::memory_order_acquire) == seq) {
+            std::this_thread::yield();
+        }
+    }
+
+    timestamp_t end_ns = get_timestamp_ns();
+    IntervalTotals totals = totals_source_ ? totals_source_() : IntervalTotals();
+
+    std::string payload;
+    put_varint(payload, end_ns - interval_start_ns_);
+    put_varint(payload, closed->packets);
+    put_varint(payload, closed->bytes);
+    put_varint(payload, totals.losses - last_totals_.losses);
+    put_varint(payload, totals.retransmits - last_totals_.retransmits);
+    put_varint(payload, totals.duplicates - last_totals_.duplicates);
+    closed->latency.encode(payload);
+    put_varint(payload, totals.reordered - last_totals_.reordered);
+    put_varint(payload, totals.loss_bursts - last_totals_.loss_bursts);
+    put_varint(payload, totals.jitter_ns);
+
+    record_.clear();
+    put_varint(record_, payload.size());
+    record_ += payload;
+    file_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+    file_.flush();
+    intervals_written_++;
+
+    closed->packets = 0;
+    closed->bytes = 0;
+    closed->latency.reset();
+    interval_start_ns_ = end_ns;
+    last_totals_ = totals;
+}
+
+
+bool IntervalLogReader::open(const std::string& path) {
+    file_.open(path, std::ios::binary);
+    char magic[sizeof(LOG_MAGIC)];
+    if (!file_ || !file_.read(magic, sizeof(magic)) || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    uint64_t sub_bucket_bits;
+    uint64_t max_value_bits;
+    uint64_t role;
+    uint64_t interval_ms;
+    if (!read_varint(file_, sub_bucket_bits) || !read_varint(file_, max_value_bits) || !read_varint(file_, role) ||
+        !read_varint(file_, interval_ms) || !read_varint(file_, header_.run_id) ||
+        !read_varint(file_, header_.start_unix_ns) || !read_varint(file_, header_.start_ns)) {
+        return false;
+    }
+    if (sub_bucket_bits != LatencyHistogram::SUB_BUCKET_BITS || max_value_bits != LatencyHistogram::MAX_VALUE_BITS) {
+        return false;
+    }
+    header_.role = static_cast<uint32_t>(role);
+    header_.interval_ms = static_cast<uint32_t>(interval_ms);
+    previous_end_ns_ = header_.start_ns;
+    return true;
+}
+
+bool IntervalLogReader::next(IntervalRecord& record) {
+    uint64_t size;
+    if (!read_varint(file_, size) || size > (uint64_t{1} << 20)) {
+        return false;
+    }
+    record_.resize(size);
+    if (!file_.read(&record_[0], static_cast<std::streamsize>(size))) {
+        return false;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(record_.data());
+    const uint8_t* end = data + size;
+    uint64_t duration_ns;
+    if (!get_varint(data, end, duration_ns) ||
+        !get_varint(data, end, record.packets) || !get_varint(data, end, record.bytes) ||
+        !get_varint(data, end, record.losses) || !get_varint(data, end, record.retransmits) ||
+        !get_varint(data, end, record.duplicates) || !record.latency.decode(data, end)) {
+        return false;
+    }
+
+
+    // Logs written before the receive-quality fields end at the histogram.
+    record.reordered = 0;
+    record.loss_bursts = 0;
+    record.jitter_ns = 0;
+    if (data < end && (!get_varint(data, end, record.reordered) || !get_varint(data, end, record.loss_bursts) ||
+                       !get_varint(data, end, record.jitter_ns))) {
+        return false;
+    }
+    record.start_ns = previous_end_ns_;
+    record.end_ns = record.start_ns + duration_ns;
+    previous_end_ns_ = record.end_ns;
+    return true;
+}
+
+}
@@ -0,0 +1,283 @@
+#include "udp_benchmark/live_stats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <signal.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace udp_benchmark {
+
+namespace {
+
+const char SHM_PREFIX[] = "/udp_benchmark.";
+constexpr int READ_RETRIES = 1000;
+
+std::string shm_name_of(const std::string& name) {
+    return SHM_PREFIX + name;
+}
+
+bool is_process_alive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+}
+
+
+void LiveValues::add(const LiveValues& other) {
+    messages += other.messages;
+    packets_sent += other.packets_sent;
+    bytes_sent += other.bytes_sent;
+    packets_received += other.packets_received;
+    bytes_received += other.bytes_received;
+    acks += other.acks;
+    retransmits += other.retransmits;
+    losses += other.losses;
+    duplicates += other.duplicates;
+
+    cwnd = std::max(cwnd, other.cwnd);
+    inflight = std::max(inflight, other.inflight);
+    srtt_ns = std::max(srtt_ns, other.srtt_ns);
+    min_rtt_ns = std::max(min_rtt_ns, other.min_rtt_ns);
+
+    latency_count += other.latency_count;
+    latency_sum_ns += other.latency_sum_ns;
+    window_count += other.window_count;
+    for (size_t i = 0; i < LIVE_HISTOGRAM_BUCKETS; ++i) {
+        histogram[i] += other.histogram[i];
+        window_histogram[i] += other.window_histogram[i];
+    }
+}
+
+
+size_t live_histogram_bucket(timestamp_t latency_ns) {
+    uint64_t us = latency_ns / 1000;
+    size_t bucket = us == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(us));
+    return std::min(bucket, LIVE_HISTOGRAM_BUCKETS - 1);
+}
+
+double live_histogram_percentile_us(const uint64_t* buckets, double p) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < LIVE_HISTOGRAM_BUCKETS; ++i) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LIVE_HISTOGRAM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return static_cast<double>(1ULL << i);
+        }
+    }
+    return static_cast<double>(1ULL << (LIVE_HISTOGRAM_BUCKETS - 1));
+}
+
+
+void LiveStatsWriter::add_latency(LiveValues* live, timestamp_t now_ns, timestamp_t latency_ns) {
+    if (now_ns >= window_end_ns_) {
+        if (window_end_ns_ != 0) {
+            std::copy(window_, window_ + LIVE_HISTOGRAM_BUCKETS, live->window_histogram);
+            live->window_count = window_count_;
+        }
+        std::fill(window_, window_ + LIVE_HISTOGRAM_BUCKETS, 0);
+        window_count_ = 0;
+        window_end_ns_ = now_ns + static_cast<timestamp_t>(config::LIVE_STATS_WINDOW_MS) * 1000000;
+    }
+
+    size_t bucket = live_histogram_bucket(latency_ns);
+    live->histogram[bucket]++;
+    live->latency_count++;
+    live->latency_sum_ns += latency_ns;
+    window_[bucket]++;
+    window_count_++;
+}
+
+
+LiveStats::~LiveStats() {
+    close();
+}
+
+bool LiveStats::create(const std::string& name, LiveRole role, uint64_t run_id, uint64_t total_messages) {
+    close();
+    std::string shm_name = shm_name_of(name);
+    int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+
+    // A segment whose writer is gone was left behind by an unclean exit.
+    if (fd < 0 && errno == EEXIST) {
+        LiveStatsReader existing;
+        LiveSnapshot snapshot;
+        if (existing.attach(name) && existing.read(snapshot) && is_process_alive(snapshot.pid)) {
+            std::cerr << "Error: live stats " << name << " are being published by process " << snapshot.pid << "\n";
+            return false;
+        }
+        shm_unlink(shm_name.c_str());
+        fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: cannot create shared memory " << shm_name << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, sizeof(LiveStatsSegment)) == 0) {
+        mem = mmap(nullptr, sizeof(LiveStatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Error: cannot map shared memory " << shm_name << ": " << std::strerror(error) << "\n";
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+
+    segment_ = new (mem) LiveStatsSegment();
+    segment_->role = role;
+    segment_->pid = static_cast<int32_t>(getpid());
+    segment_->run_id = run_id;
+    segment_->total_messages = total_messages;
+    segment_->start_unix_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    segment_->version = LIVE_STATS_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    segment_->magic = LIVE_STATS_MAGIC;
+    shm_name_ = shm_name;
+    return true;
+}
+
+LiveStatsWriter LiveStats::add_section(const char* name) {
+    if (!segment_ || segment_->section_count >= LIVE_STATS_SECTIONS) {
+        return LiveStatsWriter();
+    }
+    LiveSection* section = &segment_->sections[segment_->section_count];
+    std::strncpy(section->name, name, sizeof(section->name) - 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    segment_->section_count++;
+    return LiveStatsWriter(section);
+}
+
+void LiveStats::set_session(uint64_t run_id, uint64_t total_messages) {
+    if (segment_) {
+        segment_->run_id = run_id;
+        segment_->total_messages = total_messages;
+    }
+}
+
+void LiveStats::finish() {
+    if (segment_) {
+        segment_->finished.store(1, std::memory_order_release);
+    }
+}
+
+void LiveStats::close() {
+    if (!segment_) {
+        return;
+    }
+    finish();
+    munmap(segment_, sizeof(LiveStatsSegment));
+    shm_unlink(shm_name_.c_str());
+    segment_ = nullptr;
+    shm_name_.clear();
+}
+
+
+LiveStatsReader::~LiveStatsReader() {
+    if (segment_) {
+        munmap(const_cast<LiveStatsSegment*>(segment_), sizeof(LiveStatsSegment));
+    }
+}
+
+bool LiveStatsReader::attach(const std::string& name) {
+    std::string shm_name = shm_name_of(name);
+    int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    void* mem = mmap(nullptr, sizeof(LiveStatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+
+    const LiveStatsSegment* segment = static_cast<const LiveStatsSegment*>(mem);
+    if (segment->magic != LIVE_STATS_MAGIC || segment->version != LIVE_STATS_VERSION) {
+        munmap(mem, sizeof(LiveStatsSegment));
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    segment_ = segment;
+    name_ = name;
+    return true;
+}
+
+bool LiveStatsReader::read(LiveSnapshot& snapshot) const {
+    if (!segment_) {
+        return false;
+    }
+    snapshot = LiveSnapshot();
+    snapshot.role = segment_->role;
+    snapshot.pid = segment_->pid;
+    snapshot.finished = segment_->finished.load(std::memory_order_acquire) != 0;
+    snapshot.run_id = segment_->run_id;
+    snapshot.total_messages = segment_->total_messages;
+    snapshot.start_unix_ns = segment_->start_unix_ns;
+
+    uint32_t sections = std::min<uint32_t>(segment_->section_count, LIVE_STATS_SECTIONS);
+    for (uint32_t i = 0; i < sections; ++i) {
+        const LiveSection& section = segment_->sections[i];
+        bool consistent = false;
+        for (int attempt = 0; attempt < READ_RETRIES && !consistent; ++attempt) {
+            uint64_t before = section.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            LiveValues values;
+            std::memcpy(static_cast<void*>(&values), &section.values, sizeof(values));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (section.seq.load(std::memory_order_relaxed) == before) {
+                snapshot.total.add(values);
+                consistent = true;
+            }
+        }
+        if (!consistent) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LiveStatsReader::is_writer_alive() const {
+    return segment_ && is_process_alive(segment_->pid);
+}
+
+std::vector<std::string> LiveStatsReader::list() {
+    std::vector<std::string> names;
+#ifdef __linux__
+    DIR* dir = opendir("/dev/shm");
+    if (!dir) {
+        return names;
+    }
+    const size_t prefix_length = sizeof(SHM_PREFIX) - 2;
+    while (dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, SHM_PREFIX + 1, prefix_length) == 0 && entry->d_name[prefix_length]) {
+            names.push_back(entry->d_name + prefix_length);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+#endif
+    return names;
+}
+
+}
@@ -0,0 +1,494 @@
+#include "udp_benchmark/log_analysis.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace udp_benchmark {
+
+namespace {
+
+const char* const STAGE_NAMES[] = {
+    "app -> qdisc (TX_SCHED)",
+    "qdisc -> device (TX_SOFTWARE)",
+    "app -> kernel TX",
+    "kernel TX -> kernel RX",
+    "kernel RX -> app"
+};
+
+LogField field_of(const std::string& name) {
+    static const std::pair<const char*, LogField> names[] = {
+        {"seq", LOG_SEQ},
+        {"send_ts_ns", LOG_SEND_TS},
+        {"ack_recv_ts_ns", LOG_ACK_RECV_TS},
+        {"retransmits", LOG_RETRANSMITS},
+        {"intended_ts_ns", LOG_INTENDED_TS},
+        {"tx_sched_ts_ns", LOG_TX_SCHED_TS},
+        {"tx_ts_ns", LOG_TX_TS},
+        {"recv_ts_ns", LOG_RECV_TS},
+        {"clock_offset_ns", LOG_CLOCK_OFFSET},
+        {"kernel_rx_ts_ns", LOG_KERNEL_RX_TS}
+    };
+    for (const auto& entry : names) {
+        if (name == entry.first) {
+            return entry.second;
+        }
+    }
+    return LOG_IGNORED;
+}
+
+const char* end_of_line(const char* p, const char* end) {
+    if (p >= end) {
+        return end;
+    }
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return newline ? newline : end;
+}
+
+bool parse_value(const char*& p, const char* end, int64_t& value) {
+    bool negative = p < end && *p == '-';
+    if (negative) {
+        ++p;
+    }
+    const char* start = p;
+    uint64_t magnitude = 0;
+    while (p < end && static_cast<unsigned char>(*p - '0') < 10) {
+        magnitude = magnitude * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return p != start;
+}
+
+std::string format_latency(double us) {
+    std::ostringstream out;
+    out << std::fixed;
+    if (us < 1000) {
+        out << std::setprecision(1) << us << " μs";
+    } else if (us < 1e6) {
+        out << std::setprecision(3) << us / 1000 << " ms";
+    } else {
+        out << std::setprecision(6) << us / 1e6 << " s";
+    }
+    return out.str();
+}
+
+}
+
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+bool MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        madvise(mem, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mem);
+    }
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::release(const char* begin, const char* end) const {
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) & ~(page - 1);
+    uintptr_t last = reinterpret_cast<uintptr_t>(end) & ~(page - 1);
+    if (last > first) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+
+bool LogStream::open(const std::string& path, size_t depth, size_t chunk_bytes) {
+    path_ = path;
+    if (!file_.open(path)) {
+        std::cerr << "Error: cannot read " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    const char* p = file_.data();
+    const char* end = p + file_.size();
+    while (p < end && *p == '#') {
+        const char* eol = end_of_line(p, end);
+        std::string line(p, eol);
+        if (line.compare(0, 9, "# run_id=") == 0) {
+            run_id_ = std::strtoull(line.c_str() + 9, nullptr, 16);
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+
+    const char* eol = end_of_line(p, end);
+    std::istringstream header(std::string(p, eol));
+    std::string name;
+    while (std::getline(header, name, ',')) {
+        if (!name.empty() && name.back() == '\r') {
+            name.pop_back();
+        }
+        LogField field = field_of(name);
+        columns_.push_back(field);
+        if (field != LOG_IGNORED) {
+            present_ |= 1u << field;
+        }
+    }
+    if (!has(LOG_SEQ)) {
+        std::cerr << "Error: " << path << " is not a latency log (no seq column)\n";
+        return false;
+    }
+
+    depth_ = std::max<size_t>(depth, 1);
+    chunk_bytes_ = std::max<size_t>(chunk_bytes, 4096);
+    next_ = eol < end ? eol + 1 : end;
+    schedule();
+    return true;
+}
+
+LogStream::Chunk LogStream::parse_chunk(const char* begin, const char* end, const std::vector<LogField>& columns) {
+    Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = end;
+    chunk.rows.reserve(static_cast<size_t>(end - begin) / 32);
+
+    const size_t column_count = columns.size();
+    const char* p = begin;
+    while (p < end) {
+        if (*p == '#' || *p == '\n' || *p == '\r') {
+            const char* eol = end_of_line(p, end);
+            p = eol < end ? eol + 1 : end;
+            continue;
+        }
+
+        LogRow row{};
+        bool valid = true;
+        for (size_t c = 0; c < column_count && valid; ++c) {
+            if (columns[c] == LOG_IGNORED) {
+                while (p < end && *p != ',' && *p != '\n') {
+                    ++p;
+                }
+            } else {
+                valid = parse_value(p, end, row.values[columns[c]]);
+            }
+
+            bool last = c + 1 == column_count;
+            if (last && p < end && *p == '\r') {
+                ++p;
+            }
+            if (p < end && *p == (last ? '\n' : ',')) {
+                ++p;
+            } else if (!last || p < end) {
+                valid = false;
+            }
+        }
+
+        if (valid && row.values[LOG_SEQ] >= 0) {
+            chunk.rows.push_back(row);
+        } else {
+            chunk.malformed++;
+            const char* eol = end_of_line(p, end);
+            p = eol < end ? eol + 1 : end;
+        }
+    }
+    return chunk;
+}
+
+void LogStream::schedule() {
+    const char* end = file_.data() + file_.size();
+    while (pending_.size() < depth_ && next_ < end) {
+        const char* begin = next_;
+        const char* chunk_end = begin + std::min<size_t>(chunk_bytes_, static_cast<size_t>(end - begin));
+        if (chunk_end < end) {
+            chunk_end = end_of_line(chunk_end, end);
+            chunk_end = chunk_end < end ? chunk_end + 1 : end;
+        }
+        next_ = chunk_end;
+        pending_.push_back(std::async(std::launch::async, &LogStream::parse_chunk, begin, chunk_end,
+                                      std::cref(columns_)));
+    }
+}
+
+bool LogStream::advance() {
+    if (current_.begin) {
+        file_.release(current_.begin, current_.end);
+    }
+    current_ = Chunk();
+    index_ = 0;
+    while (!pending_.empty()) {
+        current_ = pending_.front().get();
+        pending_.pop_front();
+        schedule();
+        rows_ += current_.rows.size();
+        malformed_ += current_.malformed;
+        if (!current_.rows.empty()) {
+            return true;
+        }
+        file_.release(current_.begin, current_.end);
+    }
+    return false;
+}
+
+
+LogAnalyzer::LogAnalyzer(size_t reorder_window) {
+    size_t slots = 2;
+    while (slots < reorder_window) {
+        slots <<= 1;
+    }
+    slots_.resize(slots);
+    mask_ = slots - 1;
+}
+
+void LogAnalyzer::add_sender(const LogRow& row) {
+    uint64_t seq = row.seq();
+    if (seq < base_) {
+        late_sender_++;
+        return;
+    }
+    Slot& slot = slots_[seq & mask_];
+    if (slot.flags & HAS_SENDER) {
+        return;
+    }
+    slot.seq = seq;
+    slot.flags |= HAS_SENDER;
+    slot.retransmits = static_cast<uint32_t>(row.values[LOG_RETRANSMITS]);
+    slot.send_ts = row.values[LOG_SEND_TS];
+    slot.ack_recv_ts = row.values[LOG_ACK_RECV_TS];
+    slot.intended_ts = row.values[LOG_INTENDED_TS];
+    slot.tx_sched_ts = row.values[LOG_TX_SCHED_TS];
+    slot.tx_ts = row.values[LOG_TX_TS];
+}
+
+void LogAnalyzer::add_receiver(const LogRow& row) {
+    uint64_t seq = row.seq();
+    if (seq < base_) {
+        late_receiver_++;
+        return;
+    }
+
+
+    // A sequence logged twice keeps its earliest arrival.
+    Slot& slot = slots_[seq & mask_];
+    if ((slot.flags & HAS_RECEIVER) && slot.recv_ts <= row.values[LOG_RECV_TS]) {
+        return;
+    }
+    slot.seq = seq;
+    slot.flags |= HAS_RECEIVER;
+    slot.recv_ts = row.values[LOG_RECV_TS];
+    slot.clock_offset = row.values[LOG_CLOCK_OFFSET];
+    slot.kernel_rx_ts = row.values[LOG_KERNEL_RX_TS];
+}
+
+void LogAnalyzer::settle(const Slot& slot) {
+    bool sent = slot.flags & HAS_SENDER;
+    bool received = slot.flags & HAS_RECEIVER;
+    if (sent) {
+        sent_++;
+        retransmits_ += slot.retransmits;
+        int64_t rtt_ns = slot.ack_recv_ts - slot.send_ts;
+        if (sender_rtt_ && rtt_ns > 0) {
+            rtt_.record(static_cast<uint64_t>(rtt_ns));
+            if (sender_intended_) {
+                rtt_corrected_.record(static_cast<uint64_t>(std::max<int64_t>(rtt_ns + slot.send_ts - slot.intended_ts, 0)));
+            }
+        }
+    }
+    if (received) {
+        received_++;
+        first_recv_ts_ = std::min(first_recv_ts_, slot.recv_ts);
+        last_recv_ts_ = std::max(last_recv_ts_, slot.recv_ts);
+    }
+    if (!sent || !received) {
+        return;
+    }
+
+    if (joined_send_ts_) {
+        int64_t oneway_ns = slot.recv_ts - slot.send_ts - slot.clock_offset;
+        if (oneway_ns < 0) {
+            oneway_negative_++;
+        } else {
+            oneway_.record(static_cast<uint64_t>(oneway_ns));
+            oneway_min_ns_ = std::min(oneway_min_ns_, oneway_ns);
+            if (sender_intended_) {
+                oneway_corrected_.record(static_cast<uint64_t>(std::max<int64_t>(oneway_ns + slot.send_ts - slot.intended_ts, 0)));
+            }
+        }
+    }
+
+
+    // A 0 stamp is missing; retransmitted packets have no single path.
+    if (stages_ && slot.tx_ts > 0 && slot.kernel_rx_ts > 0 && slot.retransmits == 0) {
+        stage_packets_++;
+        bool scheduled = slot.tx_sched_ts > 0;
+        const int64_t stages[STAGE_COUNT] = {
+            slot.tx_sched_ts - slot.send_ts,
+            slot.tx_ts - slot.tx_sched_ts,
+            slot.tx_ts - slot.send_ts,
+            slot.kernel_rx_ts - slot.tx_ts - slot.clock_offset,
+            slot.recv_ts - slot.kernel_rx_ts
+        };
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            if (i < 2 && !scheduled) {
+                continue;
+            }
+            if (stages[i] < 0) {
+                stage_negative_[i]++;
+            } else {
+                stage_latency_[i].record(static_cast<uint64_t>(stages[i]));
+            }
+        }
+    }
+}
+
+void LogAnalyzer::settle_until(uint64_t seq) {
+    if (seq - base_ >= slots_.size()) {
+        for (Slot& slot : slots_) {
+            if (slot.flags) {
+                settle(slot);
+                slot.flags = 0;
+            }
+        }
+    } else {
+        for (uint64_t s = base_; s < seq; ++s) {
+            Slot& slot = slots_[s & mask_];
+            if (slot.flags) {
+                settle(slot);
+                slot.flags = 0;
+            }
+        }
+    }
+    base_ = seq;
+}
+
+void LogAnalyzer::run(LogStream& sender, LogStream& receiver) {
+    sender_intended_ = sender.has(LOG_INTENDED_TS);
+    sender_rtt_ = sender.has(LOG_SEND_TS) && sender.has(LOG_ACK_RECV_TS);
+    joined_send_ts_ = sender.has(LOG_SEND_TS) && receiver.has(LOG_RECV_TS);
+    stages_ = sender.has(LOG_TX_TS) && receiver.has(LOG_KERNEL_RX_TS);
+
+    const LogRow* s = sender.peek();
+    const LogRow* r = receiver.peek();
+    if (!s && !r) {
+        return;
+    }
+    base_ = std::min(s ? s->seq() : UINT64_MAX, r ? r->seq() : UINT64_MAX);
+
+
+    const uint64_t window = slots_.size();
+    for (;;) {
+        uint64_t limit = base_ + window;
+        while ((s = sender.peek()) && s->seq() < limit) {
+            add_sender(*s);
+            sender.pop();
+        }
+        while ((r = receiver.peek()) && r->seq() < limit) {
+            add_receiver(*r);
+            receiver.pop();
+        }
+        if (!s && !r) {
+            settle_until(limit);
+            return;
+        }
+        uint64_t head = std::min(s ? s->seq() : UINT64_MAX, r ? r->seq() : UINT64_MAX);
+        settle_until(std::max(limit, head) - window / 2);
+    }
+}
+
+void LogAnalyzer::print_report() const {
+    if (oneway_negative_ > 0) {
+        std::cout << "Warning: " << oneway_negative_ << " negative one-way samples excluded (clock offset error)\n";
+    }
+    if (late_sender_ + late_receiver_ > 0) {
+        std::cout << "Warning: " << late_sender_ << " sender and " << late_receiver_ << " receiver rows were more than "
+                  << slots_.size() / 2 << " sequences out of order and were not joined (raise --reorder-window)\n";
+    }
+
+    std::cout << std::fixed;
+    std::cout << "\nMessage Statistics:\n";
+    std::cout << "  Total messages sent: " << sent_ << "\n";
+    std::cout << "  Total retransmissions: " << retransmits_ << " (" << std::setprecision(2)
+              << (sent_ > 0 ? retransmits_ * 100.0 / sent_ : 0.0) << "%)\n";
+    std::cout << "  Unique messages received: " << received_ << "\n";
+    std::cout << "  Packet loss rate (unique recv): " << std::setprecision(4)
+              << (sent_ > 0 ? (1.0 - static_cast<double>(received_) / sent_) * 100.0 : 0.0) << "%\n";
+
+    if (oneway_.get_count() > 0) {
+        std::cout << "\nOne-way latency (sender -> receiver):\n";
+        std::cout << "  Samples: " << oneway_.get_count() << "\n";
+        std::cout << "  Min: " << format_latency(oneway_min_ns_ / 1000.0) << "\n";
+        std::cout << "  Median (p50): " << format_latency(oneway_.get_percentile_us(50.0)) << "\n";
+        std::cout << "  Mean: " << format_latency(oneway_.get_mean_us()) << "\n";
+        std::cout << "  p90: " << format_latency(oneway_.get_percentile_us(90.0)) << "\n";
+        std::cout << "  p95: " << format_latency(oneway_.get_percentile_us(95.0)) << "\n";
+        std::cout << "  p99: " << format_latency(oneway_.get_percentile_us(99.0)) << "\n";
+        std::cout << "  p99.9: " << format_latency(oneway_.get_percentile_us(99.9)) << "\n";
+        std::cout << "  Max: " << format_latency(oneway_.get_max_ns() / 1000.0) << "\n";
+    }
+
+    if (oneway_corrected_.get_count() > 0) {
+        std::cout << "\nOne-way latency from intended send time (coordinated omission corrected):\n";
+        std::cout << "  Median (p50): " << format_latency(oneway_corrected_.get_percentile_us(50.0)) << "\n";
+        std::cout << "  p99: " << format_latency(oneway_corrected_.get_percentile_us(99.0)) << "\n";
+        std::cout << "  p99.9: " << format_latency(oneway_corrected_.get_percentile_us(99.9)) << "\n";
+        std::cout << "  Max: " << format_latency(oneway_corrected_.get_max_ns() / 1000.0) << "\n";
+    }
+
+    if (stages_) {
+        std::cout << "\nLatency stages (kernel timestamps):\n";
+        std::cout << "  Packets: " << stage_packets_ << "\n";
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            const LatencyHistogram& stage = stage_latency_[i];
+            if (stage.get_count() == 0) {
+                continue;
+            }
+            std::cout << "  " << STAGE_NAMES[i] << ": p50 " << format_latency(stage.get_percentile_us(50.0))
+                      << ", p99 " << format_latency(stage.get_percentile_us(99.0)) << ", p99.9 "
+                      << format_latency(stage.get_percentile_us(99.9));
+            if (stage_negative_[i] > 0) {
+                std::cout << " (" << stage_negative_[i] << " negative excluded)";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    if (rtt_.get_count() > 0) {
+        std::cout << "\nRTT (sender):\n";
+        std::cout << "  Samples: " << rtt_.get_count() << "\n";
+        std::cout << "  Median (p50): " << format_latency(rtt_.get_percentile_us(50.0)) << "\n";
+        std::cout << "  p99: " << format_latency(rtt_.get_percentile_us(99.0)) << "\n";
+        std::cout << "  Max: " << format_latency(rtt_.get_max_ns() / 1000.0) << "\n";
+        if (rtt_corrected_.get_count() > 0) {
+            std::cout << "  Corrected p99 / p99.9: " << format_latency(rtt_corrected_.get_percentile_us(99.0)) << " / "
+                      << format_latency(rtt_corrected_.get_percentile_us(99.9)) << "\n";
+        }
+    }
+
+    if (received_ > 1 && last_recv_ts_ > first_recv_ts_) {
+        double duration_s = (last_recv_ts_ - first_recv_ts_) / 1e9;
+        std::cout << "\nThroughput:\n";
+        std::cout << "  Average: " << std::setprecision(0) << received_ / duration_s << " msgs/sec\n";
+        std::cout << "  Duration: " << std::setprecision(3) << duration_s << " s\n";
+    }
+}
+
+}
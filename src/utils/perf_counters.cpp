@@ -0,0 +1,252 @@
+#include "udp_benchmark/perf_counters.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace udp_benchmark {
+
+namespace {
+
+struct PerfEventInfo {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+#ifdef __linux__
+const PerfEventInfo PERF_EVENTS[PERF_EVENT_COUNT] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int open_event(const PerfEventInfo& info, bool user_only) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = info.type;
+    attr.config = info.config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = user_only ? 1 : 0;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+double per_packet(const PerfPhase& phase, PerfEvent event) {
+    return phase.packets > 0 ? static_cast<double>(phase.counts.get(event)) / phase.packets : 0.0;
+}
+
+}
+
+
+PerfReading PerfReading::delta_since(const PerfReading& start) const {
+    PerfReading delta;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        delta.values[i] = values[i] - start.values[i];
+    }
+    return delta;
+}
+
+
+PerfCounters::PerfCounters() {
+    std::fill(fds_, fds_ + PERF_EVENT_COUNT, -1);
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+bool PerfCounters::open() {
+    close();
+    user_only_ = false;
+    bool any = false;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        fds_[i] = open_event(PERF_EVENTS[i], false);
+
+
+        // Without kernel counting permission, count user space only.
+        if (fds_[i] < 0 && (errno == EACCES || errno == EPERM)) {
+            fds_[i] = open_event(PERF_EVENTS[i], true);
+            if (fds_[i] >= 0) {
+                user_only_ = true;
+            }
+        }
+        any = any || fds_[i] >= 0;
+    }
+#endif
+    return any;
+}
+
+void PerfCounters::close() {
+    for (int& fd : fds_) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+PerfReading PerfCounters::read() const {
+    PerfReading reading;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        uint64_t data[3];
+        if (fds_[i] < 0 || ::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+        uint64_t enabled = data[1];
+        uint64_t running = data[2];
+        reading.values[i] = running == 0 || running == enabled
+            ? data[0]
+            : static_cast<uint64_t>(static_cast<long double>(data[0]) * enabled / running);
+    }
+    return reading;
+}
+
+std::string PerfCounters::describe() const {
+    std::string names;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] >= 0) {
+            names += (names.empty() ? "" : ", ") + std::string(PERF_EVENTS[i].name);
+        }
+    }
+#endif
+    if (names.empty()) {
+        return "none available";
+    }
+    if (!has_hardware()) {
+        names += " (hardware counters unavailable, software only)";
+    }
+    if (user_only_) {
+        names += " (user space only; lower kernel.perf_event_paranoid to include syscalls)";
+    }
+    return names;
+}
+
+
+bool PerfProfile::open(uint64_t interval_packets) {
+    open_ = counters_.open();
+    interval_packets_ = open_ ? interval_packets : 0;
+    return open_;
+}
+
+void PerfProfile::begin_phase(const char* name) {
+    if (!open_) {
+        return;
+    }
+    end_phase();
+    phase_ = PerfPhase();
+    phase_.name = name;
+    phase_.first_packet = total_packets_;
+    interval_ = PerfPhase();
+    interval_.first_packet = total_packets_;
+    phase_start_ = counters_.read();
+    interval_start_ = phase_start_;
+    in_phase_ = true;
+}
+
+void PerfProfile::end_phase() {
+    if (!in_phase_) {
+        return;
+    }
+    phase_.counts = counters_.read().delta_since(phase_start_);
+    total_packets_ += phase_.packets;
+    phases_.push_back(phase_);
+    in_phase_ = false;
+}
+
+void PerfProfile::close_interval() {
+    if (!in_phase_) {
+        interval_.packets = 0;
+        return;
+    }
+    PerfReading now = counters_.read();
+    interval_.counts = now.delta_since(interval_start_);
+    intervals_.push_back(interval_);
+    interval_start_ = now;
+    interval_.first_packet += interval_.packets;
+    interval_.packets = 0;
+}
+
+void PerfProfile::print_phase(const PerfPhase& phase) const {
+    std::cout << "  " << phase.name << ": " << phase.packets << " packets";
+    if (phase.packets > 0) {
+        if (counters_.has_hardware()) {
+            double cycles = per_packet(phase, PerfEvent::CYCLES);
+            double instructions = per_packet(phase, PerfEvent::INSTRUCTIONS);
+            std::cout << std::setprecision(0) << ", " << cycles << " cycles/packet, " << instructions
+                      << " instructions/packet, IPC " << std::setprecision(2)
+                      << (cycles > 0 ? instructions / cycles : 0.0);
+        }
+        std::cout << std::setprecision(2);
+        if (counters_.has(PerfEvent::CACHE_MISSES)) {
+            std::cout << ", " << per_packet(phase, PerfEvent::CACHE_MISSES) << " cache misses/packet";
+        }
+        if (counters_.has(PerfEvent::BRANCH_MISSES)) {
+            std::cout << ", " << per_packet(phase, PerfEvent::BRANCH_MISSES) << " branch misses/packet";
+        }
+        if (counters_.has(PerfEvent::TASK_CLOCK)) {
+            std::cout << ", " << per_packet(phase, PerfEvent::TASK_CLOCK) / 1000.0 << " μs CPU/packet";
+        }
+    } else if (counters_.has(PerfEvent::TASK_CLOCK)) {
+        std::cout << std::setprecision(2) << ", " << phase.counts.get(PerfEvent::TASK_CLOCK) / 1e6 << " ms CPU";
+    }
+    if (counters_.has(PerfEvent::CONTEXT_SWITCHES)) {
+        std::cout << ", " << phase.counts.get(PerfEvent::CONTEXT_SWITCHES) << " context switches";
+    }
+    if (counters_.has(PerfEvent::PAGE_FAULTS)) {
+        std::cout << ", " << phase.counts.get(PerfEvent::PAGE_FAULTS) << " page faults";
+    }
+    std::cout << "\n";
+}
+
+void PerfProfile::print_summary(const char* title) const {
+    if (!open_) {
+        return;
+    }
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << "  Counters: " << counters_.describe() << "\n";
+    for (const PerfPhase& phase : phases_) {
+        print_phase(phase);
+    }
+    if (intervals_.empty()) {
+        return;
+    }
+
+
+    bool hardware = counters_.has_hardware();
+    PerfEvent event = hardware ? PerfEvent::CYCLES : PerfEvent::TASK_CLOCK;
+    double scale = hardware ? 1.0 : 1e-3;
+    std::vector<std::pair<double, const PerfPhase*>> costs;
+    costs.reserve(intervals_.size());
+    for (const PerfPhase& interval : intervals_) {
+        costs.emplace_back(per_packet(interval, event) * scale, &interval);
+    }
+    std::sort(costs.begin(), costs.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    auto percentile = [&](double p) {
+        return costs[std::min(costs.size() - 1, static_cast<size_t>(p / 100.0 * costs.size()))].first;
+    };
+
+    const PerfPhase& worst = *costs.back().second;
+    std::cout << std::setprecision(hardware ? 0 : 2) << "  Per " << interval_packets_ << " packets ("
+              << costs.size() << " intervals): " << (hardware ? "cycles/packet" : "μs CPU/packet") << " p50 "
+              << percentile(50) << ", p99 " << percentile(99) << ", max " << costs.back().first << " (packets "
+              << worst.first_packet + 1 << "-" << worst.first_packet + worst.packets << ")\n";
+}
+
+}
@@ -0,0 +1,149 @@
+#include "udp_benchmark/rate_sweep.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+
+namespace udp_benchmark {
+
+
+bool SweepConfig::parse(const char* spec, SweepConfig& config) {
+    char* end = nullptr;
+    config.max_rate = std::strtod(spec, &end);
+    if (end == spec || config.max_rate <= 0) {
+        return false;
+    }
+    if (*end == ':') {
+        config.factor = std::strtod(end + 1, &end);
+    }
+    return *end == '\0' && config.factor > 1.0;
+}
+
+
+RateSweep::RateSweep(const SweepConfig& config)
+    : config_(config), current_rate_(config.start_rate) {
+    done_ = current_rate_ <= 0 || current_rate_ > config_.max_rate;
+}
+
+uint64_t RateSweep::get_planned_messages() const {
+    double total = 0;
+    for (double rate = config_.start_rate; rate > 0; rate = std::min(rate * config_.factor, config_.max_rate)) {
+        total += rate * config_.step_ms / 1000.0;
+        if (rate >= config_.max_rate) {
+            break;
+        }
+    }
+    return static_cast<uint64_t>(std::ceil(total));
+}
+
+void RateSweep::record_step(SweepStep step) {
+    step.meets_slo = step.has_data() && (config_.slo_p99_us <= 0 ||
+                                         (step.p99_us <= config_.slo_p99_us && step.losses * 100 <= step.datagrams));
+    steps_.push_back(step);
+
+    if (!step.meets_slo || current_rate_ >= config_.max_rate) {
+        done_ = true;
+        return;
+    }
+    current_rate_ = std::min(current_rate_ * config_.factor, config_.max_rate);
+}
+
+double RateSweep::get_knee_rate() const {
+    double knee = 0;
+    for (const SweepStep& step : steps_) {
+        if (step.meets_slo) {
+            knee = std::max(knee, step.offered_rate);
+        }
+    }
+    return knee;
+}
+
+bool RateSweep::write_results(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open sweep output: " << path << std::endl;
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(2);
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json) {
+        out << "{\n  \"slo_p99_us\": " << config_.slo_p99_us
+            << ",\n  \"knee_rate\": " << get_knee_rate() << ",\n  \"steps\": [\n";
+        for (size_t i = 0; i < steps_.size(); ++i) {
+            const SweepStep& s = steps_[i];
+            out << "    {\"offered_rate\": " << s.offered_rate
+                << ", \"achieved_rate\": " << s.achieved_rate
+                << ", \"sent\": " << s.sent
+                << ", \"datagrams\": " << s.datagrams
+                << ", \"measured\": " << s.measured
+                << ", \"loss_pct\": " << s.get_loss_percent();
+            if (s.has_data()) {
+                out << ", \"p50_us\": " << s.p50_us
+                    << ", \"p99_us\": " << s.p99_us
+                    << ", \"p999_us\": " << s.p999_us
+                    << ", \"p99_corrected_us\": " << s.corrected_p99_us;
+            } else {
+                out << ", \"p50_us\": null, \"p99_us\": null, \"p999_us\": null, \"p99_corrected_us\": null";
+            }
+            out << ", \"cpu_pct\": " << s.cpu_percent
+                << ", \"meets_slo\": " << (s.meets_slo ? "true" : "false") << "}"
+                << (i + 1 < steps_.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    } else {
+        out << "offered_rate,achieved_rate,sent,datagrams,measured,loss_pct,p50_us,p99_us,p999_us,"
+               "p99_corrected_us,cpu_pct,meets_slo\n";
+        for (const SweepStep& s : steps_) {
+            out << s.offered_rate << "," << s.achieved_rate << "," << s.sent << "," << s.datagrams << ","
+                << s.measured << "," << s.get_loss_percent() << ",";
+            if (s.has_data()) {
+                out << s.p50_us << "," << s.p99_us << "," << s.p999_us << "," << s.corrected_p99_us << ",";
+            } else {
+                out << ",,,,";
+            }
+            out << s.cpu_percent << "," << (s.meets_slo ? 1 : 0) << "\n";
+        }
+    }
+    return true;
+}
+
+void RateSweep::print_summary() const {
+    std::cout << "\nRate Sweep (" << config_.step_ms << " ms steps, x" << config_.factor << "):\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  " << std::setw(10) << "offered" << std::setw(10) << "achieved" << std::setw(8) << "loss%"
+              << std::setw(10) << "p50 μs" << std::setw(10) << "p99 μs" << std::setw(11) << "p99.9 μs"
+              << std::setw(11) << "p99co μs" << std::setw(7) << "cpu%" << "\n";
+    for (const SweepStep& s : steps_) {
+        std::cout << "  " << std::setw(10) << s.offered_rate << std::setw(10) << s.achieved_rate
+                  << std::setw(8) << s.get_loss_percent();
+        if (!s.has_data()) {
+            std::cout << std::setw(42) << "no data" << std::setw(7) << s.cpu_percent << "\n";
+            continue;
+        }
+        std::cout << std::setw(10) << s.p50_us << std::setw(10) << s.p99_us << std::setw(11) << s.p999_us
+                  << std::setw(11) << s.corrected_p99_us << std::setw(7) << s.cpu_percent
+                  << (s.meets_slo ? "" : "  SLO miss") << "\n";
+    }
+
+    if (config_.slo_p99_us > 0) {
+        double knee = get_knee_rate();
+        if (knee > 0) {
+            std::cout << "  Highest rate meeting p99 <= " << config_.slo_p99_us << " μs: " << knee << " msgs/sec\n";
+        } else {
+            std::cout << "  No step met p99 <= " << config_.slo_p99_us << " μs\n";
+        }
+    }
+}
+
+double RateSweep::get_cpu_seconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+}
@@ -1,5 +1,7 @@
 #include "udp_benchmark/stats.hpp"
+#include "udp_benchmark/trace.hpp"
 #include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <iomanip>
 #include <thread>
@@ -12,49 +14,131 @@ LatencyLogger::LatencyLogger(const std::string& filename) : filename_(filename)
     if (!file_.is_open()) {
         std::cerr << "Failed to open log file: " << filename_ << std::endl;
     }
+    buffer_.reserve(buffer_limit_ + 128);
 }
 
 LatencyLogger::~LatencyLogger() {
     close();
 }
 
+void LatencyLogger::reserve_buffer(size_t bytes) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    buffer_limit_ = bytes;
+    buffer_.reserve(buffer_limit_ + 128);
+}
+
+void LatencyLogger::append_value(uint64_t value, char separator) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+    buffer_.push_back(separator);
+}
+
+void LatencyLogger::append_value(int64_t value, char separator) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+    buffer_.push_back(separator);
+}
+
+void LatencyLogger::flush_buffer_if_full() {
+    if (buffer_.size() >= buffer_limit_) {
+        UDP_TRACE_SPAN_START(flush_start);
+        file_.write(buffer_.data(), buffer_.size());
+        UDP_TRACE_SPAN(LOG_FLUSH, flush_start, buffer_.size(), 0);
+        buffer_.clear();
+    }
+}
+
 void LatencyLogger::log_sender_data(sequence_t seq, timestamp_t send_ts,
-                                   timestamp_t ack_recv_ts, int retransmits) {
+                                   timestamp_t ack_recv_ts, int retransmits,
+                                   timestamp_t intended_ts, timestamp_t tx_sched_ns,
+                                   timestamp_t tx_ns) {
     std::lock_guard<std::mutex> lock(file_mutex_);
     if (!header_written_) {
         write_sender_header();
         header_written_ = true;
     }
 
-    file_ << seq << "," << send_ts << "," << ack_recv_ts << "," << retransmits << "\n";
+    append_value(seq, ',');
+    append_value(send_ts, ',');
+    append_value(ack_recv_ts, ',');
+    append_value(static_cast<uint64_t>(retransmits), ',');
+    if (kernel_timestamps_) {
+        append_value(intended_ts != 0 ? intended_ts : send_ts, ',');
+        append_value(tx_sched_ns, ',');
+        append_value(tx_ns, '\n');
+    } else {
+        append_value(intended_ts != 0 ? intended_ts : send_ts, '\n');
+    }
+    flush_buffer_if_full();
 }
 
 void LatencyLogger::log_receiver_data(sequence_t seq, timestamp_t recv_ts,
-                                     timestamp_t send_ts) {
+                                     timestamp_t send_ts, int64_t clock_offset_ns,
+                                     timestamp_t intended_ts, timestamp_t kernel_rx_ns) {
     std::lock_guard<std::mutex> lock(file_mutex_);
     if (!header_written_) {
         write_receiver_header();
         header_written_ = true;
     }
 
-    file_ << seq << "," << recv_ts << "," << send_ts << "\n";
+    append_value(seq, ',');
+    append_value(recv_ts, ',');
+    append_value(send_ts, ',');
+    append_value(clock_offset_ns, ',');
+    if (kernel_timestamps_) {
+        append_value(intended_ts != 0 ? intended_ts : send_ts, ',');
+        append_value(kernel_rx_ns, '\n');
+    } else {
+        append_value(intended_ts != 0 ? intended_ts : send_ts, '\n');
+    }
+    flush_buffer_if_full();
+}
+
+void LatencyLogger::log_csv_row(const std::vector<std::string>& values) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    for (size_t i = 0; i < values.size(); ++i) {
+        buffer_ += values[i];
+        buffer_.push_back(i + 1 < values.size() ? ',' : '\n');
+    }
+    flush_buffer_if_full();
+}
+
+void LatencyLogger::write_run_id() {
+    if (run_id_ != 0) {
+        char hex[17];
+        auto result = std::to_chars(hex, hex + sizeof(hex), run_id_, 16);
+        buffer_ += "# run_id=";
+        buffer_.append(hex, result.ptr);
+        buffer_.push_back('\n');
+    }
 }
 
 void LatencyLogger::write_sender_header() {
-    file_ << "seq,send_ts_ns,ack_recv_ts_ns,retransmits\n";
+    write_run_id();
+    buffer_ += kernel_timestamps_ ? "seq,send_ts_ns,ack_recv_ts_ns,retransmits,intended_ts_ns,tx_sched_ts_ns,tx_ts_ns\n"
+                                  : "seq,send_ts_ns,ack_recv_ts_ns,retransmits,intended_ts_ns\n";
 }
 
 void LatencyLogger::write_receiver_header() {
-    file_ << "seq,recv_ts_ns,send_ts_ns\n";
+    write_run_id();
+    buffer_ += kernel_timestamps_ ? "seq,recv_ts_ns,send_ts_ns,clock_offset_ns,intended_ts_ns,kernel_rx_ts_ns\n"
+                                  : "seq,recv_ts_ns,send_ts_ns,clock_offset_ns,intended_ts_ns\n";
 }
 
 void LatencyLogger::flush() {
     std::lock_guard<std::mutex> lock(file_mutex_);
+    UDP_TRACE_SPAN_START(flush_start);
+    file_.write(buffer_.data(), buffer_.size());
     file_.flush();
+    UDP_TRACE_SPAN(LOG_FLUSH, flush_start, buffer_.size(), 0);
+    buffer_.clear();
 }
 
 void LatencyLogger::close() {
     if (file_.is_open()) {
+        flush();
         file_.close();
     }
 }
@@ -63,22 +147,55 @@ void LatencyLogger::close() {
 uint64_t LatencyStats::get_percentile_latency_ns(double percentile) const {
     if (latencies.empty()) return 0;
 
-    std::vector<uint64_t> sorted_latencies = latencies;
-    std::sort(sorted_latencies.begin(), sorted_latencies.end());
-
-    size_t index = static_cast<size_t>(percentile * (sorted_latencies.size() - 1) / 100.0);
-    return sorted_latencies[index];
+    std::vector<uint64_t> partitioned = latencies;
+    size_t index = static_cast<size_t>(percentile * (partitioned.size() - 1) / 100.0);
+    std::nth_element(partitioned.begin(), partitioned.begin() + index, partitioned.end());
+    return partitioned[index];
 }
 
 double LatencyStats::get_percentile_latency_us(double percentile) const {
     return static_cast<double>(get_percentile_latency_ns(percentile)) / 1000.0;
 }
 
+void LatencyStats::print_distribution(const char* title) const {
+    if (latencies.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile_us = [&](double p) {
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) / 100.0);
+        return sorted[index] / 1000.0;
+    };
+
+    std::cout << "\n" << title << ":\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  p50: " << percentile_us(50.0) << " μs, p90: " << percentile_us(90.0)
+              << " μs, p99: " << percentile_us(99.0) << " μs, p99.9: " << percentile_us(99.9)
+              << " μs, p99.99: " << percentile_us(99.99) << " μs\n";
+
+
+    size_t index = 0;
+    for (uint64_t upper_us = 1; index < sorted.size(); upper_us *= 2) {
+        size_t count = 0;
+        while (index < sorted.size() && sorted[index] < upper_us * 1000) {
+            ++count;
+            ++index;
+        }
+        if (count > 0) {
+            double share = count * 100.0 / sorted.size();
+            std::cout << "  < " << std::setw(8) << upper_us << " μs: " << std::setw(10) << count
+                      << " (" << std::setw(6) << share << "%) "
+                      << std::string(static_cast<size_t>(share / 2), '#') << "\n";
+        }
+    }
+}
+
 
 void StatsCollector::start_collection() {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     throughput_stats_.start();
-    last_progress_time_ = get_timestamp_ns();
 }
 
 void StatsCollector::end_collection() {
@@ -86,10 +203,23 @@ void StatsCollector::end_collection() {
     throughput_stats_.end();
 }
 
-void StatsCollector::add_latency_measurement(timestamp_t send_ts, timestamp_t recv_ts) {
+void StatsCollector::reserve(uint64_t expected_packets) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    size_t samples = static_cast<size_t>(std::min<uint64_t>(expected_packets, config::MAX_PREALLOCATED_SAMPLES));
+    latency_stats_.latencies.reserve(samples);
+    corrected_latency_stats_.latencies.reserve(samples);
+}
+
+void StatsCollector::add_latency_measurement(timestamp_t send_ts, timestamp_t recv_ts,
+                                             timestamp_t intended_ts) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    timestamp_t scheduled_ts = intended_ts != 0 && intended_ts < send_ts ? intended_ts : send_ts;
     if (recv_ts > send_ts) {
-        std::lock_guard<std::mutex> lock(stats_mutex_);
         latency_stats_.add_latency(recv_ts - send_ts);
+        corrected_latency_stats_.add_latency(recv_ts - scheduled_ts);
+    } else {
+        // Only possible with unsynchronized clocks or a bad offset estimate.
+        latency_stats_.negative_count++;
     }
 }
 
@@ -110,25 +240,20 @@ LatencyStats StatsCollector::get_latency_stats() const {
     return latency_stats_;
 }
 
-ThroughputStats StatsCollector::get_throughput_stats() const {
+LatencyStats StatsCollector::get_corrected_latency_stats() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
-    return throughput_stats_;
+    return corrected_latency_stats_;
 }
 
-bool StatsCollector::should_report_progress() {
+ThroughputStats StatsCollector::get_throughput_stats() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
-    timestamp_t now = get_timestamp_ns();
-    if (throughput_stats_.packets_received % progress_interval_ == 0 || 
-        (now - last_progress_time_) > 1000000000) {
-        last_progress_time_ = now;
-        return true;
-    }
-    return false;
+    return throughput_stats_;
 }
 
 void StatsCollector::reset() {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     latency_stats_.reset();
+    corrected_latency_stats_.reset();
     throughput_stats_.reset();
 }
 
@@ -146,6 +271,18 @@ void StatsCollector::print_final_summary() const {
         std::cout << "  Max: " << latency_stats_.get_max_latency_us() << " μs\n";
         std::cout << "  p50: " << latency_stats_.get_percentile_latency_us(50.0) << " μs\n";
         std::cout << "  p99: " << latency_stats_.get_percentile_latency_us(99.0) << " μs\n";
+        std::cout << "  p99.9: " << latency_stats_.get_percentile_latency_us(99.9) << " μs\n";
+
+        const LatencyStats& corrected = corrected_latency_stats_;
+        std::cout << "Latency from intended send time (coordinated omission corrected):\n";
+        std::cout << "  Mean: " << corrected.get_mean_latency_us() << " μs\n";
+        std::cout << "  p50: " << corrected.get_percentile_latency_us(50.0) << " μs\n";
+        std::cout << "  p99: " << corrected.get_percentile_latency_us(99.0) << " μs\n";
+        std::cout << "  p99.9: " << corrected.get_percentile_latency_us(99.9) << " μs\n";
+        std::cout << "  Max: " << corrected.get_max_latency_us() << " μs\n";
+    }
+    if (latency_stats_.negative_count > 0) {
+        std::cout << "  Negative one-way samples dropped: " << latency_stats_.negative_count << "\n";
     }
     
     std::cout << "\nThroughput Statistics:\n";
@@ -155,63 +292,89 @@ void StatsCollector::print_final_summary() const {
     std::cout << "  Loss rate: " << (throughput_stats_.get_loss_rate() * 100) << "%\n";
 }
 
-void RateLimiter::wait_for_next_send() {
-    while (!can_send()) {
-        std::this_thread::sleep_for(std::chrono::microseconds(10));
-    }
-    mark_sent();
+void StatsCollector::print_latency_distribution() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    latency_stats_.print_distribution("Latency Distribution");
 }
 
-ProgressReporter::ProgressReporter(uint64_t total_work, uint64_t report_interval) 
-    : total_work_(total_work), report_interval_(report_interval) {
-    start_time_ = get_timestamp_ns();
-    last_report_time_ = start_time_;
-}
+timestamp_t RateLimiter::wait_for_next_send() {
+    if (can_send()) {
+        return mark_sent();
+    }
 
-void ProgressReporter::update(uint64_t completed) {
-    completed_work_ = completed;
+    UDP_TRACE_SPAN_START(wait_start);
+    wait_until_ns(get_next_send_time(), config::PACER_SPIN_US);
+    timestamp_t intended = mark_sent();
+    UDP_TRACE_SPAN(PACER_WAIT, wait_start, get_timestamp_ns() - intended, 0);
+    return intended;
 }
 
-double ProgressReporter::get_progress_percentage() const {
-    return total_work_ > 0 ? (static_cast<double>(completed_work_) * 100.0 / total_work_) : 0.0;
+RateLimiter::RateLimiter(double rate_msgs_per_sec) {
+    set_rate(rate_msgs_per_sec);
 }
 
-void ProgressReporter::print_progress() {
-    timestamp_t now = get_timestamp_ns();
-    double elapsed_sec = static_cast<double>(now - start_time_) / 1e9;
-    double rate = elapsed_sec > 0 ? completed_work_ / elapsed_sec : 0;
-    
-    std::cout << "\rProgress: " << completed_work_ << "/" << total_work_ 
-              << " (" << static_cast<int>(get_progress_percentage()) << "%)"
-              << " Rate: " << static_cast<int>(rate) << " msgs/sec" << std::flush;
-    
-    last_report_time_ = now;
+void RateLimiter::set_rate(double rate_msgs_per_sec) {
+    target_rate_ = rate_msgs_per_sec;
+    interval_ns_ = rate_msgs_per_sec > 0 ? 1e9 / rate_msgs_per_sec : 0;
+    schedule_start_ns_ = 0;
+    scheduled_count_ = 0;
 }
 
-void ProgressReporter::finish() {
-    completed_work_ = total_work_;
-    print_progress();
-    std::cout << "\n";
+void RateLimiter::set_generator(TrafficGenerator* generator) {
+    generator_ = generator;
+    next_event_ = TrafficEvent();
+    if (generator_) {
+        generator_->next(next_event_);
+    }
+    schedule_start_ns_ = 0;
+    scheduled_count_ = 0;
 }
 
-
-RateLimiter::RateLimiter(double rate_msgs_per_sec) {
-    set_rate(rate_msgs_per_sec);
+timestamp_t RateLimiter::get_next_send_time() const {
+    if (schedule_start_ns_ == 0) {
+        return 0;
+    }
+    if (generator_) {
+        return schedule_start_ns_ + next_event_.offset_ns;
+    }
+    if (interval_ns_ <= 0) {
+        return 0;
+    }
+    return schedule_start_ns_ + static_cast<timestamp_t>(scheduled_count_ * interval_ns_);
 }
 
-void RateLimiter::set_rate(double rate_msgs_per_sec) {
-    target_rate_ = rate_msgs_per_sec;
-    interval_us_ = rate_msgs_per_sec > 0 ? 1000000.0 / rate_msgs_per_sec : 0;
+bool RateLimiter::can_send() {
+    return can_send(get_timestamp_ns());
 }
 
-bool RateLimiter::can_send() {
-    timestamp_t now = get_timestamp_ns();
-    timestamp_t elapsed_us = (now - last_send_time_) / 1000;
-    return elapsed_us >= interval_us_;
+timestamp_t RateLimiter::mark_sent() {
+    return mark_sent(get_timestamp_ns());
 }
 
-void RateLimiter::mark_sent() {
-    last_send_time_ = get_timestamp_ns();
+timestamp_t RateLimiter::mark_sent(timestamp_t now) {
+    if (interval_ns_ <= 0 && !generator_) {
+        return now;
+    }
+    if (schedule_start_ns_ == 0) {
+        schedule_start_ns_ = now - next_event_.offset_ns;
+        scheduled_count_ = 0;
+    }
+    timestamp_t scheduled = get_next_send_time();
+    scheduled_count_++;
+
+    timestamp_t max_lag_ns = static_cast<timestamp_t>(config::PACER_MAX_BURST * interval_ns_);
+    if (max_lag_ns > 0 && now > scheduled + max_lag_ns) {
+        timestamp_t skipped = now - scheduled - max_lag_ns;
+        schedule_start_ns_ += skipped;
+        skipped_ns_ += skipped;
+        stalls_++;
+    }
+
+
+    if (generator_) {
+        generator_->next(next_event_);
+    }
+    return scheduled;
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,187 @@
+#include "udp_benchmark/trace.hpp"
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+
+namespace udp_benchmark {
+
+
+bool g_trace_enabled = false;
+
+namespace {
+
+std::mutex g_trace_mutex;
+std::vector<std::unique_ptr<TraceRing>> g_trace_rings;
+std::string g_trace_path;
+size_t g_trace_ring_events = config::TRACE_RING_EVENTS;
+int g_trace_dumps = 0;
+volatile std::sig_atomic_t g_trace_dump_requested = 0;
+thread_local TraceRing* t_trace_ring = nullptr;
+
+void handle_dump_signal(int) {
+    g_trace_dump_requested = 1;
+}
+
+TraceRing* thread_ring() {
+    if (!t_trace_ring) {
+        std::lock_guard<std::mutex> lock(g_trace_mutex);
+        g_trace_rings.push_back(
+            std::make_unique<TraceRing>(g_trace_ring_events, static_cast<uint32_t>(g_trace_rings.size() + 1)));
+        t_trace_ring = g_trace_rings.back().get();
+    }
+    return t_trace_ring;
+}
+
+size_t round_up_pow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+
+struct EventFormat {
+    const char* name;
+    const char* arg0;
+    const char* arg1;
+};
+
+EventFormat event_format(TraceEvent type) {
+    switch (type) {
+        case TraceEvent::SEND: return {"send", "seq", "bytes"};
+        case TraceEvent::RETRANSMIT: return {"retransmit", "seq", "retransmits"};
+        case TraceEvent::ACK_RECV: return {"ack_recv", "ack_seq", "missing"};
+        case TraceEvent::RECV: return {"recv", "seq", "bytes"};
+        case TraceEvent::ACK_SEND: return {"ack_send", "ack_seq", "bytes"};
+        case TraceEvent::CWND: return {"cwnd", "cwnd", nullptr};
+        case TraceEvent::LOSS: return {"loss", "cwnd_before", "cwnd_after"};
+        case TraceEvent::TIMEOUT: return {"timeout", "cwnd_before", "cwnd_after"};
+        case TraceEvent::PACER_WAIT: return {"pacer_wait", "late_ns", nullptr};
+        case TraceEvent::LOG_FLUSH: return {"log_flush", "bytes", nullptr};
+    }
+    return {"unknown", "arg0", "arg1"};
+}
+
+}
+
+
+TraceRing::TraceRing(size_t capacity, uint32_t tid)
+    : records_(round_up_pow2(std::max<size_t>(capacity, 2))), tid_(tid), name_("thread " + std::to_string(tid)) {}
+
+void TraceRing::snapshot(std::vector<TraceRecord>& out) const {
+    size_t capacity = records_.size();
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    size_t start = out.size();
+    for (uint64_t i = first; i < head; ++i) {
+        out.push_back(records_[i & (capacity - 1)]);
+    }
+
+
+    // Records the writer may have overwritten while we copied are dropped.
+    uint64_t after = head_.load(std::memory_order_acquire);
+    uint64_t reused = after > capacity ? after - capacity : 0;
+    if (reused > first) {
+        size_t drop = static_cast<size_t>(std::min(reused - first, head - first));
+        out.erase(out.begin() + start, out.begin() + start + drop);
+    }
+}
+
+
+void Tracer::enable(const std::string& path, size_t ring_events) {
+    g_trace_path = path;
+    g_trace_ring_events = ring_events;
+    g_trace_enabled = true;
+    std::signal(SIGUSR1, handle_dump_signal);
+}
+
+void Tracer::set_thread_name(const char* name) {
+    if (!g_trace_enabled) {
+        return;
+    }
+    TraceRing* ring = thread_ring();
+    std::lock_guard<std::mutex> lock(g_trace_mutex);
+    ring->set_name(name);
+}
+
+void Tracer::record(TraceEvent type, timestamp_t ts_ns, timestamp_t end_ns, uint64_t arg0, uint32_t arg1) {
+    TraceRecord record;
+    record.ts_ns = ts_ns;
+    record.arg0 = arg0;
+    record.arg1 = arg1;
+    record.duration_ns = static_cast<uint32_t>(std::min<timestamp_t>(end_ns - ts_ns, UINT32_MAX));
+    record.type = type;
+    thread_ring()->push(record);
+}
+
+void Tracer::poll() {
+    if (g_trace_dump_requested) {
+        g_trace_dump_requested = 0;
+        write_json(g_trace_path + "." + std::to_string(++g_trace_dumps));
+    }
+}
+
+bool Tracer::dump() {
+    return g_trace_enabled && write_json(g_trace_path);
+}
+
+bool Tracer::write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot write trace " << path << "\n";
+        return false;
+    }
+
+    int pid = static_cast<int>(getpid());
+    std::vector<TraceRecord> records;
+    size_t threads = 0;
+    size_t events = 0;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    std::lock_guard<std::mutex> lock(g_trace_mutex);
+    bool first = true;
+    for (const auto& ring : g_trace_rings) {
+        records.clear();
+        ring->snapshot(records);
+        threads++;
+        events += records.size();
+
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"tid\":" << ring->get_tid() << ",\"args\":{\"name\":\"" << ring->get_name() << "\"}}";
+        first = false;
+
+        for (const TraceRecord& record : records) {
+            EventFormat format = event_format(record.type);
+            out << ",\n{\"name\":\"" << format.name << "\",\"cat\":\"udp\",\"pid\":" << pid
+                << ",\"tid\":" << ring->get_tid() << ",\"ts\":" << static_cast<double>(record.ts_ns) / 1000.0;
+            if (record.type == TraceEvent::CWND) {
+                out << ",\"ph\":\"C\"";
+            } else if (record.duration_ns > 0) {
+                out << ",\"ph\":\"X\",\"dur\":" << static_cast<double>(record.duration_ns) / 1000.0;
+            } else {
+                out << ",\"ph\":\"i\",\"s\":\"t\"";
+            }
+            out << ",\"args\":{\"" << format.arg0 << "\":" << record.arg0;
+            if (format.arg1) {
+                out << ",\"" << format.arg1 << "\":" << record.arg1;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        std::cerr << "Error: cannot write trace " << path << "\n";
+        return false;
+    }
+    std::cout << "Trace: " << events << " events from " << threads << " threads written to " << path << "\n";
+    return true;
+}
+
+}
@@ -0,0 +1,209 @@
+#include "udp_benchmark/traffic.hpp"
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace udp_benchmark {
+
+
+bool TrafficConfig::parse(const std::string& spec, TrafficConfig& config) {
+    if (spec == "constant") {
+        config.pattern = TrafficPattern::CONSTANT;
+        return true;
+    }
+    if (spec == "poisson") {
+        config.pattern = TrafficPattern::POISSON;
+        return true;
+    }
+    if (spec.compare(0, 6, "trace:") == 0 && spec.size() > 6) {
+        config.pattern = TrafficPattern::TRACE;
+        config.trace_path = spec.substr(6);
+        return true;
+    }
+    if (spec.compare(0, 6, "onoff:") == 0) {
+        char* end = nullptr;
+        unsigned long burst = std::strtoul(spec.c_str() + 6, &end, 10);
+        if (*end != ':' || burst == 0) {
+            return false;
+        }
+        const char* gap = end + 1;
+        unsigned long gap_us = std::strtoul(gap, &end, 10);
+        if (end == gap || *end != '\0') {
+            return false;
+        }
+        config.pattern = TrafficPattern::ON_OFF;
+        config.burst = static_cast<uint32_t>(burst);
+        config.gap_us = static_cast<uint32_t>(gap_us);
+        return true;
+    }
+    return false;
+}
+
+std::string TrafficConfig::describe() const {
+    std::ostringstream out;
+    switch (pattern) {
+        case TrafficPattern::CONSTANT:
+            out << "constant";
+            break;
+        case TrafficPattern::POISSON:
+            out << "Poisson arrivals";
+            break;
+        case TrafficPattern::ON_OFF:
+            out << "bursts of " << burst << " messages, " << gap_us << " μs idle between bursts";
+            break;
+        case TrafficPattern::TRACE:
+            out << "trace replay of " << trace_path;
+            break;
+    }
+    if (pattern != TrafficPattern::TRACE && min_size < max_size) {
+        out << ", sizes " << min_size << "-" << max_size << " bytes";
+    }
+    return out.str();
+}
+
+
+std::unique_ptr<TrafficGenerator> TrafficGenerator::create(const TrafficConfig& config) {
+    switch (config.pattern) {
+        case TrafficPattern::POISSON:
+            return std::make_unique<PoissonTraffic>(config);
+        case TrafficPattern::ON_OFF:
+            return std::make_unique<OnOffTraffic>(config);
+        case TrafficPattern::TRACE: {
+            auto trace = std::make_unique<TraceTraffic>();
+            if (!trace->load(config.trace_path, config.max_size)) {
+                return nullptr;
+            }
+            return trace;
+        }
+        case TrafficPattern::CONSTANT:
+            break;
+    }
+    return std::make_unique<ConstantTraffic>(config);
+}
+
+
+MessageSizes::MessageSizes(uint32_t min_size, uint32_t max_size, uint64_t seed)
+    : min_(std::min(min_size, max_size)), max_(max_size), rng_(seed), dist_(min_, max_) {}
+
+
+ConstantTraffic::ConstantTraffic(const TrafficConfig& config)
+    : interval_ns_(config.rate > 0 ? 1e9 / config.rate : 0),
+      sizes_(config.min_size, config.max_size, config.seed) {}
+
+bool ConstantTraffic::next(TrafficEvent& event) {
+    event.offset_ns = static_cast<timestamp_t>(count_++ * interval_ns_);
+    event.size = sizes_.next();
+    return true;
+}
+
+
+PoissonTraffic::PoissonTraffic(const TrafficConfig& config)
+    : rng_(config.seed), gap_ns_(config.rate > 0 ? config.rate / 1e9 : 1.0),
+      sizes_(config.min_size, config.max_size, config.seed + 1) {}
+
+bool PoissonTraffic::next(TrafficEvent& event) {
+    if (started_) {
+        offset_ns_ += gap_ns_(rng_);
+    }
+    started_ = true;
+    event.offset_ns = static_cast<timestamp_t>(offset_ns_);
+    event.size = sizes_.next();
+    return true;
+}
+
+
+OnOffTraffic::OnOffTraffic(const TrafficConfig& config)
+    : interval_ns_(config.rate > 0 ? 1e9 / config.rate : 0),
+      gap_ns_(static_cast<double>(config.gap_us) * 1000),
+      burst_(std::max<uint32_t>(config.burst, 1)),
+      sizes_(config.min_size, config.max_size, config.seed) {}
+
+bool OnOffTraffic::next(TrafficEvent& event) {
+    if (count_ > 0) {
+        offset_ns_ += count_ % burst_ == 0 ? gap_ns_ : interval_ns_;
+    }
+    count_++;
+    event.offset_ns = static_cast<timestamp_t>(offset_ns_);
+    event.size = sizes_.next();
+    return true;
+}
+
+
+bool TraceTraffic::load(const std::string& path, uint32_t max_size) {
+    events_.clear();
+    position_ = 0;
+
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    std::ifstream file(path, csv ? std::ios::in : std::ios::in | std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: cannot open trace " << path << "\n";
+        return false;
+    }
+
+    if (csv) {
+
+        // Lines that do not start with a digit (headers, comments) are skipped.
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] < '0' || line[0] > '9') {
+                continue;
+            }
+            char* end = nullptr;
+            timestamp_t ts = std::strtoull(line.c_str(), &end, 10);
+            uint32_t size = *end == ',' ? static_cast<uint32_t>(std::strtoul(end + 1, nullptr, 10)) : 0;
+            if (!add_event(ts, size, max_size)) {
+                std::cerr << "Error: trace " << path << " line \"" << line << "\" goes back in time or exceeds "
+                          << max_size << " bytes\n";
+                return false;
+            }
+        }
+    } else {
+        uint8_t record[12];
+        while (file.read(reinterpret_cast<char*>(record), sizeof(record))) {
+            uint64_t ts_be;
+            uint32_t size_be;
+            std::memcpy(&ts_be, record, sizeof(ts_be));
+            std::memcpy(&size_be, record + sizeof(ts_be), sizeof(size_be));
+            if (!add_event(be64toh(ts_be), ntohl(size_be), max_size)) {
+                std::cerr << "Error: trace " << path << " record " << events_.size() + 1
+                          << " goes back in time or exceeds " << max_size << " bytes\n";
+                return false;
+            }
+        }
+    }
+
+    if (events_.empty()) {
+        std::cerr << "Error: trace " << path << " holds no messages\n";
+        return false;
+    }
+    return true;
+}
+
+bool TraceTraffic::add_event(timestamp_t ts, uint32_t size, uint32_t max_size) {
+    if (events_.empty()) {
+        trace_start_ns_ = ts;
+    }
+    if (size > max_size || ts < trace_start_ns_ ||
+        (!events_.empty() && ts - trace_start_ns_ < events_.back().offset_ns)) {
+        return false;
+    }
+
+    TrafficEvent event;
+    event.offset_ns = ts - trace_start_ns_;
+    event.size = size == 0 ? max_size : std::max<uint32_t>(size, config::MIN_MESSAGE_SIZE);
+    events_.push_back(event);
+    return true;
+}
+
+bool TraceTraffic::next(TrafficEvent& event) {
+    if (position_ >= events_.size()) {
+        return false;
+    }
+    event = events_[position_++];
+    return true;
+}
+
+}
@@ -0,0 +1,193 @@
+#include "udp_benchmark/fec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace udp_benchmark;
+
+
+// FEC unit cases: the GF(2^8) region kernels against a bitwise reference, and
+// byte-exact recovery from every erasure pattern a code can repair.
+namespace {
+
+// Shift-and-add multiply modulo x^8 + x^4 + x^3 + x^2 + 1.
+uint8_t reference_mul(uint8_t a, uint8_t b) {
+    uint8_t product = 0;
+    while (b != 0) {
+        if (b & 1) {
+            product ^= a;
+        }
+        a = static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1d : 0));
+        b >>= 1;
+    }
+    return product;
+}
+
+// Lengths around the 16- and 32-byte vector widths, so every kernel hands off to the scalar tail.
+const size_t kRegionSizes[] = {0, 1, 2, 7, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 97, 255, 1023, 1473};
+
+bool check_gf() {
+    bool ok = true;
+    for (uint32_t a = 0; a < 256; ++a) {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint8_t expected = reference_mul(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+            if (Gf256::mul(static_cast<uint8_t>(a), static_cast<uint8_t>(b)) != expected) {
+                std::cerr << "mul(" << a << ", " << b << ") != " << static_cast<int>(expected) << "\n";
+                return false;
+            }
+            if (b != 0 && Gf256::div(expected, static_cast<uint8_t>(b)) != a) {
+                std::cerr << "div(" << static_cast<int>(expected) << ", " << b << ") != " << a << "\n";
+                return false;
+            }
+        }
+    }
+
+    std::mt19937_64 rng(11);
+    std::vector<uint8_t> src(1473 + 3);
+    std::vector<uint8_t> dst(1473 + 3);
+    std::vector<uint8_t> expected(1473 + 3);
+    for (size_t size : kRegionSizes) {
+        // Unaligned starts keep the loadu/storeu paths honest.
+        for (size_t offset = 0; offset < 4; ++offset) {
+            for (uint32_t coef = 0; coef < 256; ++coef) {
+                for (size_t i = 0; i < src.size(); ++i) {
+                    src[i] = static_cast<uint8_t>(rng());
+                    dst[i] = static_cast<uint8_t>(rng());
+                }
+                expected = dst;
+                for (size_t i = 0; i < size; ++i) {
+                    expected[offset + i] ^= reference_mul(static_cast<uint8_t>(coef), src[offset + i]);
+                }
+
+                Gf256::mul_add_region(dst.data() + offset, src.data() + offset, static_cast<uint8_t>(coef), size);
+                if (dst != expected) {
+                    std::cerr << Gf256::get_simd_name() << " mul_add_region: coef " << coef << ", size " << size
+                              << ", offset " << offset << " differs from the scalar reference\n";
+                    ok = false;
+                }
+            }
+
+            dst = expected;
+            for (size_t i = 0; i < size; ++i) {
+                expected[offset + i] ^= src[offset + i];
+            }
+            Gf256::xor_region(dst.data() + offset, src.data() + offset, size);
+            if (dst != expected) {
+                std::cerr << "xor_region: size " << size << ", offset " << offset << " differs\n";
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+
+// One block of count data packets with odd, mixed lengths; count < data closes it by flush().
+bool check_block(const FecCode& code, uint32_t count, std::mt19937_64& rng) {
+    std::vector<Packet> data;
+    std::vector<Packet> parity;
+    FecEncoder encoder;
+    encoder.set_code(code);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t size = sizeof(PacketHeader) + (rng() % 1400) * 2 + 1;
+        data.push_back(PacketHandler::create_data_packet(i + 1, 1000 + i, size));
+        for (size_t b = sizeof(PacketHeader); b < size; ++b) {
+            data.back().data()[b] = static_cast<uint8_t>(rng());
+        }
+        encoder.add(i + 1, data.back().data(), data.back().size(), parity);
+    }
+    encoder.flush(parity);
+    if (parity.size() != code.parity) {
+        std::cerr << code.describe() << ": encoder made " << parity.size() << " parity packets\n";
+        return false;
+    }
+
+    // Every subset of at most parity packets among the count + parity sent, by next_permutation.
+    uint32_t sent = count + code.parity;
+    uint64_t patterns = 0;
+    for (uint32_t erased = 0; erased <= code.parity; ++erased) {
+        bool lost[config::FEC_MAX_DATA + config::FEC_MAX_PARITY] = {};
+        std::fill(lost + sent - erased, lost + sent, true);
+        do {
+            FecDecoder decoder;
+            decoder.reset(code);
+            std::vector<Packet> recovered;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!lost[i]) {
+                    decoder.add_data(i + 1, data[i].data(), data[i].size(), recovered);
+                }
+            }
+            for (uint32_t row = 0; row < code.parity; ++row) {
+                if (!lost[count + row]) {
+                    decoder.add_parity(parity[row].data(), parity[row].size(), recovered);
+                }
+            }
+
+            std::string pattern;
+            for (uint32_t i = 0; i < sent; ++i) {
+                if (lost[i]) {
+                    pattern += (i < count ? " d" + std::to_string(i) : " p" + std::to_string(i - count));
+                }
+            }
+
+            size_t next = 0;
+            bool exact = decoder.get_stats().corrupt_blocks == 0;
+            for (uint32_t i = 0; i < count && exact; ++i) {
+                if (lost[i]) {
+                    exact = next < recovered.size() && recovered[next].size() == data[i].size() &&
+                            std::memcmp(recovered[next].data(), data[i].data(), data[i].size()) == 0;
+                    next++;
+                }
+            }
+            if (!exact || next != recovered.size()) {
+                std::cerr << code.describe() << ", " << count << " packets, erased" << pattern
+                          << ": recovered " << recovered.size() << " packets, not byte-exact\n";
+                return false;
+            }
+            patterns++;
+        } while (std::next_permutation(lost, lost + sent));
+    }
+    std::cout << code.data << ":" << code.parity << " with " << count << " packets: " << patterns
+              << " erasure patterns recovered\n";
+    return true;
+}
+
+bool check_recover() {
+    const char* kCodes[] = {"1:1", "4:1", "10:1", "5:3", "10:4", "4:8", "20:3", "64:2"};
+    std::mt19937_64 rng(5);
+    bool ok = true;
+    for (const char* spec : kCodes) {
+        FecCode code;
+        if (!FecCode::parse(spec, code)) {
+            std::cerr << "Error: invalid FEC code " << spec << "\n";
+            return false;
+        }
+        ok = check_block(code, code.data, rng) && ok;
+        if (code.data > 2) {
+            ok = check_block(code, code.data / 2 + 1, rng) && ok;
+        }
+    }
+    return ok;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " gf|recover\n";
+        return 1;
+    }
+
+    if (std::strcmp(argv[1], "gf") == 0) {
+        return check_gf() ? 0 : 1;
+    }
+    if (std::strcmp(argv[1], "recover") == 0) {
+        return check_recover() ? 0 : 1;
+    }
+    std::cerr << "Error: unknown case " << argv[1] << "\n";
+    return 1;
+}
@@ -0,0 +1,134 @@
+#include "udp_benchmark/simulation.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace udp_benchmark;
+
+
+// udp_sim regression cases: fixed seeds, expected digests and upper bounds.
+namespace {
+
+struct SimCase {
+    const char* name;
+    size_t msg_size;
+    double rate;
+    uint64_t total;
+    const char* link;
+    const char* fec;
+    uint64_t seed;
+
+    uint64_t digest;
+    uint64_t max_retransmits;
+    uint64_t max_spurious;
+    uint64_t max_queue_drops;
+    double min_goodput;
+    timestamp_t max_virtual_ns;
+};
+
+const SimCase kCases[] = {
+    // Loss detection on random loss, then on reordering.
+    {"loss", 256, 20000, 40000, "delay=500,loss=2", nullptr, 1,
+     0x31e4eba6ef74d689, 1000, 10, 0, 11000, 3600000000},
+    {"reorder", 256, 20000, 40000, "delay=500,jitter=100,reorder=2,loss=0.5", nullptr, 3,
+     0x1d10d688d2cdb132, 600, 375, 0, 15000, 2700000000},
+    // Paced below a 100 Mbit/s bottleneck, then the README example.
+    {"pacing", 1024, 10000, 50000, "rate=100,delay=500,limit=100", nullptr, 7,
+     0x2f958a911d369bcf, 0, 0, 0, 9900, 5100000000},
+    {"bottleneck", 1024, 10000, 100000, "rate=100,delay=500,limit=100,ge=1:25", nullptr, 7,
+     0xaa972c0ff53de384, 4800, 60, 0, 7000, 14000000000},
+    // A short lossy run, with normal jitter, that ends on tail probes and the FIN.
+    {"drain", 512, 0, 200, "delay=2000,jitter=20,dist=normal,loss=10", nullptr, 5,
+     0x68e092099ca709bc, 45, 5, 0, 0, 40000000},
+    {"fec", 256, 20000, 40000, "delay=500,loss=2", "10:2", 1,
+     0xec53ef58aa6cd006, 30, 10, 0, 19500, 2100000000},
+};
+
+
+bool run_case(const SimCase& c, bool print) {
+    SimConfig sim;
+    sim.msg_size = c.msg_size;
+    sim.rate = c.rate;
+    sim.total = c.total;
+    sim.forward.burst_bytes = 0;
+    if (!ImpairmentConfig::parse(c.link, sim.forward) || (c.fec && !FecCode::parse(c.fec, sim.fec))) {
+        std::cerr << "Error: invalid spec in case " << c.name << "\n";
+        return false;
+    }
+    // As udp_sim sets up the links without --reverse-link.
+    sim.reverse.delay_us = sim.forward.delay_us;
+    sim.reverse.jitter_us = sim.forward.jitter_us;
+    sim.reverse.distribution = sim.forward.distribution;
+    sim.forward.seed = c.seed;
+    sim.reverse.seed = c.seed + 1;
+
+    Simulation simulation(sim);
+    SimResult r = simulation.run();
+
+    if (print) {
+        std::printf("%s: digest=0x%016llx retransmits=%llu spurious=%llu queue_drops=%llu "
+                    "goodput=%.0f virtual_ns=%llu fec_recovered=%llu\n",
+                    c.name, static_cast<unsigned long long>(r.digest),
+                    static_cast<unsigned long long>(r.loss.retransmits),
+                    static_cast<unsigned long long>(r.loss.spurious_retransmits),
+                    static_cast<unsigned long long>(r.forward.queue_drops), r.get_goodput(),
+                    static_cast<unsigned long long>(r.virtual_ns),
+                    static_cast<unsigned long long>(r.fec_received.recovered_packets));
+        return true;
+    }
+
+    bool ok = true;
+    auto check = [&](bool pass, const std::string& what) {
+        if (!pass) {
+            std::cerr << c.name << ": " << what << "\n";
+            ok = false;
+        }
+    };
+    check(r.completed && r.delivered == r.total,
+          "delivered " + std::to_string(r.delivered) + "/" + std::to_string(r.total));
+    check(r.loss.retransmits <= c.max_retransmits,
+          "retransmits " + std::to_string(r.loss.retransmits) + " > " + std::to_string(c.max_retransmits));
+    check(r.loss.spurious_retransmits <= c.max_spurious,
+          "spurious retransmits " + std::to_string(r.loss.spurious_retransmits) + " > " +
+          std::to_string(c.max_spurious));
+    check(r.forward.queue_drops <= c.max_queue_drops,
+          "queue drops " + std::to_string(r.forward.queue_drops) + " > " + std::to_string(c.max_queue_drops));
+    check(r.get_goodput() >= c.min_goodput,
+          "goodput " + std::to_string(r.get_goodput()) + " < " + std::to_string(c.min_goodput));
+    check(r.virtual_ns <= c.max_virtual_ns,
+          "finished at " + std::to_string(r.virtual_ns) + " ns > " + std::to_string(c.max_virtual_ns));
+    if (c.fec) {
+        check(r.fec_received.recovered_packets > 0, "FEC recovered nothing");
+    }
+
+    char digest[32];
+    std::snprintf(digest, sizeof(digest), "0x%016llx", static_cast<unsigned long long>(r.digest));
+    check(r.digest == c.digest, std::string("digest ") + digest);
+    return ok;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <case>|--print\n";
+        return 1;
+    }
+
+    bool print = std::strcmp(argv[1], "--print") == 0;
+    bool found = false;
+    bool ok = true;
+    for (const SimCase& c : kCases) {
+        if (print || std::strcmp(argv[1], c.name) == 0) {
+            found = true;
+            ok = run_case(c, print) && ok;
+        }
+    }
+    if (!found) {
+        std::cerr << "Error: unknown case " << argv[1] << "\n";
+        return 1;
+    }
+    return ok ? 0 : 1;
+}